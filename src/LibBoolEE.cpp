@@ -16,6 +16,8 @@ this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "LibBoolEE.h"
 
+#include <algorithm>
+
 std::vector<std::string> LibBoolEE::singleParse(const std::string & formula, const char op, ErrorReport* errorReport) {
     int start_pos = -1;
     int parity_count = 0;
@@ -145,6 +147,112 @@ bool LibBoolEE::resolveRec(const std::string &source, const Vals & valuation, Er
     }
 }
 
+void LibBoolEE::compile(const std::string &source, const std::vector<std::string> & variables, Program & program, ErrorReport* errorReport) {
+    if (variables.size() > Program::MAX_VARIABLES) {
+        throw std::runtime_error("Too many variables to compile the formula.");
+    }
+    program.code.clear();
+    if (compileRec(removeWhitespaces(source), variables, program, errorReport) > Program::MAX_DEPTH) {
+        throw std::runtime_error("The formula is nested too deep to be compiled.");
+    }
+}
+
+size_t LibBoolEE::compileRec(const std::string &source, const std::vector<std::string> & variables, Program & program, ErrorReport* errorReport) {
+    if (source.empty()) {
+        if (errorReport) {
+            errorReport->type = ErrorReport::ErrorType::EmptySubExpression;
+            errorReport->vecUserData.emplace_back(source);
+            errorReport->strDevData = "bad-txns-null-verifier-empty-sub-expression";
+        }
+        throw std::runtime_error("An empty subexpression was encountered");
+    }
+
+    char current_op = '|';
+    std::vector<std::string> subexpressions = singleParse(source, current_op, errorReport);
+    if (subexpressions.size() == 1) {
+        current_op = '&';
+        subexpressions = singleParse(source, current_op, errorReport);
+    }
+
+    if (subexpressions.size() == 0) {
+        if (errorReport) {
+            errorReport->type = ErrorReport::ErrorType::InvalidQualifierName;
+            errorReport->vecUserData.emplace_back(source);
+            errorReport->strDevData = "bad-txns-null-verifier-no-sub-expressions";
+        }
+        throw std::runtime_error("The subexpression " + source + " is not a valid formula.");
+    }
+    else if (subexpressions.size() == 1) {
+        if (source[0] == '!') {
+            size_t depth = compileRec(source.substr(1), variables, program, errorReport);
+            program.code.push_back({Program::Not, 0});
+            return depth;
+        }
+        else if (source[0] == '(') {
+            return compileRec(source.substr(1, source.size() - 2), variables, program, errorReport);
+        }
+        else if (source == "1") {
+            program.code.push_back({Program::PushTrue, 0});
+            return 1;
+        }
+        else if (source == "0") {
+            program.code.push_back({Program::PushFalse, 0});
+            return 1;
+        }
+        std::vector<std::string>::const_iterator it = std::find(variables.begin(), variables.end(), source);
+        if (it == variables.end()) {
+            if (errorReport) {
+                errorReport->type = ErrorReport::ErrorType::VariableNotFound;
+                errorReport->vecUserData.emplace_back(source);
+                errorReport->strDevData = "bad-txns-null-verifier-variable-not-found";
+            }
+            throw std::runtime_error("Variable '" + source + "' not found in the interpretation.");
+        }
+        program.code.push_back({Program::PushVariable, static_cast<uint8_t>(it - variables.begin())});
+        return 1;
+    }
+    else {
+        // Fold the operands from the left, every operand is compiled so errors surface like in resolveRec
+        const Program::Op op = current_op == '|' ? Program::Or : Program::And;
+        size_t depth = compileRec(subexpressions[0], variables, program, errorReport);
+        for (size_t i = 1; i < subexpressions.size(); i++) {
+            depth = std::max(depth, 1 + compileRec(subexpressions[i], variables, program, errorReport));
+            program.code.push_back({op, 0});
+        }
+        return depth;
+    }
+}
+
+bool LibBoolEE::evaluate(const Program & program, uint64_t valuation) {
+    bool stack[Program::MAX_DEPTH];
+    size_t depth = 0;
+    for (const Program::Instruction & instruction : program.code) {
+        switch (instruction.op) {
+            case Program::PushFalse:
+                stack[depth++] = false;
+                break;
+            case Program::PushTrue:
+                stack[depth++] = true;
+                break;
+            case Program::PushVariable:
+                stack[depth++] = (valuation >> instruction.variable) & 1;
+                break;
+            case Program::Not:
+                stack[depth - 1] = !stack[depth - 1];
+                break;
+            case Program::And:
+                depth--;
+                stack[depth - 1] = stack[depth - 1] && stack[depth];
+                break;
+            case Program::Or:
+                depth--;
+                stack[depth - 1] = stack[depth - 1] || stack[depth];
+                break;
+        }
+    }
+    return depth == 1 && stack[0];
+}
+
 std::string LibBoolEE::trim(const std::string &source) {
     static const std::string WHITESPACES = " \n\r\t\v\f";
     const size_t front = source.find_first_not_of(WHITESPACES);
@@ -34,6 +34,7 @@ this program.  If not, see <http://www.gnu.org/licenses/>.
 #include "assets/assets.h"
 
 #include <map>
+#include <stdint.h>
 #include <string>
 #include <vector>
 #include <utility>
@@ -53,6 +54,25 @@ public:
     // @return new string made from the source by removing removal all character that match the given character
     static std::string removeCharacter(const std::string &source, const char ch);
 
+    /// A formula compiled to postfix form, variables are referred to by their index in the list it was compiled against.
+    struct Program {
+        static const size_t MAX_VARIABLES = 64;
+        static const size_t MAX_DEPTH = 64;
+
+        enum Op : uint8_t { PushFalse, PushTrue, PushVariable, Not, And, Or };
+        struct Instruction {
+            Op op;
+            uint8_t variable;
+        };
+        std::vector<Instruction> code;
+    };
+
+    // Compile the formula. It throws exactly when resolve would throw for a valuation of the given variables.
+    static void compile(const std::string & source, const std::vector<std::string> & variables, Program & program, ErrorReport* errorReport = nullptr);
+
+    // @return	true iff the program is true when the variables with their bit set in valuation are true
+    static bool evaluate(const Program & program, uint64_t valuation);
+
 private:
     static std::vector<std::string> singleParse(const std::string & formula, const char op, ErrorReport* errorReport = nullptr);
 
@@ -62,6 +82,10 @@ private:
     // @return	true iff the formula is true under the valuation (where the valuation are pairs (variable,value))---used internally
     static bool resolveRec(const std::string & source, const Vals & valuation, ErrorReport* errorReport = nullptr);
 
+    // Append the postfix code of the formula, mirroring resolveRec---used internally
+    // @return	the stack depth the code needs
+    static size_t compileRec(const std::string & source, const std::vector<std::string> & variables, Program & program, ErrorReport* errorReport = nullptr);
+
 
     // @return	new string made from the source by removing the leading and trailing white spaces
     static std::string trim(const std::string & source);
@@ -0,0 +1,501 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "addressindexer.h"
+
+#include "assets/assets.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "init.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+#include "warnings.h"
+
+#include <chrono>
+
+std::unique_ptr<CAddressIndexer> g_addressindexer;
+
+//! Blocks the notifications may queue up before the indexer reads them from disk instead
+static const size_t MAX_QUEUED_BLOCKS = 100;
+//! Index entries collected before they are written while catching up
+static const size_t MAX_BATCH_ENTRIES = 200000;
+
+static void FatalError(const std::string& strMessage)
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+/** Same spacing as CChain::GetLocator, but without needing cs_main */
+static CBlockLocator GetLocator(const CBlockIndex* pindex)
+{
+    std::vector<uint256> vHave;
+    int nStep = 1;
+    while (pindex) {
+        vHave.push_back(pindex->GetBlockHash());
+        if (pindex->nHeight == 0)
+            break;
+        pindex = pindex->GetAncestor(std::max(pindex->nHeight - nStep, 0));
+        if (vHave.size() > 10)
+            nStep *= 2;
+    }
+    return CBlockLocator(vHave);
+}
+
+/**
+ * Address type (1 for P2PKH, P2PK and assets, 2 for P2SH, 0 when not indexed),
+ * address hash, asset and amount of an output as they are stored in the indexes.
+ */
+static int GetIndexedAddress(const CTxOut& out, const Coin* pcoin, uint160& hashBytes, std::string& assetName, CAmount& amount)
+{
+    const CScript& script = out.scriptPubKey;
+    assetName = YERB;
+    amount = out.nValue;
+
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+2, script.begin()+22));
+        return 2;
+    }
+    if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin()+3, script.begin()+23));
+        return 1;
+    }
+    if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin()+1, script.end()-1);
+        return 1;
+    }
+
+    hashBytes.SetNull();
+    if (pcoin ? ParseAssetScript(*pcoin, hashBytes, assetName, amount) : ParseAssetScript(script, hashBytes, assetName, amount))
+        return 1;
+
+    hashBytes.SetNull();
+    assetName = YERB;
+    amount = out.nValue;
+    return 0;
+}
+
+CAddressIndexer::CAddressIndexer(bool fAddressIndexIn, bool fSpentIndexIn, bool fTimestampIndexIn) :
+    fAddressIndex(fAddressIndexIn),
+    fSpentIndex(fSpentIndexIn),
+    fTimestampIndex(fTimestampIndexIn),
+    pindexBest(nullptr),
+    fSynced(false),
+    fStopping(false)
+{
+}
+
+CAddressIndexer::~CAddressIndexer()
+{
+    Stop();
+}
+
+bool CAddressIndexer::Init()
+{
+    AssertLockHeld(cs_main);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pindexBest = nullptr;
+    fSynced = false;
+
+    CBlockLocator locator;
+    if (pblocktree->ReadAddressIndexerBestBlock(locator) && !locator.IsNull()) {
+        BlockMap::iterator mi = mapBlockIndex.find(locator.vHave[0]);
+        if (mi != mapBlockIndex.end()) {
+            pindexBest = mi->second;
+        } else {
+            // The blocks above the last known ancestor can't be read back to disconnect them,
+            // start over rather than keeping their entries
+            LogPrintf("%s: address indexer best block %s is unknown, rebuilding the indexes\n", __func__, locator.vHave[0].ToString());
+            if (!pblocktree->EraseAddressIndexes())
+                return error("%s: failed to reset the address indexer", __func__);
+        }
+    }
+
+    LogPrintf("%s: address indexer at height %d\n", __func__, pindexBest ? pindexBest->nHeight : -1);
+    return true;
+}
+
+void CAddressIndexer::Start()
+{
+    RegisterValidationInterface(this);
+    threadIndexer = std::thread(&TraceThread<std::function<void()> >, "addridx", std::function<void()>(std::bind(&CAddressIndexer::ThreadSync, this)));
+}
+
+void CAddressIndexer::Stop()
+{
+    if (!threadIndexer.joinable())
+        return;
+
+    UnregisterValidationInterface(this);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStopping = true;
+    }
+    cond.notify_all();
+    threadIndexer.join();
+}
+
+bool CAddressIndexer::IsSynced() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return fSynced;
+}
+
+const CBlockIndex* CAddressIndexer::GetBestBlock() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pindexBest;
+}
+
+bool CAddressIndexer::BlockUntilSyncedToCurrentChain() const
+{
+    // The indexer may need cs_main to process the blocks waited for
+    AssertLockNotHeld(cs_main);
+
+    while (true) {
+        const CBlockIndex* pindexTip;
+        {
+            LOCK(cs_main);
+            pindexTip = chainActive.Tip();
+        }
+
+        // Every block up to pindexTip is queued by now, none of them needs cs_main to be processed
+        std::unique_lock<std::mutex> lock(mutex);
+        bool fDone = cond.wait_for(lock, std::chrono::seconds(1), [this, pindexTip] {
+            return !fSynced || fStopping || !pindexTip || (pindexBest && pindexBest->GetAncestor(pindexTip->nHeight) == pindexTip);
+        });
+        if (fDone)
+            return fSynced;
+        // pindexTip may have been reorged away in the meantime, wait for the new tip instead
+    }
+}
+
+void CAddressIndexer::Enqueue(BlockJob&& job)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (fSynced) {
+            if (queueJobs.size() < MAX_QUEUED_BLOCKS) {
+                queueJobs.push_back(std::move(job));
+            } else {
+                // Too far behind to keep the blocks in memory, read them from disk instead
+                LogPrint(BCLog::BENCHMARK, "%s: %u blocks queued, catching up from disk\n", __func__, queueJobs.size());
+                fSynced = false;
+                queueJobs.clear();
+            }
+        }
+    }
+    cond.notify_all();
+}
+
+void CAddressIndexer::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
+{
+    AssertLockHeld(cs_main);
+    Enqueue(BlockJob{pindex, pblock, CDiskBlockPos(), pindex->GetUndoPos(), true});
+}
+
+void CAddressIndexer::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected)
+{
+    AssertLockHeld(cs_main);
+    Enqueue(BlockJob{pindexDisconnected, pblock, CDiskBlockPos(), pindexDisconnected->GetUndoPos(), false});
+}
+
+bool CAddressIndexer::ProcessBlock(const BlockJob& job, std::vector<CAddressIndexerUpdate>& vUpdates)
+{
+    const CBlockIndex* pindex = job.pindex;
+
+    // The genesis block's transactions are never connected
+    if (!pindex->pprev)
+        return true;
+
+    std::shared_ptr<const CBlock> pblock = job.pblock;
+    if (!pblock) {
+        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+        if (job.blockPos.IsNull() || !ReadBlockFromDisk(*pblockRead, job.blockPos, pindex->GetBlockHash(), Params().GetConsensus()))
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        pblock = pblockRead;
+    }
+    const CBlock& block = *pblock;
+
+    CBlockUndo blockUndo;
+    if (job.undoPos.IsNull() || !UndoReadFromDisk(blockUndo, job.undoPos, pindex->pprev->GetBlockHash()))
+        return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+    if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block %s and undo data inconsistent", __func__, pindex->GetBlockHash().ToString());
+
+    vUpdates.emplace_back();
+    CAddressIndexerUpdate& update = vUpdates.back();
+    const int nHeight = pindex->nHeight;
+    uint160 hashBytes;
+    std::string assetName;
+    CAmount amount;
+
+    if (job.fConnect) {
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256 txhash = tx.GetHash();
+
+            if (!tx.IsCoinBase()) {
+                const CTxUndo& txundo = blockUndo.vtxundo[i-1];
+                if (txundo.vprevout.size() != tx.vin.size())
+                    return error("%s: transaction %s and undo data inconsistent", __func__, txhash.ToString());
+
+                for (unsigned int j = 0; j < tx.vin.size(); j++) {
+                    const COutPoint& prevout = tx.vin[j].prevout;
+                    const Coin& coin = txundo.vprevout[j];
+                    int addressType = GetIndexedAddress(coin.out, &coin, hashBytes, assetName, amount);
+
+                    if (fAddressIndex && addressType > 0) {
+                        // record spending activity
+                        update.vAddressIndex.emplace_back(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, j, true), amount * -1);
+
+                        // remove address from unspent index
+                        update.vAddressUnspentIndex.emplace_back(CAddressUnspentKey(addressType, hashBytes, assetName, prevout.hash, prevout.n), CAddressUnspentValue());
+                    }
+
+                    if (fSpentIndex) {
+                        // add the spent index to determine the txid and input that spent an output
+                        // and to find the amount and address from an input
+                        update.vSpentIndex.emplace_back(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue(txhash, j, nHeight, coin.out.nValue, addressType, hashBytes));
+                    }
+                }
+            }
+
+            if (fAddressIndex) {
+                for (unsigned int k = 0; k < tx.vout.size(); k++) {
+                    const CTxOut& out = tx.vout[k];
+                    int addressType = GetIndexedAddress(out, nullptr, hashBytes, assetName, amount);
+                    if (addressType == 0)
+                        continue;
+
+                    // record receiving activity
+                    update.vAddressIndex.emplace_back(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, k, false), amount);
+
+                    // record unspent output
+                    update.vAddressUnspentIndex.emplace_back(CAddressUnspentKey(addressType, hashBytes, assetName, txhash, k), CAddressUnspentValue(amount, out.scriptPubKey, nHeight));
+                }
+            }
+        }
+
+        if (fTimestampIndex)
+            update.vTimestampIndex.emplace_back(pindex->nTime, pindex->GetBlockHash());
+    } else {
+        // Undo in reverse order, so outputs spent in the same block end up erased
+        update.fEraseAddressIndex = true;
+        for (int i = block.vtx.size() - 1; i >= 0; i--) {
+            const CTransaction& tx = *block.vtx[i];
+            const uint256 txhash = tx.GetHash();
+
+            if (fAddressIndex) {
+                for (unsigned int k = tx.vout.size(); k-- > 0;) {
+                    int addressType = GetIndexedAddress(tx.vout[k], nullptr, hashBytes, assetName, amount);
+                    if (addressType == 0)
+                        continue;
+
+                    // undo receiving activity
+                    update.vAddressIndex.emplace_back(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, k, false), amount);
+
+                    // undo unspent index
+                    update.vAddressUnspentIndex.emplace_back(CAddressUnspentKey(addressType, hashBytes, assetName, txhash, k), CAddressUnspentValue());
+                }
+            }
+
+            if (!tx.IsCoinBase()) {
+                const CTxUndo& txundo = blockUndo.vtxundo[i-1];
+                if (txundo.vprevout.size() != tx.vin.size())
+                    return error("%s: transaction %s and undo data inconsistent", __func__, txhash.ToString());
+
+                for (unsigned int j = tx.vin.size(); j-- > 0;) {
+                    const COutPoint& prevout = tx.vin[j].prevout;
+                    const Coin& coin = txundo.vprevout[j];
+                    int addressType = GetIndexedAddress(coin.out, &coin, hashBytes, assetName, amount);
+
+                    if (fAddressIndex && addressType > 0) {
+                        // undo spending activity
+                        update.vAddressIndex.emplace_back(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, j, true), amount * -1);
+
+                        // restore unspent index
+                        update.vAddressUnspentIndex.emplace_back(CAddressUnspentKey(addressType, hashBytes, assetName, prevout.hash, prevout.n), CAddressUnspentValue(amount, coin.out.scriptPubKey, coin.nHeight));
+                    }
+
+                    if (fSpentIndex) {
+                        // undo and delete the spent index
+                        update.vSpentIndex.emplace_back(CSpentIndexKey(prevout.hash, prevout.n), CSpentIndexValue());
+                    }
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+bool CAddressIndexer::WriteUpdates(std::vector<CAddressIndexerUpdate>& vUpdates, const CBlockIndex* pindexNewBest)
+{
+    if (!pblocktree->WriteAddressIndexerUpdates(vUpdates, GetLocator(pindexNewBest))) {
+        FatalError("Failed to write address index");
+        return false;
+    }
+    vUpdates.clear();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pindexBest = pindexNewBest;
+    }
+    cond.notify_all();
+    return true;
+}
+
+void CAddressIndexer::ThreadSync()
+{
+    std::vector<CAddressIndexerUpdate> vUpdates;
+    size_t nEntries = 0;
+    //! Last block processed, vUpdates holds the changes since pindexWritten
+    const CBlockIndex* pindexLast = GetBestBlock();
+    const CBlockIndex* pindexWritten = pindexLast;
+    int64_t nLastLog = 0;
+
+    while (!fStopping) {
+        BlockJob job;
+        bool fQueued;
+        bool fFlush = false;
+        bool fWait = false;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            fQueued = fSynced;
+            if (fQueued) {
+                cond.wait(lock, [this] { return fStopping || !fSynced || !queueJobs.empty(); });
+                if (fStopping || !fSynced)
+                    continue;
+                job = std::move(queueJobs.front());
+                queueJobs.pop_front();
+
+                if (job.fConnect ? job.pindex->pprev != pindexLast : job.pindex != pindexLast) {
+                    LogPrintf("%s: block %s does not follow the indexed chain, catching up from disk\n", __func__, job.pindex->GetBlockHash().ToString());
+                    fSynced = false;
+                    queueJobs.clear();
+                    // Release BlockUntilSyncedToCurrentChain callers, the block they wait for may never come
+                    cond.notify_all();
+                    continue;
+                }
+            }
+        }
+
+        if (!fQueued) {
+            // Catch up with the active chain, one block at a time
+            LOCK(cs_main);
+            if (pindexLast && !chainActive.Contains(pindexLast)) {
+                const CBlockIndex* pindexTip = chainActive.Tip();
+                if (!pindexTip || pindexLast->GetAncestor(pindexTip->nHeight) == pindexTip) {
+                    // The chain is still being (re)connected up to what was indexed before
+                    fWait = true;
+                } else {
+                    job = BlockJob{pindexLast, nullptr, pindexLast->GetBlockPos(), pindexLast->GetUndoPos(), false};
+                }
+            } else {
+                const CBlockIndex* pindexNext = pindexLast ? chainActive.Next(pindexLast) : chainActive.Genesis();
+                if (pindexNext) {
+                    job = BlockJob{pindexNext, nullptr, pindexNext->GetBlockPos(), pindexNext->GetUndoPos(), true};
+                } else if (pindexLast != pindexWritten) {
+                    fFlush = true;
+                } else {
+                    // Caught up, the notifications take over while cs_main is still held
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fSynced = true;
+                    LogPrintf("%s: address indexer synced to height %d\n", __func__, pindexLast ? pindexLast->nHeight : -1);
+                    continue;
+                }
+            }
+        }
+
+        if (fFlush || fWait) {
+            if (pindexLast != pindexWritten) {
+                if (!WriteUpdates(vUpdates, pindexLast))
+                    return;
+                pindexWritten = pindexLast;
+                nEntries = 0;
+            }
+            if (fWait) {
+                std::unique_lock<std::mutex> lock(mutex);
+                cond.wait_for(lock, std::chrono::seconds(1));
+            }
+            continue;
+        }
+
+        size_t nUpdates = vUpdates.size();
+        if (!ProcessBlock(job, vUpdates)) {
+            FatalError(strprintf("Failed to index block %s", job.pindex->GetBlockHash().ToString()));
+            return;
+        }
+        pindexLast = job.fConnect ? job.pindex : job.pindex->pprev;
+        if (vUpdates.size() > nUpdates)
+            nEntries += vUpdates.back().Count();
+
+        bool fWrite = nEntries >= MAX_BATCH_ENTRIES;
+        if (fQueued) {
+            std::lock_guard<std::mutex> lock(mutex);
+            fWrite |= queueJobs.empty();
+        }
+        if (fWrite) {
+            if (!WriteUpdates(vUpdates, pindexLast))
+                return;
+            pindexWritten = pindexLast;
+            nEntries = 0;
+        }
+
+        if (!fQueued && GetTime() - nLastLog >= 30) {
+            LogPrintf("%s: address indexer at height %d\n", __func__, pindexLast ? pindexLast->nHeight : -1);
+            nLastLog = GetTime();
+        }
+    }
+
+    if (pindexLast != pindexWritten)
+        WriteUpdates(vUpdates, pindexLast);
+}
+
+bool InitAddressIndexer()
+{
+    AssertLockHeld(cs_main);
+
+    // fAddressIndex, fSpentIndex and fTimestampIndex were loaded from the block tree DB
+    bool fAddressIndexArg = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+    bool fSpentIndexArg = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+    bool fTimestampIndexArg = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+    bool fWasIndexing = fAddressIndex || fSpentIndex || fTimestampIndex;
+    bool fNewIndex = (fAddressIndexArg && !fAddressIndex) || (fSpentIndexArg && !fSpentIndex) || (fTimestampIndexArg && !fTimestampIndex);
+
+    CBlockLocator locator;
+    bool fHaveBestBlock = pblocktree->ReadAddressIndexerBestBlock(locator);
+    if (fNewIndex) {
+        // The newly enabled index has to be built from the start, the others are rebuilt along with it
+        if (!pblocktree->EraseAddressIndexes())
+            return error("%s: failed to reset the address indexer", __func__);
+    } else if (fWasIndexing && !fHaveBestBlock && chainActive.Tip()) {
+        // Indexes written by ConnectBlock in older versions are at the chain tip
+        if (!pblocktree->WriteAddressIndexerUpdates(std::vector<CAddressIndexerUpdate>(), chainActive.GetLocator()))
+            return error("%s: failed to write the address indexer best block", __func__);
+    }
+
+    fAddressIndex = fAddressIndexArg;
+    fSpentIndex = fSpentIndexArg;
+    fTimestampIndex = fTimestampIndexArg;
+    if (!pblocktree->WriteFlag("addressindex", fAddressIndex) ||
+        !pblocktree->WriteFlag("spentindex", fSpentIndex) ||
+        !pblocktree->WriteFlag("timestampindex", fTimestampIndex))
+        return error("%s: failed to write the index flags", __func__);
+
+    g_addressindexer.reset();
+    if (!fAddressIndex && !fSpentIndex && !fTimestampIndex)
+        return true;
+
+    g_addressindexer.reset(new CAddressIndexer(fAddressIndex, fSpentIndex, fTimestampIndex));
+    return g_addressindexer->Init();
+}
@@ -0,0 +1,103 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YERB_ADDRESSINDEXER_H
+#define YERB_ADDRESSINDEXER_H
+
+#include "chain.h"
+#include "validationinterface.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+struct CAddressIndexerUpdate;
+
+/**
+ * Maintains the address, spent and timestamp indexes (-addressindex,
+ * -spentindex, -timestampindex) in a background thread instead of inside
+ * ConnectBlock.
+ *
+ * The indexer keeps its own best block in the block tree DB, updated in the
+ * same batch as the index entries. On start it first catches up with the
+ * active chain by reading blocks and undo data from disk, rewinding blocks
+ * that were reorged away. Once it has reached the tip it follows the
+ * BlockConnected / BlockDisconnected notifications, falling back to catching
+ * up from disk whenever it gets too far behind.
+ */
+class CAddressIndexer : public CValidationInterface
+{
+private:
+    struct BlockJob
+    {
+        const CBlockIndex* pindex;
+        std::shared_ptr<const CBlock> pblock;
+        //! Copied from pindex under cs_main, blockPos is only used without pblock
+        CDiskBlockPos blockPos;
+        CDiskBlockPos undoPos;
+        bool fConnect;
+    };
+
+    const bool fAddressIndex;
+    const bool fSpentIndex;
+    const bool fTimestampIndex;
+
+    mutable std::mutex mutex;
+    mutable std::condition_variable cond;
+    /** Last block whose changes are in the indexes, protected by mutex */
+    const CBlockIndex* pindexBest;
+    /** Whether notifications are queued, set with cs_main held as well, protected by mutex */
+    bool fSynced;
+    /** Blocks connected and disconnected since fSynced was set, protected by mutex */
+    std::deque<BlockJob> queueJobs;
+    std::atomic<bool> fStopping;
+    std::thread threadIndexer;
+
+    void ThreadSync();
+    /** Read the block from disk if needed and add its index changes to vUpdates */
+    bool ProcessBlock(const BlockJob& job, std::vector<CAddressIndexerUpdate>& vUpdates);
+    bool WriteUpdates(std::vector<CAddressIndexerUpdate>& vUpdates, const CBlockIndex* pindexNewBest);
+    void Enqueue(BlockJob&& job);
+
+protected:
+    // CValidationInterface
+    void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindexDisconnected) override;
+
+public:
+    CAddressIndexer(bool fAddressIndexIn, bool fSpentIndexIn, bool fTimestampIndexIn);
+    ~CAddressIndexer();
+
+    /**
+     * Load the best block of the indexer, starting over when an index was
+     * turned on since the last run. Requires cs_main and a loaded chain.
+     */
+    bool Init();
+    void Start();
+    void Stop();
+
+    /** Whether the indexer caught up with the active chain and follows it */
+    bool IsSynced() const;
+    const CBlockIndex* GetBestBlock() const;
+    /**
+     * Once the indexer caught up, wait until it processed the current tip.
+     * Returns false without waiting while it is still catching up. Must not
+     * be called with cs_main held.
+     */
+    bool BlockUntilSyncedToCurrentChain() const;
+};
+
+/** The running indexer, or nullptr when all of these indexes are off */
+extern std::unique_ptr<CAddressIndexer> g_addressindexer;
+
+/**
+ * Switch the indexes to the -addressindex, -spentindex and -timestampindex
+ * settings, creating g_addressindexer when any of them is on.
+ */
+bool InitAddressIndexer();
+
+#endif // YERB_ADDRESSINDEXER_H
@@ -10,33 +10,130 @@
 #include "assets.h"
 #include "validation.h"
 
+#include <boost/optional.hpp>
 #include <boost/thread.hpp>
 
+#include <algorithm>
+#include <limits>
+
 static const char ASSET_FLAG = 'A';
 static const char ASSET_ADDRESS_QUANTITY_FLAG = 'B';
 static const char ADDRESS_ASSET_QUANTITY_FLAG = 'C';
 static const char MY_ASSET_FLAG = 'M';
 static const char BLOCK_ASSET_UNDO_DATA = 'U';
 static const char MEMPOOL_REISSUED_TX = 'Z';
+static const char ASSET_HOLDER_COUNT_FLAG = 'H';
+static const char ASSET_HOLDER_COUNTS_BUILT = 'h';
 
 static size_t MAX_DATABASE_RESULTS = 50000;
 
-CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe) {
+CAssetsDB::CAssetsDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "assets", nCacheSize, fMemory, fWipe), fHolderCounts(false) {
+}
+
+template<typename K>
+static CDataStream SerializeKeyPrefix(const K& prefix)
+{
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << prefix;
+    return ssPrefix;
+}
+
+bool CAssetsDB::HasAssetAddressQuantity(const std::string& assetName, const std::string& address)
+{
+    auto it = mapPendingAddressQuantities.find(std::make_pair(assetName, address));
+    if (it != mapPendingAddressQuantities.end())
+        return it->second;
+    return Exists(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+}
+
+bool CAssetsDB::ReadAssetHolderCount(const std::string& assetName, int64_t& count)
+{
+    auto it = mapPendingHolderCounts.find(assetName);
+    if (it != mapPendingHolderCounts.end()) {
+        count = it->second;
+        return true;
+    }
+
+    count = 0;
+    if (!Exists(std::make_pair(ASSET_HOLDER_COUNT_FLAG, assetName)))
+        return true;
+    return Read(std::make_pair(ASSET_HOLDER_COUNT_FLAG, assetName), count);
+}
+
+void CAssetsDB::WriteAssetHolderCount(CDBBatch& batch, const std::string& assetName, int64_t count)
+{
+    if (count > 0)
+        batch.Write(std::make_pair(ASSET_HOLDER_COUNT_FLAG, assetName), count);
+    else
+        batch.Erase(std::make_pair(ASSET_HOLDER_COUNT_FLAG, assetName));
+}
+
+bool CAssetsDB::UpdateAssetHolderCount(const std::string& assetName, int64_t count)
+{
+    mapPendingHolderCounts[assetName] = count;
+    if (count > 0)
+        return BatchWrite(std::make_pair(ASSET_HOLDER_COUNT_FLAG, assetName), count);
+    return BatchErase(std::make_pair(ASSET_HOLDER_COUNT_FLAG, assetName));
+}
+
+void CAssetsDB::BeginBatch(size_t nMaxBatchSizeIn)
+{
+    CDBWrapper::BeginBatch(nMaxBatchSizeIn);
+    mapPendingAddressQuantities.clear();
+    mapPendingHolderCounts.clear();
+
+    // Like the chainstate head blocks, a partial write leaves a mark. Here it makes the counts get rebuilt.
+    if (fHolderCounts)
+        BatchErase(ASSET_HOLDER_COUNTS_BUILT);
+}
+
+bool CAssetsDB::CommitBatch(bool fSync)
+{
+    if (fHolderCounts)
+        BatchWrite(ASSET_HOLDER_COUNTS_BUILT, true);
+
+    mapPendingAddressQuantities.clear();
+    mapPendingHolderCounts.clear();
+    return CDBWrapper::CommitBatch(fSync);
+}
+
+void CAssetsDB::AbortBatch()
+{
+    mapPendingAddressQuantities.clear();
+    mapPendingHolderCounts.clear();
+    CDBWrapper::AbortBatch();
 }
 
 bool CAssetsDB::WriteAssetData(const CNewAsset &asset, const int nHeight, const uint256& blockHash)
 {
     CDatabasedAssetData data(asset, nHeight, blockHash);
-    return Write(std::make_pair(ASSET_FLAG, asset.strName), data);
+    return BatchWrite(std::make_pair(ASSET_FLAG, asset.strName), data);
 }
 
 bool CAssetsDB::WriteAssetAddressQuantity(const std::string &assetName, const std::string &address, const CAmount &quantity)
 {
-    return Write(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)), quantity);
+    auto key = std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address));
+    if (HasAssetAddressQuantity(assetName, address))
+        return BatchWrite(key, quantity);
+
+    // A new holder of the asset, count it in the same batch
+    int64_t count;
+    if (!ReadAssetHolderCount(assetName, count))
+        return false;
+    bool fOwnBatch = !IsBatching();
+    if (fOwnBatch)
+        BeginBatch(std::numeric_limits<size_t>::max());
+    mapPendingAddressQuantities[key.second] = true;
+    if (!BatchWrite(key, quantity) || !UpdateAssetHolderCount(assetName, count + 1)) {
+        if (fOwnBatch)
+            AbortBatch();
+        return false;
+    }
+    return !fOwnBatch || CommitBatch();
 }
 
 bool CAssetsDB::WriteAddressAssetQuantity(const std::string &address, const std::string &assetName, const CAmount& quantity) {
-    return Write(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)), quantity);
+    return BatchWrite(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)), quantity);
 }
 
 bool CAssetsDB::ReadAssetData(const std::string& strName, CNewAsset& asset, int& nHeight, uint256& blockHash)
@@ -65,7 +162,7 @@ bool CAssetsDB::ReadAddressAssetQuantity(const std::string &address, const std::
 
 bool CAssetsDB::EraseAssetData(const std::string& assetName)
 {
-    return Erase(std::make_pair(ASSET_FLAG, assetName));
+    return BatchErase(std::make_pair(ASSET_FLAG, assetName));
 }
 
 bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
@@ -74,15 +171,29 @@ bool CAssetsDB::EraseMyAssetData(const std::string& assetName)
 }
 
 bool CAssetsDB::EraseAssetAddressQuantity(const std::string &assetName, const std::string &address) {
-    return Erase(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address)));
+    auto key = std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, address));
+    if (!HasAssetAddressQuantity(assetName, address))
+        return true;
+
+    int64_t count;
+    if (!ReadAssetHolderCount(assetName, count))
+        return false;
+    bool fOwnBatch = !IsBatching();
+    if (fOwnBatch)
+        BeginBatch(std::numeric_limits<size_t>::max());
+    mapPendingAddressQuantities[key.second] = false;
+    if (!BatchErase(key) || !UpdateAssetHolderCount(assetName, count - 1)) {
+        if (fOwnBatch)
+            AbortBatch();
+        return false;
+    }
+    return !fOwnBatch || CommitBatch();
 }
 
 bool CAssetsDB::EraseAddressAssetQuantity(const std::string &address, const std::string &assetName) {
-    return Erase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)));
+    return BatchErase(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, assetName)));
 }
 
-bool EraseAddressAssetQuantity(const std::string &address, const std::string &assetName);
-
 bool CAssetsDB::WriteBlockUndoAssetData(const uint256& blockhash, const std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData)
 {
     return Write(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash), assetUndoData);
@@ -168,17 +279,165 @@ bool CAssetsDB::LoadAssets()
                 break;
             }
         }
+
+        if (!Exists(ASSET_HOLDER_COUNTS_BUILT) && !BuildAssetHolderCounts())
+            return error("%s: failed to build the asset holder counts", __func__);
+        fHolderCounts = true;
     }
 
     return true;
 }
 
+bool CAssetsDB::BuildAssetHolderCounts()
+{
+    LogPrintf("%s: Counting asset holders, this is only done once...\n", __func__);
+
+    // Drop stale counts left by an earlier run without the asset index
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    CDataStream ssCountPrefix = SerializeKeyPrefix(ASSET_HOLDER_COUNT_FLAG);
+    for (pcursor->Seek(ssCountPrefix); pcursor->Valid() && pcursor->KeyHasPrefix(ssCountPrefix); pcursor->Next()) {
+        batch.Erase(pcursor->GetKey());
+    }
+
+    std::string strCurrent;
+    int64_t count = 0;
+    CDataStream ssPrefix = SerializeKeyPrefix(ASSET_ADDRESS_QUANTITY_FLAG);
+    for (pcursor->Seek(ssPrefix); pcursor->Valid() && pcursor->KeyHasPrefix(ssPrefix); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+
+        // Only the asset name is needed, stop deserializing there
+        std::string strName;
+        if (!pcursor->GetKeySuffix(ssPrefix.size(), strName))
+            return error("%s: failed to read asset address key", __func__);
+        if (strName != strCurrent) {
+            WriteAssetHolderCount(batch, strCurrent, count);
+            strCurrent = strName;
+            count = 0;
+        }
+        count++;
+    }
+    WriteAssetHolderCount(batch, strCurrent, count);
+    batch.Write(ASSET_HOLDER_COUNTS_BUILT, true);
+
+    return WriteBatch(batch, true);
+}
+
+// The changes of passets not written to the database yet, by the name following a key prefix, none for erased entries
+template<typename V>
+using PendingEntries = std::vector<std::pair<std::string, boost::optional<V> > >;
+
+// Whether name a comes before name b in the database, which orders the serialized keys
+static bool KeyLess(const std::string& a, const std::string& b)
+{
+    CDataStream ssA(SER_DISK, CLIENT_VERSION), ssB(SER_DISK, CLIENT_VERSION);
+    ssA << a;
+    ssB << b;
+    return std::string(ssA.begin(), ssA.end()) < std::string(ssB.begin(), ssB.end());
+}
+
+template<typename V>
+static PendingEntries<V> SortPending(std::map<std::string, boost::optional<V> >&& mapPending)
+{
+    PendingEntries<V> vPending(std::make_move_iterator(mapPending.begin()), std::make_move_iterator(mapPending.end()));
+    std::sort(vPending.begin(), vPending.end(), [](const std::pair<std::string, boost::optional<V> >& a, const std::pair<std::string, boost::optional<V> >& b) {
+        return KeyLess(a.first, b.first);
+    });
+    return vPending;
+}
+
+// Asset data of passets not written yet, applied in the order of CAssetsCache::WriteCacheToDatabase
+static PendingEntries<CDatabasedAssetData> GetPendingAssetData()
+{
+    AssertLockHeld(cs_main);
+    std::map<std::string, boost::optional<CDatabasedAssetData> > mapPending;
+    if (!passets)
+        return {};
+
+    for (const auto& newAsset : passets->setNewAssetsToRemove)
+        mapPending[newAsset.asset.strName] = boost::none;
+    for (const auto& newAsset : passets->setNewAssetsToAdd)
+        mapPending[newAsset.asset.strName] = CDatabasedAssetData(newAsset.asset, newAsset.blockHeight, newAsset.blockHash);
+    for (const auto& newReissue : passets->setNewReissueToAdd) {
+        auto it = passets->mapReissuedAssetData.find(newReissue.reissue.strName);
+        if (it != passets->mapReissuedAssetData.end())
+            mapPending[it->first] = CDatabasedAssetData(it->second, newReissue.blockHeight, newReissue.blockHash);
+    }
+    for (const auto& undoReissue : passets->setNewReissueToRemove) {
+        if (passets->setNewAssetsToRemove.count(CAssetCacheNewAsset(CNewAsset(undoReissue.reissue.strName, 0), "", 0, uint256())))
+            continue;
+        auto it = passets->mapReissuedAssetData.find(undoReissue.reissue.strName);
+        if (it != passets->mapReissuedAssetData.end())
+            mapPending[it->first] = CDatabasedAssetData(it->second, undoReissue.blockHeight, undoReissue.blockHash);
+    }
+    return SortPending(std::move(mapPending));
+}
+
+// Address quantities of passets not written yet, for one asset (by address) or for one address (by asset)
+static PendingEntries<CAmount> GetPendingQuantities(const std::string& assetName, const std::string& address)
+{
+    AssertLockHeld(cs_main);
+    std::map<std::string, boost::optional<CAmount> > mapPending;
+    if (!passets)
+        return {};
+
+    auto add = [&mapPending](const std::string& name, CAmount amount) {
+        mapPending[name] = amount > 0 ? boost::optional<CAmount>(amount) : boost::none;
+    };
+    const auto& mapAmounts = passets->mapAssetsAddressAmount;
+    if (!assetName.empty()) {
+        for (auto it = mapAmounts.lower_bound(std::make_pair(assetName, std::string())); it != mapAmounts.end() && it->first.first == assetName; ++it)
+            add(it->first.second, it->second);
+    } else {
+        for (const auto& pair : mapAmounts) {
+            if (pair.first.second == address)
+                add(pair.first.first, pair.second);
+        }
+    }
+    return SortPending(std::move(mapPending));
+}
+
+// Walk the names following ssPrefix in database order, with vPending applied over the database. func
+// gets the pending value, or nullptr when the value is the one under the cursor, and returns false to
+// stop the walk.
+template<typename V>
+static bool WalkWithPending(CDBIterator& cursor, const CDataStream& ssPrefix, const PendingEntries<V>& vPending, const std::function<bool(const std::string&, const V*)>& func)
+{
+    auto itPending = vPending.begin();
+    std::string strName;
+    for (cursor.Seek(ssPrefix);;) {
+        boost::this_thread::interruption_point();
+
+        bool fCursor = cursor.Valid() && cursor.KeyHasPrefix(ssPrefix);
+        if (fCursor && !cursor.GetKeySuffix(ssPrefix.size(), strName))
+            return false;
+        if (itPending == vPending.end() || (fCursor && KeyLess(strName, itPending->first))) {
+            if (!fCursor || !func(strName, nullptr))
+                return true;
+            cursor.Next();
+            continue;
+        }
+
+        if (fCursor && strName == itPending->first)
+            cursor.Next();
+        const auto& entry = *itPending++;
+        if (entry.second && !func(entry.first, entry.second.get_ptr()))
+            return true;
+    }
+}
+
+static bool MatchesFilter(const std::string& name, const std::string& prefix, bool wildcard)
+{
+    return prefix == "" || (wildcard && name.find(prefix) == 0) || (!wildcard && name == prefix);
+}
+
 bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start)
 {
-    FlushStateToDisk();
+    // The assets not flushed yet are taken from passets
+    PendingEntries<CDatabasedAssetData> vPending = GetPendingAssetData();
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ASSET_FLAG, std::string()));
+    CDataStream ssFlag = SerializeKeyPrefix(ASSET_FLAG);
 
     auto prefix = filter;
     bool wildcard = prefix.back() == '*';
@@ -192,76 +451,103 @@ bool CAssetsDB::AssetDir(std::vector<CDatabasedAssetData>& assets, const std::st
     else {
         // compute table size for backwards offset
         long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
-
-            std::pair<char, std::string> key;
-            if (pcursor->GetKey(key) && key.first == ASSET_FLAG) {
-                if (prefix == "" ||
-                    (wildcard && key.second.find(prefix) == 0) ||
-                    (!wildcard && key.second == prefix)) {
-                    table_size += 1;
-                }
-            }
-            pcursor->Next();
-        }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
+        bool fOk = WalkWithPending<CDatabasedAssetData>(*pcursor, ssFlag, vPending, [&](const std::string& name, const CDatabasedAssetData*) {
+            if (MatchesFilter(name, prefix, wildcard))
+                table_size += 1;
+            return true;
+        });
+        if (!fOk)
+            return error("%s: failed to read asset key", __func__);
+        skip = std::max(table_size + start, 0L);
     }
 
-
     size_t loaded = 0;
     size_t offset = 0;
+    bool fValueOk = true;
 
     // Load assets
-    while (pcursor->Valid() && loaded < count) {
-        boost::this_thread::interruption_point();
-
-        std::pair<char, std::string> key;
-        if (pcursor->GetKey(key) && key.first == ASSET_FLAG) {
-            if (prefix == "" ||
-                    (wildcard && key.second.find(prefix) == 0) ||
-                    (!wildcard && key.second == prefix)) {
-                if (offset < skip) {
-                    offset += 1;
-                }
-                else {
-                    CDatabasedAssetData data;
-                    if (pcursor->GetValue(data)) {
-                        assets.push_back(data);
-                        loaded += 1;
-                    } else {
-                        return error("%s: failed to read asset", __func__);
-                    }
-                }
-            }
-            pcursor->Next();
-        } else {
-            break;
+    bool fOk = WalkWithPending<CDatabasedAssetData>(*pcursor, ssFlag, vPending, [&](const std::string& name, const CDatabasedAssetData* pdata) {
+        if (loaded >= count)
+            return false;
+        if (!MatchesFilter(name, prefix, wildcard))
+            return true;
+        if (offset < skip) {
+            offset += 1;
+            return true;
         }
-    }
+        CDatabasedAssetData data;
+        if (pdata) {
+            data = *pdata;
+        } else if (!pcursor->GetValue(data)) {
+            fValueOk = false;
+            return false;
+        }
+        assets.push_back(data);
+        loaded += 1;
+        return true;
+    });
+    if (!fOk || !fValueOk)
+        return error("%s: failed to read asset", __func__);
 
     return true;
 }
 
+// Number of entries following ssPrefix, with the pending ones applied
+static bool CountWithPending(CDBIterator& cursor, const CDataStream& ssPrefix, const PendingEntries<CAmount>& vPending, long& count)
+{
+    count = 0;
+    return WalkWithPending<CAmount>(cursor, ssPrefix, vPending, [&count](const std::string&, const CAmount*) {
+        count++;
+        return true;
+    });
+}
+
+// Page through the (name, quantity) entries keyed by ssPrefix followed by the name, with the pending ones applied
+static bool ReadQuantitiesWithPending(CDBIterator& cursor, const CDataStream& ssPrefix, const PendingEntries<CAmount>& vPending, const size_t skip, const size_t count, std::vector<std::pair<std::string, CAmount> >& vecNameAmount)
+{
+    size_t loaded = 0;
+    size_t offset = 0;
+    bool fValueOk = true;
+
+    bool fOk = WalkWithPending<CAmount>(cursor, ssPrefix, vPending, [&](const std::string& name, const CAmount* pamount) {
+        if (loaded >= count || loaded >= MAX_DATABASE_RESULTS)
+            return false;
+        if (offset < skip) {
+            offset += 1;
+            return true;
+        }
+
+        CAmount amount;
+        if (pamount) {
+            amount = *pamount;
+        } else if (!cursor.GetValue(amount)) {
+            fValueOk = false;
+            return false;
+        }
+        vecNameAmount.emplace_back(name, amount);
+        loaded += 1;
+        return true;
+    });
+
+    return fOk && fValueOk;
+}
+
 bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start)
 {
-    FlushStateToDisk();
+    // The quantities not flushed yet are taken from passets
+    PendingEntries<CAmount> vPending = GetPendingQuantities("", address);
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, std::make_pair(address, std::string())));
+    CDataStream ssPrefix = SerializeKeyPrefix(std::make_pair(ADDRESS_ASSET_QUANTITY_FLAG, address));
 
-    if (fGetTotal) {
-        totalEntries = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
+    long table_size = 0;
+    if (fGetTotal || start < 0) {
+        if (!CountWithPending(*pcursor, ssPrefix, vPending, table_size))
+            return error("%s: failed to count Address Asset Quanity", __func__);
+    }
 
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                totalEntries++;
-            }
-            pcursor->Next();
-        }
+    if (fGetTotal) {
+        totalEntries = table_size;
         return true;
     }
 
@@ -270,48 +556,11 @@ bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAss
         skip = start;
     }
     else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
-
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                table_size += 1;
-            }
-            pcursor->Next();
-        }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
+        skip = std::max(table_size + start, 0L);
     }
 
-
-    size_t loaded = 0;
-    size_t offset = 0;
-
-    // Load assets
-    while (pcursor->Valid() && loaded < count && loaded < MAX_DATABASE_RESULTS) {
-        boost::this_thread::interruption_point();
-
-        std::pair<char, std::pair<std::string, std::string> > key;
-        if (pcursor->GetKey(key) && key.first == ADDRESS_ASSET_QUANTITY_FLAG && key.second.first == address) {
-                if (offset < skip) {
-                    offset += 1;
-                }
-                else {
-                    CAmount amount;
-                    if (pcursor->GetValue(amount)) {
-                        vecAssetAmount.emplace_back(std::make_pair(key.second.second, amount));
-                        loaded += 1;
-                    } else {
-                        return error("%s: failed to Address Asset Quanity", __func__);
-                    }
-                }
-            pcursor->Next();
-        } else {
-            break;
-        }
-    }
+    if (!ReadQuantitiesWithPending(*pcursor, ssPrefix, vPending, skip, count, vecAssetAmount))
+        return error("%s: failed to Address Asset Quanity", __func__);
 
     return true;
 }
@@ -319,22 +568,34 @@ bool CAssetsDB::AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAss
 // Can get to total count of addresses that belong to a certain asset_name, or get you the list of all address that belong to a certain asset_name
 bool CAssetsDB::AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& assetName, const size_t count, const long start)
 {
-    FlushStateToDisk();
+    // The quantities not flushed yet are taken from passets
+    PendingEntries<CAmount> vPending = GetPendingQuantities(assetName, "");
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
-    pcursor->Seek(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, std::make_pair(assetName, std::string())));
-
-    if (fGetTotal) {
-        totalEntries = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
-
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-                totalEntries += 1;
+    CDataStream ssPrefix = SerializeKeyPrefix(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, assetName));
+
+    long table_size = 0;
+    if (fGetTotal || start < 0) {
+        if (fHolderCounts) {
+            int64_t holders;
+            if (!ReadAssetHolderCount(assetName, holders))
+                return error("%s: failed to read the holder count of %s", __func__, assetName);
+            table_size = holders;
+            // Holders gained or lost since the last flush
+            for (const auto& entry : vPending) {
+                bool fInDB = HasAssetAddressQuantity(assetName, entry.first);
+                if (entry.second && !fInDB)
+                    table_size++;
+                else if (!entry.second && fInDB)
+                    table_size--;
             }
-            pcursor->Next();
+        } else if (!CountWithPending(*pcursor, ssPrefix, vPending, table_size)) {
+            return error("%s: failed to count Asset Address Quanity", __func__);
         }
+    }
+
+    if (fGetTotal) {
+        totalEntries = table_size;
         return true;
     }
 
@@ -343,48 +604,39 @@ bool CAssetsDB::AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& v
         skip = start;
     }
     else {
-        // compute table size for backwards offset
-        long table_size = 0;
-        while (pcursor->Valid()) {
-            boost::this_thread::interruption_point();
-
-            std::pair<char, std::pair<std::string, std::string> > key;
-            if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-                table_size += 1;
-            }
-            pcursor->Next();
-        }
-        skip = table_size + start;
-        pcursor->SeekToFirst();
+        skip = std::max(table_size + start, 0L);
     }
 
-    size_t loaded = 0;
-    size_t offset = 0;
+    if (!ReadQuantitiesWithPending(*pcursor, ssPrefix, vPending, skip, count, vecAddressAmount))
+        return error("%s: failed to Asset Address Quanity", __func__);
 
-    // Load assets
-    while (pcursor->Valid() && loaded < count && loaded < MAX_DATABASE_RESULTS) {
-        boost::this_thread::interruption_point();
+    return true;
+}
 
-        std::pair<char, std::pair<std::string, std::string> > key;
-        if (pcursor->GetKey(key) && key.first == ASSET_ADDRESS_QUANTITY_FLAG && key.second.first == assetName) {
-            if (offset < skip) {
-                offset += 1;
-            }
-            else {
-                CAmount amount;
-                if (pcursor->GetValue(amount)) {
-                    vecAddressAmount.emplace_back(std::make_pair(key.second.second, amount));
-                    loaded += 1;
-                } else {
-                    return error("%s: failed to Asset Address Quanity", __func__);
-                }
-            }
-            pcursor->Next();
-        } else {
-            break;
+bool CAssetsDB::ReadAssetAddressQuantities(const CDBSnapshot& snapshot, const std::string& assetName, const size_t nChunkSize, const std::function<bool(std::vector<std::pair<std::string, CAmount> >&)>& func)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator(snapshot));
+    CDataStream ssPrefix = SerializeKeyPrefix(std::make_pair(ASSET_ADDRESS_QUANTITY_FLAG, assetName));
+
+    std::vector<std::pair<std::string, CAmount> > vecAddressAmount;
+    vecAddressAmount.reserve(nChunkSize);
+    for (pcursor->Seek(ssPrefix); pcursor->Valid() && pcursor->KeyHasPrefix(ssPrefix); pcursor->Next()) {
+        std::string address;
+        CAmount amount;
+        if (!pcursor->GetKeySuffix(ssPrefix.size(), address) || !pcursor->GetValue(amount))
+            return error("%s: failed to read an address quantity of %s", __func__, assetName);
+        vecAddressAmount.emplace_back(std::move(address), amount);
+
+        if (vecAddressAmount.size() >= nChunkSize) {
+            if (!func(vecAddressAmount))
+                return false;
+            vecAddressAmount.clear();
         }
     }
 
+    if (!vecAddressAmount.empty() && !func(vecAddressAmount))
+        return false;
+
     return true;
 }
 
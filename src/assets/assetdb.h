@@ -9,6 +9,7 @@
 #include "serialize.h"
 
 #include <string>
+#include <functional>
 #include <map>
 #include <dbwrapper.h>
 
@@ -59,12 +60,32 @@ struct CBlockAssetUndo
 /** Access to the block database (blocks/index/) */
 class CAssetsDB : public CDBWrapper
 {
+private:
+    /** Whether the per-asset holder counts cover the whole asset address index */
+    bool fHolderCounts;
+
+    /** Asset address balances written (true) or erased (false) in the pending batch */
+    std::map<std::pair<std::string, std::string>, bool> mapPendingAddressQuantities;
+    /** Holder counts changed in the pending batch */
+    std::map<std::string, int64_t> mapPendingHolderCounts;
+
+    bool HasAssetAddressQuantity(const std::string& assetName, const std::string& address);
+    bool ReadAssetHolderCount(const std::string& assetName, int64_t& count);
+    void WriteAssetHolderCount(CDBBatch& batch, const std::string& assetName, int64_t count);
+    bool UpdateAssetHolderCount(const std::string& assetName, int64_t count);
+    bool BuildAssetHolderCounts();
+
 public:
     explicit CAssetsDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
 
     CAssetsDB(const CAssetsDB&) = delete;
     CAssetsDB& operator=(const CAssetsDB&) = delete;
 
+    // Batched writes, see CDBWrapper::BeginBatch. A flush interrupted between partial batches makes the holder counts get rebuilt on the next start
+    void BeginBatch(size_t nMaxBatchSizeIn);
+    bool CommitBatch(bool fSync = false);
+    void AbortBatch();
+
     // Write to database functions
     bool WriteAssetData(const CNewAsset& asset, const int nHeight, const uint256& blockHash);
     bool WriteAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount& quantity);
@@ -90,8 +111,13 @@ public:
     bool AssetDir(std::vector<CDatabasedAssetData>& assets, const std::string filter, const size_t count, const long start);
     bool AssetDir(std::vector<CDatabasedAssetData>& assets);
 
+    // The directory functions apply the changes of passets not flushed yet over the database, cs_main must be held
     bool AddressDir(std::vector<std::pair<std::string, CAmount> >& vecAssetAmount, int& totalEntries, const bool& fGetTotal, const std::string& address, const size_t count, const long start);
     bool AssetAddressDir(std::vector<std::pair<std::string, CAmount> >& vecAddressAmount, int& totalEntries, const bool& fGetTotal, const std::string& assetName, const size_t count, const long start);
+
+    // Read every (address, quantity) of an asset from a database snapshot in one pass, handing them to func
+    // in address order and in chunks of up to nChunkSize. Stops early and fails if func returns false.
+    bool ReadAssetAddressQuantities(const CDBSnapshot& snapshot, const std::string& assetName, const size_t nChunkSize, const std::function<bool(std::vector<std::pair<std::string, CAmount> >&)>& func);
 };
 
 
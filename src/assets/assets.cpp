@@ -31,6 +31,7 @@
 #include "LibBoolEE.h"
 #include <spork.h>
 #include "core_io.h"
+#include "txdb.h"
 
 #define SIX_MONTHS 15780000 // Six months worth of seconds
 
@@ -1598,46 +1599,22 @@ void CAssetsCache::AddToAssetBalance(const std::string& strName, const std::stri
     }
 }
 
-bool CAssetsCache::TrySpendCoin(const COutPoint& out, const CTxOut& txOut)
+bool CAssetsCache::TrySpendCoin(const COutPoint& out, const Coin& coin)
 {
-    // Placeholder strings that will get set if you successfully get the transfer or asset from the script
+    // If it isn't an asset tx return true, we only fail if an error occurs
+    if (!coin.assetOutput)
+        return true;
+
+    // Placeholder strings that will get set if you successfully got the transfer or asset from the script
     std::string address = "";
     std::string assetName = "";
     CAmount nAmount = -1;
 
-    // Get the asset tx data
-    int nType = -1;
-    bool fIsOwner = false;
-    if (txOut.scriptPubKey.IsAssetScript(nType, fIsOwner)) {
-
-        // Get the New Asset or Transfer Asset from the scriptPubKey
-        if (nType == TX_NEW_ASSET && !fIsOwner) {
-            CNewAsset asset;
-            if (AssetFromScript(txOut.scriptPubKey, asset, address)) {
-                assetName = asset.strName;
-                nAmount = asset.nAmount;
-            }
-        } else if (nType == TX_TRANSFER_ASSET) {
-            CAssetTransfer transfer;
-            if (TransferAssetFromScript(txOut.scriptPubKey, transfer, address)) {
-                assetName = transfer.strName;
-                nAmount = transfer.nAmount;
-            }
-        } else if (nType == TX_NEW_ASSET && fIsOwner) {
-            if (!OwnerAssetFromScript(txOut.scriptPubKey, assetName, address))
-                return error("%s : ERROR Failed to get owner asset from the OutPoint: %s", __func__,
-                             out.ToString());
-            nAmount = OWNER_ASSET_AMOUNT;
-        } else if (nType == TX_REISSUE_ASSET) {
-            CReissueAsset reissue;
-            if (ReissueAssetFromScript(txOut.scriptPubKey, reissue, address)) {
-                assetName = reissue.strName;
-                nAmount = reissue.nAmount;
-            }
-        }
-    } else {
-        // If it isn't an asset tx return true, we only fail if an error occurs
-        return true;
+    const CAssetOutputData& assetOutput = *coin.assetOutput;
+    if (assetOutput.fValid) {
+        address = assetOutput.strAddress;
+        assetName = assetOutput.assetName;
+        nAmount = assetOutput.nAmount;
     }
 
     // If we got the address and the assetName, proceed to remove it from the database, and in memory objects
@@ -1679,48 +1656,15 @@ bool CAssetsCache::UndoAssetCoin(const Coin& coin, const COutPoint& out)
     std::string assetName = "";
     CAmount nAmount = 0;
 
-    // Get the asset tx from the script
-    int nType = -1;
-    bool fIsOwner = false;
-    if(coin.out.scriptPubKey.IsAssetScript(nType, fIsOwner)) {
+    // Get the asset tx from the decoded script
+    if (coin.assetOutput) {
+        if (!coin.assetOutput->fValid)
+            return error("%s : Failed to get asset from script while trying to undo asset spend. OutPoint : %s",
+                         __func__, out.ToString());
 
-        if (nType == TX_NEW_ASSET && !fIsOwner) {
-            CNewAsset asset;
-            if (!AssetFromScript(coin.out.scriptPubKey, asset, strAddress)) {
-                return error("%s : Failed to get asset from script while trying to undo asset spend. OutPoint : %s",
-                             __func__,
-                             out.ToString());
-            }
-            assetName = asset.strName;
-
-            nAmount = asset.nAmount;
-        } else if (nType == TX_TRANSFER_ASSET) {
-            CAssetTransfer transfer;
-            if (!TransferAssetFromScript(coin.out.scriptPubKey, transfer, strAddress))
-                return error(
-                        "%s : Failed to get transfer asset from script while trying to undo asset spend. OutPoint : %s",
-                        __func__,
-                        out.ToString());
-
-            assetName = transfer.strName;
-            nAmount = transfer.nAmount;
-        } else if (nType == TX_NEW_ASSET && fIsOwner) {
-            std::string ownerName;
-            if (!OwnerAssetFromScript(coin.out.scriptPubKey, ownerName, strAddress))
-                return error(
-                        "%s : Failed to get owner asset from script while trying to undo asset spend. OutPoint : %s",
-                        __func__, out.ToString());
-            assetName = ownerName;
-            nAmount = OWNER_ASSET_AMOUNT;
-        } else if (nType == TX_REISSUE_ASSET) {
-            CReissueAsset reissue;
-            if (!ReissueAssetFromScript(coin.out.scriptPubKey, reissue, strAddress))
-                return error(
-                        "%s : Failed to get reissue asset from script while trying to undo asset spend. OutPoint : %s",
-                        __func__, out.ToString());
-            assetName = reissue.strName;
-            nAmount = reissue.nAmount;
-        }
+        strAddress = coin.assetOutput->strAddress;
+        assetName = coin.assetOutput->assetName;
+        nAmount = coin.assetOutput->nAmount;
     }
 
     if (assetName == "" || strAddress == "" || nAmount == 0)
@@ -2171,6 +2115,46 @@ bool CAssetsCache::RemoveRestrictedVerifier(const std::string& assetName, const
 }
 
 bool CAssetsCache::DumpCacheToDatabase()
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    // Send all of the writes through one batch per database, split up like the chainstate flush
+    size_t nBatchSize = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    passetsdb->BeginBatch(nBatchSize);
+    prestricteddb->BeginBatch(nBatchSize);
+
+    if (!WriteCacheToDatabase()) {
+        passetsdb->AbortBatch();
+        prestricteddb->AbortBatch();
+        return false;
+    }
+    int64_t nTimeWrite = GetTimeMicros();
+
+    try {
+        if (!passetsdb->CommitBatch(true)) {
+            prestricteddb->AbortBatch();
+            return error("%s : Failed to write the asset database batch", __func__);
+        }
+        int64_t nTimeAssets = GetTimeMicros();
+        if (!prestricteddb->CommitBatch(true))
+            return error("%s : Failed to write the restricted asset database batch", __func__);
+        int64_t nTimeRestricted = GetTimeMicros();
+
+        LogPrint(BCLog::BENCHMARK, "    - Dump asset cache: %.2fms (collect %.2fms, asset db %.2fms, restricted db %.2fms)\n",
+                 (nTimeRestricted - nTimeStart) * 0.001, (nTimeWrite - nTimeStart) * 0.001,
+                 (nTimeAssets - nTimeWrite) * 0.001, (nTimeRestricted - nTimeAssets) * 0.001);
+    } catch (const std::runtime_error& e) {
+        passetsdb->AbortBatch();
+        prestricteddb->AbortBatch();
+        return error("%s : %s ", __func__, std::string("System error while flushing assets: ") + e.what());
+    }
+
+    ClearDirtyCache();
+
+    return true;
+}
+
+bool CAssetsCache::WriteCacheToDatabase()
 {
     try {
         bool dirty = false;
@@ -2703,190 +2687,195 @@ bool CAssetsCache::DumpCacheToDatabase()
             }
         }
 
-        ClearDirtyCache();
-
         return true;
     } catch (const std::runtime_error& e) {
         return error("%s : %s ", __func__, std::string("System error while flushing assets: ") + e.what());
     }
 }
 
-// This function will put all current cache data into the global passets cache.
+CAssetsCache* CAssetsCache::GetBase() const
+{
+    if (this == passets)
+        return nullptr;
+    return pBase ? pBase : passets;
+}
+
+// This function will put all current cache data into the base cache, the global passets cache by default.
 //! Do not call this function on the passets pointer
 bool CAssetsCache::Flush()
 {
-
-    if (!passets)
-        return error("%s: Couldn't find passets pointer while trying to flush assets cache", __func__);
+    CAssetsCache* base = GetBase();
+    if (!base)
+        return error("%s: Couldn't find the base cache while trying to flush assets cache", __func__);
 
     try {
         for (auto &item : setNewAssetsToAdd) {
-            if (passets->setNewAssetsToRemove.count(item))
-                passets->setNewAssetsToRemove.erase(item);
-            passets->setNewAssetsToAdd.insert(item);
+            if (base->setNewAssetsToRemove.count(item))
+                base->setNewAssetsToRemove.erase(item);
+            base->setNewAssetsToAdd.insert(item);
         }
 
         for (auto &item : setNewAssetsToRemove) {
-            if (passets->setNewAssetsToAdd.count(item))
-                passets->setNewAssetsToAdd.erase(item);
-            passets->setNewAssetsToRemove.insert(item);
+            if (base->setNewAssetsToAdd.count(item))
+                base->setNewAssetsToAdd.erase(item);
+            base->setNewAssetsToRemove.insert(item);
         }
 
         for (auto &item : mapAssetsAddressAmount)
-            passets->mapAssetsAddressAmount[item.first] = item.second;
+            base->mapAssetsAddressAmount[item.first] = item.second;
 
         for (auto &item : mapReissuedAssetData)
-            passets->mapReissuedAssetData[item.first] = item.second;
+            base->mapReissuedAssetData[item.first] = item.second;
 
         for (auto &item : setNewOwnerAssetsToAdd) {
-            if (passets->setNewOwnerAssetsToRemove.count(item))
-                passets->setNewOwnerAssetsToRemove.erase(item);
-            passets->setNewOwnerAssetsToAdd.insert(item);
+            if (base->setNewOwnerAssetsToRemove.count(item))
+                base->setNewOwnerAssetsToRemove.erase(item);
+            base->setNewOwnerAssetsToAdd.insert(item);
         }
 
         for (auto &item : setNewOwnerAssetsToRemove) {
-            if (passets->setNewOwnerAssetsToAdd.count(item))
-                passets->setNewOwnerAssetsToAdd.erase(item);
-            passets->setNewOwnerAssetsToRemove.insert(item);
+            if (base->setNewOwnerAssetsToAdd.count(item))
+                base->setNewOwnerAssetsToAdd.erase(item);
+            base->setNewOwnerAssetsToRemove.insert(item);
         }
 
         for (auto &item : setNewReissueToAdd) {
-            if (passets->setNewReissueToRemove.count(item))
-                passets->setNewReissueToRemove.erase(item);
-            passets->setNewReissueToAdd.insert(item);
+            if (base->setNewReissueToRemove.count(item))
+                base->setNewReissueToRemove.erase(item);
+            base->setNewReissueToAdd.insert(item);
         }
 
         for (auto &item : setNewReissueToRemove) {
-            if (passets->setNewReissueToAdd.count(item))
-                passets->setNewReissueToAdd.erase(item);
-            passets->setNewReissueToRemove.insert(item);
+            if (base->setNewReissueToAdd.count(item))
+                base->setNewReissueToAdd.erase(item);
+            base->setNewReissueToRemove.insert(item);
         }
 
         for (auto &item : setNewTransferAssetsToAdd) {
-            if (passets->setNewTransferAssetsToRemove.count(item))
-                passets->setNewTransferAssetsToRemove.erase(item);
-            passets->setNewTransferAssetsToAdd.insert(item);
+            if (base->setNewTransferAssetsToRemove.count(item))
+                base->setNewTransferAssetsToRemove.erase(item);
+            base->setNewTransferAssetsToAdd.insert(item);
         }
 
         for (auto &item : setNewTransferAssetsToRemove) {
-            if (passets->setNewTransferAssetsToAdd.count(item))
-                passets->setNewTransferAssetsToAdd.erase(item);
-            passets->setNewTransferAssetsToRemove.insert(item);
+            if (base->setNewTransferAssetsToAdd.count(item))
+                base->setNewTransferAssetsToAdd.erase(item);
+            base->setNewTransferAssetsToRemove.insert(item);
         }
 
         for (auto &item : vSpentAssets) {
-            passets->vSpentAssets.emplace_back(item);
+            base->vSpentAssets.emplace_back(item);
         }
 
         for (auto &item : vUndoAssetAmount) {
-            passets->vUndoAssetAmount.emplace_back(item);
+            base->vUndoAssetAmount.emplace_back(item);
         }
 
         for(auto &item : setNewQualifierAddressToAdd) {
-            if (passets->setNewQualifierAddressToRemove.count(item)) {
-                passets->setNewQualifierAddressToRemove.erase(item);
+            if (base->setNewQualifierAddressToRemove.count(item)) {
+                base->setNewQualifierAddressToRemove.erase(item);
             }
 
-            if (passets->setNewQualifierAddressToAdd.count(item)) {
-                passets->setNewQualifierAddressToAdd.erase(item);
+            if (base->setNewQualifierAddressToAdd.count(item)) {
+                base->setNewQualifierAddressToAdd.erase(item);
             }
 
-            passets->setNewQualifierAddressToAdd.insert(item);
+            base->setNewQualifierAddressToAdd.insert(item);
         }
 
         for(auto &item : setNewQualifierAddressToRemove) {
-            if (passets->setNewQualifierAddressToAdd.count(item)) {
-                passets->setNewQualifierAddressToAdd.erase(item);
+            if (base->setNewQualifierAddressToAdd.count(item)) {
+                base->setNewQualifierAddressToAdd.erase(item);
             }
 
-            if (passets->setNewQualifierAddressToRemove.count(item)) {
-                passets->setNewQualifierAddressToRemove.erase(item);
+            if (base->setNewQualifierAddressToRemove.count(item)) {
+                base->setNewQualifierAddressToRemove.erase(item);
             }
 
-            passets->setNewQualifierAddressToRemove.insert(item);
+            base->setNewQualifierAddressToRemove.insert(item);
         }
 
         for(auto &item : setNewRestrictedAddressToAdd) {
-            if (passets->setNewRestrictedAddressToRemove.count(item)) {
-                passets->setNewRestrictedAddressToRemove.erase(item);
+            if (base->setNewRestrictedAddressToRemove.count(item)) {
+                base->setNewRestrictedAddressToRemove.erase(item);
             }
 
-            if (passets->setNewRestrictedAddressToAdd.count(item)) {
-                passets->setNewRestrictedAddressToAdd.erase(item);
+            if (base->setNewRestrictedAddressToAdd.count(item)) {
+                base->setNewRestrictedAddressToAdd.erase(item);
             }
 
-            passets->setNewRestrictedAddressToAdd.insert(item);
+            base->setNewRestrictedAddressToAdd.insert(item);
         }
 
         for(auto &item : setNewRestrictedAddressToRemove) {
-            if (passets->setNewRestrictedAddressToAdd.count(item)) {
-                passets->setNewRestrictedAddressToAdd.erase(item);
+            if (base->setNewRestrictedAddressToAdd.count(item)) {
+                base->setNewRestrictedAddressToAdd.erase(item);
             }
 
-            if (passets->setNewRestrictedAddressToRemove.count(item)) {
-                passets->setNewRestrictedAddressToRemove.erase(item);
+            if (base->setNewRestrictedAddressToRemove.count(item)) {
+                base->setNewRestrictedAddressToRemove.erase(item);
             }
 
-            passets->setNewRestrictedAddressToRemove.insert(item);
+            base->setNewRestrictedAddressToRemove.insert(item);
         }
 
         for(auto &item : setNewRestrictedGlobalToAdd) {
-            if (passets->setNewRestrictedGlobalToRemove.count(item)) {
-                passets->setNewRestrictedGlobalToRemove.erase(item);
+            if (base->setNewRestrictedGlobalToRemove.count(item)) {
+                base->setNewRestrictedGlobalToRemove.erase(item);
             }
 
-            if (passets->setNewRestrictedGlobalToAdd.count(item)) {
-                passets->setNewRestrictedGlobalToAdd.erase(item);
+            if (base->setNewRestrictedGlobalToAdd.count(item)) {
+                base->setNewRestrictedGlobalToAdd.erase(item);
             }
 
-            passets->setNewRestrictedGlobalToAdd.insert(item);
+            base->setNewRestrictedGlobalToAdd.insert(item);
         }
 
         for(auto &item : setNewRestrictedGlobalToRemove) {
-            if (passets->setNewRestrictedGlobalToAdd.count(item)) {
-                passets->setNewRestrictedGlobalToAdd.erase(item);
+            if (base->setNewRestrictedGlobalToAdd.count(item)) {
+                base->setNewRestrictedGlobalToAdd.erase(item);
             }
 
-            if (passets->setNewRestrictedGlobalToRemove.count(item)) {
-                passets->setNewRestrictedGlobalToRemove.erase(item);
+            if (base->setNewRestrictedGlobalToRemove.count(item)) {
+                base->setNewRestrictedGlobalToRemove.erase(item);
             }
 
-            passets->setNewRestrictedGlobalToRemove.insert(item);
+            base->setNewRestrictedGlobalToRemove.insert(item);
         }
 
         for (auto &item : setNewRestrictedVerifierToAdd) {
-            if (passets->setNewRestrictedVerifierToRemove.count(item)) {
-                passets->setNewRestrictedVerifierToRemove.erase(item);
+            if (base->setNewRestrictedVerifierToRemove.count(item)) {
+                base->setNewRestrictedVerifierToRemove.erase(item);
             }
 
-            if (passets->setNewRestrictedVerifierToAdd.count(item)) {
-                passets->setNewRestrictedVerifierToAdd.erase(item);
+            if (base->setNewRestrictedVerifierToAdd.count(item)) {
+                base->setNewRestrictedVerifierToAdd.erase(item);
             }
 
-            passets->setNewRestrictedVerifierToAdd.insert(item);
+            base->setNewRestrictedVerifierToAdd.insert(item);
         }
 
         for (auto &item : setNewRestrictedVerifierToRemove) {
-            if (passets->setNewRestrictedVerifierToAdd.count(item)) {
-                passets->setNewRestrictedVerifierToAdd.erase(item);
+            if (base->setNewRestrictedVerifierToAdd.count(item)) {
+                base->setNewRestrictedVerifierToAdd.erase(item);
             }
 
-            if (passets->setNewRestrictedVerifierToRemove.count(item)) {
-                passets->setNewRestrictedVerifierToRemove.erase(item);
+            if (base->setNewRestrictedVerifierToRemove.count(item)) {
+                base->setNewRestrictedVerifierToRemove.erase(item);
             }
 
-            passets->setNewRestrictedVerifierToRemove.insert(item);
+            base->setNewRestrictedVerifierToRemove.insert(item);
         }
 
         for (auto &item : mapRootQualifierAddressesAdd) {
             for (auto asset : item.second) {
-                passets->mapRootQualifierAddressesAdd[item.first].insert(asset);
+                base->mapRootQualifierAddressesAdd[item.first].insert(asset);
             }
         }
 
         for (auto &item : mapRootQualifierAddressesRemove) {
             for (auto asset : item.second) {
-                passets->mapRootQualifierAddressesAdd[item.first].insert(asset);
+                base->mapRootQualifierAddressesAdd[item.first].insert(asset);
             }
         }
 
@@ -3184,30 +3173,20 @@ bool CAssetsCache::CheckIfAssetExists(const std::string& name, bool fForceDuplic
     CAssetCacheNewAsset cachedAsset(asset, "", 0, uint256());
 
     // Check the dirty caches first and see if it was recently added or removed
-    if (setNewAssetsToRemove.count(cachedAsset)) {
-        return false;
-    }
-
-    // Check the dirty caches first and see if it was recently added or removed
-    if (passets->setNewAssetsToRemove.count(cachedAsset)) {
-        return false;
-    }
-
-    if (setNewAssetsToAdd.count(cachedAsset)) {
-        if (fForceDuplicateCheck) {
-            return true;
-        }
-        else {
-            LogPrintf("%s : Found asset %s in setNewAssetsToAdd but force duplicate check wasn't true\n", __func__, name);
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (cache->setNewAssetsToRemove.count(cachedAsset)) {
+            return false;
         }
     }
 
-    if (passets->setNewAssetsToAdd.count(cachedAsset)) {
-        if (fForceDuplicateCheck) {
-            return true;
-        }
-        else {
-            LogPrintf("%s : Found asset %s in setNewAssetsToAdd but force duplicate check wasn't true\n", __func__, name);
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (cache->setNewAssetsToAdd.count(cachedAsset)) {
+            if (fForceDuplicateCheck) {
+                return true;
+            }
+            else {
+                LogPrintf("%s : Found asset %s in setNewAssetsToAdd but force duplicate check wasn't true\n", __func__, name);
+            }
         }
     }
 
@@ -3250,15 +3229,12 @@ bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &
 bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &asset, int& nHeight, uint256& blockHash)
 {
     // Check the map that contains the reissued asset data. If it is in this map, it hasn't been saved to disk yet
-    if (mapReissuedAssetData.count(name)) {
-        asset = mapReissuedAssetData.at(name);
-        return true;
-    }
-
-    // Check the map that contains the reissued asset data. If it is in this map, it hasn't been saved to disk yet
-    if (passets->mapReissuedAssetData.count(name)) {
-        asset = passets->mapReissuedAssetData.at(name);
-        return true;
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        auto mapIterator = cache->mapReissuedAssetData.find(name);
+        if (mapIterator != cache->mapReissuedAssetData.end()) {
+            asset = mapIterator->second;
+            return true;
+        }
     }
 
     // Create objects that will be used to check the dirty cache
@@ -3267,31 +3243,21 @@ bool CAssetsCache::GetAssetMetaDataIfExists(const std::string &name, CNewAsset &
     CAssetCacheNewAsset cachedAsset(tempAsset, "", 0, uint256());
 
     // Check the dirty caches first and see if it was recently added or removed
-    if (setNewAssetsToRemove.count(cachedAsset)) {
-        LogPrintf("%s : Found in new assets to Remove - Returning False\n", __func__);
-        return false;
-    }
-
-    // Check the dirty caches first and see if it was recently added or removed
-    if (passets->setNewAssetsToRemove.count(cachedAsset)) {
-        LogPrintf("%s : Found in new assets to Remove - Returning False\n", __func__);
-        return false;
-    }
-
-    auto setIterator = setNewAssetsToAdd.find(cachedAsset);
-    if (setIterator != setNewAssetsToAdd.end()) {
-        asset = setIterator->asset;
-        nHeight = setIterator->blockHeight;
-        blockHash = setIterator->blockHash;
-        return true;
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (cache->setNewAssetsToRemove.count(cachedAsset)) {
+            LogPrintf("%s : Found in new assets to Remove - Returning False\n", __func__);
+            return false;
+        }
     }
 
-    setIterator = passets->setNewAssetsToAdd.find(cachedAsset);
-    if (setIterator != passets->setNewAssetsToAdd.end()) {
-        asset = setIterator->asset;
-        nHeight = setIterator->blockHeight;
-        blockHash = setIterator->blockHash;
-        return true;
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        auto setIterator = cache->setNewAssetsToAdd.find(cachedAsset);
+        if (setIterator != cache->setNewAssetsToAdd.end()) {
+            asset = setIterator->asset;
+            nHeight = setIterator->blockHeight;
+            blockHash = setIterator->blockHash;
+            return true;
+        }
     }
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
@@ -3337,81 +3303,94 @@ bool GetAssetInfoFromScript(const CScript& scriptPubKey, std::string& strName, C
 
 bool GetAssetInfoFromCoin(const Coin& coin, std::string& strName, CAmount& nAmount)
 {
-    return GetAssetInfoFromScript(coin.out.scriptPubKey, strName, nAmount);
+    if (!coin.assetOutput || !coin.assetOutput->fValid)
+        return false;
+
+    strName = coin.assetOutput->assetName;
+    nAmount = coin.assetOutput->nAmount;
+
+    return true;
 }
 
 bool GetAssetData(const CScript& script, CAssetOutputEntry& data)
 {
-    // Placeholder strings that will get set if you successfully get the transfer or asset from the script
-    std::string address = "";
-    std::string assetName = "";
+    CAssetOutputDataRef assetOutput = DecodeAssetOutput(script);
+    if (!assetOutput)
+        return false;
 
-    int nType = 0;
-    bool fIsOwner = false;
-    if (!script.IsAssetScript(nType, fIsOwner)) {
+    return GetAssetData(*assetOutput, data);
+}
+
+bool GetAssetData(const CAssetOutputData& assetOutput, CAssetOutputEntry& data)
+{
+    if (!assetOutput.fValid) {
+        if (assetOutput.type == TX_TRANSFER_ASSET)
+            LogPrintf("Failed to get transfer from script\n");
         return false;
     }
 
-    txnouttype type = txnouttype(nType);
+    data.type = assetOutput.type;
+    data.nAmount = assetOutput.nAmount;
+    data.destination = assetOutput.destination;
+    data.assetName = assetOutput.assetName;
+    if (assetOutput.type == TX_TRANSFER_ASSET) {
+        data.message = assetOutput.message;
+        data.expireTime = assetOutput.expireTime;
+    }
+
+    return true;
+}
+
+CAssetOutputDataRef DecodeAssetOutput(const CScript& script)
+{
+    int nType = 0;
+    bool fIsOwner = false;
+    if (!script.IsAssetScript(nType, fIsOwner))
+        return nullptr;
+
+    auto assetOutput = std::make_shared<CAssetOutputData>();
+    assetOutput->type = txnouttype(nType);
+    assetOutput->fIsOwner = fIsOwner;
 
-    // Get the New Asset or Transfer Asset from the scriptPubKey
-    if (type == TX_NEW_ASSET && !fIsOwner) {
+    std::string address = "";
+    if (nType == TX_NEW_ASSET && !fIsOwner) {
         CNewAsset asset;
         if (AssetFromScript(script, asset, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = asset.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = asset.strName;
-            return true;
-        } else if (MsgChannelAssetFromScript(script, asset, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = asset.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = asset.strName;
-        } else if (QualifierAssetFromScript(script, asset, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = asset.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = asset.strName;
-        } else if (RestrictedAssetFromScript(script, asset, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = asset.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = asset.strName;
-        }
-    } else if (type == TX_TRANSFER_ASSET) {
+            assetOutput->fValid = true;
+            assetOutput->assetName = asset.strName;
+            assetOutput->nAmount = asset.nAmount;
+        }
+    } else if (nType == TX_NEW_ASSET && fIsOwner) {
+        std::string ownerName = "";
+        if (OwnerAssetFromScript(script, ownerName, address)) {
+            assetOutput->fValid = true;
+            assetOutput->assetName = ownerName;
+            assetOutput->nAmount = OWNER_ASSET_AMOUNT;
+        }
+    } else if (nType == TX_TRANSFER_ASSET) {
         CAssetTransfer transfer;
         if (TransferAssetFromScript(script, transfer, address)) {
-            data.type = TX_TRANSFER_ASSET;
-            data.nAmount = transfer.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = transfer.strName;
-            data.message = transfer.message;
-            data.expireTime = transfer.nExpireTime;
-            return true;
-        } else {
-            LogPrintf("Failed to get transfer from script\n");
-        }
-    } else if (type == TX_NEW_ASSET && fIsOwner) {
-        if (OwnerAssetFromScript(script, assetName, address)) {
-            data.type = TX_NEW_ASSET;
-            data.nAmount = OWNER_ASSET_AMOUNT;
-            data.destination = DecodeDestination(address);
-            data.assetName = assetName;
-            return true;
+            assetOutput->fValid = true;
+            assetOutput->assetName = transfer.strName;
+            assetOutput->nAmount = transfer.nAmount;
+            assetOutput->message = transfer.message;
+            assetOutput->expireTime = transfer.nExpireTime;
         }
-    } else if (type == TX_REISSUE_ASSET) {
+    } else if (nType == TX_REISSUE_ASSET) {
         CReissueAsset reissue;
         if (ReissueAssetFromScript(script, reissue, address)) {
-            data.type = TX_REISSUE_ASSET;
-            data.nAmount = reissue.nAmount;
-            data.destination = DecodeDestination(address);
-            data.assetName = reissue.strName;
-            return true;
+            assetOutput->fValid = true;
+            assetOutput->assetName = reissue.strName;
+            assetOutput->nAmount = reissue.nAmount;
         }
     }
 
-    return false;
+    if (assetOutput->fValid) {
+        assetOutput->strAddress = address;
+        assetOutput->destination = DecodeDestination(address);
+    }
+
+    return assetOutput;
 }
 
 #ifdef ENABLE_WALLET
@@ -3571,10 +3550,13 @@ bool GetBestAssetAddressAmount(CAssetsCache& cache, const std::string& assetName
         if (cache.mapAssetsAddressAmount.count(pair))
             return true;
 
-        // If the caches map has the pair, return true because the map already contains the best dirty amount
-        if (passets->mapAssetsAddressAmount.count(pair)) {
-            cache.mapAssetsAddressAmount[pair] = passets->mapAssetsAddressAmount.at(pair);
-            return true;
+        // If one of the caches below has the pair, copy its dirty amount up
+        for (const CAssetsCache* base = cache.GetBase(); base; base = base->GetBase()) {
+            auto mapIterator = base->mapAssetsAddressAmount.find(pair);
+            if (mapIterator != base->mapAssetsAddressAmount.end()) {
+                cache.mapAssetsAddressAmount[pair] = mapIterator->second;
+                return true;
+            }
         }
 
         // If the database contains the assets address amount, insert it into the database and return true
@@ -3604,10 +3586,10 @@ bool GetAllMyAssetBalances(std::map<std::string, std::vector<COutput> >& outputs
     for (const auto& pair : outputs) {
         if (prefix.empty() || pair.first.find(prefix) == 0) { // Check for prefix
             CAmount balance = 0;
-            for (auto txout : pair.second) { // Compute balance of asset by summing all Available Outputs
-                CAssetOutputEntry data;
-                if (GetAssetData(txout.tx->tx->vout[txout.i].scriptPubKey, data))
-                    balance += data.nAmount;
+            for (const auto& txout : pair.second) { // Compute balance of asset by summing all Available Outputs
+                const CAssetOutputData* assetOutput = txout.tx->GetAssetOutput(txout.i);
+                if (assetOutput && assetOutput->fValid)
+                    balance += assetOutput->nAmount;
             }
             amounts.insert(std::make_pair(pair.first, balance));
         }
@@ -3630,9 +3612,9 @@ bool GetMyAssetBalance(const std::string& name, CAmount& balance, const int& con
     if (outputs.count(name)) {
         auto& ref = outputs.at(name);
         for (const auto& txout : ref) {
-            CAssetOutputEntry data;
-            if (GetAssetData(txout.tx->tx->vout[txout.i].scriptPubKey, data)) {
-                balance += data.nAmount;
+            const CAssetOutputData* assetOutput = txout.tx->GetAssetOutput(txout.i);
+            if (assetOutput && assetOutput->fValid) {
+                balance += assetOutput->nAmount;
             }
         }
     }
@@ -4262,61 +4244,28 @@ void GetTxOutAssetTypes(const std::vector<CTxOut>& vout, int& issues, int& reiss
     }
 }
 
-bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
-    int nType;
-    bool fIsOwner;
-    int _nStartingPoint;
-    std::string _strAddress;
-    bool isAsset = false;
-    if (scriptPubKey.IsAssetScript(nType, fIsOwner, _nStartingPoint)) {
-        if (nType == TX_NEW_ASSET) {
-            if (fIsOwner) {
-                if (OwnerAssetFromScript(scriptPubKey, assetName, _strAddress)) {
-                    assetAmount = OWNER_ASSET_AMOUNT;
-                    isAsset = true;
-                } else {
-                    LogPrintf("%s : Couldn't get new owner asset from script: %s", __func__, HexStr(scriptPubKey));
-                }
-            } else {
-                CNewAsset asset;
-                if (AssetFromScript(scriptPubKey, asset, _strAddress)) {
-                    assetName = asset.strName;
-                    assetAmount = asset.nAmount;
-                    isAsset = true;
-                } else {
-                    LogPrintf("%s : Couldn't get new asset from script: %s", __func__, HexStr(scriptPubKey));
-                }
-            }
-        } else if (nType == TX_REISSUE_ASSET) {
-            CReissueAsset asset;
-            if (ReissueAssetFromScript(scriptPubKey, asset, _strAddress)) {
-                assetName = asset.strName;
-                assetAmount = asset.nAmount;
-                isAsset = true;
-            } else {
-                LogPrintf("%s : Couldn't get reissue asset from script: %s", __func__, HexStr(scriptPubKey));
-            }
-        } else if (nType == TX_TRANSFER_ASSET) {
-            CAssetTransfer asset;
-            if (TransferAssetFromScript(scriptPubKey, asset, _strAddress)) {
-                assetName = asset.strName;
-                assetAmount = asset.nAmount;
-                isAsset = true;
-            } else {
-                LogPrintf("%s : Couldn't get transfer asset from script: %s", __func__, HexStr(scriptPubKey));
-            }
-        } else {
-            LogPrintf("%s : Unsupported asset type: %s", __func__, nType);
-        }
-    } else {
-//        LogPrintf("%s : Found no asset in script: %s", __func__, HexStr(scriptPubKey));
-    }
-    if (isAsset) {
-//        LogPrintf("%s : Found assets in script at address %s : %s (%s)", __func__, _strAddress, assetName, assetAmount);
-        hashBytes = uint160(std::vector <unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
-        return true;
+static bool ParseAssetOutput(const CScript& scriptPubKey, const CAssetOutputData* assetOutput, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+    if (!assetOutput)
+        return false;
+
+    if (!assetOutput->fValid) {
+        LogPrintf("%s : Couldn't get asset from script: %s", __func__, HexStr(scriptPubKey));
+        return false;
     }
-    return false;
+
+    assetName = assetOutput->assetName;
+    assetAmount = assetOutput->nAmount;
+    hashBytes = uint160(std::vector <unsigned char>(scriptPubKey.begin()+3, scriptPubKey.begin()+23));
+    return true;
+}
+
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+    CAssetOutputDataRef assetOutput = DecodeAssetOutput(scriptPubKey);
+    return ParseAssetOutput(scriptPubKey, assetOutput.get(), hashBytes, assetName, assetAmount);
+}
+
+bool ParseAssetScript(const Coin& coin, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount) {
+    return ParseAssetOutput(coin.out.scriptPubKey, coin.assetOutput.get(), hashBytes, assetName, assetAmount);
 }
 
 CNullAssetTxData::CNullAssetTxData(const std::string &strAssetname, const int8_t &nFlag)
@@ -4406,36 +4355,30 @@ bool CAssetsCache::GetAssetVerifierStringIfExists(const std::string &name, CNull
     // Create objects that will be used to check the dirty cache
     CAssetCacheRestrictedVerifiers tempCacheVerifier {name, ""};
 
-    auto setIterator = setNewRestrictedVerifierToRemove.find(tempCacheVerifier);
     // Check the dirty caches first and see if it was recently added or removed
-    if (!fSkipTempCache && setIterator != setNewRestrictedVerifierToRemove.end()) {
-        if (setIterator->fUndoingRessiue) {
-            verifierString.verifier_string = setIterator->verifier;
-            return true;
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
+
+        auto setIterator = cache->setNewRestrictedVerifierToRemove.find(tempCacheVerifier);
+        if (setIterator != cache->setNewRestrictedVerifierToRemove.end()) {
+            if (setIterator->fUndoingRessiue) {
+                verifierString.verifier_string = setIterator->verifier;
+                return true;
+            }
+            return false;
         }
-        return false;
     }
 
-    setIterator = passets->setNewRestrictedVerifierToRemove.find(tempCacheVerifier);
-    // Check the dirty caches first and see if it was recently added or removed
-    if (setIterator != passets->setNewRestrictedVerifierToRemove.end()) {
-        if (setIterator->fUndoingRessiue) {
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
+
+        auto setIterator = cache->setNewRestrictedVerifierToAdd.find(tempCacheVerifier);
+        if (setIterator != cache->setNewRestrictedVerifierToAdd.end()) {
             verifierString.verifier_string = setIterator->verifier;
             return true;
         }
-        return false;
-    }
-
-    setIterator = setNewRestrictedVerifierToAdd.find(tempCacheVerifier);
-    if (!fSkipTempCache && setIterator != setNewRestrictedVerifierToAdd.end()) {
-        verifierString.verifier_string = setIterator->verifier;
-        return true;
-    }
-
-    setIterator = passets->setNewRestrictedVerifierToAdd.find(tempCacheVerifier);
-    if (setIterator != passets->setNewRestrictedVerifierToAdd.end()) {
-        verifierString.verifier_string = setIterator->verifier;
-        return true;
     }
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
@@ -4474,59 +4417,56 @@ bool CAssetsCache::CheckForAddressQualifier(const std::string &qualifier_name, c
     CAssetCacheQualifierAddress cachedQualifierAddress(qualifier_name, address, QualifierType::ADD_QUALIFIER);
 
     // Check the dirty caches first and see if it was recently added or removed
-    auto setIterator = setNewQualifierAddressToRemove.find(cachedQualifierAddress);
-    if (!fSkipTempCache &&setIterator != setNewQualifierAddressToRemove.end()) {
-        // Undoing a remove qualifier command, means that we are adding the qualifier to the address
-        return setIterator->type == QualifierType::REMOVE_QUALIFIER;
-    }
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
 
-
-    setIterator = passets->setNewQualifierAddressToRemove.find(cachedQualifierAddress);
-    if (setIterator != passets->setNewQualifierAddressToRemove.end()) {
-        // Undoing a remove qualifier command, means that we are adding the qualifier to the address
-        return setIterator->type == QualifierType::REMOVE_QUALIFIER;
+        auto setIterator = cache->setNewQualifierAddressToRemove.find(cachedQualifierAddress);
+        if (setIterator != cache->setNewQualifierAddressToRemove.end()) {
+            // Undoing a remove qualifier command, means that we are adding the qualifier to the address
+            return setIterator->type == QualifierType::REMOVE_QUALIFIER;
+        }
     }
 
-    setIterator = setNewQualifierAddressToAdd.find(cachedQualifierAddress);
-    if (!fSkipTempCache && setIterator != setNewQualifierAddressToAdd.end()) {
-        // Return true if we are adding the qualifier, and false if we are removing it
-        return setIterator->type == QualifierType::ADD_QUALIFIER;
-    }
+    auto tempChecker = CAssetCacheRootQualifierChecker(qualifier_name, address);
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
 
+        auto setIterator = cache->setNewQualifierAddressToAdd.find(cachedQualifierAddress);
+        if (setIterator == cache->setNewQualifierAddressToAdd.end())
+            continue;
 
-    setIterator = passets->setNewQualifierAddressToAdd.find(cachedQualifierAddress);
-    if (setIterator != passets->setNewQualifierAddressToAdd.end()) {
-        if (setIterator->type == QualifierType::ADD_QUALIFIER) {
+        if (setIterator->type == QualifierType::ADD_QUALIFIER)
             return true;
-        } else {
-            // BUG FIX:
-            // This scenario can occur if a tag #TAG is removed from an address in a block, then in a later block
-            // #TAG/#SECOND is added to the address.
-            // If a database event hasn't occurred yet the in memory caches will find that #TAG should be removed from the
-            // address and would normally fail this check. Now we can check for the exact condition where a subqualifier
-            // was added later.
-
-            auto tempChecker = CAssetCacheRootQualifierChecker(qualifier_name, address);
-            if (passets->mapRootQualifierAddressesAdd.count(tempChecker)) {
-                if (passets->mapRootQualifierAddressesAdd.at(tempChecker).size()) {
-                    return true;
-                }
-            }
 
+        // Return false if we are removing it, unless this is the passets cache reached from another one
+        if (cache != passets || (cache == this && !fSkipTempCache))
             return false;
-        }
-    }
 
-    auto tempChecker = CAssetCacheRootQualifierChecker(qualifier_name, address);
-    if (!fSkipTempCache && mapRootQualifierAddressesAdd.count(tempChecker)){
-        if (mapRootQualifierAddressesAdd.at(tempChecker).size()) {
-            return true;
+        // BUG FIX:
+        // This scenario can occur if a tag #TAG is removed from an address in a block, then in a later block
+        // #TAG/#SECOND is added to the address.
+        // If a database event hasn't occurred yet the in memory caches will find that #TAG should be removed from the
+        // address and would normally fail this check. Now we can check for the exact condition where a subqualifier
+        // was added later.
+        if (cache->mapRootQualifierAddressesAdd.count(tempChecker)) {
+            if (cache->mapRootQualifierAddressesAdd.at(tempChecker).size()) {
+                return true;
+            }
         }
+
+        return false;
     }
 
-    if (passets->mapRootQualifierAddressesAdd.count(tempChecker)) {
-        if (passets->mapRootQualifierAddressesAdd.at(tempChecker).size()) {
-            return true;
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
+
+        if (cache->mapRootQualifierAddressesAdd.count(tempChecker)) {
+            if (cache->mapRootQualifierAddressesAdd.at(tempChecker).size()) {
+                return true;
+            }
         }
     }
 
@@ -4569,28 +4509,26 @@ bool CAssetsCache::CheckForAddressRestriction(const std::string &restricted_name
     CAssetCacheRestrictedAddress cachedRestrictedAddress(restricted_name, address, RestrictedType::FREEZE_ADDRESS);
 
     // Check the dirty caches first and see if it was recently added or removed
-    auto setIterator = setNewRestrictedAddressToRemove.find(cachedRestrictedAddress);
-    if (!fSkipTempCache && setIterator != setNewRestrictedAddressToRemove.end()) {
-        // Undoing a unfreeze, means that we are adding back a freeze
-        return setIterator->type == RestrictedType::UNFREEZE_ADDRESS;
-    }
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
 
-    setIterator = passets->setNewRestrictedAddressToRemove.find(cachedRestrictedAddress);
-    if (setIterator != passets->setNewRestrictedAddressToRemove.end()) {
-        // Undoing a unfreeze, means that we are adding back a freeze
-        return setIterator->type == RestrictedType::UNFREEZE_ADDRESS;
+        auto setIterator = cache->setNewRestrictedAddressToRemove.find(cachedRestrictedAddress);
+        if (setIterator != cache->setNewRestrictedAddressToRemove.end()) {
+            // Undoing a unfreeze, means that we are adding back a freeze
+            return setIterator->type == RestrictedType::UNFREEZE_ADDRESS;
+        }
     }
 
-    setIterator = setNewRestrictedAddressToAdd.find(cachedRestrictedAddress);
-    if (!fSkipTempCache && setIterator != setNewRestrictedAddressToAdd.end()) {
-        // Return true if we are freezing the address
-        return setIterator->type == RestrictedType::FREEZE_ADDRESS;
-    }
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
 
-    setIterator = passets->setNewRestrictedAddressToAdd.find(cachedRestrictedAddress);
-    if (setIterator != passets->setNewRestrictedAddressToAdd.end()) {
-        // Return true if we are freezing the address
-        return setIterator->type == RestrictedType::FREEZE_ADDRESS;
+        auto setIterator = cache->setNewRestrictedAddressToAdd.find(cachedRestrictedAddress);
+        if (setIterator != cache->setNewRestrictedAddressToAdd.end()) {
+            // Return true if we are freezing the address
+            return setIterator->type == RestrictedType::FREEZE_ADDRESS;
+        }
     }
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
@@ -4628,28 +4566,26 @@ bool CAssetsCache::CheckForGlobalRestriction(const std::string &restricted_name,
     CAssetCacheRestrictedGlobal cachedRestrictedGlobal(restricted_name, RestrictedType::GLOBAL_FREEZE);
 
     // Check the dirty caches first and see if it was recently added or removed
-    auto setIterator = setNewRestrictedGlobalToRemove.find(cachedRestrictedGlobal);
-    if (!fSkipTempCache && setIterator != setNewRestrictedGlobalToRemove.end()) {
-        // Undoing a removal of a global unfreeze, means that is will become frozen
-        return setIterator->type == RestrictedType::GLOBAL_UNFREEZE;
-    }
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
 
-    setIterator = passets->setNewRestrictedGlobalToRemove.find(cachedRestrictedGlobal);
-    if (setIterator != passets->setNewRestrictedGlobalToRemove.end()) {
-        // Undoing a removal of a global unfreeze, means that is will become frozen
-        return setIterator->type == RestrictedType::GLOBAL_UNFREEZE;
+        auto setIterator = cache->setNewRestrictedGlobalToRemove.find(cachedRestrictedGlobal);
+        if (setIterator != cache->setNewRestrictedGlobalToRemove.end()) {
+            // Undoing a removal of a global unfreeze, means that is will become frozen
+            return setIterator->type == RestrictedType::GLOBAL_UNFREEZE;
+        }
     }
 
-    setIterator = setNewRestrictedGlobalToAdd.find(cachedRestrictedGlobal);
-    if (!fSkipTempCache && setIterator != setNewRestrictedGlobalToAdd.end()) {
-        // Return true if we are adding a freeze command
-        return setIterator->type == RestrictedType::GLOBAL_FREEZE;
-    }
+    for (const CAssetsCache* cache = this; cache; cache = cache->GetBase()) {
+        if (fSkipTempCache && cache != passets)
+            continue;
 
-    setIterator = passets->setNewRestrictedGlobalToAdd.find(cachedRestrictedGlobal);
-    if (setIterator != passets->setNewRestrictedGlobalToAdd.end()) {
-        // Return true if we are adding a freeze command
-        return setIterator->type == RestrictedType::GLOBAL_FREEZE;
+        auto setIterator = cache->setNewRestrictedGlobalToAdd.find(cachedRestrictedGlobal);
+        if (setIterator != cache->setNewRestrictedGlobalToAdd.end()) {
+            // Return true if we are adding a freeze command
+            return setIterator->type == RestrictedType::GLOBAL_FREEZE;
+        }
     }
 
     // Check the cache, if it doesn't exist in the cache. Try and read it from database
@@ -4962,12 +4898,101 @@ bool ContextualCheckVerifierAssetTxOut(const CTxOut& txout, CAssetsCache* assetC
     return true;
 }
 
+/** A verifier string that passed CheckVerifierString, compiled against its qualifiers in sorted order */
+struct CCompiledVerifier
+{
+    std::vector<std::string> vQualifiers;
+    LibBoolEE::Program program;
+};
+
+// Compiled verifiers keyed by the verifier string, nullptr for strings that can't be compiled.
+// A reissue that changes the verifier of a restricted asset changes the key, so entries never go stale.
+static const size_t MAX_CACHE_COMPILED_VERIFIERS = 2500;
+static CCriticalSection cs_compiledVerifiers;
+static CLRUCache<std::string, std::shared_ptr<const CCompiledVerifier>> compiledVerifiers(MAX_CACHE_COMPILED_VERIFIERS);
+
+static std::shared_ptr<const CCompiledVerifier> GetCompiledVerifier(const std::string& verifier)
+{
+    {
+        LOCK(cs_compiledVerifiers);
+        if (compiledVerifiers.Exists(verifier))
+            return compiledVerifiers.Get(verifier);
+    }
+
+    std::shared_ptr<CCompiledVerifier> compiled;
+    std::set<std::string> setFoundQualifiers;
+    std::string strError;
+    if (CheckVerifierString(verifier, setFoundQualifiers, strError)) {
+        compiled = std::make_shared<CCompiledVerifier>();
+        compiled->vQualifiers.assign(setFoundQualifiers.begin(), setFoundQualifiers.end());
+        try {
+            LibBoolEE::compile(verifier, compiled->vQualifiers, compiled->program);
+        } catch (const std::runtime_error& run_error) {
+            LogPrintf("%s : Failed to compile verifier string %s: %s\n", __func__, verifier, run_error.what());
+            compiled.reset();
+        }
+    }
+
+    LOCK(cs_compiledVerifiers);
+    compiledVerifiers.Put(verifier, compiled);
+    return compiled;
+}
+
+static bool ContextualCheckCompiledVerifier(CAssetsCache* cache, const CCompiledVerifier& compiled, const std::string& verifier, const std::string& check_address, std::string& strError, ErrorReport* errorReport)
+{
+    // Loop through each qualifier and make sure that the asset exists
+    for (const auto& qualifier : compiled.vQualifiers) {
+        std::string search = QUALIFIER_CHAR + qualifier;
+        if (!cache->CheckIfAssetExists(search, true)) {
+            if (errorReport) {
+                errorReport->type = ErrorReport::ErrorType::AssetDoesntExist;
+                errorReport->vecUserData.emplace_back(search);
+                errorReport->strDevData = "bad-txns-null-verifier-contains-non-issued-qualifier";
+            }
+            strError = "bad-txns-null-verifier-contains-non-issued-qualifier";
+            return false;
+        }
+    }
+
+    if (check_address.empty())
+        return true;
+
+    // Set the bit of every qualifier the address has
+    uint64_t valuation = 0;
+    for (size_t i = 0; i < compiled.vQualifiers.size(); i++) {
+        if (cache->CheckForAddressQualifier(QUALIFIER_CHAR + compiled.vQualifiers[i], check_address, true))
+            valuation |= uint64_t(1) << i;
+    }
+
+    if (!LibBoolEE::evaluate(compiled.program, valuation)) {
+        if (errorReport) {
+            if (errorReport->type == ErrorReport::ErrorType::NotSetError) {
+                errorReport->type = ErrorReport::ErrorType::FailedToVerifyAgainstAddress;
+                errorReport->vecUserData.emplace_back(check_address);
+                errorReport->strDevData = "bad-txns-null-verifier-address-failed-verification";
+            }
+        }
+
+        error("%s : The address %s failed to verify against: %s. Is null %d", __func__, check_address, verifier, errorReport ? 0 : 1);
+        strError = "bad-txns-null-verifier-address-failed-verification";
+        return false;
+    }
+
+    return true;
+}
+
 bool ContextualCheckVerifierString(CAssetsCache* cache, const std::string& verifier, const std::string& check_address, std::string& strError, ErrorReport* errorReport)
 {
     // If verifier is set to true, return true
     if (verifier == "true")
         return true;
 
+    // Verifier strings that passed the syntax checks before are evaluated from their compiled form,
+    // the others go through the checks below to report what is wrong with them
+    std::shared_ptr<const CCompiledVerifier> compiled = GetCompiledVerifier(verifier);
+    if (compiled)
+        return ContextualCheckCompiledVerifier(cache, *compiled, verifier, check_address, strError, errorReport);
+
     // Check against the non contextual changes first
     std::set<std::string> setFoundQualifiers;
     if (!CheckVerifierString(verifier, setFoundQualifiers, strError, errorReport))
@@ -123,12 +123,24 @@ struct ErrorReport {
 
 std::string GetUserErrorString(const ErrorReport& report);
 
+/**
+ * Asset state changes on top of a base cache, the way CCoinsViewCache sits on top of a CCoinsView.
+ *
+ * A cache only holds its own dirty entries. Lookups that miss in it fall through to its base, then to the
+ * global passets and the databases, and Flush() moves its entries into the base. Validation code that wants a
+ * scratch view of the asset state creates an empty cache over the current one instead of copying it.
+ */
 class CAssetsCache : public CAssets
 {
 private:
+    //! Cache this one is layered on, nullptr to use the global passets
+    CAssetsCache* pBase;
+
     bool AddBackSpentAsset(const Coin& coin, const std::string& assetName, const std::string& address, const CAmount& nAmount, const COutPoint& out);
     void AddToAssetBalance(const std::string& strName, const std::string& address, const CAmount& nAmount);
     bool UndoTransfer(const CAssetTransfer& transfer, const std::string& address, const COutPoint& outToRemove);
+    //! Hand the dirty entries to the asset and restricted databases, DumpCacheToDatabase() commits them
+    bool WriteCacheToDatabase();
 public :
     //! These are memory only containers that show dirty entries that will be databased when flushed
     std::vector<CAssetCacheUndoAssetAmount> vUndoAssetAmount;
@@ -170,13 +182,19 @@ public :
     std::map<CAssetCacheRootQualifierChecker, std::set<std::string> > mapRootQualifierAddressesAdd;
     std::map<CAssetCacheRootQualifierChecker, std::set<std::string> > mapRootQualifierAddressesRemove;
 
-    CAssetsCache() : CAssets()
+    CAssetsCache() : CAssets(), pBase(nullptr)
+    {
+        SetNull();
+        ClearDirtyCache();
+    }
+
+    explicit CAssetsCache(CAssetsCache* base) : CAssets(), pBase(base)
     {
         SetNull();
         ClearDirtyCache();
     }
 
-    CAssetsCache(const CAssetsCache& cache) : CAssets(cache)
+    CAssetsCache(const CAssetsCache& cache) : CAssets(cache), pBase(cache.pBase)
     {
         //! Copy dirty cache also
         this->vSpentAssets = cache.vSpentAssets;
@@ -221,6 +239,7 @@ public :
 
     CAssetsCache& operator=(const CAssetsCache& cache)
     {
+        this->pBase = cache.pBase;
         this->mapAssetsAddressAmount = cache.mapAssetsAddressAmount;
         this->mapReissuedAssetData = cache.mapReissuedAssetData;
 
@@ -289,7 +308,7 @@ public :
     bool AddRestrictedVerifier(const std::string& assetName, const std::string& verifier);
 
     //! Cache only validation functions
-    bool TrySpendCoin(const COutPoint& out, const CTxOut& coin);
+    bool TrySpendCoin(const COutPoint& out, const Coin& coin);
 
     //! Help functions
     bool ContainsAsset(const CNewAsset& asset);
@@ -321,7 +340,10 @@ public :
     size_t GetCacheSize() const;
     size_t GetCacheSizeV2() const;
 
-    //! Flush all new cache entries into the passets global cache
+    //! The next cache to look into after this one, nullptr when this is the global passets
+    CAssetsCache* GetBase() const;
+
+    //! Flush all new cache entries into the base cache (the passets global cache by default)
     bool Flush();
 
     //! Write asset cache data to database
@@ -495,6 +517,10 @@ bool GetAssetInfoFromCoin(const Coin& coin, std::string& strName, CAmount& nAmou
 bool GetAssetInfoFromScript(const CScript& scriptPubKey, std::string& strName, CAmount& nAmount);
 
 bool GetAssetData(const CScript& script, CAssetOutputEntry& data);
+bool GetAssetData(const CAssetOutputData& assetOutput, CAssetOutputEntry& data);
+
+//! Decode the asset fields of an output script, nullptr if it isn't an asset script
+CAssetOutputDataRef DecodeAssetOutput(const CScript& script);
 
 bool GetBestAssetAddressAmount(CAssetsCache& cache, const std::string& assetName, const std::string& address);
 
@@ -529,7 +555,8 @@ bool VerifyWalletHasAsset(const std::string& asset_name, std::pair<int, std::str
 #endif
 
 /** Helper method for extracting address bytes, asset name and amount from an asset script */
-bool ParseAssetScript(CScript scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
+bool ParseAssetScript(const CScript& scriptPubKey, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
+bool ParseAssetScript(const Coin& coin, uint160 &hashBytes, std::string &assetName, CAmount &assetAmount);
 
 /** Helper method for extracting #TAGS from a verifier string */
 void ExtractVerifierStringQualifiers(const std::string& verifier, std::set<std::string>& qualifiers);
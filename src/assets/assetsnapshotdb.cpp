@@ -3,6 +3,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "assetsnapshotdb.h"
+#include "assetdb.h"
 #include "validation.h"
 #include "base58.h"
 
@@ -10,6 +11,10 @@
 #include <boost/thread.hpp>
 
 static const char SNAPSHOTCHECK_FLAG = 'C'; // Snapshot Check
+static const char SNAPSHOTCHUNK_FLAG = 'c'; // Snapshot owners chunk
+
+//  Owners read from the assets DB, validated and written per chunk
+static const size_t SNAPSHOT_CHUNK_SIZE = 10000;
 
 CAssetSnapshotDBEntry::CAssetSnapshotDBEntry()
 {
@@ -32,81 +37,205 @@ CAssetSnapshotDBEntry::CAssetSnapshotDBEntry(
     heightAndName = std::to_string(height) + assetName;
 }
 
-CAssetSnapshotDB::CAssetSnapshotDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "rewards" / "assetsnapshot", nCacheSize, fMemory, fWipe) {
+CAssetSnapshotDB::CAssetSnapshotDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper(GetDataDir() / "rewards" / "assetsnapshot", nCacheSize, fMemory, fWipe), fStopping(false) {
 }
 
-bool CAssetSnapshotDB::AddAssetOwnershipSnapshot(
-    const std::string & p_assetName, int p_height)
+CAssetSnapshotDB::~CAssetSnapshotDB()
 {
-    LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Adding snapshot for '%s' at height %d\n",
-        p_assetName.c_str(), p_height);
+    Stop();
+}
 
-    //  Retrieve ownership interest for the asset at this height
-    if (passetsdb == nullptr) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Invalid assets DB!\n");
-        return false;
+void CAssetSnapshotDB::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutexJobs);
+        fStopping = true;
     }
+    condJobs.notify_all();
+    if (threadBuilder.joinable()) {
+        threadBuilder.join();
+    }
+    workerPool.stop(true);
+}
 
-    std::set<std::pair<std::string, CAmount>> ownersAndAmounts;
-    std::vector<std::pair<std::string, CAmount>> tempOwnersAndAmounts;
-    int totalEntryCount;
+void CAssetSnapshotDB::ThreadBuildSnapshots()
+{
+    //  Together with this thread one worker per core
+    if (workerPool.size() == 0 && GetNumCores() > 1) {
+        workerPool.resize(GetNumCores() - 1);
+        RenameThreadPool(workerPool, "snapshot-worker");
+    }
 
-    if (!passetsdb->AssetAddressDir(tempOwnersAndAmounts, totalEntryCount, true, p_assetName, INT_MAX, 0)) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to retrieve assets directory for '%s'\n", p_assetName.c_str());
-        return false;
+    while (true) {
+        SnapshotJob job;
+        {
+            std::unique_lock<std::mutex> lock(mutexJobs);
+            condJobs.wait(lock, [this] { return fStopping || !queueJobs.empty(); });
+            //  Queued snapshots are finished before stopping, rewards can't be paid without them
+            if (queueJobs.empty()) {
+                return;
+            }
+            job = std::move(queueJobs.front());
+            queueJobs.pop_front();
+        }
+
+        BuildOwnershipSnapshot(job);
+        std::string heightAndName = std::to_string(job.height) + job.assetName;
+        job.snapshot.reset();
+
+        {
+            std::lock_guard<std::mutex> lock(mutexJobs);
+            setPendingJobs.erase(setPendingJobs.find(heightAndName));
+        }
+        condJobs.notify_all();
     }
+}
 
-    //  Retrieve all of the addresses/amounts in batches
-    const int MAX_RETRIEVAL_COUNT = 100;
-    bool errorsOccurred = false;
+void CAssetSnapshotDB::WaitForPendingSnapshot(const std::string& heightAndName)
+{
+    std::unique_lock<std::mutex> lock(mutexJobs);
+    condJobs.wait(lock, [this, &heightAndName] { return !setPendingJobs.count(heightAndName); });
+}
+
+bool CAssetSnapshotDB::EraseSnapshotChunks(const std::string& heightAndName)
+{
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << std::make_pair(SNAPSHOTCHUNK_FLAG, heightAndName);
 
-    for (int retrievalOffset = 0; retrievalOffset < totalEntryCount; retrievalOffset += MAX_RETRIEVAL_COUNT) {
-        //  Retrieve the specified segment of addresses
-        if (!passetsdb->AssetAddressDir(tempOwnersAndAmounts, totalEntryCount, false, p_assetName, MAX_RETRIEVAL_COUNT, retrievalOffset)) {
-            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to retrieve assets directory for '%s'\n", p_assetName.c_str());
-            errorsOccurred = true;
-            break;
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    for (pcursor->Seek(ssPrefix); pcursor->Valid() && pcursor->KeyHasPrefix(ssPrefix); pcursor->Next()) {
+        std::pair<char, std::pair<std::string, uint32_t>> key;
+        if (!pcursor->GetKey(key))
+            return false;
+        batch.Erase(key);
+    }
+    return WriteBatch(batch);
+}
+
+//  Validate the addresses on the calling thread and the workers, only keeping the valid ones
+static void RemoveInvalidOwners(ctpl::thread_pool& workerPool, std::vector<std::pair<std::string, CAmount>>& vecOwnersAndAmounts)
+{
+    std::vector<char> vValid(vecOwnersAndAmounts.size());
+    auto validate = [&vecOwnersAndAmounts, &vValid](size_t nBegin, size_t nEnd) {
+        for (size_t i = nBegin; i < nEnd; i++) {
+            vValid[i] = IsValidDestination(DecodeDestination(vecOwnersAndAmounts[i].first));
         }
+    };
 
-        //  Verify that some addresses were returned
-        if (tempOwnersAndAmounts.size() == 0) {
-            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No addresses were retrieved.\n");
-            continue;
+    size_t nParts = std::max(std::min<size_t>(workerPool.size() + 1, vecOwnersAndAmounts.size() / 1000), (size_t)1);
+    size_t nPerPart = (vecOwnersAndAmounts.size() + nParts - 1) / nParts;
+    std::vector<std::future<void>> futures;
+    for (size_t n = 1; n < nParts; n++) {
+        size_t nBegin = std::min(n * nPerPart, vecOwnersAndAmounts.size());
+        size_t nEnd = std::min((n + 1) * nPerPart, vecOwnersAndAmounts.size());
+        futures.emplace_back(workerPool.push([&validate, nBegin, nEnd](int threadId) { validate(nBegin, nEnd); }));
+    }
+    validate(0, std::min(nPerPart, vecOwnersAndAmounts.size()));
+    for (auto& f : futures) {
+        f.get();
+    }
+
+    size_t nKept = 0;
+    for (size_t i = 0; i < vecOwnersAndAmounts.size(); i++) {
+        if (vValid[i]) {
+            vecOwnersAndAmounts[nKept++] = std::move(vecOwnersAndAmounts[i]);
+        } else {
+            LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Address '%s' is invalid.\n", vecOwnersAndAmounts[i].first.c_str());
         }
+    }
+    vecOwnersAndAmounts.resize(nKept);
+}
+
+bool CAssetSnapshotDB::BuildOwnershipSnapshot(const SnapshotJob& job)
+{
+    int64_t nTimeStart = GetTimeMicros();
 
-        //  Move these into the main set
-        for (auto const & currPair : tempOwnersAndAmounts) {
-            //  Verify that the address is valid
-            CTxDestination dest = DecodeDestination(currPair.first);
-            if (IsValidDestination(dest)) {
-                ownersAndAmounts.insert(currPair);
+    CAssetSnapshotDBEntry snapshotEntry(job.assetName, job.height, std::set<std::pair<std::string, CAmount>>());
+
+    //  A previous attempt may have left chunks behind
+    if (!EraseSnapshotChunks(snapshotEntry.heightAndName)) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to clear the snapshot for '%s' at height %d\n", job.assetName.c_str(), job.height);
+        return false;
+    }
+
+    //  Stream the owners out of the assets DB once, writing each chunk as soon as it is validated
+    uint32_t nChunks = 0;
+    size_t nOwners = 0;
+    bool fRead = job.assetsdb->ReadAssetAddressQuantities(*job.snapshot, job.assetName, SNAPSHOT_CHUNK_SIZE,
+        [this, &snapshotEntry, &nChunks, &nOwners](std::vector<std::pair<std::string, CAmount>>& vecOwnersAndAmounts) {
+            RemoveInvalidOwners(workerPool, vecOwnersAndAmounts);
+            if (vecOwnersAndAmounts.empty()) {
+                return true;
             }
-            else {
-                LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Address '%s' is invalid.\n", currPair.first.c_str());
+            if (!Write(std::make_pair(SNAPSHOTCHUNK_FLAG, std::make_pair(snapshotEntry.heightAndName, nChunks)), vecOwnersAndAmounts)) {
+                return false;
             }
-        }
+            nChunks++;
+            nOwners += vecOwnersAndAmounts.size();
+            return true;
+        });
 
-        tempOwnersAndAmounts.clear();
+    if (!fRead) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Errors occurred while acquiring ownership info for asset '%s'.\n", job.assetName.c_str());
+        EraseSnapshotChunks(snapshotEntry.heightAndName);
+        return false;
+    }
+    if (nOwners == 0) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No owners exist for asset '%s'.\n", job.assetName.c_str());
+        return false;
     }
 
-    if (errorsOccurred) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Errors occurred while acquiring ownership info for asset '%s'.\n", p_assetName.c_str());
+    //  The entry without owners goes last, it marks the chunks before it as complete
+    if (!Write(std::make_pair(SNAPSHOTCHECK_FLAG, snapshotEntry.heightAndName), snapshotEntry, true)) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Failed to write the snapshot for '%s' at height %d\n", job.assetName.c_str(), job.height);
         return false;
     }
-    if (ownersAndAmounts.size() == 0) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: No owners exist for asset '%s'.\n", p_assetName.c_str());
+
+    LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Successfully added snapshot for '%s' at height %d (ownerCount = %d, chunks = %d) in %.2fms.\n",
+        job.assetName.c_str(), job.height, nOwners, nChunks, (GetTimeMicros() - nTimeStart) * 0.001);
+    return true;
+}
+
+bool CAssetSnapshotDB::AddAssetOwnershipSnapshot(
+    const std::string & p_assetName, int p_height)
+{
+    LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Adding snapshot for '%s' at height %d\n",
+        p_assetName.c_str(), p_height);
+
+    //  Retrieve ownership interest for the asset at this height
+    if (passetsdb == nullptr) {
+        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Invalid assets DB!\n");
         return false;
     }
 
-    //  Write the snapshot to the database. We don't care if we overwrite, because it should be identical.
-    CAssetSnapshotDBEntry snapshotEntry(p_assetName, p_height, ownersAndAmounts);
+    //  The asset DB snapshot is taken as of the last flush, the caller flushed this block
+    SnapshotJob job;
+    job.assetName = p_assetName;
+    job.height = p_height;
+    job.assetsdb = passetsdb;
+    job.snapshot = passetsdb->GetSnapshot();
 
-    if (Write(std::make_pair(SNAPSHOTCHECK_FLAG, snapshotEntry.heightAndName), snapshotEntry)) {
-        LogPrint(BCLog::REWARDS, "AddAssetOwnershipSnapshot: Successfully added snapshot for '%s' at height %d (ownerCount = %d).\n",
-            p_assetName.c_str(), p_height, ownersAndAmounts.size());
+    bool fQueued = false;
+    {
+        std::lock_guard<std::mutex> lock(mutexJobs);
+        if (!fStopping) {
+            //  Requests for a snapshot that is still being built wait for it
+            setPendingJobs.insert(std::to_string(p_height) + p_assetName);
+            queueJobs.push_back(std::move(job));
+            if (!threadBuilder.joinable()) {
+                threadBuilder = std::thread(&TraceThread<std::function<void()> >, "snapshot", std::function<void()>(std::bind(&CAssetSnapshotDB::ThreadBuildSnapshots, this)));
+            }
+            fQueued = true;
+        }
+    }
+    if (fQueued) {
+        condJobs.notify_all();
         return true;
     }
-    return false;
+
+    //  Shutting down, there is no builder thread anymore
+    return BuildOwnershipSnapshot(job);
 }
 
 bool CAssetSnapshotDB::RetrieveOwnershipSnapshot(
@@ -120,8 +249,22 @@ bool CAssetSnapshotDB::RetrieveOwnershipSnapshot(
         __func__,
         heightAndName.c_str());
 
+    WaitForPendingSnapshot(heightAndName);
+
     bool succeeded = Read(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName), p_snapshotEntry);
 
+    //  Snapshots without owners in their entry have them in chunks
+    if (succeeded && p_snapshotEntry.ownersAndAmounts.empty()) {
+        std::vector<std::pair<std::string, CAmount>> vecOwnersAndAmounts;
+        for (uint32_t nChunk = 0; Read(std::make_pair(SNAPSHOTCHUNK_FLAG, std::make_pair(heightAndName, nChunk)), vecOwnersAndAmounts); nChunk++) {
+            for (auto& currPair : vecOwnersAndAmounts) {
+                p_snapshotEntry.ownersAndAmounts.insert(p_snapshotEntry.ownersAndAmounts.end(), std::move(currPair));
+            }
+            vecOwnersAndAmounts.clear();
+        }
+        succeeded = !p_snapshotEntry.ownersAndAmounts.empty();
+    }
+
     LogPrint(BCLog::REWARDS, "%s : Retrieval of snapshot for '%s' %s!\n",
         __func__,
         heightAndName.c_str(),
@@ -140,7 +283,10 @@ bool CAssetSnapshotDB::RemoveOwnershipSnapshot(
         __func__,
         heightAndName.c_str());
 
-    bool succeeded = Erase(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName), true);
+    WaitForPendingSnapshot(heightAndName);
+
+    //  Remove the entry first so a partially removed snapshot is never read
+    bool succeeded = Erase(std::make_pair(SNAPSHOTCHECK_FLAG, heightAndName), true) && EraseSnapshotChunks(heightAndName);
 
     LogPrint(BCLog::REWARDS, "%s : Removal of snapshot for '%s' %s!\n",
         __func__,
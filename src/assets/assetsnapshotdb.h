@@ -5,10 +5,18 @@
 #ifndef ASSETSNAPSHOTDB_H
 #define ASSETSNAPSHOTDB_H
 
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
 #include <set>
+#include <thread>
 
 #include <dbwrapper.h>
 #include "amount.h"
+#include "ctpl.h"
+
+class CAssetsDB;
 
 class CAssetSnapshotDBEntry
 {
@@ -53,18 +61,53 @@ public:
     }
 };
 
+/**
+ * Ownership snapshots are built by a background thread from a LevelDB snapshot
+ * of the assets database taken when they are requested, so the validation
+ * thread never waits on assets with many holders. Owners are stored in chunks
+ * next to an entry without owners that marks the snapshot as complete;
+ * snapshots written as a single entry by older versions are still read.
+ */
 class CAssetSnapshotDB  : public CDBWrapper {
+private:
+    struct SnapshotJob
+    {
+        std::string assetName;
+        int height;
+        CAssetsDB* assetsdb;
+        std::unique_ptr<CDBSnapshot> snapshot;
+    };
+
+    std::mutex mutexJobs;
+    std::condition_variable condJobs;
+    /** Snapshots waiting to be built, protected by mutexJobs */
+    std::deque<SnapshotJob> queueJobs;
+    /** heightAndName of the queued snapshots and the one being built, protected by mutexJobs */
+    std::multiset<std::string> setPendingJobs;
+    bool fStopping;
+    std::thread threadBuilder;
+    /** Helps the builder thread validate the owner addresses, started with it */
+    ctpl::thread_pool workerPool;
+
+    void ThreadBuildSnapshots();
+    bool BuildOwnershipSnapshot(const SnapshotJob& job);
+    void WaitForPendingSnapshot(const std::string& heightAndName);
+    bool EraseSnapshotChunks(const std::string& heightAndName);
+
 public:
     explicit CAssetSnapshotDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false);
+    ~CAssetSnapshotDB();
 
     CAssetSnapshotDB(const CAssetSnapshotDB&) = delete;
     CAssetSnapshotDB& operator=(const CAssetSnapshotDB&) = delete;
 
-    //  Add an entry to the snapshot at the specified height
+    //  Add an entry to the snapshot at the specified height. The owners are
+    //      read from the assets DB as of this call but written in the background,
+    //      so the caller flushes the chain state first.
     bool AddAssetOwnershipSnapshot(
         const std::string & p_assetName, int p_height);
 
-    //  Read all of the entries at a specified height
+    //  Read all of the entries at a specified height, waiting for the snapshot if it is still being built
     bool RetrieveOwnershipSnapshot(
         const std::string & p_assetName, int p_height,
         CAssetSnapshotDBEntry & p_snapshotEntry);
@@ -72,6 +115,9 @@ public:
     //  Remove the asset snapshot at the specified height
     bool RemoveOwnershipSnapshot(
         const std::string & p_assetName, int p_height);
+
+    //  Finish the queued snapshots and stop the builder thread. Must be called before the assets DB is closed.
+    void Stop();
 };
 
 
@@ -8,8 +8,10 @@
 #include <string>
 #include <sstream>
 #include <list>
+#include <memory>
 #include <unordered_map>
 #include "amount.h"
+#include "pubkey.h"
 #include "script/standard.h"
 #include "primitives/transaction.h"
 
@@ -273,6 +275,29 @@ public:
     bool IsNull() const;
 };
 
+/**
+ * The asset fields of an output script. Decoding a script means deserializing
+ * its payload and encoding its address, so it is done once per output and the
+ * result shared by the coins and wallet transactions holding the output.
+ */
+struct CAssetOutputData
+{
+    //! TX_NEW_ASSET, TX_TRANSFER_ASSET or TX_REISSUE_ASSET
+    txnouttype type = TX_NONSTANDARD;
+    bool fIsOwner = false;
+    //! False if the script matches an asset template but its payload doesn't deserialize
+    bool fValid = false;
+    std::string assetName;
+    CAmount nAmount = 0;
+    CTxDestination destination;
+    std::string strAddress;
+    //! Transfers only
+    std::string message;
+    int64_t expireTime = 0;
+};
+
+typedef std::shared_ptr<const CAssetOutputData> CAssetOutputDataRef;
+
 class CNullAssetTxData {
 public:
     std::string asset_name;
@@ -4,6 +4,7 @@
 #include "validation.h"
 #include "myassetsdb.h"
 #include "messages.h"
+#include "txdb.h"
 #include <boost/thread.hpp>
 
 #include <boost/thread.hpp>
@@ -21,7 +22,7 @@ CMessageDB::CMessageDB(size_t nCacheSize, bool fMemory, bool fWipe) : CDBWrapper
 
 bool CMessageDB::WriteMessage(const CMessage &message)
 {
-    return Write(std::make_pair(MESSAGE_FLAG, message.out), message);
+    return BatchWrite(std::make_pair(MESSAGE_FLAG, message.out), message);
 }
 
 bool CMessageDB::ReadMessage(const COutPoint &out, CMessage &message)
@@ -31,7 +32,7 @@ bool CMessageDB::ReadMessage(const COutPoint &out, CMessage &message)
 
 bool CMessageDB::EraseMessage(const COutPoint &out)
 {
-    return Erase(std::make_pair(MESSAGE_FLAG, out));
+    return BatchErase(std::make_pair(MESSAGE_FLAG, out));
 }
 
 bool CMessageDB::LoadMessages(std::set<CMessage>& setMessages)
@@ -94,15 +95,21 @@ bool CMessageDB::EraseAllMessages(int& count)
 
 bool CMessageDB::Flush() {
     try {
+        int64_t nTimeStart = GetTimeMicros();
+        BeginBatch(gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize));
 
         for (auto messageRemove : setDirtyMessagesRemove) {
-            if (!EraseMessage(messageRemove))
+            if (!EraseMessage(messageRemove)) {
+                AbortBatch();
                 return error("%s: failed to erase message %s", __func__, messageRemove.ToString());
+            }
         }
 
         for (auto messageAdd : mapDirtyMessagesAdd) {
-            if (!WriteMessage(messageAdd.second))
+            if (!WriteMessage(messageAdd.second)) {
+                AbortBatch();
                 return error("%s: failed to write message %s", __func__, messageAdd.second.ToString());
+            }
 
             mapDirtyMessagesOrphaned.erase(messageAdd.first);
         }
@@ -110,14 +117,21 @@ bool CMessageDB::Flush() {
         for (auto orphans : mapDirtyMessagesOrphaned) {
             CMessage msg = orphans.second;
             msg.status = MessageStatus::ORPHAN;
-            if (!WriteMessage(msg))
+            if (!WriteMessage(msg)) {
+                AbortBatch();
                 return error("%s: failed to write message orphan %s", __func__, msg.ToString());
+            }
         }
 
+        if (!CommitBatch(true))
+            return error("%s: failed to write the message batch", __func__);
+        LogPrint(BCLog::BENCHMARK, "    - Flush message db: %.2fms\n", (GetTimeMicros() - nTimeStart) * 0.001);
+
         setDirtyMessagesRemove.clear();
         mapDirtyMessagesAdd.clear();
         mapDirtyMessagesOrphaned.clear();
     } catch (const std::runtime_error& e) {
+        AbortBatch();
         return error("%s : %s ", __func__, std::string("System error while flushing messages: ") + e.what());
     }
 
@@ -129,7 +143,7 @@ CMessageChannelDB::CMessageChannelDB(size_t nCacheSize, bool fMemory, bool fWipe
 
 bool CMessageChannelDB::WriteMyMessageChannel(const std::string& channelname)
 {
-    return Write(std::make_pair(MY_MESSAGE_CHANNEL, channelname), 1);
+    return BatchWrite(std::make_pair(MY_MESSAGE_CHANNEL, channelname), 1);
 }
 
 bool CMessageChannelDB::ReadMyMessageChannel(const std::string& channelname)
@@ -140,7 +154,7 @@ bool CMessageChannelDB::ReadMyMessageChannel(const std::string& channelname)
 
 bool CMessageChannelDB::EraseMyMessageChannel(const std::string& channelname)
 {
-    return Erase(std::make_pair(MY_MESSAGE_CHANNEL, channelname));
+    return BatchErase(std::make_pair(MY_MESSAGE_CHANNEL, channelname));
 }
 
 bool CMessageChannelDB::LoadMyMessageChannels(std::set<std::string>& setChannels)
@@ -182,7 +196,7 @@ bool CMessageDB::ReadFlag(const std::string &name, bool &fValue)
 
 bool CMessageChannelDB::WriteUsedAddress(const std::string& address)
 {
-    return Write(std::make_pair(MY_SEEN_ADDRESSES, address), 1);
+    return BatchWrite(std::make_pair(MY_SEEN_ADDRESSES, address), 1);
 }
 bool CMessageChannelDB::ReadUsedAddress(const std::string& address)
 {
@@ -212,27 +226,41 @@ bool CMessageChannelDB::Flush() {
     try {
         LogPrintf("%s: Flushing messagechannelsdb addSize:%u, removeSize:%u, seenAddressSize:%u\n", __func__, setDirtyChannelsAdd.size(), setDirtyChannelsRemove.size(), setDirtySeenAddressAdd.size());
 
+        int64_t nTimeStart = GetTimeMicros();
+        BeginBatch(gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize));
+
         for (auto channelRemove : setDirtyChannelsRemove) {
-            if (!EraseMyMessageChannel(channelRemove))
+            if (!EraseMyMessageChannel(channelRemove)) {
+                AbortBatch();
                 return error("%s: failed to erase messagechannel %s", __func__, channelRemove);
+            }
         }
 
         for (auto channelAdd : setDirtyChannelsAdd) {
-            if (!WriteMyMessageChannel(channelAdd))
+            if (!WriteMyMessageChannel(channelAdd)) {
+                AbortBatch();
                 return error("%s: failed to write messagechannel %s", __func__, channelAdd);
+            }
         }
 
         for (auto seenAddress : setDirtySeenAddressAdd) {
-            if (!WriteUsedAddress(seenAddress))
+            if (!WriteUsedAddress(seenAddress)) {
+                AbortBatch();
                 return error("%s: failed to write seenaddress %s", __func__, seenAddress);
+            }
         }
 
+        if (!CommitBatch(true))
+            return error("%s: failed to write the messagechannel batch", __func__);
+        LogPrint(BCLog::BENCHMARK, "    - Flush messagechannel db: %.2fms\n", (GetTimeMicros() - nTimeStart) * 0.001);
+
         setDirtyChannelsRemove.clear();
         setDirtyChannelsAdd.clear();
         setDirtySeenAddressAdd.clear();
         setSubscribedChannelsAskedForFalse.clear();
         setAddressAskedForFalse.clear();
     } catch (const std::runtime_error& e) {
+        AbortBatch();
         return error("%s : %s ", __func__, std::string("System error while flushing messagechannels: ") + e.what());
     }
 
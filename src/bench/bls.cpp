@@ -5,6 +5,7 @@
 
 #include "bench.h"
 #include "random.h"
+#include "bls/bls_batchverifier.h"
 #include "bls/bls_worker.h"
 #include "utiltime.h"
 
@@ -356,6 +357,48 @@ static void BLSVerify_BatchedParallel(benchmark::State& state)
     }
 }
 
+static void BLSVerify_ISLockBurstHelper(bool parallel, benchmark::State& state)
+{
+    // A burst of ISLOCKs relayed by a few peers, one of them relaying an invalid one among them
+    const size_t lockCount = 400;
+    const size_t peerCount = 8;
+
+    BLSPublicKeyVector pubKeys;
+    BLSSecretKeyVector secKeys;
+    BLSSignatureVector sigs;
+    std::vector<uint256> msgHashes;
+    std::vector<bool> invalid;
+    BuildTestVectors(lockCount, 1, pubKeys, secKeys, sigs, msgHashes, invalid);
+
+    std::set<size_t> expectedBadSources;
+    for (size_t i = 0; i < lockCount; i++) {
+        if (invalid[i]) {
+            expectedBadSources.emplace(i % peerCount);
+        }
+    }
+
+    // Benchmark.
+    while (state.KeepRunning()) {
+        CBLSBatchVerifier<size_t, uint256> batchVerifier(false, true, 0, parallel ? &blsWorker : nullptr);
+        for (size_t i = 0; i < lockCount; i++) {
+            batchVerifier.PushMessage(i % peerCount, msgHashes[i], msgHashes[i], sigs[i], pubKeys[i]);
+        }
+        batchVerifier.Verify();
+        assert(batchVerifier.badSources == expectedBadSources);
+        assert(batchVerifier.badMessages.size() == 1);
+    }
+}
+
+static void BLSVerify_ISLockBurst(benchmark::State& state)
+{
+    BLSVerify_ISLockBurstHelper(false, state);
+}
+
+static void BLSVerify_ISLockBurstParallel(benchmark::State& state)
+{
+    BLSVerify_ISLockBurstHelper(true, state);
+}
+
 BENCHMARK(BLSPubKeyAggregate_Normal)
 BENCHMARK(BLSSecKeyAggregate_Normal)
 BENCHMARK(BLSSign_Normal)
@@ -368,3 +411,5 @@ BENCHMARK(BLSVerify_LargeAggregatedBlock10000)
 BENCHMARK(BLSVerify_LargeAggregatedBlock1000PreVerified)
 BENCHMARK(BLSVerify_Batched)
 BENCHMARK(BLSVerify_BatchedParallel)
+BENCHMARK(BLSVerify_ISLockBurst)
+BENCHMARK(BLSVerify_ISLockBurstParallel)
@@ -218,6 +218,44 @@ static void HASH_GR_2048b_single(benchmark::State& state)
         hash = HashGR(in.begin(), in.end(), uint256());
 }
 
+static void HASH_GR_0080b_plan(benchmark::State& state)
+{
+    uint256 hash;
+    std::vector<uint8_t> in(80,0);
+    const GRPlan plan = MakeGRPlan(uint256());
+    while (state.KeepRunning())
+        hash = HashGR(in.begin(), in.end(), plan);
+}
+
+static void HASH_GR_0080b_midstate(benchmark::State& state)
+{
+    uint256 hash;
+    std::vector<uint8_t> in(80,0);
+    const GRMidstate midstate(MakeGRPlan(uint256()), in.data(), 76);
+    while (state.KeepRunning())
+        hash = HashGR(midstate, in.begin() + 76, in.end());
+}
+
+static void HASH_GR_0080b_batch4(benchmark::State& state)
+{
+    uint256 hashes[4];
+    std::vector<uint8_t> in(80,0);
+    const GRMidstate midstate(MakeGRPlan(uint256()), in.data(), 76);
+    const unsigned char* tails[4] = {&in[76], &in[76], &in[76], &in[76]};
+    while (state.KeepRunning())
+        HashGRBatch(midstate, tails, 4, hashes, 4);
+}
+
+static void HASH_GR_core_batch4(benchmark::State& state)
+{
+    uint512 in[4], out[4];
+    const uint512* pin[4] = {&in[0], &in[1], &in[2], &in[3]};
+    uint512* pout[4] = {&out[0], &out[1], &out[2], &out[3]};
+    while (state.KeepRunning())
+        for (int algo = 0; algo < 15; algo++)
+            coreHashN(pin, pout, 4, algo);
+}
+
 BENCHMARK(HASH_RIPEMD160);
 BENCHMARK(HASH_SHA1);
 BENCHMARK(HASH_SHA256);
@@ -238,6 +276,10 @@ BENCHMARK(HASH_DSHA256_1024b_single);
 BENCHMARK(HASH_DSHA256_2048b_single);
 BENCHMARK(HASH_GR_0032b_single);
 BENCHMARK(HASH_GR_0080b_single);
+BENCHMARK(HASH_GR_0080b_plan);
+BENCHMARK(HASH_GR_0080b_midstate);
+BENCHMARK(HASH_GR_0080b_batch4);
+BENCHMARK(HASH_GR_core_batch4);
 BENCHMARK(HASH_GR_0128b_single);
 BENCHMARK(HASH_GR_0512b_single);
 BENCHMARK(HASH_GR_1024b_single);
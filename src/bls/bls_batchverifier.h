@@ -7,10 +7,17 @@
 #define YERBAS_CRYPTO_BLS_BATCHVERIFIER_H
 
 #include "bls.h"
+#include "bls_worker.h"
 
+#include <future>
 #include <map>
+#include <set>
 #include <vector>
 
+// Verifies a batch of messages in as few aggregated pairings as possible and finds the sources (and optionally the
+// messages) which are invalid if the aggregated verification fails.
+// If a CBLSWorker is passed, large batches are split into shards which are verified concurrently on the worker pool.
+// Only shards which fail are then bisected by source to find the bad ones.
 template<typename SourceId, typename MessageId>
 class CBLSBatchVerifier
 {
@@ -26,9 +33,26 @@ private:
     typedef typename MessageMap::iterator MessageMapIterator;
     typedef std::map<SourceId, std::vector<MessageMapIterator>> MessagesBySourceMap;
 
+    // The messages of one source which ended up in the same shard
+    struct SourceMessages {
+        SourceId sourceId;
+        std::vector<MessageMapIterator> msgIts;
+    };
+    typedef std::vector<SourceMessages> Shard;
+
+    struct ShardResult {
+        std::set<SourceId> badSources;
+        std::set<MessageId> badMessages;
+    };
+
+    // Don't bother the worker pool with shards smaller than this
+    static const size_t MIN_SHARD_SIZE = 8;
+
     bool secureVerification;
     bool perMessageFallback;
     size_t subBatchSize;
+    CBLSWorker* worker;
+    size_t maxShards;
 
     MessageMap messages;
     MessagesBySourceMap messagesBySource;
@@ -38,11 +62,18 @@ public:
     std::set<MessageId> badMessages;
 
 public:
-    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0) :
+    // When a worker is passed, subBatchSize is per shard, so that each sub batch keeps all worker threads busy
+    CBLSBatchVerifier(bool _secureVerification, bool _perMessageFallback, size_t _subBatchSize = 0, CBLSWorker* _worker = nullptr) :
             secureVerification(_secureVerification),
             perMessageFallback(_perMessageFallback),
-            subBatchSize(_subBatchSize)
+            subBatchSize(_subBatchSize),
+            worker(_worker),
+            maxShards(1)
     {
+        if (worker != nullptr) {
+            // the calling thread verifies one shard itself
+            maxShards += worker->GetWorkerCount();
+        }
     }
 
     void PushMessage(const SourceId& sourceId, const MessageId& msgId, const uint256& msgHash, const CBLSSignature& sig, const CBLSPublicKey& pubKey)
@@ -52,7 +83,7 @@ public:
         auto it = messages.emplace(msgId, Message{msgId, msgHash, sig, pubKey}).first;
         messagesBySource[sourceId].emplace_back(it);
 
-        if (subBatchSize != 0 && messages.size() >= subBatchSize) {
+        if (subBatchSize != 0 && messages.size() >= subBatchSize * maxShards) {
             Verify();
             ClearMessages();
         }
@@ -66,51 +97,121 @@ public:
 
     void Verify()
     {
-        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        if (messages.empty()) {
+            return;
+        }
+
+        std::vector<Shard> shards = BuildShards();
+        std::vector<ShardResult> results(shards.size());
 
-        for (auto it = messages.begin(); it != messages.end(); ++it) {
-            byMessageHash[it->second.msgHash].emplace_back(it);
+        std::vector<std::future<void>> futures;
+        futures.reserve(shards.size() - 1);
+        for (size_t i = 1; i < shards.size(); i++) {
+            futures.emplace_back(worker->AsyncRun([this, &shards, &results, i]() {
+                VerifyShard(shards[i], results[i]);
+            }));
+        }
+        VerifyShard(shards[0], results[0]);
+        for (auto& f : futures) {
+            f.get();
         }
 
-        if (VerifyBatch(byMessageHash)) {
-            // full batch is valid
-            return;
+        for (const auto& result : results) {
+            badSources.insert(result.badSources.begin(), result.badSources.end());
+            badMessages.insert(result.badMessages.begin(), result.badMessages.end());
         }
+    }
 
-        // revert to per-source verification
+private:
+    // Splits the messages into up to maxShards shards of about the same size. The messages of a single source
+    // might end up in multiple shards, so a burst from one peer is still spread over the pool
+    std::vector<Shard> BuildShards() const
+    {
+        size_t totalCount = 0;
         for (const auto& p : messagesBySource) {
-            bool batchValid = false;
+            totalCount += p.second.size();
+        }
+        size_t shardCount = std::max<size_t>(std::min(maxShards, totalCount / MIN_SHARD_SIZE), 1);
+        size_t shardSize = (totalCount + shardCount - 1) / shardCount;
 
-            // no need to verify it again if there was just one source
-            if (messagesBySource.size() != 1) {
-                byMessageHash.clear();
-                for (auto it = p.second.begin(); it != p.second.end(); ++it) {
-                    byMessageHash[(*it)->second.msgHash].emplace_back(*it);
+        std::vector<Shard> shards(1);
+        size_t curSize = 0;
+        for (const auto& p : messagesBySource) {
+            auto it = p.second.begin();
+            while (it != p.second.end()) {
+                if (curSize == shardSize) {
+                    shards.emplace_back();
+                    curSize = 0;
                 }
-                batchValid = VerifyBatch(byMessageHash);
+                size_t n = std::min<size_t>(shardSize - curSize, p.second.end() - it);
+                shards.back().emplace_back(SourceMessages{p.first, std::vector<MessageMapIterator>(it, it + n)});
+                it += n;
+                curSize += n;
             }
-            if (!batchValid) {
-                badSources.emplace(p.first);
-
-                if (perMessageFallback) {
-                    // revert to per-message verification
-                    if (p.second.size() == 1) {
-                        // no need to re-verify a single message
-                        badMessages.emplace(p.second[0]->second.msgId);
-                    } else {
-                        for (const auto& msgIt : p.second) {
-                            if (badMessages.count(msgIt->first)) {
-                                // same message might be invalid from different source, so no need to re-verify it
-                                continue;
-                            }
-
-                            const auto& msg = msgIt->second;
-                            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
-                                badMessages.emplace(msg.msgId);
-                            }
-                        }
-                    }
-                }
+        }
+        return shards;
+    }
+
+    void VerifyShard(const Shard& shard, ShardResult& result) const
+    {
+        if (!VerifySources(shard, 0, shard.size())) {
+            BisectSources(shard, 0, shard.size(), result);
+        }
+    }
+
+    bool VerifySources(const Shard& shard, size_t start, size_t end) const
+    {
+        std::map<uint256, std::vector<MessageMapIterator>> byMessageHash;
+        for (size_t i = start; i < end; i++) {
+            for (const auto& msgIt : shard[i].msgIts) {
+                byMessageHash[msgIt->second.msgHash].emplace_back(msgIt);
+            }
+        }
+        return VerifyBatch(byMessageHash);
+    }
+
+    // The sources in [start, end) failed to verify as one batch, find the bad ones
+    void BisectSources(const Shard& shard, size_t start, size_t end, ShardResult& result) const
+    {
+        if (end - start == 1) {
+            MarkBadSource(shard[start], result);
+            return;
+        }
+
+        size_t mid = start + (end - start) / 2;
+        bool firstValid = VerifySources(shard, start, mid);
+        if (!firstValid) {
+            BisectSources(shard, start, mid, result);
+        }
+        // if the first half is valid, the second half is what failed, so no need to verify it again
+        if (firstValid || !VerifySources(shard, mid, end)) {
+            BisectSources(shard, mid, end, result);
+        }
+    }
+
+    void MarkBadSource(const SourceMessages& source, ShardResult& result) const
+    {
+        result.badSources.emplace(source.sourceId);
+
+        if (!perMessageFallback) {
+            return;
+        }
+
+        // revert to per-message verification
+        if (source.msgIts.size() == 1) {
+            // no need to re-verify a single message
+            result.badMessages.emplace(source.msgIts[0]->second.msgId);
+            return;
+        }
+        for (const auto& msgIt : source.msgIts) {
+            if (result.badMessages.count(msgIt->first)) {
+                // same message might be invalid from different source, so no need to re-verify it
+                continue;
+            }
+
+            const auto& msg = msgIt->second;
+            if (!msg.sig.VerifyInsecure(msg.pubKey, msg.msgHash)) {
+                result.badMessages.emplace(msg.msgId);
             }
         }
     }
@@ -119,7 +220,7 @@ private:
     // All Verify methods take ownership of the passed byMessageHash map and thus might modify the map. This is to avoid
     // unnecessary copies
 
-    bool VerifyBatch(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatch(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         if (secureVerification) {
             return VerifyBatchSecure(byMessageHash);
@@ -128,7 +229,7 @@ private:
         }
     }
 
-    bool VerifyBatchInsecure(const std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchInsecure(const std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         CBLSSignature aggSig;
         std::vector<uint256> msgHashes;
@@ -179,7 +280,7 @@ private:
         return aggSig.VerifyInsecureAggregated(pubKeys, msgHashes);
     }
 
-    bool VerifyBatchSecure(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchSecure(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         // Loop until the byMessageHash map is empty, which means that all messages were verified
         // The secure form of verification will only aggregate one message for the same message hash, even if multiple
@@ -193,7 +294,7 @@ private:
         return true;
     }
 
-    bool VerifyBatchSecureStep(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash)
+    bool VerifyBatchSecureStep(std::map<uint256, std::vector<MessageMapIterator>>& byMessageHash) const
     {
         CBLSSignature aggSig;
         std::vector<uint256> msgHashes;
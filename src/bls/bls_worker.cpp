@@ -888,6 +888,18 @@ bool CBLSWorker::IsAsyncVerifyInProgress()
     return sigVerifyBatchesInProgress != 0;
 }
 
+int CBLSWorker::GetWorkerCount()
+{
+    return workerPool.size();
+}
+
+std::future<void> CBLSWorker::AsyncRun(std::function<void()> func)
+{
+    return workerPool.push([func](int threadId) {
+        func();
+    });
+}
+
 // sigVerifyMutex must be held while calling
 void CBLSWorker::PushSigVerifyBatch()
 {
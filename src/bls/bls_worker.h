@@ -140,6 +140,11 @@ public:
     std::future<bool> AsyncVerifySig(const CBLSSignature& sig, const CBLSPublicKey& pubKey, const uint256& msgHash, CancelCond cancelCond = [] { return false; });
     bool IsAsyncVerifyInProgress();
 
+    // Number of threads in the worker pool, 0 while the worker is not started
+    int GetWorkerCount();
+    // Runs an arbitrary job on the worker pool, e.g. a shard of a CBLSBatchVerifier batch
+    std::future<void> AsyncRun(std::function<void()> func);
+
 private:
     void PushSigVerifyBatch();
 };
@@ -217,20 +217,23 @@ void AddCoins(CCoinsViewCache& cache, const CTransaction &tx, int nHeight, uint2
         bool overwrite = check ? cache.HaveCoin(COutPoint(txid, i)) : fCoinbase;
         // Always set the possible_overwrite flag to AddCoin for coinbase txn, in order to correctly
         // deal with the pre-BIP30 occurrences of duplicate coinbase transactions.
-        cache.AddCoin(COutPoint(txid, i), Coin(tx.vout[i], nHeight, fCoinbase), overwrite);
+        Coin coin(tx.vout[i], nHeight, fCoinbase);
+        // Keep the decoded asset fields, the coin is moved into the cache
+        CAssetOutputDataRef assetOutput = coin.assetOutput;
+        cache.AddCoin(COutPoint(txid, i), std::move(coin), overwrite);
     
         /** YERB ASSETS START */
         if (Params().IsAssetsActive(chainActive.Tip())) {
             if (assetsCache) {
                 CAssetOutputEntry assetData;
-                if (GetAssetData(tx.vout[i].scriptPubKey, assetData)) {
+                if (assetOutput && GetAssetData(*assetOutput, assetData)) {
 
                     // If this is a transfer asset, and the amount is greater than zero
                     // We want to make sure it is added to the asset addresses database if (fAssetIndex == true)
                     if (assetData.type == TX_TRANSFER_ASSET && assetData.nAmount > 0) {
                         // Create the objects needed from the assetData
                         CAssetTransfer assetTransfer(assetData.assetName, assetData.nAmount, assetData.message, assetData.expireTime);
-                        std::string address = EncodeDestination(assetData.destination);
+                        const std::string& address = assetOutput->strAddress;
 
                         // Add the transfer asset data to the asset cache
                         if (!assetsCache->AddTransferAsset(assetTransfer, address, COutPoint(txid, i), tx.vout[i]))
@@ -335,7 +338,7 @@ bool CCoinsViewCache::SpendCoin(const COutPoint &outpoint, Coin* moveout, CAsset
     /** YERB START */
     if (AreAssetsDeployed()) {
         if (assetsCache) {
-            if (!assetsCache->TrySpendCoin(outpoint, tempCoin.out)) {
+            if (!assetsCache->TrySpendCoin(outpoint, tempCoin)) {
                 return error("%s : Failed to try and spend the asset. COutPoint : %s", __func__, outpoint.ToString());
             }
         }
@@ -40,14 +40,23 @@ public:
     //! at which height this containing transaction was included in the active block chain
     uint32_t nHeight : 31;
 
+    //! decoded asset fields of out, nullptr if out isn't an asset output.
+    //! Shared between copies of the coin, code changing out directly must call UpdateAssetOutput().
+    CAssetOutputDataRef assetOutput;
+
     //! construct a Coin from a CTxOut and height/coinbase information.
-    Coin(CTxOut&& outIn, int nHeightIn, bool fCoinBaseIn) : out(std::move(outIn)), fCoinBase(fCoinBaseIn), nHeight(nHeightIn) {}
-    Coin(const CTxOut& outIn, int nHeightIn, bool fCoinBaseIn) : out(outIn), fCoinBase(fCoinBaseIn),nHeight(nHeightIn) {}
+    Coin(CTxOut&& outIn, int nHeightIn, bool fCoinBaseIn) : out(std::move(outIn)), fCoinBase(fCoinBaseIn), nHeight(nHeightIn), assetOutput(DecodeAssetOutput(out.scriptPubKey)) {}
+    Coin(const CTxOut& outIn, int nHeightIn, bool fCoinBaseIn) : out(outIn), fCoinBase(fCoinBaseIn),nHeight(nHeightIn), assetOutput(DecodeAssetOutput(out.scriptPubKey)) {}
 
     void Clear() {
         out.SetNull();
         fCoinBase = false;
         nHeight = 0;
+        assetOutput.reset();
+    }
+
+    void UpdateAssetOutput() {
+        assetOutput = DecodeAssetOutput(out.scriptPubKey);
     }
 
     //! empty constructor
@@ -72,6 +81,7 @@ public:
         nHeight = code >> 1;
         fCoinBase = code & 1;
         ::Unserialize(s, REF(CTxOutCompressor(out)));
+        UpdateAssetOutput();
     }
 
     bool IsSpent() const {
@@ -79,11 +89,11 @@ public:
     }
 
     bool IsAsset() const {
-        return out.scriptPubKey.IsAssetScript();
+        return assetOutput != nullptr;
     }
 
     size_t DynamicMemoryUsage() const {
-        return memusage::DynamicUsage(out.scriptPubKey);
+        return memusage::DynamicUsage(out.scriptPubKey) + memusage::DynamicUsage(assetOutput);
     }
 };
 
@@ -177,6 +177,8 @@ struct Params {
     int64_t nPowTargetTimespan;
     int nPowDGWHeight;
     int DGWBlocksAvg;
+    /** Last height whose nBits only loosely match DGW, a leftover of the DGW v1/v2 architecture issues, 0 for none */
+    int nPowLooseBitsHeight{0};
     int64_t DifficultyAdjustmentInterval() const { return nPowTargetTimespan / nPowTargetSpacing; }
     uint256 nMinimumChainWork;
     uint256 defaultAssumeValid;
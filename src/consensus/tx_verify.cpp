@@ -640,8 +640,8 @@ bool Consensus::CheckTxAssets(const CTransaction& tx, CValidationState& state, c
         assert(!coin.IsSpent());
 
         if (coin.IsAsset()) {
-            CAssetOutputEntry data;
-            if (!GetAssetData(coin.out.scriptPubKey, data))
+            const CAssetOutputData& data = *coin.assetOutput;
+            if (!data.fValid)
                 return state.DoS(100, false, REJECT_INVALID, "bad-txns-failed-to-get-asset-from-script");
 
             // Add to the total value of assets in the inputs
@@ -649,9 +649,9 @@ bool Consensus::CheckTxAssets(const CTransaction& tx, CValidationState& state, c
                 totalInputs.at(data.assetName) += data.nAmount;
             else
                 totalInputs.insert(make_pair(data.assetName, data.nAmount));
-                mapAddresses.insert(make_pair(data.assetName,EncodeDestination(data.destination)));
+                mapAddresses.insert(make_pair(data.assetName, data.strAddress));
             if (IsAssetNameAnRestricted(data.assetName)) {
-                if (assetCache->CheckForAddressRestriction(data.assetName, EncodeDestination(data.destination), true)) {
+                if (assetCache->CheckForAddressRestriction(data.assetName, data.strAddress, true)) {
                     return state.DoS(100, false, REJECT_INVALID, "bad-txns-restricted-asset-transfer-from-frozen-address");
                 }
             }
@@ -0,0 +1,41 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifdef ENABLE_AVX2
+
+#include <stdint.h>
+#include <immintrin.h>
+
+#include "crypto/sph_multi_impl.h"
+
+namespace sph_multi_avx2 {
+namespace {
+
+struct Vec4 {
+    typedef __m256i T;
+    static const int LANES = 4;
+
+    static inline T Load(const uint64_t* w) { return _mm256_loadu_si256((const __m256i*)w); }
+    static inline void Store(uint64_t* w, T x) { _mm256_storeu_si256((__m256i*)w, x); }
+    static inline T Set1(uint64_t x) { return _mm256_set1_epi64x(x); }
+    static inline T Xor(T x, T y) { return _mm256_xor_si256(x, y); }
+    /** ~x & y */
+    static inline T AndNot(T x, T y) { return _mm256_andnot_si256(x, y); }
+    static inline T Add(T x, T y) { return _mm256_add_epi64(x, y); }
+    template<int N> static inline T RotL(T x) { return _mm256_or_si256(_mm256_slli_epi64(x, N), _mm256_srli_epi64(x, 64 - N)); }
+};
+
+template<> inline __m256i Vec4::RotL<32>(__m256i x) { return _mm256_shuffle_epi32(x, 0xB1); }
+template<> inline __m256i Vec4::RotL<48>(__m256i x) { return _mm256_shuffle_epi8(x, _mm256_set_epi8(9, 8, 15, 14, 13, 12, 11, 10, 1, 0, 7, 6, 5, 4, 3, 2, 9, 8, 15, 14, 13, 12, 11, 10, 1, 0, 7, 6, 5, 4, 3, 2)); }
+template<> inline __m256i Vec4::RotL<56>(__m256i x) { return _mm256_shuffle_epi8(x, _mm256_set_epi8(8, 15, 14, 13, 12, 11, 10, 9, 0, 7, 6, 5, 4, 3, 2, 1, 8, 15, 14, 13, 12, 11, 10, 9, 0, 7, 6, 5, 4, 3, 2, 1)); }
+template<> inline __m256i Vec4::RotL<8>(__m256i x) { return _mm256_shuffle_epi8(x, _mm256_set_epi8(14, 13, 12, 11, 10, 9, 8, 15, 6, 5, 4, 3, 2, 1, 0, 7, 14, 13, 12, 11, 10, 9, 8, 15, 6, 5, 4, 3, 2, 1, 0, 7)); }
+
+} // namespace
+
+void Keccak512_4way(unsigned char* const out[], const unsigned char* const in[]) { Keccak512_64<Vec4>(out, in); }
+void Blake512_4way(unsigned char* const out[], const unsigned char* const in[]) { Blake512_64<Vec4>(out, in); }
+
+} // namespace sph_multi_avx2
+
+#endif
@@ -0,0 +1,197 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// Multi-lane versions of the sph 512 bit functions that are built from
+// 64 bit word operations, hashing one 64 byte message per lane. Shared by
+// the SSE2 and AVX2 builds: V wraps one vector type and provides Load/Store
+// of V::LANES consecutive words plus the basic word operations, with the
+// rotation count as a template argument so it can be specialized.
+// Only include this from the per-ISA translation units.
+
+#ifndef BITCOIN_CRYPTO_SPH_MULTI_IMPL_H
+#define BITCOIN_CRYPTO_SPH_MULTI_IMPL_H
+
+#include <stdint.h>
+
+#include "crypto/common.h"
+
+namespace {
+
+template<typename V>
+inline void KeccakXorRow(typename V::T* a, const typename V::T* d)
+{
+    a[0] = V::Xor(a[0], d[0]);
+    a[1] = V::Xor(a[1], d[1]);
+    a[2] = V::Xor(a[2], d[2]);
+    a[3] = V::Xor(a[3], d[3]);
+    a[4] = V::Xor(a[4], d[4]);
+}
+
+template<typename V>
+inline void KeccakChiRow(typename V::T* a, const typename V::T* b)
+{
+    a[0] = V::Xor(b[0], V::AndNot(b[1], b[2]));
+    a[1] = V::Xor(b[1], V::AndNot(b[2], b[3]));
+    a[2] = V::Xor(b[2], V::AndNot(b[3], b[4]));
+    a[3] = V::Xor(b[3], V::AndNot(b[4], b[0]));
+    a[4] = V::Xor(b[4], V::AndNot(b[0], b[1]));
+}
+
+template<typename V>
+void Keccak512_64(unsigned char* const out[], const unsigned char* const in[])
+{
+    typedef typename V::T T;
+    static const uint64_t RC[24] = {
+        0x0000000000000001ULL, 0x0000000000008082ULL, 0x800000000000808AULL, 0x8000000080008000ULL,
+        0x000000000000808BULL, 0x0000000080000001ULL, 0x8000000080008081ULL, 0x8000000000008009ULL,
+        0x000000000000008AULL, 0x0000000000000088ULL, 0x0000000080008009ULL, 0x000000008000000AULL,
+        0x000000008000808BULL, 0x800000000000008BULL, 0x8000000000008089ULL, 0x8000000000008003ULL,
+        0x8000000000008002ULL, 0x8000000000000080ULL, 0x000000000000800AULL, 0x800000008000000AULL,
+        0x8000000080008081ULL, 0x8000000000008080ULL, 0x0000000080000001ULL, 0x8000000080008008ULL
+    };
+
+    uint64_t w[V::LANES];
+    T A[25], B[25], C[5], D[5];
+
+    // 64 message bytes, then the 0x01 ... 0x80 padding inside the 72 byte rate
+    for (int i = 0; i < 8; ++i) {
+        for (int l = 0; l < V::LANES; ++l) w[l] = ReadLE64(in[l] + 8 * i);
+        A[i] = V::Load(w);
+    }
+    A[8] = V::Set1(0x8000000000000001ULL);
+    for (int i = 9; i < 25; ++i) A[i] = V::Set1(0);
+
+    for (int r = 0; r < 24; ++r) {
+        // theta, the 5 word rows are written out as the compiler won't unroll them at -O2
+        for (int x = 0; x < 5; ++x) {
+            C[x] = V::Xor(V::Xor(A[x], A[x + 5]), V::Xor(V::Xor(A[x + 10], A[x + 15]), A[x + 20]));
+        }
+        D[0] = V::Xor(C[4], V::template RotL<1>(C[1]));
+        D[1] = V::Xor(C[0], V::template RotL<1>(C[2]));
+        D[2] = V::Xor(C[1], V::template RotL<1>(C[3]));
+        D[3] = V::Xor(C[2], V::template RotL<1>(C[4]));
+        D[4] = V::Xor(C[3], V::template RotL<1>(C[0]));
+        for (int y = 0; y < 25; y += 5) {
+            KeccakXorRow<V>(A + y, D);
+        }
+        // rho and pi, unrolled so that every rotation count is a constant
+        B[0] = A[0];
+        B[10] = V::template RotL<1>(A[1]);
+        B[20] = V::template RotL<62>(A[2]);
+        B[5] = V::template RotL<28>(A[3]);
+        B[15] = V::template RotL<27>(A[4]);
+        B[16] = V::template RotL<36>(A[5]);
+        B[1] = V::template RotL<44>(A[6]);
+        B[11] = V::template RotL<6>(A[7]);
+        B[21] = V::template RotL<55>(A[8]);
+        B[6] = V::template RotL<20>(A[9]);
+        B[7] = V::template RotL<3>(A[10]);
+        B[17] = V::template RotL<10>(A[11]);
+        B[2] = V::template RotL<43>(A[12]);
+        B[12] = V::template RotL<25>(A[13]);
+        B[22] = V::template RotL<39>(A[14]);
+        B[23] = V::template RotL<41>(A[15]);
+        B[8] = V::template RotL<45>(A[16]);
+        B[18] = V::template RotL<15>(A[17]);
+        B[3] = V::template RotL<21>(A[18]);
+        B[13] = V::template RotL<8>(A[19]);
+        B[14] = V::template RotL<18>(A[20]);
+        B[24] = V::template RotL<2>(A[21]);
+        B[9] = V::template RotL<61>(A[22]);
+        B[19] = V::template RotL<56>(A[23]);
+        B[4] = V::template RotL<14>(A[24]);
+        // chi
+        for (int y = 0; y < 25; y += 5) {
+            KeccakChiRow<V>(A + y, B + y);
+        }
+        A[0] = V::Xor(A[0], V::Set1(RC[r]));
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        V::Store(w, A[i]);
+        for (int l = 0; l < V::LANES; ++l) WriteLE64(out[l] + 8 * i, w[l]);
+    }
+}
+
+template<typename V>
+void Blake512_64(unsigned char* const out[], const unsigned char* const in[])
+{
+    typedef typename V::T T;
+    static const uint64_t IV[8] = {
+        0x6A09E667F3BCC908ULL, 0xBB67AE8584CAA73BULL, 0x3C6EF372FE94F82BULL, 0xA54FF53A5F1D36F1ULL,
+        0x510E527FADE682D1ULL, 0x9B05688C2B3E6C1FULL, 0x1F83D9ABFB41BD6BULL, 0x5BE0CD19137E2179ULL
+    };
+    static const uint64_t CB[16] = {
+        0x243F6A8885A308D3ULL, 0x13198A2E03707344ULL, 0xA4093822299F31D0ULL, 0x082EFA98EC4E6C89ULL,
+        0x452821E638D01377ULL, 0xBE5466CF34E90C6CULL, 0xC0AC29B7C97C50DDULL, 0x3F84D5B5B5470917ULL,
+        0x9216D5D98979FB1BULL, 0xD1310BA698DFB5ACULL, 0x2FFD72DBD01ADFB7ULL, 0xB8E1AFED6A267E96ULL,
+        0xBA7C9045F12C7F99ULL, 0x24A19947B3916CF7ULL, 0x0801F2E2858EFC16ULL, 0x636920D871574E69ULL
+    };
+    static const uint8_t SIGMA[10][16] = {
+        { 0,  1,  2,  3,  4,  5,  6,  7,  8,  9, 10, 11, 12, 13, 14, 15},
+        {14, 10,  4,  8,  9, 15, 13,  6,  1, 12,  0,  2, 11,  7,  5,  3},
+        {11,  8, 12,  0,  5,  2, 15, 13, 10, 14,  3,  6,  7,  1,  9,  4},
+        { 7,  9,  3,  1, 13, 12, 11, 14,  2,  6,  5, 10,  4,  0, 15,  8},
+        { 9,  0,  5,  7,  2,  4, 10, 15, 14,  1, 11, 12,  6,  8,  3, 13},
+        { 2, 12,  6, 10,  0, 11,  8,  3,  4, 13,  7,  5, 15, 14,  1,  9},
+        {12,  5,  1, 15, 14, 13,  4, 10,  0,  7,  6,  3,  9,  2,  8, 11},
+        {13, 11,  7, 14, 12,  1,  3,  9,  5,  0, 15,  4,  8,  6,  2, 10},
+        { 6, 15, 14,  9, 11,  3,  0,  8, 12,  2, 13,  7,  1,  4, 10,  5},
+        {10,  2,  8,  4,  7,  6,  1,  5, 15, 11,  9, 14,  3, 12, 13,  0}
+    };
+    static const int G_IDX[8][4] = {
+        {0, 4,  8, 12}, {1, 5,  9, 13}, {2, 6, 10, 14}, {3, 7, 11, 15},
+        {0, 5, 10, 15}, {1, 6, 11, 12}, {2, 7,  8, 13}, {3, 4,  9, 14}
+    };
+
+    uint64_t w[V::LANES];
+    T M[16], v[16];
+
+    // A 64 byte message fits in a single block: 0x80 pad byte, the final
+    // 0x01 marker of BLAKE-512 and a 512 bit length counter
+    for (int i = 0; i < 8; ++i) {
+        for (int l = 0; l < V::LANES; ++l) w[l] = ReadBE64(in[l] + 8 * i);
+        M[i] = V::Load(w);
+    }
+    M[8] = V::Set1(0x8000000000000000ULL);
+    for (int i = 9; i < 13; ++i) M[i] = V::Set1(0);
+    M[13] = V::Set1(1);
+    M[14] = V::Set1(0);
+    M[15] = V::Set1(512);
+
+    for (int i = 0; i < 8; ++i) v[i] = V::Set1(IV[i]);
+    for (int i = 0; i < 4; ++i) v[8 + i] = V::Set1(CB[i]);
+    v[12] = V::Set1(512 ^ CB[4]);
+    v[13] = V::Set1(512 ^ CB[5]);
+    v[14] = V::Set1(CB[6]);
+    v[15] = V::Set1(CB[7]);
+
+    for (int r = 0; r < 16; ++r) {
+        const uint8_t* s = SIGMA[r % 10];
+        for (int g = 0; g < 8; ++g) {
+            T& a = v[G_IDX[g][0]];
+            T& b = v[G_IDX[g][1]];
+            T& c = v[G_IDX[g][2]];
+            T& d = v[G_IDX[g][3]];
+            const int e0 = s[2 * g], e1 = s[2 * g + 1];
+            a = V::Add(V::Add(a, b), V::Xor(M[e0], V::Set1(CB[e1])));
+            d = V::template RotL<32>(V::Xor(d, a));
+            c = V::Add(c, d);
+            b = V::template RotL<39>(V::Xor(b, c));
+            a = V::Add(V::Add(a, b), V::Xor(M[e1], V::Set1(CB[e0])));
+            d = V::template RotL<48>(V::Xor(d, a));
+            c = V::Add(c, d);
+            b = V::template RotL<53>(V::Xor(b, c));
+        }
+    }
+
+    for (int i = 0; i < 8; ++i) {
+        V::Store(w, V::Xor(V::Set1(IV[i]), V::Xor(v[i], v[i + 8])));
+        for (int l = 0; l < V::LANES; ++l) WriteBE64(out[l] + 8 * i, w[l]);
+    }
+}
+
+} // namespace
+
+#endif // BITCOIN_CRYPTO_SPH_MULTI_IMPL_H
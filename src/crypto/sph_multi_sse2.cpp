@@ -0,0 +1,39 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#if defined(__SSE2__)
+
+#include <stdint.h>
+#include <emmintrin.h>
+
+#include "crypto/sph_multi_impl.h"
+
+// Only keccak gains from two lanes, without byte shuffles BLAKE's rotations
+// make the 2-way version slower than the scalar code.
+namespace sph_multi_sse2 {
+namespace {
+
+struct Vec2 {
+    typedef __m128i T;
+    static const int LANES = 2;
+
+    static inline T Load(const uint64_t* w) { return _mm_loadu_si128((const __m128i*)w); }
+    static inline void Store(uint64_t* w, T x) { _mm_storeu_si128((__m128i*)w, x); }
+    static inline T Set1(uint64_t x) { return _mm_set1_epi64x(x); }
+    static inline T Xor(T x, T y) { return _mm_xor_si128(x, y); }
+    /** ~x & y */
+    static inline T AndNot(T x, T y) { return _mm_andnot_si128(x, y); }
+    static inline T Add(T x, T y) { return _mm_add_epi64(x, y); }
+    template<int N> static inline T RotL(T x) { return _mm_or_si128(_mm_slli_epi64(x, N), _mm_srli_epi64(x, 64 - N)); }
+};
+
+template<> inline __m128i Vec2::RotL<32>(__m128i x) { return _mm_shuffle_epi32(x, 0xB1); }
+
+} // namespace
+
+void Keccak512_2way(unsigned char* const out[], const unsigned char* const in[]) { Keccak512_64<Vec2>(out, in); }
+
+} // namespace sph_multi_sse2
+
+#endif
@@ -5,13 +5,18 @@
 // Portions Copyright (c) 2018 The Monero developers
 // Portions Copyright (c) 2018 The TurtleCoin Developers
 
+#if defined(HAVE_CONFIG_H)
+#include "yerbas-config.h"
+#endif
+
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <unistd.h>
 #include "slow-hash.h"
-#include "oaes_lib.h"
 #include "c_keccak.h"
 #include "c_groestl.h"
 #include "c_blake256.h"
@@ -20,12 +25,26 @@
 #include "int-util.h"
 #include "variant2_int_sqrt.h"
 
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#if defined(ENABLE_AESNI) && !defined(BUILD_BITCOIN_INTERNAL) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+#define USE_AESNI 1
+#include <cpuid.h>
+#endif
+
 #if defined(_MSC_VER)
-#include <malloc.h>
+#define THREADV __declspec(thread)
+#else
+#define THREADV __thread
 #endif
 
 #define AES_BLOCK_SIZE  16
 #define AES_KEY_SIZE    32 /*16*/
+#define AES_EXP_KEY_SIZE 240
 #define INIT_SIZE_BLK   8
 #define INIT_SIZE_BYTE  (INIT_SIZE_BLK * AES_BLOCK_SIZE)
 
@@ -145,6 +164,13 @@ static void (* const extra_hashes[4])(const void *, size_t, char *) = {
 extern int aesb_single_round(const uint8_t *in, uint8_t *out, const uint8_t *expandedKey);
 extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *expandedKey);
 
+#if defined(USE_AESNI)
+/* slow-hash_aesni.c */
+void cn_aesni_explode(uint8_t* text, uint8_t* long_state, size_t init_rounds, const uint8_t* expandedKey);
+void cn_aesni_main_loop(uint8_t* long_state, uint8_t* a, uint8_t* b, int variant, uint64_t tweak1_2, uint32_t iterations, size_t aes_rounds);
+void cn_aesni_implode(uint8_t* text, const uint8_t* long_state, size_t init_rounds, const uint8_t* expandedKey);
+#endif
+
 static inline size_t e2i(const uint8_t* a, size_t count) {
     return (*((uint64_t*) a) / AES_BLOCK_SIZE) & (count - 1);
 }
@@ -191,42 +217,182 @@ static inline void xor_blocks_dst(const uint8_t* a, const uint8_t* b, uint8_t* d
     ((uint64_t*) dst)[1] = ((uint64_t*) a)[1] ^ ((uint64_t*) b)[1];
 }
 
-void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+static const uint8_t saes_sbox[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16
+};
+
+/**
+ * AES-256 key schedule, identical to the one produced by oaes_key_import_data
+ * but written into a caller provided buffer instead of freshly allocated memory.
+ */
+static void aes_expand_key(const uint8_t* key, uint8_t* expandedKey) {
+    static const uint8_t rcon[8] = { 0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80 };
+    const size_t key_words = AES_KEY_SIZE / 4;
+    size_t i, k;
+    uint8_t t[4], tmp;
+
+    memcpy(expandedKey, key, AES_KEY_SIZE);
+    for (i = key_words; i < AES_EXP_KEY_SIZE / 4; i++) {
+        memcpy(t, &expandedKey[(i - 1) * 4], 4);
+        if (i % key_words == 0) {
+            tmp = t[0];
+            t[0] = saes_sbox[t[1]] ^ rcon[i / key_words - 1];
+            t[1] = saes_sbox[t[2]];
+            t[2] = saes_sbox[t[3]];
+            t[3] = saes_sbox[tmp];
+        } else if (i % key_words == 4) {
+            for (k = 0; k < 4; k++) {
+                t[k] = saes_sbox[t[k]];
+            }
+        }
+        for (k = 0; k < 4; k++) {
+            expandedKey[i * 4 + k] = expandedKey[(i - key_words) * 4 + k] ^ t[k];
+        }
+    }
+}
+
+/*
+ * Per-thread scratchpad, sized for the largest variant (CN_MAX_PAGE_SIZE) and
+ * shared by all of them. It is allocated on first use and kept until
+ * cn_slow_hash_free_state() is called from the owning thread, so repeated
+ * hashing does not go through the allocator nor fault in fresh pages.
+ */
+static THREADV uint8_t* hp_state = NULL;
+static THREADV int hp_mapped = 0;
+static THREADV uint8_t aes_exp_key[AES_EXP_KEY_SIZE];
+
+void cn_slow_hash_allocate_state(void)
+{
+    if (hp_state != NULL)
+        return;
+
+#if defined(_WIN32)
+    hp_state = (uint8_t*)VirtualAlloc(NULL, CN_MAX_PAGE_SIZE, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    hp_mapped = hp_state != NULL;
+#else
+#if defined(MAP_HUGETLB)
+    /* Explicit huge pages only succeed if the admin reserved some (vm.nr_hugepages) */
+    hp_state = (uint8_t*)mmap(NULL, CN_MAX_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+    if (hp_state == MAP_FAILED)
+        hp_state = NULL;
+#endif
+#if defined(MAP_ANONYMOUS)
+    if (hp_state == NULL) {
+        hp_state = (uint8_t*)mmap(NULL, CN_MAX_PAGE_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (hp_state == MAP_FAILED) {
+            hp_state = NULL;
+        }
+#if defined(MADV_HUGEPAGE)
+        else {
+            /* Fall back to transparent huge pages where the kernel supports them */
+            madvise(hp_state, CN_MAX_PAGE_SIZE, MADV_HUGEPAGE);
+        }
+#endif
+    }
+#endif
+    hp_mapped = hp_state != NULL;
+#endif
+
+    if (hp_state == NULL) {
+        hp_state = (uint8_t*)malloc(CN_MAX_PAGE_SIZE);
+        hp_mapped = 0;
+    }
+    if (hp_state == NULL) {
+        fprintf(stderr, "Cryptonight failed to allocate its %d byte scratchpad\n", CN_MAX_PAGE_SIZE);
+        _exit(1);
+    }
+}
+
+void cn_slow_hash_free_state(void)
+{
+    if (hp_state == NULL)
+        return;
+
+    if (!hp_mapped) {
+        free(hp_state);
+    } else {
+#if defined(_WIN32)
+        VirtualFree(hp_state, 0, MEM_RELEASE);
+#else
+        munmap(hp_state, CN_MAX_PAGE_SIZE);
+#endif
+    }
+    hp_state = NULL;
+    hp_mapped = 0;
+}
+
+/* -1: not detected yet, 0: portable, 1: AES-NI. Detected by init, or by the
+   first hash of a program which doesn't call cn_slow_hash_autodetect. Every
+   thread comes to the same result, so relaxed accesses are enough. */
+static atomic_int cn_use_aesni = ATOMIC_VAR_INIT(-1);
+
+static int cn_detect_aesni(void)
+{
+#if defined(USE_AESNI)
+    unsigned int eax, ebx, ecx, edx;
+    int use_aesni = __get_cpuid(1, &eax, &ebx, &ecx, &edx) && ((ecx >> 25) & 1);
+#else
+    int use_aesni = 0;
+#endif
+    atomic_store_explicit(&cn_use_aesni, use_aesni, memory_order_relaxed);
+    return use_aesni;
+}
+
+const char* cn_slow_hash_autodetect(void)
+{
+    return cn_detect_aesni() ? "aesni" : "portable";
+}
+
+static void cn_slow_hash_internal(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds, int use_aesni)
 {
   union cn_slow_hash_state state;
   uint8_t text[INIT_SIZE_BYTE];
   uint8_t a[AES_BLOCK_SIZE];
   uint8_t b[AES_BLOCK_SIZE * 2];
   uint8_t c[AES_BLOCK_SIZE];
-  uint8_t aes_key[AES_KEY_SIZE];
-  oaes_ctx* aes_ctx;
 
   size_t init_rounds = (page_size / INIT_SIZE_BYTE);
 
-#if defined(_MSC_VER)
-  uint8_t *long_state = (uint8_t *)_malloca(page_size);
-#else
-#if defined(__APPLE__)
-  uint8_t *long_state = (uint8_t *)calloc(page_size, sizeof(uint8_t));
-#else
-  uint8_t *long_state = (uint8_t *)malloc(page_size);
-#endif
-#endif
+  assert(page_size <= CN_MAX_PAGE_SIZE);
+  cn_slow_hash_allocate_state();
+  uint8_t *long_state = hp_state;
+
   hash_process(&state.hs, (const uint8_t*) input, len);
   memcpy(text, state.init, INIT_SIZE_BYTE);
-  memcpy(aes_key, state.hs.b, AES_KEY_SIZE);
-  aes_ctx = (oaes_ctx*) oaes_alloc();
   size_t i, j;
 
   VARIANT1_INIT();
   VARIANT2_INIT(b, state);
 
-  oaes_key_import_data(aes_ctx, aes_key, AES_KEY_SIZE);
+  /* The hardware path only implements the variants used by GhostRider */
+  use_aesni = use_aesni && variant < 2;
+
+  aes_expand_key(state.hs.b, aes_exp_key);
+#if defined(USE_AESNI)
+  if (use_aesni) {
+    cn_aesni_explode(text, long_state, init_rounds, aes_exp_key);
+  } else
+#endif
   for (i = 0; i < init_rounds; i++) {
     for (j = 0; j < INIT_SIZE_BLK; j++) {
       aesb_pseudo_round(&text[AES_BLOCK_SIZE * j],
       &text[AES_BLOCK_SIZE * j],
-      aes_ctx->key->exp_data);
+      aes_exp_key);
     }
     memcpy(&long_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
   }
@@ -236,6 +402,11 @@ void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_
     b[i] = state.k[16 + i] ^ state.k[48 + i];
   }
 
+#if defined(USE_AESNI)
+  if (use_aesni) {
+    cn_aesni_main_loop(long_state, a, b, variant, tweak1_2, iterations, aes_rounds);
+  } else
+#endif
   for (i = 0; i < iterations; i++) {
     /* Dependency chain: address -> read value ------+
     * written value <-+ hard function (AES or MUL) <+
@@ -279,19 +450,36 @@ void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_
   }
 
   memcpy(text, state.init, INIT_SIZE_BYTE);
-  oaes_key_import_data(aes_ctx, &state.hs.b[32], AES_KEY_SIZE);
+  aes_expand_key(&state.hs.b[32], aes_exp_key);
+#if defined(USE_AESNI)
+  if (use_aesni) {
+    cn_aesni_implode(text, long_state, init_rounds, aes_exp_key);
+  } else
+#endif
   for (i = 0; i < init_rounds; i++) {
     for (j = 0; j < INIT_SIZE_BLK; j++) {
       xor_blocks(&text[j * AES_BLOCK_SIZE], &long_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
-      aesb_pseudo_round(&text[j * AES_BLOCK_SIZE], &text[j * AES_BLOCK_SIZE], aes_ctx->key->exp_data);
+      aesb_pseudo_round(&text[j * AES_BLOCK_SIZE], &text[j * AES_BLOCK_SIZE], aes_exp_key);
     }
   }
   memcpy(state.init, text, INIT_SIZE_BYTE);
   hash_permutation(&state.hs);
   /*memcpy(hash, &state, 32);*/
   extra_hashes[state.hs.b[0] & 3](&state, 200, output);
-  oaes_free((OAES_CTX **) &aes_ctx);
-  free(long_state);
+}
+
+void cn_slow_hash(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  int use_aesni = atomic_load_explicit(&cn_use_aesni, memory_order_relaxed);
+  if (use_aesni < 0) {
+    use_aesni = cn_detect_aesni();
+  }
+  cn_slow_hash_internal(input, output, len, variant, page_size, iterations, aes_rounds, use_aesni);
+}
+
+void cn_slow_hash_portable(const char* input, char* output, int len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds)
+{
+  cn_slow_hash_internal(input, output, len, variant, page_size, iterations, aes_rounds, 0);
 }
 
 void cn_fast_hash(const char* input, char* output, uint32_t len) {
@@ -28,6 +28,22 @@
 
 #define CN_TURTLE_LITE_AES_ROUNDS 8192
 
+/* Size of the per-thread scratchpad, large enough for every variant above */
+#define CN_MAX_PAGE_SIZE      CN_PAGE_SIZE
+
+/* Allocate/release the calling thread's scratchpad. cn_slow_hash allocates on
+   demand, freeing is up to the thread before it exits. */
+#ifdef __cplusplus
+extern "C" {
+#endif
+void cn_slow_hash_allocate_state(void);
+void cn_slow_hash_free_state(void);
+/* Select the fastest CN implementation supported by this CPU and return its name */
+const char* cn_slow_hash_autodetect(void);
+#ifdef __cplusplus
+}
+#endif
+
 typedef unsigned char BitSequence;
 typedef unsigned long long DataLength;
 
@@ -48,6 +64,8 @@ extern "C" {
 #pragma pack(pop)
 
   void cn_slow_hash(const char* input, char* output, uint32_t len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds);
+  /* Table based implementation regardless of CPU support, used to cross-check the hardware path */
+  void cn_slow_hash_portable(const char* input, char* output, uint32_t len, int variant, uint32_t page_size, uint32_t iterations, size_t aes_rounds);
   void cn_fast_hash(const char* input, char* output, uint32_t len);
 
 //-----------------------------------------------------------------------------------
@@ -0,0 +1,135 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+//
+// AES-NI implementation of the CryptoNight scratchpad loops. Only compiled
+// with -maes, callers must check for CPU support at runtime before use.
+
+#ifdef ENABLE_AESNI
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <emmintrin.h>
+#include <wmmintrin.h>
+
+#include "int-util.h"
+
+#define AES_BLOCK_SIZE  16
+#define INIT_SIZE_BLK   8
+#define INIT_SIZE_BYTE  (INIT_SIZE_BLK * AES_BLOCK_SIZE)
+
+static inline void aesni_load_keys(const uint8_t* expandedKey, __m128i* k)
+{
+    int i;
+    for (i = 0; i < 10; i++) {
+        k[i] = _mm_loadu_si128((const __m128i*)(expandedKey + i * AES_BLOCK_SIZE));
+    }
+}
+
+/* Same as aesb_pseudo_round: ten full AES rounds without the initial key whitening */
+static inline __m128i aesni_pseudo_round(__m128i x, const __m128i* k)
+{
+    x = _mm_aesenc_si128(x, k[0]);
+    x = _mm_aesenc_si128(x, k[1]);
+    x = _mm_aesenc_si128(x, k[2]);
+    x = _mm_aesenc_si128(x, k[3]);
+    x = _mm_aesenc_si128(x, k[4]);
+    x = _mm_aesenc_si128(x, k[5]);
+    x = _mm_aesenc_si128(x, k[6]);
+    x = _mm_aesenc_si128(x, k[7]);
+    x = _mm_aesenc_si128(x, k[8]);
+    x = _mm_aesenc_si128(x, k[9]);
+    return x;
+}
+
+void cn_aesni_explode(uint8_t* text, uint8_t* long_state, size_t init_rounds, const uint8_t* expandedKey)
+{
+    __m128i k[10];
+    __m128i x[INIT_SIZE_BLK];
+    size_t i, j;
+
+    aesni_load_keys(expandedKey, k);
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+        x[j] = _mm_loadu_si128((const __m128i*)(text + j * AES_BLOCK_SIZE));
+    }
+    for (i = 0; i < init_rounds; i++) {
+        for (j = 0; j < INIT_SIZE_BLK; j++) {
+            x[j] = aesni_pseudo_round(x[j], k);
+            _mm_storeu_si128((__m128i*)(long_state + i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE), x[j]);
+        }
+    }
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+        _mm_storeu_si128((__m128i*)(text + j * AES_BLOCK_SIZE), x[j]);
+    }
+}
+
+void cn_aesni_main_loop(uint8_t* long_state, uint8_t* a, uint8_t* b, int variant, uint64_t tweak1_2, uint32_t iterations, size_t aes_rounds)
+{
+    __m128i _a = _mm_loadu_si128((const __m128i*)a);
+    __m128i _b = _mm_loadu_si128((const __m128i*)b);
+    uint64_t c[2], t[2], aa[2];
+    uint64_t hi, lo;
+    uint8_t* p;
+    size_t i, j;
+
+    for (i = 0; i < iterations; i++) {
+        /* Iteration 1 */
+        _mm_storeu_si128((__m128i*)aa, _a);
+        j = (aa[0] / AES_BLOCK_SIZE) & (aes_rounds - 1);
+        p = &long_state[j * AES_BLOCK_SIZE];
+        __m128i _c = _mm_aesenc_si128(_mm_loadu_si128((const __m128i*)p), _a);
+        _mm_storeu_si128((__m128i*)p, _mm_xor_si128(_c, _b));
+        if (variant == 1) {
+            const uint8_t tmp = p[11];
+            static const uint32_t table = 0x75310;
+            const uint8_t index = (((tmp >> 3) & 6) | (tmp & 1)) << 1;
+            p[11] = tmp ^ ((table >> index) & 0x30);
+        }
+
+        /* Iteration 2 */
+        _mm_storeu_si128((__m128i*)c, _c);
+        j = (c[0] / AES_BLOCK_SIZE) & (aes_rounds - 1);
+        p = &long_state[j * AES_BLOCK_SIZE];
+        memcpy(t, p, AES_BLOCK_SIZE);
+
+        lo = mul128(c[0], t[0], &hi);
+        aa[0] += hi;
+        aa[1] += lo;
+        memcpy(p, aa, AES_BLOCK_SIZE);
+        aa[0] ^= t[0];
+        aa[1] ^= t[1];
+        if (variant == 1) {
+            ((uint64_t*)p)[1] ^= tweak1_2;
+        }
+
+        _a = _mm_loadu_si128((const __m128i*)aa);
+        _b = _c;
+    }
+
+    _mm_storeu_si128((__m128i*)a, _a);
+    _mm_storeu_si128((__m128i*)b, _b);
+}
+
+void cn_aesni_implode(uint8_t* text, const uint8_t* long_state, size_t init_rounds, const uint8_t* expandedKey)
+{
+    __m128i k[10];
+    __m128i x[INIT_SIZE_BLK];
+    size_t i, j;
+
+    aesni_load_keys(expandedKey, k);
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+        x[j] = _mm_loadu_si128((const __m128i*)(text + j * AES_BLOCK_SIZE));
+    }
+    for (i = 0; i < init_rounds; i++) {
+        for (j = 0; j < INIT_SIZE_BLK; j++) {
+            x[j] = _mm_xor_si128(x[j], _mm_loadu_si128((const __m128i*)(long_state + i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE)));
+            x[j] = aesni_pseudo_round(x[j], k);
+        }
+    }
+    for (j = 0; j < INIT_SIZE_BLK; j++) {
+        _mm_storeu_si128((__m128i*)(text + j * AES_BLOCK_SIZE), x[j]);
+    }
+}
+
+#endif
@@ -14,6 +14,7 @@
 #include <memenv.h>
 #include <stdint.h>
 #include <algorithm>
+#include <atomic>
 
 class CBitcoinLevelDBLogger : public leveldb::Logger {
 public:
@@ -73,10 +74,247 @@ public:
     }
 };
 
-static leveldb::Options GetOptions(size_t nCacheSize)
+/** Lowest weight of a database in the memory budget, as a fraction of its nominal share */
+static const double DB_MIN_WEIGHT_FRACTION = 0.25;
+
+/** A database's part of the memory budget */
+class CDBCacheShare
+{
+public:
+    const std::string strName;
+    const size_t nNominalSize;
+    const size_t nWriteBufferSize;
+
+    std::atomic<size_t> nUsage{0};
+    std::atomic<size_t> nQuota{0};
+    std::atomic<uint64_t> nHits{0};
+    std::atomic<uint64_t> nMisses{0};
+
+    // protected by the budget's mutex
+    double dWeight;
+    uint64_t nLastHits{0};
+
+    CDBCacheShare(const std::string& strNameIn, size_t nNominalSizeIn) :
+        strName(strNameIn),
+        nNominalSize(nNominalSizeIn),
+        nWriteBufferSize(nNominalSizeIn / 4),
+        dWeight(nNominalSizeIn)
+    {
+    }
+};
+
+namespace {
+
+/**
+ * A database's view of the shared block cache. It tags the blocks of the
+ * database so their charge can be accounted to it, counts its hits and
+ * enforces its quota.
+ */
+class CDBCacheView : public leveldb::Cache
+{
+private:
+    struct Entry
+    {
+        std::shared_ptr<CDBCacheShare> share;
+        void* value;
+        size_t charge;
+        void (*deleter)(const leveldb::Slice& key, void* value);
+    };
+
+    static void DeleteEntry(const leveldb::Slice& key, void* value)
+    {
+        Entry* entry = static_cast<Entry*>(value);
+        entry->share->nUsage -= entry->charge;
+        entry->deleter(key, entry->value);
+        delete entry;
+    }
+
+    const std::shared_ptr<leveldb::Cache> cache;
+    const std::shared_ptr<CDBCacheShare> share;
+    const size_t nCapacity;
+
+public:
+    CDBCacheView(std::shared_ptr<leveldb::Cache> cacheIn, std::shared_ptr<CDBCacheShare> shareIn, size_t nCapacityIn) :
+        cache(std::move(cacheIn)), share(std::move(shareIn)), nCapacity(nCapacityIn) {}
+
+    ~CDBCacheView() override
+    {
+        dbMemoryBudget.RemoveShare(share);
+    }
+
+    Handle* Insert(const leveldb::Slice& key, void* value, size_t charge, void (*deleter)(const leveldb::Slice& key, void* value)) override
+    {
+        share->nUsage += charge;
+        Handle* handle = cache->Insert(key, new Entry{share, value, charge, deleter}, charge, &DeleteEntry);
+        if (share->nUsage > share->nQuota && cache->TotalCharge() >= nCapacity) {
+            // Over its quota while the others need the room, the block goes away once released
+            cache->Erase(key);
+        }
+        return handle;
+    }
+
+    Handle* Lookup(const leveldb::Slice& key) override
+    {
+        Handle* handle = cache->Lookup(key);
+        if (handle) {
+            share->nHits++;
+        } else {
+            share->nMisses++;
+        }
+        return handle;
+    }
+
+    void Release(Handle* handle) override { cache->Release(handle); }
+    void* Value(Handle* handle) override { return static_cast<Entry*>(cache->Value(handle))->value; }
+    void Erase(const leveldb::Slice& key) override { cache->Erase(key); }
+    uint64_t NewId() override { return cache->NewId(); }
+    size_t TotalCharge() const override { return share->nUsage; }
+};
+
+} // namespace
+
+CDBMemoryBudget dbMemoryBudget;
+
+void CDBMemoryBudget::Init(size_t nTotalSize)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    nCacheCapacity = nTotalSize / 2;
+    cache.reset(leveldb::NewLRUCache(nCacheCapacity));
+    UpdateQuotas();
+}
+
+void CDBMemoryBudget::Reset()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    cache.reset();
+    nCacheCapacity = 0;
+}
+
+bool CDBMemoryBudget::IsActive() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache != nullptr;
+}
+
+leveldb::Cache* CDBMemoryBudget::NewCache(const std::string& strName, size_t nNominalSize)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!cache) {
+        return nullptr;
+    }
+    auto share = std::make_shared<CDBCacheShare>(strName, nNominalSize);
+    vShares.push_back(share);
+    UpdateQuotas();
+    return new CDBCacheView(cache, share, nCacheCapacity);
+}
+
+void CDBMemoryBudget::RemoveShare(const std::shared_ptr<CDBCacheShare>& share)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    vShares.erase(std::remove(vShares.begin(), vShares.end(), share), vShares.end());
+    UpdateQuotas();
+}
+
+void CDBMemoryBudget::UpdateQuotas()
+{
+    double dTotalWeight = 0;
+    for (const auto& share : vShares) {
+        dTotalWeight += share->dWeight;
+    }
+    for (const auto& share : vShares) {
+        share->nQuota = dTotalWeight > 0 ? (size_t)(nCacheCapacity * (share->dWeight / dTotalWeight)) : 0;
+    }
+}
+
+void CDBMemoryBudget::Rebalance()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    uint64_t nTotalHits = 0;
+    double dTotalNominal = 0;
+    std::vector<uint64_t> vHits;
+    for (const auto& share : vShares) {
+        uint64_t nHits = share->nHits;
+        vHits.push_back(nHits - share->nLastHits);
+        share->nLastHits = nHits;
+        nTotalHits += vHits.back();
+        dTotalNominal += share->nNominalSize;
+    }
+    if (nTotalHits == 0 || dTotalNominal == 0) {
+        // nothing was read from the cache, keep the split
+        return;
+    }
+
+    for (size_t i = 0; i < vShares.size(); i++) {
+        CDBCacheShare& share = *vShares[i];
+        double dMinShare = DB_MIN_WEIGHT_FRACTION * share.nNominalSize / dTotalNominal;
+        double dTarget = std::max((double)vHits[i] / nTotalHits, dMinShare) * dTotalNominal;
+        share.dWeight = (share.dWeight + dTarget) / 2;
+    }
+    UpdateQuotas();
+
+    for (const auto& share : vShares) {
+        LogPrint(BCLog::LEVELDB, "%s: %s uses %.1fMiB of the block cache, quota %.1fMiB\n", __func__,
+            share->strName, share->nUsage * (1.0 / 1048576.0), share->nQuota * (1.0 / 1048576.0));
+    }
+}
+
+size_t CDBMemoryBudget::GetCacheCapacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return nCacheCapacity;
+}
+
+size_t CDBMemoryBudget::GetCacheUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return cache ? cache->TotalCharge() : 0;
+}
+
+std::vector<CDBMemoryBudget::DBInfo> CDBMemoryBudget::GetInfo() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    double dTotalWeight = 0;
+    for (const auto& share : vShares) {
+        dTotalWeight += share->dWeight;
+    }
+
+    std::vector<DBInfo> vInfo;
+    for (const auto& share : vShares) {
+        DBInfo info;
+        info.strName = share->strName;
+        info.nNominalSize = share->nNominalSize;
+        info.nWriteBufferSize = share->nWriteBufferSize;
+        info.nCacheUsage = share->nUsage;
+        info.nCacheQuota = share->nQuota;
+        info.dWeight = dTotalWeight > 0 ? share->dWeight / dTotalWeight : 0;
+        info.nHits = share->nHits;
+        info.nMisses = share->nMisses;
+        vInfo.push_back(info);
+    }
+    return vInfo;
+}
+
+/** Name of a database in the memory budget, its path below the data directory */
+static std::string GetDBName(const fs::path& path)
+{
+    if (path.empty()) {
+        return "memory";
+    }
+    if (path.parent_path() == GetDataDir()) {
+        return path.filename().string();
+    }
+    return (path.parent_path().filename() / path.filename()).generic_string();
+}
+
+static leveldb::Options GetOptions(size_t nCacheSize, const std::string& strName)
 {
     leveldb::Options options;
-    options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    options.block_cache = dbMemoryBudget.NewCache(strName, nCacheSize);
+    if (!options.block_cache) {
+        options.block_cache = leveldb::NewLRUCache(nCacheSize / 2);
+    }
     options.write_buffer_size = nCacheSize / 4; // up to two write buffers may be held in memory simultaneously
     options.filter_policy = leveldb::NewBloomFilterPolicy(10);
     options.compression = leveldb::kNoCompression;
@@ -93,11 +331,12 @@ static leveldb::Options GetOptions(size_t nCacheSize)
 CDBWrapper::CDBWrapper(const fs::path& path, size_t nCacheSize, bool fMemory, bool fWipe, bool obfuscate)
 {
     penv = nullptr;
+    nMaxBatchSize = 0;
     readoptions.verify_checksums = true;
     iteroptions.verify_checksums = true;
     iteroptions.fill_cache = false;
     syncoptions.sync = true;
-    options = GetOptions(nCacheSize);
+    options = GetOptions(nCacheSize, GetDBName(path));
     options.create_if_missing = true;
     if (fMemory) {
         penv = leveldb::NewMemEnv(leveldb::Env::Default());
@@ -162,6 +401,35 @@ bool CDBWrapper::WriteBatch(CDBBatch& batch, bool fSync)
     return true;
 }
 
+void CDBWrapper::BeginBatch(size_t nMaxBatchSizeIn)
+{
+    pbatch.reset(new CDBBatch(*this));
+    nMaxBatchSize = nMaxBatchSizeIn;
+}
+
+bool CDBWrapper::WritePartialBatch()
+{
+    if (pbatch->SizeEstimate() <= nMaxBatchSize)
+        return true;
+
+    LogPrint(BCLog::LEVELDB, "Writing partial batch of %.2f MiB\n", pbatch->SizeEstimate() * (1.0 / 1048576.0));
+    bool ret = WriteBatch(*pbatch);
+    pbatch->Clear();
+    return ret;
+}
+
+bool CDBWrapper::CommitBatch(bool fSync)
+{
+    assert(pbatch);
+    std::unique_ptr<CDBBatch> batch = std::move(pbatch);
+    return WriteBatch(*batch, fSync);
+}
+
+void CDBWrapper::AbortBatch()
+{
+    pbatch.reset();
+}
+
 // Prefixed with null character to avoid collisions with other keys
 //
 // We must use a string constructor which specifies length so that we copy
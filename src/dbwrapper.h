@@ -13,7 +13,10 @@
 #include "utilstrencodings.h"
 #include "version.h"
 
+#include <memory>
+#include <mutex>
 #include <typeindex>
+#include <vector>
 
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
@@ -28,6 +31,62 @@ public:
 };
 
 class CDBWrapper;
+class CDBCacheShare;
+
+/**
+ * Memory budget shared by the node's LevelDB databases.
+ *
+ * While the budget is active, the databases opened use one LRU block cache
+ * instead of a private one each, so the memory goes to whichever database's
+ * blocks are actually read. Every database gets a quota of that cache from
+ * its weight, which starts at the nominal size it was opened with and then
+ * follows its share of the cache hits. Once the cache is full, blocks read by
+ * a database over its quota are not kept, so scans of rarely used databases
+ * can't push the hot blocks of the others out.
+ */
+class CDBMemoryBudget
+{
+public:
+    struct DBInfo
+    {
+        std::string strName;
+        size_t nNominalSize;
+        size_t nWriteBufferSize;
+        size_t nCacheUsage;
+        size_t nCacheQuota;
+        double dWeight;
+        uint64_t nHits;
+        uint64_t nMisses;
+    };
+
+private:
+    mutable std::mutex mutex;
+    std::shared_ptr<leveldb::Cache> cache;
+    size_t nCacheCapacity{0};
+    std::vector<std::shared_ptr<CDBCacheShare>> vShares;
+
+    void UpdateQuotas();
+
+public:
+    /** Share nTotalSize bytes among the databases opened from now on, half of it as block cache */
+    void Init(size_t nTotalSize);
+    /** Let the databases opened from now on use private caches again */
+    void Reset();
+    bool IsActive() const;
+
+    /** Block cache for a new database, nullptr while the budget is not active */
+    leveldb::Cache* NewCache(const std::string& strName, size_t nNominalSize);
+    void RemoveShare(const std::shared_ptr<CDBCacheShare>& share);
+
+    /** Move the cache quotas towards the databases' shares of the cache hits since the last call */
+    void Rebalance();
+
+    size_t GetCacheCapacity() const;
+    size_t GetCacheUsage() const;
+    std::vector<DBInfo> GetInfo() const;
+};
+
+extern CDBMemoryBudget dbMemoryBudget;
 
 /** These should be considered an implementation detail of the specific database.
  */
@@ -176,6 +235,26 @@ public:
         return piter->key().size();
     }
 
+    /** Whether the current key starts with the serialized ssPrefix, compared on the raw key bytes */
+    bool KeyHasPrefix(const CDataStream& ssPrefix) {
+        return piter->key().starts_with(leveldb::Slice(ssPrefix.data(), ssPrefix.size()));
+    }
+
+    /** Deserialize only the part of the current key after its first nPrefixSize bytes */
+    template<typename K> bool GetKeySuffix(size_t nPrefixSize, K& key) {
+        leveldb::Slice slKey = piter->key();
+        if (slKey.size() < nPrefixSize) {
+            return false;
+        }
+        try {
+            CDataStream ssKey(slKey.data() + nPrefixSize, slKey.data() + slKey.size(), SER_DISK, CLIENT_VERSION);
+            ssKey >> key;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
     template<typename V> bool GetValue(V& value) {
         leveldb::Slice slValue = piter->value();
         try {
@@ -194,6 +273,26 @@ public:
 
 };
 
+/** A consistent read-only view of a CDBWrapper as of the moment it was taken */
+class CDBSnapshot
+{
+    friend class CDBWrapper;
+private:
+    leveldb::DB* pdb;
+    const leveldb::Snapshot* psnapshot;
+
+    CDBSnapshot(leveldb::DB* _pdb) : pdb(_pdb), psnapshot(_pdb->GetSnapshot()) { }
+
+public:
+    ~CDBSnapshot()
+    {
+        pdb->ReleaseSnapshot(psnapshot);
+    }
+
+    CDBSnapshot(const CDBSnapshot&) = delete;
+    CDBSnapshot& operator=(const CDBSnapshot&) = delete;
+};
+
 class CDBWrapper
 {
     friend const std::vector<unsigned char>& dbwrapper_private::GetObfuscateKey(const CDBWrapper &w);
@@ -230,6 +329,35 @@ private:
 
     std::vector<unsigned char> CreateObfuscateKey() const;
 
+    //! batch collecting the BatchWrite and BatchErase calls between BeginBatch and CommitBatch
+    std::unique_ptr<CDBBatch> pbatch;
+
+    //! size in bytes above which pbatch is written out before more is added
+    size_t nMaxBatchSize;
+
+    bool WritePartialBatch();
+
+protected:
+    /** Write key, or add it to the pending batch if there is one */
+    template <typename K, typename V>
+    bool BatchWrite(const K& key, const V& value)
+    {
+        if (!pbatch)
+            return Write(key, value);
+        pbatch->Write(key, value);
+        return WritePartialBatch();
+    }
+
+    /** Erase key, or add it to the pending batch if there is one */
+    template <typename K>
+    bool BatchErase(const K& key)
+    {
+        if (!pbatch)
+            return Erase(key);
+        pbatch->Erase(key);
+        return WritePartialBatch();
+    }
+
 public:
     /**
      * @param[in] path        Location in the filesystem where leveldb data will be stored.
@@ -336,6 +464,16 @@ public:
 
     bool WriteBatch(CDBBatch& batch, bool fSync = false);
 
+    /**
+     * Collect BatchWrite and BatchErase calls in a batch until CommitBatch(). The batch is written early
+     * whenever it grows past nMaxBatchSizeIn bytes. Reads do not see the pending entries.
+     */
+    void BeginBatch(size_t nMaxBatchSizeIn);
+    bool CommitBatch(bool fSync = false);
+    /** Drop the pending entries, parts written early stay written */
+    void AbortBatch();
+    bool IsBatching() const { return pbatch != nullptr; }
+
     // not available for LevelDB; provide for compatibility with BDB
     bool Flush()
     {
@@ -353,6 +491,22 @@ public:
         return new CDBIterator(*this, pdb->NewIterator(iteroptions));
     }
 
+    /**
+     * Take a snapshot of the database. Writes made after this don't show up
+     * in iterators created from it. It must be destroyed before the database.
+     */
+    std::unique_ptr<CDBSnapshot> GetSnapshot()
+    {
+        return std::unique_ptr<CDBSnapshot>(new CDBSnapshot(pdb));
+    }
+
+    CDBIterator *NewIterator(const CDBSnapshot& snapshot)
+    {
+        leveldb::ReadOptions snapshotoptions = iteroptions;
+        snapshotoptions.snapshot = snapshot.psnapshot;
+        return new CDBIterator(*this, pdb->NewIterator(snapshotoptions));
+    }
+
     /**
      * Return true if the database managed by this class contains no entries.
      */
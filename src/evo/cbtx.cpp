@@ -111,7 +111,7 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
     LOCK(deterministicMNManager->cs);
 
     static int64_t nTimeDMN = 0;
-    static int64_t nTimeSMNL = 0;
+    static int64_t nTimeChanges = 0;
     static int64_t nTimeMerkle = 0;
 
     int64_t nTime1 = GetTimeMicros();
@@ -124,30 +124,28 @@ bool CalcCbTxMerkleRootMNList(const CBlock& block, const CBlockIndex* pindexPrev
     int64_t nTime2 = GetTimeMicros(); nTimeDMN += nTime2 - nTime1;
     LogPrint(BCLog::BENCHMARK, "            - BuildNewListFromBlock: %.2fms [%.2fs]\n", 0.001 * (nTime2 - nTime1), nTimeDMN * 0.000001);
 
-    CSimplifiedMNList sml(tmpMNList);
+    // The tree follows the list of the parent block, so only the entries changed by this block need hashing
+    static CSimplifiedMNListMerkleTree mnListTree;
+    static CDeterministicMNList mnListTreeBase;
+    static uint256 blockHashTreeBase;
 
-    int64_t nTime3 = GetTimeMicros(); nTimeSMNL += nTime3 - nTime2;
-    LogPrint(BCLog::BENCHMARK, "            - CSimplifiedMNList: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeSMNL * 0.000001);
-
-    static CSimplifiedMNList smlCached;
-    static uint256 merkleRootCached;
-    static bool mutatedCached{false};
-
-    if (sml.mnList == smlCached.mnList) {
-        merkleRootRet = merkleRootCached;
-        return !mutatedCached;
+    if (blockHashTreeBase != pindexPrev->GetBlockHash()) {
+        auto prevMNList = deterministicMNManager->GetListForBlock(pindexPrev);
+        mnListTree.ApplyChanges(CSimplifiedMNListMerkleTree::CalcChanges(mnListTreeBase, prevMNList, pindexPrev));
+        mnListTreeBase = prevMNList;
+        blockHashTreeBase = pindexPrev->GetBlockHash();
     }
+    auto changes = CSimplifiedMNListMerkleTree::CalcChanges(mnListTreeBase, tmpMNList);
+
+    int64_t nTime3 = GetTimeMicros(); nTimeChanges += nTime3 - nTime2;
+    LogPrint(BCLog::BENCHMARK, "            - CalcChanges: %.2fms [%.2fs]\n", 0.001 * (nTime3 - nTime2), nTimeChanges * 0.000001);
 
     bool mutated = false;
-    merkleRootRet = sml.CalcMerkleRoot(&mutated);
+    merkleRootRet = mnListTree.CalcMerkleRoot(changes, &mutated);
 
     int64_t nTime4 = GetTimeMicros(); nTimeMerkle += nTime4 - nTime3;
     LogPrint(BCLog::BENCHMARK, "            - CalcMerkleRoot: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeMerkle * 0.000001);
 
-    smlCached = std::move(sml);
-    merkleRootCached = merkleRootRet;
-    mutatedCached = mutated;
-
     return !mutated;
 }
 
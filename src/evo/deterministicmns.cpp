@@ -999,6 +999,24 @@ CDeterministicMNList CDeterministicMNManager::GetListAtChainTip()
     return GetListForBlock(tipIndex);
 }
 
+bool CDeterministicMNManager::GetListDiff(const CBlockIndex* pindex, CDeterministicMNListDiff& diffRet)
+{
+    LOCK(cs);
+
+    auto itDiffs = mnListDiffsCache.find(pindex->GetBlockHash());
+    if (itDiffs != mnListDiffsCache.end()) {
+        diffRet = itDiffs->second;
+        return true;
+    }
+
+    if (!evoDb.Read(std::make_pair(DB_LIST_DIFF, pindex->GetBlockHash()), diffRet)) {
+        return false;
+    }
+    diffRet.nHeight = pindex->nHeight;
+    mnListDiffsCache.emplace(pindex->GetBlockHash(), diffRet);
+    return true;
+}
+
 bool CDeterministicMNManager::IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n)
 {
     if (tx->nVersion != 3 || tx->nType != TRANSACTION_PROVIDER_REGISTER) {
@@ -669,6 +669,8 @@ public:
 
     CDeterministicMNList GetListForBlock(const CBlockIndex* pindex);
     CDeterministicMNList GetListAtChainTip();
+    /** The diff from the list of pindex->pprev to the list of pindex, as stored when pindex got connected */
+    bool GetListDiff(const CBlockIndex* pindex, CDeterministicMNListDiff& diffRet);
 
     // Test if given TX is a ProRegTx which also contains the collateral at index n
     bool IsProTxWithCollateral(const CTransactionRef& tx, uint32_t n);
@@ -15,6 +15,7 @@
 #include "base58.h"
 #include "chainparams.h"
 #include "consensus/merkle.h"
+#include "hash.h"
 #include "univalue.h"
 #include "validation.h"
 
@@ -89,6 +90,226 @@ uint256 CSimplifiedMNList::CalcMerkleRoot(bool* pmutated) const
     return ComputeMerkleRoot(leaves, pmutated);
 }
 
+static bool IsEqualPair(const std::vector<uint256>& vLevel, size_t nPos)
+{
+    return nPos + 1 < vLevel.size() && vLevel[nPos] == vLevel[nPos + 1];
+}
+
+static uint256 HashPair(const uint256& a, const uint256& b)
+{
+    return Hash(a.begin(), a.end(), b.begin(), b.end());
+}
+
+CSimplifiedMNListMerkleTree::LeafChanges CSimplifiedMNListMerkleTree::CalcChanges(const CDeterministicMNList& from, const CDeterministicMNList& to, const CBlockIndex* pindexTo)
+{
+    // the state fields which end up in CSimplifiedMNListEntry
+    static const uint32_t SML_FIELDS = CDeterministicMNStateDiff::Field_confirmedHash |
+                                       CDeterministicMNStateDiff::Field_addr |
+                                       CDeterministicMNStateDiff::Field_pubKeyOperator |
+                                       CDeterministicMNStateDiff::Field_keyIDVoting |
+                                       CDeterministicMNStateDiff::Field_nPoSeBanHeight;
+
+    LeafChanges changes;
+    CDeterministicMNListDiff diff;
+    bool fStoredDiff = pindexTo && pindexTo->pprev &&
+                       to.GetBlockHash() == pindexTo->GetBlockHash() &&
+                       from.GetBlockHash() == pindexTo->pprev->GetBlockHash() &&
+                       deterministicMNManager->GetListDiff(pindexTo, diff);
+    if (!fStoredDiff) {
+        diff = from.BuildDiff(to);
+    }
+    for (const auto& dmn : diff.addedMNs) {
+        changes.emplace(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    for (const auto& p : diff.updatedMNs) {
+        if (!(p.second.fields & SML_FIELDS)) {
+            continue;
+        }
+        auto dmn = to.GetMNByInternalId(p.first);
+        assert(dmn);
+        changes.emplace(dmn->proTxHash, CSimplifiedMNListEntry(*dmn).CalcHash());
+    }
+    for (const auto& internalId : diff.removedMns) {
+        auto dmn = from.GetMNByInternalId(internalId);
+        assert(dmn);
+        changes.emplace(dmn->proTxHash, boost::none);
+    }
+    return changes;
+}
+
+bool CSimplifiedMNListMerkleTree::FindLeaves(const LeafChanges& changes, std::map<size_t, uint256>& mapLeavesRet) const
+{
+    for (const auto& p : changes) {
+        auto it = std::lower_bound(vProRegTxHashes.begin(), vProRegTxHashes.end(), p.first);
+        if (!p.second || it == vProRegTxHashes.end() || *it != p.first) {
+            return false;
+        }
+        mapLeavesRet.emplace(it - vProRegTxHashes.begin(), *p.second);
+    }
+    return true;
+}
+
+std::vector<std::map<size_t, uint256>> CSimplifiedMNListMerkleTree::CalcPaths(const std::map<size_t, uint256>& mapLeaves, size_t& nEqualPairsRet) const
+{
+    std::vector<std::map<size_t, uint256>> vPaths;
+    vPaths.reserve(vLevels.size());
+    vPaths.emplace_back(mapLeaves);
+    nEqualPairsRet = nEqualPairs;
+
+    for (size_t nLevel = 0; nLevel + 1 < vLevels.size(); nLevel++) {
+        const auto& vLevel = vLevels[nLevel];
+        const auto& mapNodes = vPaths[nLevel];
+        auto getNode = [&](size_t nPos) -> const uint256& {
+            auto it = mapNodes.find(nPos);
+            return it != mapNodes.end() ? it->second : vLevel[nPos];
+        };
+
+        std::map<size_t, uint256> mapParents;
+        for (const auto& p : mapNodes) {
+            size_t nPos = p.first & ~(size_t)1;
+            if (mapParents.count(nPos / 2)) {
+                continue;
+            }
+            // the last node of an odd level is paired with itself
+            const uint256& left = getNode(nPos);
+            const uint256& right = getNode(nPos + 1 < vLevel.size() ? nPos + 1 : nPos);
+            nEqualPairsRet -= IsEqualPair(vLevel, nPos);
+            nEqualPairsRet += nPos + 1 < vLevel.size() && left == right;
+            mapParents.emplace(nPos / 2, HashPair(left, right));
+        }
+        vPaths.emplace_back(std::move(mapParents));
+    }
+    return vPaths;
+}
+
+void CSimplifiedMNListMerkleTree::Rebuild(std::vector<uint256>&& vLeaves, size_t nFirst)
+{
+    std::vector<uint256> vNew = std::move(vLeaves);
+    size_t nLevel = 0;
+    while (true) {
+        if (nLevel == vLevels.size()) {
+            vLevels.emplace_back();
+        }
+        // nodes before nFirst are the same in the old and the new level
+        nFirst &= ~(size_t)1;
+        auto& vLevel = vLevels[nLevel];
+        for (size_t i = nFirst; i < vLevel.size(); i += 2) {
+            nEqualPairs -= IsEqualPair(vLevel, i);
+        }
+        for (size_t i = nFirst; i < vNew.size(); i += 2) {
+            nEqualPairs += IsEqualPair(vNew, i);
+        }
+        vLevel = std::move(vNew);
+        if (vLevel.size() <= 1) {
+            break;
+        }
+
+        vNew.clear();
+        vNew.reserve((vLevel.size() + 1) / 2);
+        if (nLevel + 1 < vLevels.size()) {
+            const auto& vParents = vLevels[nLevel + 1];
+            vNew.assign(vParents.begin(), vParents.begin() + std::min(nFirst / 2, vParents.size()));
+        }
+        for (size_t i = vNew.size() * 2; i < vLevel.size(); i += 2) {
+            vNew.emplace_back(HashPair(vLevel[i], vLevel[i + 1 < vLevel.size() ? i + 1 : i]));
+        }
+        nFirst /= 2;
+        nLevel++;
+    }
+
+    // the tree got lower
+    for (size_t i = nLevel + 1; i < vLevels.size(); i++) {
+        for (size_t j = 0; j < vLevels[i].size(); j += 2) {
+            nEqualPairs -= IsEqualPair(vLevels[i], j);
+        }
+    }
+    vLevels.resize(nLevel + 1);
+}
+
+void CSimplifiedMNListMerkleTree::ApplyChanges(const LeafChanges& changes)
+{
+    std::map<size_t, uint256> mapLeaves;
+    if (FindLeaves(changes, mapLeaves)) {
+        auto vPaths = CalcPaths(mapLeaves, nEqualPairs);
+        for (size_t nLevel = 0; nLevel < vPaths.size(); nLevel++) {
+            for (const auto& p : vPaths[nLevel]) {
+                vLevels[nLevel][p.first] = p.second;
+            }
+        }
+        return;
+    }
+
+    // entries were added or removed, merge the changes into the sorted leaves
+    if (vLevels.empty()) {
+        vLevels.emplace_back();
+    }
+    const auto& vOldLeaves = vLevels[0];
+    std::vector<uint256> vNewProRegTxHashes;
+    std::vector<uint256> vLeaves;
+    vNewProRegTxHashes.reserve(vProRegTxHashes.size() + changes.size());
+    vLeaves.reserve(vProRegTxHashes.size() + changes.size());
+    size_t nFirst = std::numeric_limits<size_t>::max();
+
+    size_t i = 0;
+    auto it = changes.begin();
+    while (i < vProRegTxHashes.size() || it != changes.end()) {
+        if (it == changes.end() || (i < vProRegTxHashes.size() && vProRegTxHashes[i] < it->first)) {
+            vNewProRegTxHashes.emplace_back(vProRegTxHashes[i]);
+            vLeaves.emplace_back(vOldLeaves[i]);
+            i++;
+            continue;
+        }
+        bool fExisting = i < vProRegTxHashes.size() && vProRegTxHashes[i] == it->first;
+        if (it->second || fExisting) {
+            nFirst = std::min(nFirst, vLeaves.size());
+        }
+        if (it->second) {
+            vNewProRegTxHashes.emplace_back(it->first);
+            vLeaves.emplace_back(*it->second);
+        }
+        if (fExisting) {
+            i++;
+        }
+        ++it;
+    }
+
+    nFirst = std::min(nFirst, vLeaves.size());
+    vProRegTxHashes = std::move(vNewProRegTxHashes);
+    Rebuild(std::move(vLeaves), nFirst);
+}
+
+uint256 CSimplifiedMNListMerkleTree::CalcMerkleRoot(const LeafChanges& changes, bool* pmutated) const
+{
+    if (changes.empty()) {
+        return GetMerkleRoot(pmutated);
+    }
+    std::map<size_t, uint256> mapLeaves;
+    if (!FindLeaves(changes, mapLeaves)) {
+        // the leaves behind added or removed entries move, which needs a copy of the tree
+        CSimplifiedMNListMerkleTree tree(*this);
+        tree.ApplyChanges(changes);
+        return tree.GetMerkleRoot(pmutated);
+    }
+
+    size_t nEqualPairsNew;
+    auto vPaths = CalcPaths(mapLeaves, nEqualPairsNew);
+    if (pmutated) {
+        *pmutated = nEqualPairsNew != 0;
+    }
+    return vPaths.back().begin()->second;
+}
+
+uint256 CSimplifiedMNListMerkleTree::GetMerkleRoot(bool* pmutated) const
+{
+    if (pmutated) {
+        *pmutated = nEqualPairs != 0;
+    }
+    if (vLevels.empty() || vLevels.back().empty()) {
+        return uint256();
+    }
+    return vLevels.back()[0];
+}
+
 CSimplifiedMNListDiff::CSimplifiedMNListDiff()
 {
 }
@@ -13,7 +13,12 @@
 #include "serialize.h"
 #include "version.h"
 
+#include <map>
+
+#include <boost/optional.hpp>
+
 class UniValue;
+class CBlockIndex;
 class CDeterministicMNList;
 class CDeterministicMN;
 
@@ -85,6 +90,40 @@ public:
     uint256 CalcMerkleRoot(bool* pmutated = nullptr) const;
 };
 
+/**
+ * Merkle tree of the simplified MN list which is kept from block to block. Leaves are
+ * keyed by proRegTxHash and sorted like in CSimplifiedMNList, so the root is the same.
+ * Entries which only changed are rehashed along their path to the root, while added or
+ * removed entries shift all leaves behind them and rehash the tree from there on.
+ */
+class CSimplifiedMNListMerkleTree
+{
+public:
+    /** New leaf hashes by proRegTxHash, none for removed entries */
+    typedef std::map<uint256, boost::optional<uint256>> LeafChanges;
+
+private:
+    std::vector<uint256> vProRegTxHashes;
+    /** The leaves, followed by the levels of inner nodes up to the root */
+    std::vector<std::vector<uint256>> vLevels;
+    /** Sibling nodes with equal hashes, these make the tree mutated */
+    size_t nEqualPairs{0};
+
+    bool FindLeaves(const LeafChanges& changes, std::map<size_t, uint256>& mapLeavesRet) const;
+    std::vector<std::map<size_t, uint256>> CalcPaths(const std::map<size_t, uint256>& mapLeaves, size_t& nEqualPairsRet) const;
+    void Rebuild(std::vector<uint256>&& vLeaves, size_t nFirst);
+
+public:
+    /** The leaves which differ between two lists, using the stored diff of pindexTo when from is the list of its parent */
+    static LeafChanges CalcChanges(const CDeterministicMNList& from, const CDeterministicMNList& to, const CBlockIndex* pindexTo = nullptr);
+
+    void ApplyChanges(const LeafChanges& changes);
+    /** The root with the changes applied, leaving the tree as it is */
+    uint256 CalcMerkleRoot(const LeafChanges& changes, bool* pmutated = nullptr) const;
+    uint256 GetMerkleRoot(bool* pmutated = nullptr) const;
+    size_t size() const { return vProRegTxHashes.size(); }
+};
+
 /// P2P messages
 
 class CGetSimplifiedMNListDiff
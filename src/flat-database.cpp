@@ -0,0 +1,230 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+
+#include "crypto/common.h"
+
+CFlatDBJournal::CFlatDBJournal(const std::string& strFilename, const std::string& strMagicMessageIn, CCriticalSection& csOwnerIn, ReplayFunc replayFuncIn) :
+    pathJournal(GetDataDir() / (strFilename + ".journal")),
+    pathRotated(GetDataDir() / (strFilename + ".journal.old")),
+    strMagicMessage(strMagicMessageIn),
+    csOwner(csOwnerIn),
+    replayFunc(std::move(replayFuncIn)),
+    file(nullptr),
+    nHeaderSize(0)
+{
+}
+
+CFlatDBJournal::~CFlatDBJournal()
+{
+    Close();
+}
+
+void CFlatDBJournal::Close()
+{
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+}
+
+bool CFlatDBJournal::Create(const uint256& hashCheckpoint)
+{
+    Close();
+
+    CDataStream ssHeader(SER_DISK, CLIENT_VERSION);
+    ssHeader << strMagicMessage;
+    ssHeader << FLATDATA(Params().MessageStart());
+    ssHeader << hashCheckpoint;
+
+    file = fsbridge::fopen(pathJournal, "wb+");
+    if (!file) {
+        return error("%s: Failed to open file %s", __func__, pathJournal.string());
+    }
+    if (fwrite(ssHeader.data(), 1, ssHeader.size(), file) != ssHeader.size() || fflush(file) != 0) {
+        Close();
+        return error("%s: Failed to write header to %s", __func__, pathJournal.string());
+    }
+    nHeaderSize = ssHeader.size();
+    return true;
+}
+
+bool CFlatDBJournal::ReplayFile(const fs::path& path, const uint256* pHashCheckpoint, long& nEndRet)
+{
+    CAutoFile filein(fsbridge::fopen(path, "rb"), SER_DISK, CLIENT_VERSION);
+    if (filein.IsNull()) {
+        return false;
+    }
+
+    std::string strMagicMessageTmp;
+    unsigned char pchMsgTmp[4];
+    uint256 hashCheckpoint;
+    try {
+        filein >> strMagicMessageTmp;
+        filein >> FLATDATA(pchMsgTmp);
+        filein >> hashCheckpoint;
+    } catch (const std::exception& e) {
+        return error("%s: Failed to read header of %s - %s", __func__, path.string(), e.what());
+    }
+    if (strMagicMessageTmp != strMagicMessage || memcmp(pchMsgTmp, Params().MessageStart(), sizeof(pchMsgTmp))) {
+        return error("%s: Invalid magic in %s", __func__, path.string());
+    }
+    if (pHashCheckpoint && hashCheckpoint != *pHashCheckpoint) {
+        LogPrintf("%s: %s does not follow the current checkpoint, skipping it\n", __func__, path.string());
+        return false;
+    }
+
+    int64_t nStart = GetTimeMillis();
+    size_t nCount = 0;
+    nEndRet = ftell(filein.Get());
+    while (true) {
+        uint32_t nSize;
+        uint32_t nChecksum;
+        std::vector<unsigned char> vchRecord;
+        try {
+            filein >> nSize;
+            if (nSize > MAX_SIZE) {
+                break;
+            }
+            vchRecord.resize(nSize);
+            filein.read((char*)vchRecord.data(), nSize);
+            filein >> nChecksum;
+        } catch (const std::exception&) {
+            // torn record at the end of the journal
+            break;
+        }
+
+        uint256 hash = Hash(vchRecord.begin(), vchRecord.end());
+        if (ReadLE32(hash.begin()) != nChecksum) {
+            LogPrintf("%s: Checksum mismatch in %s, dropping the rest of it\n", __func__, path.string());
+            break;
+        }
+
+        CDataStream ssRecord(vchRecord, SER_DISK, CLIENT_VERSION);
+        try {
+            replayFunc(ssRecord);
+        } catch (const std::exception& e) {
+            error("%s: Deserialize error in %s - %s", __func__, path.string(), e.what());
+            break;
+        }
+        nEndRet = ftell(filein.Get());
+        nCount++;
+    }
+
+    LogPrintf("Replayed %d records from %s  %dms\n", nCount, path.string(), GetTimeMillis() - nStart);
+    return true;
+}
+
+bool CFlatDBJournal::Replay(const uint256& hashCheckpoint)
+{
+    Close();
+
+    bool fClean = true;
+    long nEnd = 0;
+
+    // a checkpoint was interrupted, the rotated journal still follows the previous one
+    bool fReplayedRotated = false;
+    if (fs::exists(pathRotated)) {
+        fClean = false;
+        fReplayedRotated = ReplayFile(pathRotated, &hashCheckpoint, nEnd);
+    }
+    // the current journal follows the rotated one if that was replayed
+    if (!ReplayFile(pathJournal, fReplayedRotated ? nullptr : &hashCheckpoint, nEnd) || fReplayedRotated) {
+        fClean = false;
+    }
+
+    if (!fClean) {
+        try {
+            fs::remove(pathRotated);
+            fs::remove(pathJournal);
+        } catch (const fs::filesystem_error& e) {
+            LogPrintf("%s: Unable to remove %s - %s\n", __func__, pathJournal.string(), e.what());
+        }
+        return false;
+    }
+
+    // keep appending after the last record which could be replayed
+    file = fsbridge::fopen(pathJournal, "rb+");
+    if (!file || !TruncateFile(file, nEnd) || fseek(file, 0, SEEK_END) != 0) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void CFlatDBJournal::AppendRecord(const CDataStream& ssRecord)
+{
+    if (!file) {
+        return;
+    }
+
+    uint256 hash = Hash(ssRecord.begin(), ssRecord.end());
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << (uint32_t)ssRecord.size();
+    ss.write(ssRecord.data(), ssRecord.size());
+    ss << ReadLE32(hash.begin());
+
+    // a crash of the process loses nothing that was flushed to the OS
+    if (fwrite(ss.data(), 1, ss.size(), file) != ss.size() || fflush(file) != 0) {
+        error("%s: Failed to write to %s, stopping the journal until the next checkpoint", __func__, pathJournal.string());
+        Close();
+    }
+}
+
+void CFlatDBJournal::Rotate(const uint256& hashCheckpoint)
+{
+    AssertLockHeld(csOwner);
+
+    Close();
+    if (fs::exists(pathJournal) && !RenameOver(pathJournal, pathRotated)) {
+        error("%s: Failed to rotate %s", __func__, pathJournal.string());
+    }
+    Create(hashCheckpoint);
+}
+
+void CFlatDBJournal::CommitRotate()
+{
+    try {
+        fs::remove(pathRotated);
+    } catch (const fs::filesystem_error& e) {
+        LogPrintf("%s: Unable to remove %s - %s\n", __func__, pathRotated.string(), e.what());
+    }
+}
+
+void CFlatDBJournal::AbortRotate()
+{
+    LOCK(csOwner);
+
+    if (!fs::exists(pathRotated)) {
+        return;
+    }
+
+    // copy the records written since the rotation behind the ones of the rotated journal
+    std::vector<char> vchRecords;
+    if (file && fseek(file, 0, SEEK_END) == 0) {
+        long nSize = ftell(file);
+        if (nSize > nHeaderSize) {
+            vchRecords.resize(nSize - nHeaderSize);
+            if (fseek(file, nHeaderSize, SEEK_SET) != 0 || fread(vchRecords.data(), 1, vchRecords.size(), file) != vchRecords.size()) {
+                vchRecords.clear();
+            }
+        }
+    }
+    Close();
+
+    FILE* fileRotated = fsbridge::fopen(pathRotated, "ab");
+    if (!fileRotated) {
+        error("%s: Failed to open file %s", __func__, pathRotated.string());
+        return;
+    }
+    bool fOk = fwrite(vchRecords.data(), 1, vchRecords.size(), fileRotated) == vchRecords.size();
+    fclose(fileRotated);
+    if (!fOk || !RenameOver(pathRotated, pathJournal)) {
+        error("%s: Failed to restore %s", __func__, pathJournal.string());
+        return;
+    }
+
+    file = fsbridge::fopen(pathJournal, "ab+");
+}
@@ -11,8 +11,76 @@
 #include "fs.h"
 #include "hash.h"
 #include "streams.h"
+#include "sync.h"
 #include "util.h"
 
+#include <functional>
+#include <mutex>
+
+/** Default for -cachecheckpointinterval, in minutes */
+static const int64_t DEFAULT_CACHE_CHECKPOINT_INTERVAL = 10;
+
+/**
+ * Append-only log of the changes made to a CFlatDB object since its last checkpoint.
+ *
+ * The journal starts with the hash of the checkpoint it follows and is only replayed
+ * on top of that checkpoint. Every record carries its own checksum, a torn record at
+ * the end (e.g. after a crash) simply ends the replay.
+ *
+ * Records are appended while holding the lock of the object they describe, which
+ * CFlatDB also holds while serializing a checkpoint, so no change falls in between
+ * the checkpoint and the journal that follows it.
+ */
+class CFlatDBJournal
+{
+public:
+    typedef std::function<void(CDataStream&)> ReplayFunc;
+
+private:
+    fs::path pathJournal;
+    /** The journal of a checkpoint which is being written */
+    fs::path pathRotated;
+    std::string strMagicMessage;
+    CCriticalSection& csOwner;
+    ReplayFunc replayFunc;
+
+    FILE* file;
+    long nHeaderSize;
+
+    bool Create(const uint256& hashCheckpoint);
+    bool ReplayFile(const fs::path& path, const uint256* pHashCheckpoint, long& nEndRet);
+    void AppendRecord(const CDataStream& ssRecord);
+
+public:
+    CFlatDBJournal(const std::string& strFilename, const std::string& strMagicMessageIn, CCriticalSection& csOwnerIn, ReplayFunc replayFuncIn);
+    ~CFlatDBJournal();
+
+    CCriticalSection& GetOwnerLock() { return csOwner; }
+
+    template <typename... Args>
+    void Append(const Args&... args)
+    {
+        AssertLockHeld(csOwner);
+        CDataStream ssRecord(SER_DISK, CLIENT_VERSION);
+        SerializeMany(ssRecord, args...);
+        AppendRecord(ssRecord);
+    }
+
+    /**
+     * Replay the journal on top of the checkpoint with hash hashCheckpoint and keep appending to it.
+     * Returns false if the journal did not cleanly follow that checkpoint, in which case whatever
+     * could be replayed is applied but a new checkpoint has to be written.
+     */
+    bool Replay(const uint256& hashCheckpoint);
+    /** Start a new journal for a checkpoint about to be written, keeping the current one until it's on disk */
+    void Rotate(const uint256& hashCheckpoint);
+    /** The checkpoint is on disk, drop the journal it replaces */
+    void CommitRotate();
+    /** The checkpoint could not be written, move the new records back behind the old ones */
+    void AbortRotate();
+    void Close();
+};
+
 /** 
 *   Generic Dumping and Loading
 *   ---------------------------
@@ -37,25 +105,36 @@ private:
     std::string strFilename;
     std::string strMagicMessage;
 
-    bool Write(const T& objToSave)
-    {
-        // LOCK(objToSave.cs);
+    CFlatDBJournal* journal;
 
-        int64_t nStart = GetTimeMillis();
+    // Serializes checkpoints of the same type of object, e.g. a periodic one and the one at shutdown
+    static std::mutex& GetWriteMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
 
+    uint256 Serialize(const T& objToSave, CDataStream& ssObj)
+    {
         // serialize, checksum data up to that point, then append checksum
-        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
         ssObj << strMagicMessage; // specific magic message for this type of object
         ssObj << FLATDATA(Params().MessageStart()); // network specific magic number
         ssObj << objToSave;
         uint256 hash = Hash(ssObj.begin(), ssObj.end());
         ssObj << hash;
+        return hash;
+    }
+
+    bool WriteFile(const CDataStream& ssObj)
+    {
+        // write to a temporary file first, so a crash never leaves a partial file behind
+        fs::path pathTmp = fs::path(pathDB.string() + ".new");
 
         // open output file, and associate with CAutoFile
-        FILE *file = fopen(pathDB.string().c_str(), "wb");
+        FILE *file = fsbridge::fopen(pathTmp, "wb");
         CAutoFile fileout(file, SER_DISK, CLIENT_VERSION);
         if (fileout.IsNull())
-            return error("%s: Failed to open file %s", __func__, pathDB.string());
+            return error("%s: Failed to open file %s", __func__, pathTmp.string());
 
         // Write and commit header, data
         try {
@@ -64,15 +143,33 @@ private:
         catch (std::exception &e) {
             return error("%s: Serialize or I/O error - %s", __func__, e.what());
         }
+        FileCommit(fileout.Get());
         fileout.fclose();
 
+        if (!RenameOver(pathTmp, pathDB))
+            return error("%s: Rename-into-place failed for %s", __func__, pathDB.string());
+
+        return true;
+    }
+
+    bool Write(const T& objToSave)
+    {
+        std::lock_guard<std::mutex> lock(GetWriteMutex());
+
+        int64_t nStart = GetTimeMillis();
+
+        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+        Serialize(objToSave, ssObj);
+        if (!WriteFile(ssObj))
+            return false;
+
         LogPrintf("Written info to %s  %dms\n", strFilename, GetTimeMillis() - nStart);
         LogPrintf("     %s\n", objToSave.ToString());
 
         return true;
     }
 
-    ReadResult Read(T& objToLoad, bool fDryRun = false)
+    ReadResult Read(T& objToLoad, uint256& hashRet, bool fDryRun = false)
     {
         //LOCK(objToLoad.cs);
 
@@ -116,6 +213,7 @@ private:
             error("%s: Checksum mismatch, data corrupted", __func__);
             return IncorrectHash;
         }
+        hashRet = hashIn;
 
 
         unsigned char pchMsgTmp[4];
@@ -164,17 +262,20 @@ private:
 
 
 public:
-    CFlatDB(std::string strFilenameIn, std::string strMagicMessageIn)
+    CFlatDB(std::string strFilenameIn, std::string strMagicMessageIn, CFlatDBJournal* journalIn = nullptr)
     {
         pathDB = GetDataDir() / strFilenameIn;
         strFilename = strFilenameIn;
         strMagicMessage = strMagicMessageIn;
+        journal = journalIn;
     }
 
     bool Load(T& objToLoad)
     {
         LogPrintf("Reading info from %s...\n", strFilename);
-        ReadResult readResult = Read(objToLoad);
+        uint256 hashCheckpoint;
+        // with a journal, clean up only once all of it was replayed
+        ReadResult readResult = Read(objToLoad, hashCheckpoint, journal != nullptr);
         if (readResult == FileError)
             LogPrintf("Missing file %s, will try to recreate\n", strFilename);
         else if (readResult != Ok)
@@ -190,16 +291,69 @@ public:
                 return false;
             }
         }
+
+        if (journal) {
+            if (readResult != Ok) {
+                // whatever followed the old file is gone with it
+                hashCheckpoint.SetNull();
+            }
+            bool fClean = journal->Replay(hashCheckpoint);
+            LogPrintf("%s: Cleaning....\n", __func__);
+            objToLoad.CheckAndRemove();
+            LogPrintf("     %s\n", objToLoad.ToString());
+            if (!fClean && !Checkpoint(objToLoad)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * Write objToSave without reading back the current file first. With a journal, the
+     * changes made from now on go to a new journal which follows this checkpoint.
+     */
+    bool Checkpoint(T& objToSave)
+    {
+        std::lock_guard<std::mutex> lock(GetWriteMutex());
+
+        int64_t nStart = GetTimeMillis();
+
+        CDataStream ssObj(SER_DISK, CLIENT_VERSION);
+        if (journal) {
+            LOCK(journal->GetOwnerLock());
+            journal->Rotate(Serialize(objToSave, ssObj));
+        } else {
+            Serialize(objToSave, ssObj);
+        }
+
+        if (!WriteFile(ssObj)) {
+            if (journal) {
+                journal->AbortRotate();
+            }
+            return false;
+        }
+        if (journal) {
+            journal->CommitRotate();
+        }
+
+        LogPrintf("Checkpoint of %s written  %dms\n", strFilename, GetTimeMillis() - nStart);
+        LogPrintf("     %s\n", objToSave.ToString());
         return true;
     }
 
     bool Dump(T& objToSave)
     {
+        if (journal) {
+            // no need to verify the old file, the new journal will follow the checkpoint replacing it
+            return Checkpoint(objToSave);
+        }
+
         int64_t nStart = GetTimeMillis();
 
         LogPrintf("Verifying %s format...\n", strFilename);
         T tmpObjToLoad;
-        ReadResult readResult = Read(tmpObjToLoad, true);
+        uint256 hashTmp;
+        ReadResult readResult = Read(tmpObjToLoad, hashTmp, true);
 
         // there was an error and it was not an error on file opening => do not proceed
         if (readResult == FileError)
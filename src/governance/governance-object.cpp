@@ -217,6 +217,29 @@ bool CGovernanceObject::ProcessVote(CNode* pfrom,
     return true;
 }
 
+bool CGovernanceObject::ReplayVote(const CGovernanceVote& vote, int64_t nVoteTime)
+{
+    LOCK(cs);
+
+    if (fileVotes.HasVote(vote.GetHash())) {
+        return true;
+    }
+
+    // the smartnode or its keys might have changed since the vote was recorded
+    auto dmn = deterministicMNManager->GetListAtChainTip().GetMNByCollateral(vote.GetSmartnodeOutpoint());
+    bool onlyVotingKeyAllowed = nObjectType == GOVERNANCE_OBJECT_PROPOSAL && vote.GetSignal() == VOTE_SIGNAL_FUNDING;
+    if (!dmn || !vote.IsValid(onlyVotingKeyAllowed)) {
+        return false;
+    }
+    mmetaman.AddGovernanceVote(dmn->proTxHash, vote.GetParentHash());
+
+    vote_rec_t& voteRecordRef = mapCurrentMNVotes[vote.GetSmartnodeOutpoint()];
+    voteRecordRef.mapInstances[int(vote.GetSignal())] = vote_instance_t(vote.GetOutcome(), nVoteTime, vote.GetTimestamp());
+    fileVotes.AddVote(vote);
+    fDirtyCache = true;
+    return true;
+}
+
 void CGovernanceObject::ClearSmartnodeVotes()
 {
     LOCK(cs);
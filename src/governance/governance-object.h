@@ -301,6 +301,10 @@ public:
 
     bool GetCurrentMNVotes(const COutPoint& mnCollateralOutpoint, vote_rec_t& voteRecord) const;
 
+    // Restore a vote accepted by ProcessVote before a restart, only checking it
+    // against the current smartnode list. nVoteTime is the time recorded for it.
+    bool ReplayVote(const CGovernanceVote& vote, int64_t nVoteTime);
+
     // FUNCTIONS FOR DEALING WITH DATA STRING
 
     std::string GetDataAsHexString() const;
@@ -5,6 +5,7 @@
 
 #include "governance.h"
 #include "consensus/validation.h"
+#include "flat-database.h"
 #include "governance-classes.h"
 #include "governance-object.h"
 #include "governance-validators.h"
@@ -42,6 +43,7 @@ CGovernanceManager::CGovernanceManager() :
     mapLastSmartnodeObject(),
     setRequestedObjects(),
     fRateChecksEnabled(true),
+    journal(nullptr),
     cs()
 {
 }
@@ -271,6 +273,11 @@ void CGovernanceManager::CheckOrphanVotes(CGovernanceObject& govobj, CGovernance
         if (pairVote.second < nNow) {
             fRemove = true;
         } else if (govobj.ProcessVote(nullptr, vote, exception, connman)) {
+            cmapVoteToObject.Insert(vote.GetHash(), &govobj);
+            vote_rec_t voteRecord;
+            if (journal && govobj.GetCurrentMNVotes(vote.GetSmartnodeOutpoint(), voteRecord)) {
+                journal->Append(uint8_t(JOURNAL_VOTE), vote, voteRecord.mapInstances[int(vote.GetSignal())].nTime);
+            }
             vote.Relay(connman);
             fRemove = true;
         }
@@ -310,6 +317,10 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
         return;
     }
 
+    if (journal) {
+        journal->Append(uint8_t(JOURNAL_OBJECT), govobj);
+    }
+
     // SHOULD WE ADD THIS OBJECT TO ANY OTHER MANANGERS?
 
     LogPrint(BCLog::GOBJECT, "CGovernanceManager::AddGovernanceObject -- Before trigger block, GetDataAsPlainString = %s, nObjectType = %d\n",
@@ -333,8 +344,9 @@ void CGovernanceManager::AddGovernanceObject(CGovernanceObject& govobj, CConnman
 
     // WE MIGHT HAVE PENDING/ORPHAN VOTES FOR THIS OBJECT
 
+    // Apply them to our copy, the one the journal and cmapVoteToObject refer to
     CGovernanceException exception;
-    CheckOrphanVotes(govobj, exception, connman);
+    CheckOrphanVotes(objpair.first->second, exception, connman);
 
     // SEND NOTIFICATION TO SCRIPT/ZMQ
     GetMainSignals().NotifyGovernanceObject(govobj);
@@ -426,6 +438,10 @@ void CGovernanceManager::UpdateCachesAndClean()
 
             mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
             mapObjects.erase(it++);
+
+            if (journal) {
+                journal->Append(uint8_t(JOURNAL_ERASE), nHash, nTimeExpired);
+            }
         } else {
             // NOTE: triggers are handled via triggerman
             if (pObj->GetObjectType() == GOVERNANCE_OBJECT_PROPOSAL) {
@@ -842,6 +858,11 @@ bool CGovernanceManager::ProcessVote(CNode* pfrom, const CGovernanceVote& vote,
     }
 
     bool fOk = govobj.ProcessVote(pfrom, vote, exception, connman) && cmapVoteToObject.Insert(nHashVote, &govobj);
+
+    vote_rec_t voteRecord;
+    if (fOk && journal && govobj.GetCurrentMNVotes(vote.GetSmartnodeOutpoint(), voteRecord)) {
+        journal->Append(uint8_t(JOURNAL_VOTE), vote, voteRecord.mapInstances[int(vote.GetSignal())].nTime);
+    }
     LEAVE_CRITICAL_SECTION(cs);
     return fOk;
 }
@@ -1136,6 +1157,48 @@ void CGovernanceManager::InitOnLoad()
     LogPrintf("     %s\n", ToString());
 }
 
+void CGovernanceManager::ReplayJournalRecord(CDataStream& s)
+{
+    LOCK(cs);
+
+    uint8_t nType;
+    s >> nType;
+
+    switch (nType) {
+    case JOURNAL_OBJECT: {
+        CGovernanceObject govobj;
+        s >> govobj;
+        if (mapObjects.emplace(govobj.GetHash(), govobj).second) {
+            SmartnodeRateUpdate(govobj);
+        }
+        break;
+    }
+    case JOURNAL_VOTE: {
+        CGovernanceVote vote;
+        int64_t nVoteTime;
+        s >> vote;
+        s >> nVoteTime;
+        object_m_it it = mapObjects.find(vote.GetParentHash());
+        if (it == mapObjects.end() || !it->second.ReplayVote(vote, nVoteTime)) {
+            LogPrint(BCLog::GOBJECT, "CGovernanceManager::%s -- dropping vote %s\n", __func__, vote.GetHash().ToString());
+        }
+        break;
+    }
+    case JOURNAL_ERASE: {
+        uint256 nHash;
+        int64_t nTimeExpired;
+        s >> nHash;
+        s >> nTimeExpired;
+        mmetaman.RemoveGovernanceObject(nHash);
+        mapObjects.erase(nHash);
+        mapErasedGovernanceObjects.insert(std::make_pair(nHash, nTimeExpired));
+        break;
+    }
+    default:
+        LogPrintf("CGovernanceManager::%s -- unknown record type %d\n", __func__, nType);
+    }
+}
+
 std::string CGovernanceManager::ToString() const
 {
     LOCK(cs);
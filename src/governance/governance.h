@@ -22,6 +22,7 @@
 
 #include <univalue.h>
 
+class CFlatDBJournal;
 class CGovernanceManager;
 class CGovernanceTriggerManager;
 class CGovernanceObject;
@@ -251,6 +252,9 @@ private:
 
     bool fRateChecksEnabled;
 
+    // changes since the last checkpoint of governance.dat, if journaling is enabled
+    CFlatDBJournal* journal;
+
     // used to check for changed voting keys
     CDeterministicMNList lastMNListForVotingKeys;
 
@@ -275,6 +279,13 @@ private:
     };
 
 public:
+    // kinds of records in the governance journal
+    enum JournalRecordType : uint8_t {
+        JOURNAL_OBJECT = 1,
+        JOURNAL_VOTE = 2,
+        JOURNAL_ERASE = 3,
+    };
+
     // critical section to protect the inner data structures
     mutable CCriticalSection cs;
 
@@ -398,6 +409,15 @@ public:
 
     void InitOnLoad();
 
+    void SetJournal(CFlatDBJournal* journalIn)
+    {
+        LOCK(cs);
+        journal = journalIn;
+    }
+
+    // Apply a change recorded in the journal on top of the loaded checkpoint
+    void ReplayJournalRecord(CDataStream& s);
+
     int RequestGovernanceObjectVotes(CNode* pnode, CConnman& connman);
     int RequestGovernanceObjectVotes(const std::vector<CNode*>& vNodesCopy, CConnman& connman);
 
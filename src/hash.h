@@ -303,43 +303,36 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
 
 /* ----------- Ghost Rider Hash ------------------------------------------------ */
 template<typename T1>
-inline uint256 HashGR(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+inline uint256 HashGR(const T1 pbegin, const T1 pend, const GRPlan& plan)
 {
-	static unsigned char pblank[1];
-
-	uint512 hash[18];
-	HashSelection hashSelection(PrevBlockHash, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14}, {0, 1, 2, 3, 4, 5});
-    std::vector<int> randomCNs(hashSelection.getCnIndexes());
-    std::vector<int> coreHashIndexes(hashSelection.getAlgoIndexes());
-    for (int i = 0; i < 18; ++i) {
-        const void* toHash;
-        int lenToHash;
-        if (i == 0) {
-            toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
-            lenToHash = (pend - pbegin) * sizeof(pbegin[0]);
-        } else {
-            toHash = static_cast<const void*>(&hash[i - 1]);
-            lenToHash = 64;
-        }
-        int coreSelection = -1;
-        int cnSelection   = -1;
-        if (i < 5) {
-            coreSelection = coreHashIndexes[i];
-        } else if (i == 5) {
-            cnSelection = randomCNs[0];
-        } else if (i < 11) {
-            coreSelection = coreHashIndexes[i - 1];
-        } else if (i == 11) {
-            cnSelection = randomCNs[1];
-        } else if (i < 17) {
-            coreSelection = coreHashIndexes[i - 2];
-        } else if (i == 17) {
-            cnSelection = randomCNs[2];
-        }
+    static unsigned char pblank[1];
+
+    uint512 hash[2];
+    const void* toHash = (pbegin == pend ? pblank : static_cast<const void*>(&pbegin[0]));
+    plan.rounds[0](toHash, &hash[0], (pend - pbegin) * sizeof(pbegin[0]));
+    for (int i = 1; i < GRPlan::ROUNDS; ++i) {
+        plan.rounds[i](&hash[(i - 1) & 1], &hash[i & 1], 64);
+    }
+    return hash[(GRPlan::ROUNDS - 1) & 1].trim256();
+}
 
-		coreHash(toHash, &hash[i], lenToHash, coreSelection);
-		cnHash(&hash[i-1], &hash[i], lenToHash, cnSelection);
-	}
-	return hash[17].trim256();;
+/** GhostRider hash of a prefix already absorbed into midstate followed by [pbegin, pend) */
+template<typename T1>
+inline uint256 HashGR(const GRMidstate& midstate, const T1 pbegin, const T1 pend)
+{
+    const GRPlan& plan = midstate.GetPlan();
+
+    uint512 hash[2];
+    midstate.FinishFirstRound(static_cast<const void*>(&pbegin[0]), (pend - pbegin) * sizeof(pbegin[0]), &hash[0]);
+    for (int i = 1; i < GRPlan::ROUNDS; ++i) {
+        plan.rounds[i](&hash[(i - 1) & 1], &hash[i & 1], 64);
+    }
+    return hash[(GRPlan::ROUNDS - 1) & 1].trim256();
+}
+
+template<typename T1>
+inline uint256 HashGR(const T1 pbegin, const T1 pend, const uint256 PrevBlockHash)
+{
+    return HashGR(pbegin, pend, MakeGRPlan(PrevBlockHash));
 }
 #endif // BITCOIN_HASH_H
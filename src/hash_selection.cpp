@@ -6,9 +6,31 @@
  *      Author: tri
  */
 
+#if defined(HAVE_CONFIG_H)
+#include "config/yerbas-config.h"
+#endif
+
 #include "hash_selection.h"
 #include "cryptonote/slow-hash.h"
 
+#include <assert.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+#include <cpuid.h>
+#endif
+
+namespace sph_multi_sse2
+{
+void Keccak512_2way(unsigned char* const out[], const unsigned char* const in[]);
+}
+
+namespace sph_multi_avx2
+{
+void Keccak512_4way(unsigned char* const out[], const unsigned char* const in[]);
+void Blake512_4way(unsigned char* const out[], const unsigned char* const in[]);
+}
+
 std::vector<std::vector<int>> GR_GROUP = {
 		{0,1,2,3,4},
 		{5,6,7,8,9},
@@ -92,127 +114,308 @@ std::string HashSelection::getHashSelectionString() {
 	selectedAlgoes.append(selectedCN_3);
 	return selectedAlgoes;
 }
-void coreHash(const void *toHash, uint512* hash, int lenToHash, int hashSelection) {
-	sph_blake512_context     ctx_blake;      //0
-	sph_bmw512_context       ctx_bmw;        //1
-	sph_groestl512_context   ctx_groestl;    //2
-	sph_jh512_context        ctx_jh;         //3
-	sph_keccak512_context    ctx_keccak;     //4
-	sph_skein512_context     ctx_skein;      //5
-	sph_luffa512_context     ctx_luffa;      //6
-	sph_cubehash512_context  ctx_cubehash;   //7
-	sph_shavite512_context   ctx_shavite;    //8
-	sph_simd512_context      ctx_simd;       //9
-	sph_echo512_context      ctx_echo;       //A
-	sph_hamsi512_context     ctx_hamsi;      //B
-	sph_fugue512_context     ctx_fugue;      //C
-	sph_shabal512_context    ctx_shabal;     //D
-	sph_whirlpool_context    ctx_whirlpool;  //E
-	sph_sha512_context       ctx_sha512;     //F
-	switch(hashSelection) {
-		case 0:
-			sph_blake512_init(&ctx_blake);
-			sph_blake512 (&ctx_blake, toHash, lenToHash);
-			sph_blake512_close(&ctx_blake, static_cast<void*>(hash));
-			break;
-		case 1:
-			sph_bmw512_init(&ctx_bmw);
-			sph_bmw512 (&ctx_bmw, toHash, lenToHash);
-			sph_bmw512_close(&ctx_bmw, static_cast<void*>(hash));
-			break;
-		case 2:
-			sph_groestl512_init(&ctx_groestl);
-			sph_groestl512 (&ctx_groestl, toHash, lenToHash);
-			sph_groestl512_close(&ctx_groestl, static_cast<void*>(hash));
-			break;
-		case 3:
-			sph_jh512_init(&ctx_jh);
-			sph_jh512 (&ctx_jh, toHash, lenToHash);
-			sph_jh512_close(&ctx_jh, static_cast<void*>(hash));
-			break;
-		case 4:
-			sph_keccak512_init(&ctx_keccak);
-			sph_keccak512 (&ctx_keccak, toHash, lenToHash);
-			sph_keccak512_close(&ctx_keccak, static_cast<void*>(hash));
-			break;
-		case 5:
-			sph_skein512_init(&ctx_skein);
-			sph_skein512 (&ctx_skein, toHash, lenToHash);
-			sph_skein512_close(&ctx_skein, static_cast<void*>(hash));
-			break;
-		case 6:
-			sph_luffa512_init(&ctx_luffa);
-			sph_luffa512 (&ctx_luffa, toHash, lenToHash);
-			sph_luffa512_close(&ctx_luffa, static_cast<void*>(hash));
-			break;
-		case 7:
-			sph_cubehash512_init(&ctx_cubehash);
-			sph_cubehash512 (&ctx_cubehash, toHash, lenToHash);
-			sph_cubehash512_close(&ctx_cubehash, static_cast<void*>(hash));
-			break;
-		case 8:
-			sph_shavite512_init(&ctx_shavite);
-			sph_shavite512(&ctx_shavite, toHash, lenToHash);
-			sph_shavite512_close(&ctx_shavite, static_cast<void*>(hash));
-			break;
-		case 9:
-			sph_simd512_init(&ctx_simd);
-			sph_simd512 (&ctx_simd, toHash, lenToHash);
-			sph_simd512_close(&ctx_simd, static_cast<void*>(hash));
-			break;
-		case 10:
-			sph_echo512_init(&ctx_echo);
-			sph_echo512 (&ctx_echo, toHash, lenToHash);
-			sph_echo512_close(&ctx_echo, static_cast<void*>(hash));
-			break;
-	   case 11:
-			sph_hamsi512_init(&ctx_hamsi);
-			sph_hamsi512 (&ctx_hamsi, toHash, lenToHash);
-			sph_hamsi512_close(&ctx_hamsi, static_cast<void*>(hash));
-			break;
-	   case 12:
-			sph_fugue512_init(&ctx_fugue);
-			sph_fugue512 (&ctx_fugue, toHash, lenToHash);
-			sph_fugue512_close(&ctx_fugue, static_cast<void*>(hash));
-			break;
-	   case 13:
-			sph_shabal512_init(&ctx_shabal);
-			sph_shabal512 (&ctx_shabal, toHash, lenToHash);
-			sph_shabal512_close(&ctx_shabal, static_cast<void*>(hash));
-			break;
-	   case 14:
-			sph_whirlpool_init(&ctx_whirlpool);
-			sph_whirlpool(&ctx_whirlpool, toHash, lenToHash);
-			sph_whirlpool_close(&ctx_whirlpool, static_cast<void*>(hash));
-			break;
-	   case 15:
-			sph_sha512_init(&ctx_sha512);
-			sph_sha512 (&ctx_sha512, toHash, lenToHash);
-			sph_sha512_close(&ctx_sha512, static_cast<void*>(hash));
+namespace {
+template<typename Context, void (*Init)(void*), void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void coreHashRound(const void* toHash, uint512* hash, int lenToHash)
+{
+	Context ctx;
+	Init(&ctx);
+	Update(&ctx, toHash, lenToHash);
+	Close(&ctx, static_cast<void*>(hash));
+}
+
+const GRRoundFn coreHashRounds[16] = {
+	coreHashRound<sph_blake512_context, sph_blake512_init, sph_blake512, sph_blake512_close>,             //0
+	coreHashRound<sph_bmw512_context, sph_bmw512_init, sph_bmw512, sph_bmw512_close>,                     //1
+	coreHashRound<sph_groestl512_context, sph_groestl512_init, sph_groestl512, sph_groestl512_close>,     //2
+	coreHashRound<sph_jh512_context, sph_jh512_init, sph_jh512, sph_jh512_close>,                         //3
+	coreHashRound<sph_keccak512_context, sph_keccak512_init, sph_keccak512, sph_keccak512_close>,         //4
+	coreHashRound<sph_skein512_context, sph_skein512_init, sph_skein512, sph_skein512_close>,             //5
+	coreHashRound<sph_luffa512_context, sph_luffa512_init, sph_luffa512, sph_luffa512_close>,             //6
+	coreHashRound<sph_cubehash512_context, sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close>, //7
+	coreHashRound<sph_shavite512_context, sph_shavite512_init, sph_shavite512, sph_shavite512_close>,     //8
+	coreHashRound<sph_simd512_context, sph_simd512_init, sph_simd512, sph_simd512_close>,                 //9
+	coreHashRound<sph_echo512_context, sph_echo512_init, sph_echo512, sph_echo512_close>,                 //A
+	coreHashRound<sph_hamsi512_context, sph_hamsi512_init, sph_hamsi512, sph_hamsi512_close>,             //B
+	coreHashRound<sph_fugue512_context, sph_fugue512_init, sph_fugue512, sph_fugue512_close>,             //C
+	coreHashRound<sph_shabal512_context, sph_shabal512_init, sph_shabal512, sph_shabal512_close>,         //D
+	coreHashRound<sph_whirlpool_context, sph_whirlpool_init, sph_whirlpool, sph_whirlpool_close>,         //E
+	coreHashRound<sph_sha512_context, sph_sha512_init, sph_sha512, sph_sha512_close>                      //F
+};
+
+struct CoreHashMidstateFns {
+	void (*absorb)(void* ctx, const void* data, int len);
+	void (*finish)(const void* ctx, const void* data, int len, uint512* hash);
+};
+
+template<typename Context, void (*Init)(void*), void (*Update)(void*, const void*, size_t)>
+void coreHashAbsorb(void* ctx, const void* data, int len)
+{
+	Init(ctx);
+	Update(ctx, data, len);
+}
+
+template<typename Context, void (*Update)(void*, const void*, size_t), void (*Close)(void*, void*)>
+void coreHashFinish(const void* midstate, const void* data, int len, uint512* hash)
+{
+	Context ctx = *static_cast<const Context*>(midstate);
+	Update(&ctx, data, len);
+	Close(&ctx, static_cast<void*>(hash));
+}
+
+#define CORE_HASH_MIDSTATE(ctx, name) \
+	{coreHashAbsorb<ctx, name##_init, name>, coreHashFinish<ctx, name, name##_close>}
+
+const CoreHashMidstateFns coreHashMidstates[16] = {
+	CORE_HASH_MIDSTATE(sph_blake512_context, sph_blake512),         //0
+	CORE_HASH_MIDSTATE(sph_bmw512_context, sph_bmw512),             //1
+	CORE_HASH_MIDSTATE(sph_groestl512_context, sph_groestl512),     //2
+	CORE_HASH_MIDSTATE(sph_jh512_context, sph_jh512),               //3
+	CORE_HASH_MIDSTATE(sph_keccak512_context, sph_keccak512),       //4
+	CORE_HASH_MIDSTATE(sph_skein512_context, sph_skein512),         //5
+	CORE_HASH_MIDSTATE(sph_luffa512_context, sph_luffa512),         //6
+	CORE_HASH_MIDSTATE(sph_cubehash512_context, sph_cubehash512),   //7
+	CORE_HASH_MIDSTATE(sph_shavite512_context, sph_shavite512),     //8
+	CORE_HASH_MIDSTATE(sph_simd512_context, sph_simd512),           //9
+	CORE_HASH_MIDSTATE(sph_echo512_context, sph_echo512),           //A
+	CORE_HASH_MIDSTATE(sph_hamsi512_context, sph_hamsi512),         //B
+	CORE_HASH_MIDSTATE(sph_fugue512_context, sph_fugue512),         //C
+	CORE_HASH_MIDSTATE(sph_shabal512_context, sph_shabal512),       //D
+	CORE_HASH_MIDSTATE(sph_whirlpool_context, sph_whirlpool),       //E
+	CORE_HASH_MIDSTATE(sph_sha512_context, sph_sha512)              //F
+};
+
+#undef CORE_HASH_MIDSTATE
+
+// Releases the calling thread's CryptoNight scratchpad when the thread exits
+struct CNScratchpadReleaser {
+	~CNScratchpadReleaser() { cn_slow_hash_free_state(); }
+};
+
+template<void (*CNHash)(const char*, char*, uint32_t, int)>
+void cnHashRound(const void* toHash, uint512* hash, int lenToHash)
+{
+	static thread_local CNScratchpadReleaser scratchpadReleaser;
+	(void)scratchpadReleaser;
+	// CryptoNight only produces 256 bits, the upper half of the digest fed to the next round is zero
+	hash->SetNull();
+	CNHash(static_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
+}
+
+const GRRoundFn cnHashRounds[6] = {
+	cnHashRound<crypto::cryptonight_dark_hash>,       //0
+	cnHashRound<crypto::cryptonight_darklite_hash>,   //1
+	cnHashRound<crypto::cryptonight_cnfast_hash>,     //2
+	cnHashRound<crypto::cryptonight_cnlite_hash>,     //3
+	cnHashRound<crypto::cryptonight_turtle_hash>,     //4
+	cnHashRound<crypto::cryptonight_turtlelite_hash>  //5
+};
+
+// Allocation free equivalent of HashSelection::getRandomIndexes for the indexes 0..count-1
+void getRandomIndexes(const uint256& prevBlockHash, int count, int8_t* result)
+{
+	int8_t used[16] = {0};
+	int found = 0;
+	int i = 63;
+	for (; i >= 0; i--) {
+		unsigned int hashSelection = prevBlockHash.GetNibble(i);
+		if (hashSelection >= (unsigned int)count) {
+			hashSelection = hashSelection % count;
+		}
+		if (!used[hashSelection]) {
+			result[found++] = hashSelection;
+			used[hashSelection] = 1;
+		}
+		if (found == count) {
 			break;
+		}
+	}
+	if (i < 0 && found < count) {
+		for (int j = 0; j < count; j++) {
+			if (!used[j]) {
+				result[found++] = j;
+			}
+		}
+	}
+}
+}
+
+namespace {
+typedef void (*CoreHash64MultiFn)(unsigned char* const out[], const unsigned char* const in[]);
+
+// Multi-lane kernels of the core algorithms hashing 64 byte inputs, set up by GRBatchAutoDetect
+CoreHash64MultiFn coreHash64_2way[16] = {};
+CoreHash64MultiFn coreHash64_4way[16] = {};
+
+#if defined(__x86_64__) || defined(__amd64__) || defined(__i386__)
+/** Check whether the OS has enabled AVX registers. */
+bool AVXEnabled()
+{
+	uint32_t a, d;
+	__asm__("xgetbv" : "=a"(a), "=d"(d) : "c"(0));
+	return (a & 6) == 6;
+}
+#endif
+
+bool BatchSelfTest()
+{
+	uint512 in[5], out[5], expected;
+	const uint512* pin[5];
+	uint512* pout[5];
+	for (int i = 0; i < 5; i++) {
+		for (int j = 0; j < 64; j++) {
+			*(in[i].begin() + j) = (unsigned char)(i * 71 + j * 13 + 5);
+		}
+		pin[i] = &in[i];
+		pout[i] = &out[i];
+	}
+	for (int algo = 0; algo < 16; algo++) {
+		if (!coreHash64_2way[algo] && !coreHash64_4way[algo]) {
+			continue;
+		}
+		// 5 lanes go through the 4-way, 2-way and scalar paths
+		coreHashN(pin, pout, 5, algo);
+		for (int i = 0; i < 5; i++) {
+			coreHashRounds[algo](&in[i], &expected, 64);
+			if (out[i] != expected) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+}
+
+std::string GRBatchAutoDetect()
+{
+	std::string ret = "standard";
+#if !defined(BUILD_BITCOIN_INTERNAL)
+#if defined(__SSE2__)
+	coreHash64_2way[4] = sph_multi_sse2::Keccak512_2way;
+	ret = "sse2(2way)";
+#endif
+
+#if defined(ENABLE_AVX2) && (defined(__x86_64__) || defined(__amd64__) || defined(__i386__))
+	uint32_t eax, ebx, ecx, edx;
+	bool have_avx2 = false;
+	__cpuid(1, eax, ebx, ecx, edx);
+	const bool have_xsave = (ecx >> 27) & 1;
+	const bool have_avx = (ecx >> 28) & 1;
+	if (have_xsave && have_avx && AVXEnabled() && __get_cpuid_max(0, nullptr) >= 7) {
+		__cpuid_count(7, 0, eax, ebx, ecx, edx);
+		have_avx2 = (ebx >> 5) & 1;
+	}
+	if (have_avx2) {
+		coreHash64_4way[0] = sph_multi_avx2::Blake512_4way;
+		coreHash64_4way[4] = sph_multi_avx2::Keccak512_4way;
+		ret += ",avx2(4way)";
+	}
+#endif
+#endif
+
+	assert(BatchSelfTest());
+	return ret;
+}
+
+void coreHashN(const uint512* const toHash[], uint512* const hash[], int n, int hashSelection)
+{
+	assert(hashSelection >= 0 && hashSelection < 16);
+	const unsigned char* in[4];
+	unsigned char* out[4];
+	int i = 0;
+	if (coreHash64_4way[hashSelection]) {
+		for (; i + 4 <= n; i += 4) {
+			for (int l = 0; l < 4; l++) {
+				in[l] = toHash[i + l]->begin();
+				out[l] = hash[i + l]->begin();
+			}
+			coreHash64_4way[hashSelection](out, in);
+		}
+	}
+	if (coreHash64_2way[hashSelection]) {
+		for (; i + 2 <= n; i += 2) {
+			for (int l = 0; l < 2; l++) {
+				in[l] = toHash[i + l]->begin();
+				out[l] = hash[i + l]->begin();
+			}
+			coreHash64_2way[hashSelection](out, in);
+		}
+	}
+	for (; i < n; i++) {
+		coreHashRounds[hashSelection](toHash[i], hash[i], 64);
+	}
+}
+
+GRPlan MakeGRPlan(const uint256& prevBlockHash) {
+	int8_t coreIndexes[GRPlan::CORE_ALGOS];
+	int8_t cnIndexes[GRPlan::CN_VARIANTS];
+	getRandomIndexes(prevBlockHash, GRPlan::CN_VARIANTS, cnIndexes);
+	getRandomIndexes(prevBlockHash, GRPlan::CORE_ALGOS, coreIndexes);
+
+	// Five core rounds followed by one CryptoNight round, three times
+	GRPlan plan;
+	for (int i = 0; i < GRPlan::ROUNDS; i++) {
+		int group = i / 6;
+		if (i % 6 == 5) {
+			plan.algos[i] = GRPlan::CN_BASE + cnIndexes[group];
+			plan.rounds[i] = cnHashRounds[cnIndexes[group]];
+		} else {
+			plan.algos[i] = coreIndexes[i - group];
+			plan.rounds[i] = coreHashRounds[coreIndexes[i - group]];
+		}
+	}
+	return plan;
+}
+
+GRMidstate::GRMidstate(const GRPlan& _plan, const void* prefix, int prefixLen) : plan(_plan) {
+	// The first round is always one of the core algorithms
+	assert(plan.algos[0] >= 0 && plan.algos[0] < 16);
+	coreHashMidstates[plan.algos[0]].absorb(&ctx, prefix, prefixLen);
+}
+
+void GRMidstate::FinishFirstRound(const void* tail, int tailLen, uint512* hash) const {
+	coreHashMidstates[plan.algos[0]].finish(&ctx, tail, tailLen, hash);
+}
+
+void HashGRBatch(const GRMidstate& midstate, const unsigned char* const tails[], int tailLen, uint256 hashes[], int n)
+{
+	assert(n > 0 && n <= GRPlan::MAX_LANES);
+	const GRPlan& plan = midstate.GetPlan();
+
+	uint512 buf[2][GRPlan::MAX_LANES];
+	const uint512* in[GRPlan::MAX_LANES];
+	uint512* out[GRPlan::MAX_LANES];
+	for (int l = 0; l < n; l++) {
+		midstate.FinishFirstRound(tails[l], tailLen, &buf[0][l]);
+	}
+	for (int i = 1; i < GRPlan::ROUNDS; i++) {
+		for (int l = 0; l < n; l++) {
+			in[l] = &buf[(i - 1) & 1][l];
+			out[l] = &buf[i & 1][l];
+		}
+		if (plan.algos[i] < GRPlan::CN_BASE) {
+			coreHashN(in, out, n, plan.algos[i]);
+		} else {
+			for (int l = 0; l < n; l++) {
+				plan.rounds[i](in[l], out[l], 64);
+			}
+		}
+	}
+	for (int l = 0; l < n; l++) {
+		hashes[l] = buf[(GRPlan::ROUNDS - 1) & 1][l].trim256();
+	}
+}
+
+void coreHash(const void *toHash, uint512* hash, int lenToHash, int hashSelection) {
+	if (hashSelection < 0 || hashSelection > 15) {
+		return;
 	}
+	coreHashRounds[hashSelection](toHash, hash, lenToHash);
 }
 
 void cnHash(uint512* toHash, uint512* hash, int lenToHash, int hashSelection) {
-	switch(hashSelection)
-	{
-	 case 0:
-		crypto::cryptonight_dark_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
-  	break;
-	 case 1:
-		crypto::cryptonight_darklite_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
-		break;
-	 case 2:
-		crypto::cryptonight_cnfast_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
-		break;
-	 case 3:
-	  crypto::cryptonight_cnlite_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
-		break;
-	 case 4:
-		crypto::cryptonight_turtle_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
-		break;
-	 case 5:
-		crypto::cryptonight_turtlelite_hash(reinterpret_cast<const char*>(toHash), reinterpret_cast<char*>(hash), lenToHash, 1);
-		break;
+	if (hashSelection < 0 || hashSelection > 5) {
+		return;
 	}
+	cnHashRounds[hashSelection](toHash, hash, lenToHash);
 }
@@ -39,6 +39,87 @@ extern std::vector<std::vector<int>> GR_GROUP;
 void coreHash(const void *toHash, uint512* hash, int lenToHash, int hashSelection);
 void cnHash(uint512* toHash, uint512* hash, int lenToHash, int hashSelection);
 
+/** A single GhostRider round, hashing lenToHash bytes into a 512 bit digest */
+typedef void (*GRRoundFn)(const void* toHash, uint512* hash, int lenToHash);
+
+/**
+ * The resolved GhostRider round order for one previous block hash.
+ * Building it is allocation free, and it can be kept around and reused for
+ * every header that shares the same hashPrevBlock (e.g. all nonces tried by
+ * the miner).
+ */
+struct GRPlan {
+	static const int ROUNDS = 18;
+	static const int CORE_ALGOS = 15;
+	static const int CN_VARIANTS = 6;
+	/** Offset added to the CryptoNight variant index in algos[] */
+	static const int CN_BASE = 16;
+	/** Upper bound on the number of inputs hashed together by HashGRBatch */
+	static const int MAX_LANES = 8;
+
+	GRRoundFn rounds[ROUNDS];
+	/** Core algorithm index (0-15) or CN_BASE + CryptoNight variant of every round */
+	int8_t algos[ROUNDS];
+};
+
+GRPlan MakeGRPlan(const uint256& prevBlockHash);
+
+/**
+ * State of the first GhostRider round after absorbing a fixed prefix of the
+ * input. sph contexts are plain structs, so the state is copied for every
+ * tail and only the blocks that contain the tail get compressed again. How
+ * much work is saved depends on the block size of the first algorithm: the
+ * 32/64/72 byte block functions (jh, keccak, skein, luffa, cubehash, hamsi,
+ * fugue, shabal, whirlpool) skip all full blocks of an 80 byte header, the
+ * 128 byte block ones only skip re-absorbing the prefix.
+ */
+class GRMidstate {
+public:
+	GRMidstate(const GRPlan& plan, const void* prefix, int prefixLen);
+
+	/** Finish the first round with the remaining input bytes */
+	void FinishFirstRound(const void* tail, int tailLen, uint512* hash) const;
+
+	const GRPlan& GetPlan() const { return plan; }
+
+private:
+	GRPlan plan;
+	union {
+		sph_blake512_context     blake;
+		sph_bmw512_context       bmw;
+		sph_groestl512_context   groestl;
+		sph_jh512_context        jh;
+		sph_keccak512_context    keccak;
+		sph_skein512_context     skein;
+		sph_luffa512_context     luffa;
+		sph_cubehash512_context  cubehash;
+		sph_shavite512_context   shavite;
+		sph_simd512_context      simd;
+		sph_echo512_context      echo;
+		sph_hamsi512_context     hamsi;
+		sph_fugue512_context     fugue;
+		sph_shabal512_context    shabal;
+		sph_whirlpool_context    whirlpool;
+		sph_sha512_context       sha512;
+	} ctx;
+};
+
+/**
+ * Hash n 64 byte inputs with core algorithm hashSelection (0-15). Algorithms
+ * with a multi-lane kernel for the running CPU hash several inputs per call,
+ * the rest fall back to the scalar sph code.
+ */
+void coreHashN(const uint512* const toHash[], uint512* const hash[], int n, int hashSelection);
+
+/**
+ * GhostRider hashes of n (at most GRPlan::MAX_LANES) inputs that share the
+ * prefix absorbed into midstate and differ in their tailLen byte tails.
+ */
+void HashGRBatch(const GRMidstate& midstate, const unsigned char* const tails[], int tailLen, uint256 hashes[], int n);
+
+/** Autodetect the best available multi-lane kernels for coreHashN. */
+std::string GRBatchAutoDetect();
+
 class HashSelection {
 public:
 	HashSelection(const uint256 prevBlockHash, const std::vector<int> algoIndexes, std::vector<int> cnIndexes) {
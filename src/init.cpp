@@ -11,6 +11,7 @@
 
 #include "init.h"
 
+#include "addressindexer.h"
 #include "addrman.h"
 #include "amount.h"
 #include "base58.h"
@@ -38,6 +39,7 @@
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "stratum.h"
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -77,6 +79,8 @@
 #include "llmq/quorums_init.h"
 
 #include <primitives/powcache.h>
+#include <cryptonote/slow-hash.h>
+#include <hash_selection.h>
 
 #include <stdint.h>
 #include <stdio.h>
@@ -197,6 +201,7 @@ public:
 
 static CCoinsViewErrorCatcher *pcoinscatcher = nullptr;
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
+static std::unique_ptr<CFlatDBJournal> governanceJournal;
 
 void Interrupt(boost::thread_group& threadGroup)
 {
@@ -205,12 +210,25 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
     llmq::InterruptLLMQSystem();
     if (g_connman)
         g_connman->Interrupt();
     threadGroup.interrupt_all();
 }
 
+/** Periodically write the Yerbas specific caches, so a crash doesn't lose everything since the last start */
+static void CheckpointCaches()
+{
+    if (ShutdownRequested()) {
+        return;
+    }
+    CFlatDB<CSmartnodeMetaMan>("mncache.dat", "magicSmartnodeCache").Checkpoint(mmetaman);
+    CFlatDB<CGovernanceManager>("governance.dat", "magicGovernanceCache", governanceJournal.get()).Checkpoint(governance);
+    CFlatDB<CNetFulfilledRequestManager>("netfulfilled.dat", "magicFulfilledCache").Checkpoint(netfulfilledman);
+    CFlatDB<CSporkManager>("sporks.dat", "magicSporkCache").Checkpoint(sporkManager);
+}
+
 /** Preparing steps before shutting down or restarting the wallet */
 void PrepareShutdown()
 {
@@ -230,6 +248,8 @@ void PrepareShutdown()
     StopREST();
     StopRPC();
     StopHTTPServer();
+    StopStratumServer();
+    blockTemplateManager.Disconnect();
     llmq::StopLLMQSystem();
 
     // fRPCInWarmup should be `false` if we completed the loading sequence
@@ -255,19 +275,21 @@ void PrepareShutdown()
     if(g_connman) g_connman->Stop();
     peerLogic.reset();
     g_connman.reset();
+    StopHeaderPowThreads();
 
     if (!fLiteMode && !fRPCInWarmup) {
         // STORE DATA CACHES INTO SERIALIZED DAT FILES
         CFlatDB<CSmartnodeMetaMan> flatdb1("mncache.dat", "magicSmartnodeCache");
         flatdb1.Dump(mmetaman);
-        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache");
+        CFlatDB<CGovernanceManager> flatdb3("governance.dat", "magicGovernanceCache", governanceJournal.get());
         flatdb3.Dump(governance);
+        governance.SetJournal(nullptr);
+        governanceJournal.reset();
         CFlatDB<CNetFulfilledRequestManager> flatdb4("netfulfilled.dat", "magicFulfilledCache");
         flatdb4.Dump(netfulfilledman);
         CFlatDB<CSporkManager> flatdb6("sporks.dat", "magicSporkCache");
         flatdb6.Dump(sporkManager);
-        CFlatDB<CPowCache> flatdb7("powcache.dat", "powCache");
-        flatdb7.Dump(CPowCache::Instance());
+        CPowCache::Instance().Flush();
     }
 
     if (fDumpMempoolLater && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
@@ -291,6 +313,11 @@ void PrepareShutdown()
         FlushStateToDisk();
     }
 
+    if (g_addressindexer) {
+        g_addressindexer->Stop();
+        g_addressindexer.reset();
+    }
+
     // After there are no more peers/RPC left to give us new data which may generate
     // CValidationInterface callbacks, flush them...
     GetMainSignals().FlushBackgroundCallbacks();
@@ -316,6 +343,10 @@ void PrepareShutdown()
         pblocktree = nullptr;
 
         /** YERB START */
+        // The snapshot builder reads from the assets DB
+        if (pAssetSnapshotDb)
+            pAssetSnapshotDb->Stop();
+
         delete passets;
         passets = nullptr;
 
@@ -528,6 +559,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug) {
         strUsage += HelpMessageOpt("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()));
     }
+    strUsage += HelpMessageOpt("-cachecheckpointinterval=<n>", strprintf(_("Write the smartnode, governance, fulfilled request and spork caches every <n> minutes and journal governance changes in between, 0 to only write them at shutdown (default: %u)"), DEFAULT_CACHE_CHECKPOINT_INTERVAL));
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
     strUsage += HelpMessageOpt("-syncmempool", strprintf(_("Sync mempool from other nodes on start (default: %u)"), DEFAULT_SYNC_MEMPOOL));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
@@ -576,6 +608,7 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-proxy=<ip:port>", _("Connect through SOCKS5 proxy"));
     strUsage += HelpMessageOpt("-proxyrandomize", strprintf(_("Randomize credentials for every proxy connection. This enables Tor stream isolation (default: %u)"), DEFAULT_PROXYRANDOMIZE));
     strUsage += HelpMessageOpt("-seednode=<ip>", _("Connect to a node to retrieve peer addresses, and disconnect"));
+    strUsage += HelpMessageOpt("-socketevents=<mode>", strprintf(_("Socket events mode, which must be one of: %s (default: %s)"), GetSupportedSocketEventsModesString(), SocketEventsModeToString(DEFAULT_SOCKETEVENTS)));
     strUsage += HelpMessageOpt("-timeout=<n>", strprintf(_("Specify connection timeout in milliseconds (minimum: 1, default: %d)"), DEFAULT_CONNECT_TIMEOUT));
     strUsage += HelpMessageOpt("-torcontrol=<ip>:<port>", strprintf(_("Tor control port to use if onion listening enabled (default: %s)"), DEFAULT_TOR_CONTROL));
     strUsage += HelpMessageOpt("-torpassword=<pass>", _("Tor control port password (default: empty)"));
@@ -620,6 +653,7 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-checkblockindex", strprintf("Do a full consistency check for mapBlockIndex, setBlockIndexCandidates, chainActive and mapBlocksUnlinked occasionally. Also sets -checkmempool (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkmempool=<n>", strprintf("Run checks every <n> transactions (default: %u)", defaultChainParams->DefaultConsistencyChecks()));
         strUsage += HelpMessageOpt("-checkpoints", strprintf("Disable expensive verification for known chain history (default: %u)", DEFAULT_CHECKPOINTS_ENABLED));
+        strUsage += HelpMessageOpt("-checkblockreadpow", strprintf("Re-check the proof of work of every block read from disk, including fully validated ones (default: %u)", DEFAULT_CHECKBLOCKREADPOW));
         strUsage += HelpMessageOpt("-disablesafemode", strprintf("Disable safemode, override a real safe mode event (default: %u)", DEFAULT_DISABLE_SAFEMODE));
         strUsage += HelpMessageOpt("-testsafemode", strprintf("Force safe mode (default: %u)", DEFAULT_TESTSAFEMODE));
         strUsage += HelpMessageOpt("-dropmessagestest=<n>", "Randomly drop 1 of every <n> network messages");
@@ -702,6 +736,11 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
 
+    strUsage += HelpMessageGroup(_("Stratum server options:"));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>[:port]", strprintf(_("Bind the Stratum v1 server to given address and listen for miners (default port: %u). Use [host]:port notation for IPv6. This option can be specified multiple times, the server is only started if it is set"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumaddress=<address>", _("Pay the blocks mined through the Stratum server to <address>"));
+    strUsage += HelpMessageOpt("-stratumdifficulty=<n>", strprintf(_("Share difficulty for Stratum miners, in the units of the difficulty reported by getmininginfo (default: %g)"), DEFAULT_STRATUM_DIFFICULTY));
+
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
     strUsage += HelpMessageOpt("-rest", strprintf(_("Accept public REST requests (default: %u)"), DEFAULT_REST_ENABLE));
@@ -1059,18 +1098,6 @@ void InitParameterInteraction()
         LogPrintf("%s: parameter interaction: can't use -hdseed and -mnemonic/-mnemonicpassphrase together, will prefer -seed\n", __func__);
     }
 #endif // ENABLE_WALLET
-
-    // Make sure additional indexes are recalculated correctly in VerifyDB
-    // (we must reconnect blocks whenever we disconnect them for these indexes to work)
-    bool fAdditionalIndexes =
-        gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) ||
-        gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
-        gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
-
-    if (fAdditionalIndexes && gArgs.GetArg("-checklevel", DEFAULT_CHECKLEVEL) < 4) {
-        gArgs.ForceSetArg("-checklevel", "4");
-        LogPrintf("%s: parameter interaction: additional indexes -> setting -checklevel=4\n", __func__);
-    }
 }
 
 static std::string ResolveErrMsg(const char * const optname, const std::string& strBind)
@@ -1096,6 +1123,7 @@ namespace { // Variables internal to initialization process only
 int nMaxConnections;
 int nUserMaxConnections;
 int nFD;
+static SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
 ServiceFlags nLocalServices = NODE_NETWORK;
 
 } // namespace
@@ -1200,8 +1228,16 @@ bool AppInitParameterInteraction()
     nUserMaxConnections = gArgs.GetArg("-maxconnections", DEFAULT_MAX_PEER_CONNECTIONS);
     nMaxConnections = std::max(nUserMaxConnections, 0);
 
+    std::string strSocketEventsMode = gArgs.GetArg("-socketevents", SocketEventsModeToString(DEFAULT_SOCKETEVENTS));
+    if (!SocketEventsModeFromString(strSocketEventsMode, socketEventsMode)) {
+        return InitError(strprintf(_("Invalid -socketevents ('%s') specified. Only these modes are supported: %s"), strSocketEventsMode, GetSupportedSocketEventsModesString()));
+    }
+
     // Trim requested connection counts, to fit into system limitations
-    nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    if (socketEventsMode == SOCKETEVENTS_SELECT) {
+        // select() can't wait on sockets beyond FD_SETSIZE
+        nMaxConnections = std::max(std::min(nMaxConnections, (int)(FD_SETSIZE - nBind - MIN_CORE_FILEDESCRIPTORS - MAX_ADDNODE_CONNECTIONS)), 0);
+    }
     nFD = RaiseFileDescriptorLimit(nMaxConnections + MIN_CORE_FILEDESCRIPTORS + MAX_ADDNODE_CONNECTIONS);
     if (nFD < MIN_CORE_FILEDESCRIPTORS)
         return InitError(_("Not enough file descriptors available."));
@@ -1262,6 +1298,7 @@ bool AppInitParameterInteraction()
     }
     fCheckBlockIndex = gArgs.GetBoolArg("-checkblockindex", chainparams.DefaultConsistencyChecks());
     fCheckpointsEnabled = gArgs.GetBoolArg("-checkpoints", DEFAULT_CHECKPOINTS_ENABLED);
+    fCheckBlockReadPOW = gArgs.GetBoolArg("-checkblockreadpow", DEFAULT_CHECKBLOCKREADPOW);
 
     hashAssumeValid = uint256S(gArgs.GetArg("-assumevalid", chainparams.GetConsensus().defaultAssumeValid.GetHex()));
     if (!hashAssumeValid.IsNull())
@@ -1550,6 +1587,8 @@ bool AppInitSanityChecks()
     // Initialize elliptic curve code
     std::string sha256_algo = SHA256AutoDetect();
     LogPrintf("Using the '%s' SHA256 implementation\n", sha256_algo);
+    LogPrintf("Using the '%s' CryptoNight implementation\n", cn_slow_hash_autodetect());
+    LogPrintf("Using the '%s' GhostRider batch hashing implementation\n", GRBatchAutoDetect());
     RandomInit();
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
@@ -1607,6 +1646,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
     }
+    StartHeaderPowThreads(nScriptCheckThreads);
 
     std::vector<std::string> vSporkAddresses;
     if (gArgs.IsArgSet("-sporkaddr")) {
@@ -1820,16 +1860,24 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     int64_t nBlockTreeDBCache = nTotalCache / 8;
     nBlockTreeDBCache = std::min(nBlockTreeDBCache, (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX) ? nMaxBlockDBAndTxIndexCache : nMaxBlockDBCache) << 20);
     nTotalCache -= nBlockTreeDBCache;
+    // the asset, messaging and rewards databases share one slice instead of each taking the block index share
+    int64_t nAssetsDBCache = std::min(2 * nBlockTreeDBCache, nTotalCache / 8);
+    nTotalCache -= nAssetsDBCache;
     int64_t nCoinDBCache = std::min(nTotalCache / 2, (nTotalCache / 4) + (1 << 23)); // use 25%-50% of the remainder for disk cache
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     int64_t nEvoDbCache = 1024 * 1024 * 16; // TODO
+    int64_t nLLMQDbCache = 1024 * 1024 * 4;
+    // all LevelDB databases share one block cache within this budget, see CDBMemoryBudget
+    dbMemoryBudget.Init(nBlockTreeDBCache + nAssetsDBCache + nCoinDBCache + nEvoDbCache + nLLMQDbCache);
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for asset databases\n", nAssetsDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for the shared database block cache\n", dbMemoryBudget.GetCacheCapacity() * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
     int64_t nStart = GetTimeMillis();
@@ -1856,11 +1904,15 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 evoDb = new CEvoDB(nEvoDbCache, false, fReset || fReindexChainState);
                 deterministicMNManager = new CDeterministicMNManager(*evoDb);
                 pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReset);
-                llmq::InitLLMQSystem(*evoDb, &scheduler, false, fReset || fReindexChainState);
+                llmq::InitLLMQSystem(*evoDb, &scheduler, false, fReset || fReindexChainState, nLLMQDbCache);
 
                 
                 /** YERB START */
                 {
+                    // The snapshot builder reads from the assets DB
+                    if (pAssetSnapshotDb)
+                        pAssetSnapshotDb->Stop();
+
                     // Basic assets
                     delete passets;
                     delete passetsdb;
@@ -1888,8 +1940,11 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     delete pAssetSnapshotDb;
                     delete pDistributeSnapshotDb;
 
+                    // Half of the asset slice goes to the assets database, the others split the rest
+                    int64_t nAssetsAuxDBCache = nAssetsDBCache / 14;
+
                     // Basic assets
-                    passetsdb = new CAssetsDB(nBlockTreeDBCache, false, fReset);
+                    passetsdb = new CAssetsDB(nAssetsDBCache / 2, false, fReset);
                     passets = new CAssetsCache();
                     passetsCache = new CLRUCache<std::string, CDatabasedAssetData>(MAX_CACHE_ASSETS_SIZE);
 
@@ -1897,14 +1952,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     pMessagesCache = new CLRUCache<std::string, CMessage>(1000);
                     pMessageSubscribedChannelsCache = new CLRUCache<std::string, int>(1000);
                     pMessagesSeenAddressCache = new CLRUCache<std::string, int>(1000);
-                    pmessagedb = new CMessageDB(nBlockTreeDBCache, false, false);
-                    pmessagechanneldb = new CMessageChannelDB(nBlockTreeDBCache, false, false);
+                    pmessagedb = new CMessageDB(nAssetsAuxDBCache, false, false);
+                    pmessagechanneldb = new CMessageChannelDB(nAssetsAuxDBCache, false, false);
 
                     // My restricted assets
-                    pmyrestricteddb = new CMyRestrictedDB(nBlockTreeDBCache, false, false);
+                    pmyrestricteddb = new CMyRestrictedDB(nAssetsAuxDBCache, false, false);
 
                     // Restricted assets
-                    prestricteddb = new CRestrictedDB(nBlockTreeDBCache, false, fReset);
+                    prestricteddb = new CRestrictedDB(nAssetsAuxDBCache, false, fReset);
                     passetsVerifierCache = new CLRUCache<std::string, CNullAssetTxVerifierString>(
                             MAX_CACHE_ASSETS_SIZE);
                     passetsQualifierCache = new CLRUCache<std::string, int8_t>(MAX_CACHE_ASSETS_SIZE);
@@ -1912,9 +1967,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     passetsGlobalRestrictionCache = new CLRUCache<std::string, int8_t>(MAX_CACHE_ASSETS_SIZE);
 
                     // Rewards
-                    pSnapshotRequestDb = new CSnapshotRequestDB(nBlockTreeDBCache, false, false);
-                    pAssetSnapshotDb = new CAssetSnapshotDB(nBlockTreeDBCache, false, false);
-                    pDistributeSnapshotDb = new CDistributeSnapshotRequestDB(nBlockTreeDBCache, false, false);
+                    pSnapshotRequestDb = new CSnapshotRequestDB(nAssetsAuxDBCache, false, false);
+                    pAssetSnapshotDb = new CAssetSnapshotDB(nAssetsAuxDBCache, false, false);
+                    pDistributeSnapshotDb = new CDistributeSnapshotRequestDB(nAssetsAuxDBCache, false, false);
 
                     // Read for fAssetIndex to make sure that we only load asset address balances if it if true
                     pblocktree->ReadFlag("assetindex", fAssetIndex);
@@ -1974,24 +2029,6 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -addressindex");
-                    break;
-                }
-
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -timestampindex");
-                    break;
-                }
-
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex to change -spentindex");
-                    break;
-                }
-
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -2067,6 +2104,15 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                         break;
                     }
                 }
+
+                // The address, spent and timestamp indexes catch up with the chain in the background
+                {
+                    LOCK(cs_main);
+                    if (!InitAddressIndexer()) {
+                        strLoadError = _("Error initializing the address index");
+                        break;
+                    }
+                }
             } catch (const std::exception& e) {
                 LogPrintf("%s\n", e.what());
                 strLoadError = _("Error opening block database");
@@ -2108,6 +2154,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         LogPrintf(" block index %15dms\n", GetTimeMillis() - nStart);
     }
 
+    if (g_addressindexer) {
+        g_addressindexer->Start();
+    }
+
     fs::path est_path = GetDataDir() / FEE_ESTIMATES_FILENAME;
     CAutoFile est_filein(fsbridge::fopen(est_path, "rb"), SER_DISK, CLIENT_VERSION);
     // Allowed to fail as this file IS missing on first startup.
@@ -2115,17 +2165,25 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
 
-        // ********************************************************* Step 8a: load powcache.dat
+        // ********************************************************* Step 8a: open powcache.log
 
     {
-        fs::path pathDB = GetDataDir();
-        std::string strDBName = "powcache.dat";
+        fs::path pathLog = GetDataDir() / "powcache.log";
 
         // Always load the powcache if available:
         uiInterface.InitMessage(_("Loading POW cache..."));
-        CFlatDB<CPowCache> flatdb7(strDBName, "powCache");
-        if(!flatdb7.Load(CPowCache::Instance())) {
-            return InitError(_("Failed to load POW cache from") + "\n" + (pathDB / strDBName).string());
+        if (!CPowCache::Instance().OpenLog(pathLog)) {
+            return InitError(_("Failed to load POW cache from") + "\n" + pathLog.string());
+        }
+
+        // Move entries over from the old whole-file format once
+        fs::path pathOldDB = GetDataDir() / "powcache.dat";
+        if (fs::exists(pathOldDB)) {
+            CFlatDB<CPowCache> flatdb7("powcache.dat", "powCache");
+            if (flatdb7.Load(CPowCache::Instance())) {
+                CPowCache::Instance().Flush();
+            }
+            fs::remove(pathOldDB);
         }
     }
 
@@ -2264,7 +2322,12 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     strDBName = "governance.dat";
     uiInterface.InitMessage(_("Loading governance cache..."));
-    CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache");
+    int64_t nCacheCheckpointInterval = gArgs.GetArg("-cachecheckpointinterval", DEFAULT_CACHE_CHECKPOINT_INTERVAL);
+    if (nCacheCheckpointInterval > 0 && !fLiteMode) {
+        governanceJournal.reset(new CFlatDBJournal(strDBName, "magicGovernanceJournal", governance.cs,
+                                                   std::bind(&CGovernanceManager::ReplayJournalRecord, &governance, std::placeholders::_1)));
+    }
+    CFlatDB<CGovernanceManager> flatdb3(strDBName, "magicGovernanceCache", governanceJournal.get());
     if (fLoadCacheFiles) {
         if(!flatdb3.Load(governance)) {
             return InitError(_("Failed to load governance cache from") + "\n" + (pathDB / strDBName).string());
@@ -2276,6 +2339,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
             return InitError(_("Failed to clear governance cache at") + "\n" + (pathDB / strDBName).string());
         }
     }
+    governance.SetJournal(governanceJournal.get());
 
     strDBName = "netfulfilled.dat";
     uiInterface.InitMessage(_("Loading fulfilled requests cache..."));
@@ -2299,6 +2363,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         scheduler.scheduleEvery(boost::bind(&CSmartnodeSync::DoMaintenance, boost::ref(smartnodeSync), boost::ref(*g_connman)), 1 * 1000);
 
         scheduler.scheduleEvery(boost::bind(&CGovernanceManager::DoMaintenance, boost::ref(governance), boost::ref(*g_connman)), 60 * 5 * 1000);
+
+        if (nCacheCheckpointInterval > 0) {
+            scheduler.scheduleEvery(CheckpointCaches, nCacheCheckpointInterval * 60 * 1000);
+        }
     }
 
     scheduler.scheduleEvery(boost::bind(&CSmartnodeUtils::DoMaintenance, boost::ref(*g_connman)), 1 * 1000);
@@ -2306,6 +2374,13 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     // Periodic flush of POW Cache if cache has grown enough
     scheduler.scheduleEvery(boost::bind(&CPowCache::DoMaintenance, &CPowCache::Instance()), 60 * 1000);
 
+    // Keep the candidate block of getblocktemplate, the miner and the Stratum server following the mempool
+    blockTemplateManager.Connect();
+    scheduler.scheduleEvery(boost::bind(&CBlockTemplateManager::DoMaintenance, boost::ref(blockTemplateManager)), 1 * 1000);
+
+    // Follow the databases' use of the shared block cache
+    scheduler.scheduleEvery(boost::bind(&CDBMemoryBudget::Rebalance, &dbMemoryBudget), 60 * 1000);
+
     if (fSmartnodeMode) {
         scheduler.scheduleEvery(boost::bind(&CPrivateSendServer::DoMaintenance, boost::ref(privateSendServer), boost::ref(*g_connman)), 1 * 1000);
 #ifdef ENABLE_WALLET
@@ -2383,6 +2458,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     connOptions.nMaxOutboundTimeframe = nMaxOutboundTimeframe;
     connOptions.nMaxOutboundLimit = nMaxOutboundLimit;
+    connOptions.socketEventsMode = socketEventsMode;
 
     for (const std::string& strBind : gArgs.GetArgs("-bind")) {
         CService addrBind;
@@ -2418,6 +2494,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    if (gArgs.IsArgSet("-stratumbind") && !StartStratumServer()) {
+        return false;
+    }
+
     // ********************************************************* Step 13: finished
 
     SetRPCWarmupFinished();
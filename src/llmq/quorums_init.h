@@ -6,6 +6,7 @@
 #ifndef YERBAS_QUORUMS_INIT_H
 #define YERBAS_QUORUMS_INIT_H
 
+class CBLSWorker;
 class CDBWrapper;
 class CEvoDB;
 class CScheduler;
@@ -16,8 +17,10 @@ namespace llmq
 // If true, we will connect to all new quorums and watch their communication
 static const bool DEFAULT_WATCH_QUORUMS = false;
 
+extern CBLSWorker* blsWorker;
+
 // Init/destroy LLMQ globals
-void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests, bool fWipe = false);
+void InitLLMQSystem(CEvoDB& evoDb, CScheduler* scheduler, bool unitTests, bool fWipe = false, size_t nDbCache = 1 << 20);
 void DestroyLLMQSystem();
 
 // Manage scheduled tasks, threads, listeners etc.
@@ -4,6 +4,7 @@
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
 #include "quorums_chainlocks.h"
+#include "quorums_init.h"
 #include "quorums_instantsend.h"
 #include "quorums_utils.h"
 
@@ -778,7 +779,8 @@ std::unordered_set<uint256> CInstantSendManager::ProcessPendingInstantSendLocks(
 {
     auto llmqType = Params().GetConsensus().llmqTypeInstantSend;
 
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8);
+    // ISLOCKs often arrive in bursts, so spread the verification over the BLS worker pool
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, true, 8, blsWorker);
     std::unordered_map<uint256, std::pair<CQuorumCPtr, CRecoveredSig>> recSigs;
 
     for (const auto& p : pend) {
@@ -3,6 +3,7 @@
 // Distributed under the MIT/X11 software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "quorums_init.h"
 #include "quorums_signing.h"
 #include "quorums_utils.h"
 #include "quorums_signing_shares.h"
@@ -612,7 +613,7 @@ bool CSigningManager::ProcessPendingRecoveredSigs(CConnman& connman)
 
     // It's ok to perform insecure batched verification here as we verify against the quorum public keys, which are not
     // craftable by individual entities, making the rogue public key attack impossible
-    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false);
+    CBLSBatchVerifier<NodeId, uint256> batchVerifier(false, false, 0, blsWorker);
 
     size_t verifyCount = 0;
     for (auto& p : recSigsByNode) {
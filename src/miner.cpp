@@ -63,6 +63,10 @@ double nHashesPerSec = 0;
 uint64_t nHashesDone = 0;
 std::string alsoHashString;
 
+// Nonces hashed per call so the multi-lane GhostRider kernels get full batches.
+// Divides 256, so the search loop still breaks out every 256 nonces.
+static const int MINER_HASH_LANES = 4;
+
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
 {
     int64_t nOldTime = pblock->nTime;
@@ -83,11 +87,16 @@ BlockAssembler::Options::Options() {
     nBlockMaxSize = DEFAULT_BLOCK_MAX_SIZE;
 }
 
+static unsigned int ClampBlockMaxSize(size_t nBlockMaxSize)
+{
+    // Limit size to between 1K and MaxBlockSize()-1K for sanity:
+    return std::max((unsigned int)1000, std::min((unsigned int)(MaxBlockSize(fDIP0001ActiveAtTip) - 1000), (unsigned int)nBlockMaxSize));
+}
+
 BlockAssembler::BlockAssembler(const CChainParams& params, const Options& options) : chainparams(params)
 {
     blockMinFeeRate = options.blockMinFeeRate;
-    // Limit size to between 1K and MaxBlockSize()-1K for sanity:
-    nBlockMaxSize = std::max((unsigned int)1000, std::min((unsigned int)(MaxBlockSize(fDIP0001ActiveAtTip) - 1000), (unsigned int)options.nBlockMaxSize));
+    nBlockMaxSize = ClampBlockMaxSize(options.nBlockMaxSize);
 }
 
 static BlockAssembler::Options DefaultOptions(const CChainParams& params)
@@ -110,6 +119,28 @@ static BlockAssembler::Options DefaultOptions(const CChainParams& params)
 
 BlockAssembler::BlockAssembler(const CChainParams& params) : BlockAssembler(params, DefaultOptions(params)) {}
 
+// Pay the block reward and the fees to the coinbase, less the smartnode, superblock and founder payments
+static void FillCoinbasePayments(CMutableTransaction& coinbaseTx, CBlockTemplate& blocktemplate, const CBlockIndex* pindexPrev, CAmount nFees, CAmount nSpecialTxFees, const CChainParams& chainparams)
+{
+    const int nHeight = pindexPrev->nHeight + 1;
+
+    // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
+    CAmount blockReward = nFees + GetBlockSubsidy(pindexPrev->nBits, pindexPrev->nHeight, chainparams.GetConsensus());
+    CAmount blockRewardWithSpecialtx = blockReward + nSpecialTxFees;
+
+    // Compute regular coinbase transaction.
+    coinbaseTx.vout.resize(1);
+    coinbaseTx.vout[0].nValue = blockRewardWithSpecialtx;
+
+    // Update coinbase transaction with additional info about smartnode and governance payments,
+    // get some info back to pass to getblocktemplate
+    blocktemplate.voutSmartnodePayments.clear();
+    blocktemplate.voutSuperblockPayments.clear();
+    FillBlockPayments(coinbaseTx, nHeight, blockReward, blocktemplate.voutSmartnodePayments, blocktemplate.voutSuperblockPayments, nSpecialTxFees);
+    FounderPayment founderPayment = chainparams.GetConsensus().nFounderPayment;
+    founderPayment.FillFounderPayment(coinbaseTx, nHeight, blockReward, blocktemplate.block.txoutFounder);
+}
+
 void BlockAssembler::resetBlock()
 {
     inBlock.clear();
@@ -194,13 +225,6 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     coinbaseTx.vout.resize(1);
     coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
 
-    // NOTE: unlike in bitcoin, we need to pass PREVIOUS block height here
-    CAmount blockReward = nFees + GetBlockSubsidy(pindexPrev->nBits, pindexPrev->nHeight, Params().GetConsensus());
-    CAmount blockRewardWithSpecialtx = blockReward + nSpecialTxFees;
-
-    // Compute regular coinbase transaction.
-    coinbaseTx.vout[0].nValue = blockRewardWithSpecialtx;
-
     if (!fDIP0003Active_context) {
         coinbaseTx.vin[0].scriptSig = CScript() << nHeight << OP_0;
     } else {
@@ -226,11 +250,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
         SetTxPayload(coinbaseTx, cbTx);
     }
 
-    // Update coinbase transaction with additional info about smartnode and governance payments,
-    // get some info back to pass to getblocktemplate
-    FillBlockPayments(coinbaseTx, nHeight, blockReward, pblocktemplate->voutSmartnodePayments, pblocktemplate->voutSuperblockPayments, nSpecialTxFees);
-    FounderPayment founderPayment = chainparams.GetConsensus().nFounderPayment;
-	founderPayment.FillFounderPayment(coinbaseTx, nHeight, blockReward, pblock->txoutFounder);
+    FillCoinbasePayments(coinbaseTx, *pblocktemplate, pindexPrev, nFees, nSpecialTxFees, chainparams);
     pblock->vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
     pblocktemplate->vTxFees[0] = -nFees;
     pblocktemplate->vSpecialTxFees[0] = -nSpecialTxFees;
@@ -504,6 +524,323 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
     }
 }
 
+CBlockTemplateManager blockTemplateManager;
+
+void CBlockTemplateManager::Connect()
+{
+    mempool.NotifyEntryAdded.connect(boost::bind(&CBlockTemplateManager::TransactionAddedToMempool, this, _1));
+    mempool.NotifyEntryRemoved.connect(boost::bind(&CBlockTemplateManager::TransactionRemovedFromMempool, this, _1, _2));
+}
+
+void CBlockTemplateManager::Disconnect()
+{
+    mempool.NotifyEntryAdded.disconnect(boost::bind(&CBlockTemplateManager::TransactionAddedToMempool, this, _1));
+    mempool.NotifyEntryRemoved.disconnect(boost::bind(&CBlockTemplateManager::TransactionRemovedFromMempool, this, _1, _2));
+}
+
+void CBlockTemplateManager::TransactionAddedToMempool(CTransactionRef tx)
+{
+    LOCK(cs);
+    if (fRebuild) {
+        // the rebuild picks it up
+        return;
+    }
+    if (tx->nType != TRANSACTION_NORMAL || GetTime() - nLastRequest > BLOCK_TEMPLATE_IDLE_TIMEOUT) {
+        // Special transactions change the CbTx of the candidate, and there is
+        // no point in queueing transactions while nobody asks for templates
+        fRebuild = true;
+        return;
+    }
+    vPendingTxs.push_back(tx->GetHash());
+}
+
+void CBlockTemplateManager::TransactionRemovedFromMempool(CTransactionRef tx, MemPoolRemovalReason reason)
+{
+    LOCK(cs);
+    // a rebuild in flight might have picked it up already
+    if (nRebuildsInFlight > 0 || setInBlock.count(tx->GetHash())) {
+        fRebuild = true;
+    }
+}
+
+void CBlockTemplateManager::Invalidate()
+{
+    LOCK(cs);
+    fRebuild = true;
+}
+
+void CBlockTemplateManager::Refresh()
+{
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+
+    bool fRebuildNow;
+    {
+        LOCK(cs);
+        fRebuildNow = fRebuild || pindexPrev != pindexTip ||
+                      (nTransactionsUpdated != nTransactionsUpdatedRebuild && GetTime() - nLastRebuild >= BLOCK_TEMPLATE_REBUILD_INTERVAL);
+        if (fRebuildNow) {
+            // the new candidate has everything added to the mempool until now
+            vPendingTxs.clear();
+            fRebuild = false;
+            ++nRebuildsInFlight;
+        }
+    }
+
+    if (fRebuildNow) {
+        Rebuild();
+    }
+    AddPendingTransactions();
+}
+
+void CBlockTemplateManager::Rebuild()
+{
+    const CChainParams& chainparams = Params();
+    std::unique_ptr<CBlockTemplate> pblocktemplateNew;
+    const CBlockIndex* pindexPrevNew;
+    unsigned int nTransactionsUpdated;
+    uint64_t nRebuild;
+    try {
+        LOCK2(cs_main, mempool.cs);
+        nTransactionsUpdated = mempool.GetTransactionsUpdated();
+        pblocktemplateNew = BlockAssembler(chainparams).CreateNewBlock(CScript());
+        if (!pblocktemplateNew) {
+            throw std::runtime_error("out of memory");
+        }
+        pindexPrevNew = chainActive.Tip();
+        LOCK(cs);
+        nRebuild = ++nRebuilds;
+    } catch (...) {
+        LOCK(cs);
+        --nRebuildsInFlight;
+        fRebuild = true;
+        throw;
+    }
+
+    LOCK(cs);
+    --nRebuildsInFlight;
+    if (nRebuild < nRebuildInstalled) {
+        // a rebuild which looked at the mempool later was quicker
+        return;
+    }
+    nRebuildInstalled = nRebuild;
+    nLastRebuild = GetTime();
+    nTransactionsUpdatedRebuild = nTransactionsUpdated;
+
+    pblocktemplate = std::move(pblocktemplateNew);
+    pindexPrev = pindexPrevNew;
+    // CreateNewBlock ran TestBlockValidity on it
+    nSequenceValidated = ++nSequence;
+    pblocktemplateValidated.reset(new CBlockTemplate(*pblocktemplate));
+    nLastValidation = GetTime();
+
+    const CBlock& block = pblocktemplate->block;
+    setInBlock.clear();
+    // Reserve space for coinbase tx, like BlockAssembler
+    nBlockSize = 1000;
+    nBlockSigOps = 100;
+    nFees = 0;
+    nSpecialTxFees = 0;
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        setInBlock.insert(block.vtx[i]->GetHash());
+        nBlockSize += block.vtx[i]->GetTotalSize();
+        nBlockSigOps += pblocktemplate->vTxSigOps[i];
+        nFees += pblocktemplate->vTxFees[i];
+        nSpecialTxFees += pblocktemplate->vSpecialTxFees[i];
+    }
+    nLockTimeCutoff = (STANDARD_LOCKTIME_VERIFY_FLAGS & LOCKTIME_MEDIAN_TIME_PAST)
+                       ? pindexPrev->GetMedianTimePast()
+                       : block.GetBlockTime();
+    BlockAssembler::Options options = DefaultOptions(chainparams);
+    nBlockMaxSize = ClampBlockMaxSize(options.nBlockMaxSize);
+    blockMinFeeRate = options.blockMinFeeRate;
+}
+
+void CBlockTemplateManager::AddPendingTransactions()
+{
+    int64_t nTimeStart = GetTimeMicros();
+
+    // cs_main keeps the tip from changing under the candidate
+    LOCK2(cs_main, mempool.cs);
+    LOCK(cs);
+    if (vPendingTxs.empty() || fRebuild || !pblocktemplate || pindexPrev != chainActive.Tip()) {
+        return;
+    }
+
+    const int nHeight = pindexPrev->nHeight + 1;
+    CBlock& block = pblocktemplate->block;
+    int nAdded = 0;
+    for (const uint256& hash : vPendingTxs) {
+        auto it = mempool.mapTx.find(hash);
+        if (it == mempool.mapTx.end() || setInBlock.count(hash)) {
+            continue;
+        }
+        const CTransaction& tx = it->GetTx();
+
+        // The same checks as in addPackageTxs, for a package of one. A
+        // transaction whose parents didn't make it waits for the rebuild.
+        if (it->GetModifiedFee() < blockMinFeeRate.GetFee(it->GetTxSize())) {
+            continue;
+        }
+        if (nBlockSize + it->GetTxSize() >= nBlockMaxSize || nBlockSigOps + it->GetSigOpCount() >= MaxBlockSigOps(fDIP0001ActiveAtTip)) {
+            continue;
+        }
+        if (!IsFinalTx(tx, nHeight, nLockTimeCutoff) || !llmq::chainLocksHandler->IsTxSafeForMining(hash)) {
+            continue;
+        }
+        bool fParentsInBlock = true;
+        for (const CTxIn& txin : tx.vin) {
+            if (mempool.mapTx.count(txin.prevout.hash) && !setInBlock.count(txin.prevout.hash)) {
+                fParentsInBlock = false;
+                break;
+            }
+        }
+        if (!fParentsInBlock) {
+            continue;
+        }
+
+        block.vtx.emplace_back(it->GetSharedTx());
+        pblocktemplate->vTxFees.push_back(it->GetFee());
+        pblocktemplate->vSpecialTxFees.push_back(it->GetSpecialTxFee());
+        pblocktemplate->vTxSigOps.push_back(it->GetSigOpCount());
+        nBlockSize += it->GetTxSize();
+        nBlockSigOps += it->GetSigOpCount();
+        nFees += it->GetFee();
+        nSpecialTxFees += it->GetSpecialTxFee();
+        setInBlock.insert(hash);
+        ++nAdded;
+    }
+    vPendingTxs.clear();
+
+    if (nAdded > 0) {
+        ++nSequence;
+    }
+    LogPrint(BCLog::BENCHMARK, "CBlockTemplateManager::%s -- %d txs appended, total size %u txs: %u: %.2fms\n", __func__,
+             nAdded, nBlockSize, block.vtx.size() - 1, 0.001 * (GetTimeMicros() - nTimeStart));
+}
+
+std::unique_ptr<CBlockTemplate> CBlockTemplateManager::CopyCandidate(const CBlockIndex*& pindexPrevRet)
+{
+    std::unique_ptr<CBlockTemplate> pblocktemplateRet;
+    CAmount nFeesCandidate, nSpecialTxFeesCandidate;
+    uint64_t nSequenceCandidate, nRebuildCandidate;
+    {
+        LOCK(cs);
+        if (!pblocktemplate) {
+            return nullptr;
+        }
+        pindexPrevRet = pindexPrev;
+        if (nSequenceValidated != nSequence && pblocktemplateValidated && GetTime() - nLastValidation < BLOCK_TEMPLATE_VALIDATION_INTERVAL) {
+            // the appends get checked with the next copy once the interval passed
+            return std::unique_ptr<CBlockTemplate>(new CBlockTemplate(*pblocktemplateValidated));
+        }
+        pblocktemplateRet.reset(new CBlockTemplate(*pblocktemplate));
+        if (nSequenceValidated == nSequence) {
+            return pblocktemplateRet;
+        }
+        nFeesCandidate = nFees;
+        nSpecialTxFeesCandidate = nSpecialTxFees;
+        nSequenceCandidate = nSequence;
+        nRebuildCandidate = nRebuildInstalled;
+    }
+
+    // Outside of cs, as the smartnode and superblock payments lock cs_main and governance.cs
+    CMutableTransaction coinbaseTx(*pblocktemplateRet->block.vtx[0]);
+    FillCoinbasePayments(coinbaseTx, *pblocktemplateRet, pindexPrevRet, nFeesCandidate, nSpecialTxFeesCandidate, Params());
+    pblocktemplateRet->block.vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    pblocktemplateRet->vTxFees[0] = -nFeesCandidate;
+    pblocktemplateRet->vSpecialTxFees[0] = -nSpecialTxFeesCandidate;
+
+    // The appended transactions were only checked one by one, check them as a block before handing it out
+    {
+        LOCK(cs_main);
+        if (pindexPrevRet != chainActive.Tip()) {
+            // the next Refresh rebuilds it on the new tip
+            return nullptr;
+        }
+        CValidationState state;
+        if (!TestBlockValidity(state, Params(), pblocktemplateRet->block, chainActive.Tip(), false, false)) {
+            LogPrintf("CBlockTemplateManager::%s -- candidate with appended transactions is invalid, rebuilding: %s\n", __func__, FormatStateMessage(state));
+            LOCK(cs);
+            fRebuild = true;
+            return nullptr;
+        }
+    }
+
+    // keep the payments for the next requests, unless the candidate changed in the meantime
+    LOCK(cs);
+    if (nSequence == nSequenceCandidate) {
+        pblocktemplate.reset(new CBlockTemplate(*pblocktemplateRet));
+        nSequenceValidated = nSequenceCandidate;
+    }
+    if (nRebuildInstalled == nRebuildCandidate) {
+        // a candidate rebuilt in the meantime comes with its own checked copy
+        pblocktemplateValidated.reset(new CBlockTemplate(*pblocktemplateRet));
+        nLastValidation = GetTime();
+    }
+    return pblocktemplateRet;
+}
+
+std::unique_ptr<CBlockTemplate> CBlockTemplateManager::GetTemplate(const CScript& scriptPubKeyIn)
+{
+    {
+        LOCK(cs);
+        nLastRequest = GetTime();
+    }
+    Refresh();
+
+    const CBlockIndex* pindexPrevTemplate;
+    std::unique_ptr<CBlockTemplate> pblocktemplateRet = CopyCandidate(pindexPrevTemplate);
+    if (!pblocktemplateRet) {
+        // the candidate failed its check or lost its tip, a rebuilt one was checked by CreateNewBlock
+        Refresh();
+        pblocktemplateRet = CopyCandidate(pindexPrevTemplate);
+        if (!pblocktemplateRet) {
+            return nullptr;
+        }
+    }
+
+    CBlock& block = pblocktemplateRet->block;
+    CMutableTransaction coinbaseTx(*block.vtx[0]);
+    coinbaseTx.vout[0].scriptPubKey = scriptPubKeyIn;
+    block.vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    pblocktemplateRet->vTxSigOps[0] = GetLegacySigOpCount(*block.vtx[0]);
+    block.hashMerkleRoot = BlockMerkleRoot(block);
+    UpdateTime(&block, Params().GetConsensus(), pindexPrevTemplate);
+
+    return pblocktemplateRet;
+}
+
+uint64_t CBlockTemplateManager::GetSequence()
+{
+    LOCK(cs);
+    nLastRequest = GetTime();
+    return nSequence;
+}
+
+void CBlockTemplateManager::DoMaintenance()
+{
+    {
+        LOCK(cs);
+        if (nLastRequest == 0 || GetTime() - nLastRequest > BLOCK_TEMPLATE_IDLE_TIMEOUT) {
+            return;
+        }
+    }
+    if (IsInitialBlockDownload()) {
+        return;
+    }
+
+    try {
+        Refresh();
+    } catch (const std::exception& e) {
+        LogPrintf("CBlockTemplateManager::%s -- %s\n", __func__, e.what());
+    }
+}
+
 static bool ProcessBlockFound(const CBlock* pblock, const CChainParams& chainparams, uint256& hash)
 {
     LogPrintf("%s\n", pblock->ToString());
@@ -614,7 +951,7 @@ void static YerbasMiner(const CChainParams& chainparams)
 
 
 
-            std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript));
+            std::unique_ptr<CBlockTemplate> pblocktemplate(blockTemplateManager.GetTemplate(coinbaseScript->reserveScript));
 
             if (!pblocktemplate.get())
             {
@@ -622,6 +959,10 @@ void static YerbasMiner(const CChainParams& chainparams)
                 return;
             }
             CBlock *pblock = &pblocktemplate->block;
+            if (pblock->hashPrevBlock != pindexPrev->GetBlockHash()) {
+                // the tip changed while we were asking for the template
+                continue;
+            }
             HashSelection hashSelection(pblock->hashPrevBlock, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14}, {0, 1, 2, 3, 4, 5});
 			alsoHashString.clear();
 			alsoHashString.append(hashSelection.getHashSelectionString());
@@ -631,6 +972,9 @@ void static YerbasMiner(const CChainParams& chainparams)
             LogPrintf("YerbasMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
                 ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
 
+            // The round order only depends on hashPrevBlock, resolve it once for all nonces
+            const GRPlan grPlan = MakeGRPlan(pblock->hashPrevBlock);
+
             //
             // Search
             //
@@ -640,13 +984,27 @@ void static YerbasMiner(const CChainParams& chainparams)
             {
 
                 uint256 hash;
+                // Everything but nNonce stays fixed until the inner loop breaks
+                const GRMidstate grMidstate = pblock->GetPOWMidstate(grPlan);
+                uint256 hashes[MINER_HASH_LANES];
+                // Counted separately, after a found block nNonce isn't a multiple of 0x100 anymore
+                unsigned int nHashesSinceCheck = 0;
                 while (true)
                 {
                     //hash = pblock->GetPOWHash();
-                    hash = pblock->ComputeHash();
-                    if (UintToArith256(hash) <= hashTarget)
+                    pblock->ComputeHashes(grMidstate, hashes, MINER_HASH_LANES);
+                    int nFound = -1;
+                    for (int i = 0; i < MINER_HASH_LANES; i++) {
+                        if (UintToArith256(hashes[i]) <= hashTarget) {
+                            nFound = i;
+                            break;
+                        }
+                    }
+                    if (nFound >= 0)
                     {
                         // Found a solution
+                        pblock->nNonce += nFound;
+                        hash = hashes[nFound];
                         SetThreadPriority(THREAD_PRIORITY_NORMAL);
                         LogPrintf("YerbasMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
                         ProcessBlockFound(pblock, chainparams, hash);
@@ -659,14 +1017,15 @@ void static YerbasMiner(const CChainParams& chainparams)
 
                         break;
                     }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
+                    pblock->nNonce += MINER_HASH_LANES;
+                    nHashesDone += MINER_HASH_LANES;
                     if (nHashesDone % 1000 == 0) {   //Calculate hashing speed
                         nHashesPerSec = nHashesDone / (((GetTimeMicros() - nMiningTimeStart) / 1000000.00) + 1);
                         LogPrintf("nNonce: %d, hashRate %f\n",pblock->nNonce, nHashesPerSec);
                         //LogPrintf("YerbasMiner:\n  proof-of-work in progress \n  hash: %s\n  target: %s\n, different=%s\n", hash.GetHex(), hashTarget.GetHex(), (UintToArith256(hash) - hashTarget));
                     }
-                    if ((pblock->nNonce & 0xFF) == 0)
+                    nHashesSinceCheck += MINER_HASH_LANES;
+                    if (nHashesSinceCheck >= 0x100)
                         break;
                 }
 
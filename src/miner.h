@@ -205,6 +205,100 @@ private:
     int UpdatePackagesForAdded(const CTxMemPool::setEntries& alreadyAdded, indexed_modified_transaction_set &mapModifiedTx);
 };
 
+/** Seconds after which a changed mempool makes the candidate block run the whole package selection again */
+static const int64_t BLOCK_TEMPLATE_REBUILD_INTERVAL = 30;
+/** Seconds without requests after which the candidate block isn't kept up to date anymore */
+static const int64_t BLOCK_TEMPLATE_IDLE_TIMEOUT = 120;
+/** Seconds during which the last checked copy of the candidate is handed out instead of checking the appends again */
+static const int64_t BLOCK_TEMPLATE_VALIDATION_INTERVAL = 5;
+
+/**
+ * Keeps a candidate block on top of the tip ready to serve, so that
+ * getblocktemplate, the internal miner and the Stratum server don't run the
+ * whole package selection under cs_main for every template.
+ *
+ * Transactions entering the mempool are appended to the candidate as they
+ * arrive, when their mempool parents already are in it, which only holds
+ * cs_main for as long as checking the new transactions takes. The first
+ * copy handed out after appends is checked with TestBlockValidity, at most
+ * once every BLOCK_TEMPLATE_VALIDATION_INTERVAL seconds; in between the last
+ * checked copy keeps being handed out. A new
+ * tip, a transaction of the candidate leaving the mempool, a special
+ * transaction or a prioritisation make the candidate get rebuilt by
+ * BlockAssembler, as does a changed mempool every
+ * BLOCK_TEMPLATE_REBUILD_INTERVAL seconds to pick up the packages the
+ * appends skipped.
+ */
+class CBlockTemplateManager
+{
+private:
+    mutable CCriticalSection cs;
+
+    // The candidate, with its coinbase paying to an empty script
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    const CBlockIndex* pindexPrev{nullptr};
+    std::set<uint256> setInBlock;
+    // Bumped on every change of the candidate
+    uint64_t nSequence{0};
+    // The sequence at which the candidate passed TestBlockValidity, with a
+    // coinbase paying the fees of all its transactions
+    uint64_t nSequenceValidated{0};
+    // The last copy which passed TestBlockValidity, and when it did
+    std::unique_ptr<CBlockTemplate> pblocktemplateValidated;
+    int64_t nLastValidation{0};
+
+    // Information on the candidate, as kept by BlockAssembler while building it
+    uint64_t nBlockSize{0};
+    unsigned int nBlockSigOps{0};
+    CAmount nFees{0};
+    CAmount nSpecialTxFees{0};
+    int64_t nLockTimeCutoff{0};
+    unsigned int nBlockMaxSize{0};
+    CFeeRate blockMinFeeRate;
+
+    // Mempool additions not applied to the candidate yet
+    std::vector<uint256> vPendingTxs;
+    bool fRebuild{true};
+    int nRebuildsInFlight{0};
+    // Rebuilds are numbered in the order they looked at the mempool
+    uint64_t nRebuilds{0};
+    uint64_t nRebuildInstalled{0};
+    int64_t nLastRebuild{0};
+    unsigned int nTransactionsUpdatedRebuild{0};
+    int64_t nLastRequest{0};
+
+    void TransactionAddedToMempool(CTransactionRef tx);
+    void TransactionRemovedFromMempool(CTransactionRef tx, MemPoolRemovalReason reason);
+
+    /** Rebuild the candidate if needed, then apply the pending mempool additions */
+    void Refresh();
+    void Rebuild();
+    void AddPendingTransactions();
+    /** Copy the candidate, with a coinbase paying the fees of all its transactions.
+     *  Returns nullptr when the candidate has to be rebuilt first. */
+    std::unique_ptr<CBlockTemplate> CopyCandidate(const CBlockIndex*& pindexPrevRet);
+
+public:
+    /** Follow the mempool */
+    void Connect();
+    void Disconnect();
+
+    /** Rebuild the candidate on the next request, e.g. after a fee delta changed the order of the packages */
+    void Invalidate();
+
+    /** Return a copy of the candidate with its coinbase paying to scriptPubKeyIn */
+    std::unique_ptr<CBlockTemplate> GetTemplate(const CScript& scriptPubKeyIn);
+
+    /** Number bumped on every change of the candidate, for callers reusing a template.
+     *  Counts as a request, so the candidate keeps getting updated meanwhile. */
+    uint64_t GetSequence();
+
+    /** Keep the candidate up to date while templates are being requested */
+    void DoMaintenance();
+};
+
+extern CBlockTemplateManager blockTemplateManager;
+
 /** Modify the extranonce in a block */
 void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned int& nExtraNonce);
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
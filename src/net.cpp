@@ -45,6 +45,10 @@
 #include <sys/epoll.h>
 #endif
 
+#ifdef HAVE_EVENTFD
+#include <sys/eventfd.h>
+#endif
+
 #ifdef USE_KQUEUE
 #include <sys/event.h>
 #endif
@@ -66,6 +70,16 @@
 // We add a random period time (0 to 1 seconds) to feeler connections to prevent synchronization.
 #define FEELER_SLEEP_WINDOW 1
 
+// Time the socket handler waits for events before it looks after its nodes again
+static const int SELECT_TIMEOUT_MILLISECONDS = 50;
+
+#ifdef USE_EPOLL
+// Maximum number of events taken from epoll at once
+static const int EPOLL_MAX_EVENTS = 1024;
+// Marks the epoll data of the wakeup fd and listening sockets, the data of nodes is their id
+static const uint64_t EPOLL_DATA_SOCKET = 1ULL << 63;
+#endif
+
 // MSG_NOSIGNAL is not available on some platforms, if it doesn't exist define it as 0
 #if !defined(MSG_NOSIGNAL)
 #define MSG_NOSIGNAL 0
@@ -126,6 +140,48 @@ unsigned short GetListenPort()
     return (unsigned short)(gArgs.GetArg("-port", Params().GetDefaultPort()));
 }
 
+static std::vector<SocketEventsMode> GetSupportedSocketEventsModes()
+{
+    std::vector<SocketEventsMode> vModes{SOCKETEVENTS_SELECT};
+#ifdef USE_POLL
+    vModes.push_back(SOCKETEVENTS_POLL);
+#endif
+#ifdef USE_EPOLL
+    vModes.push_back(SOCKETEVENTS_EPOLL);
+#endif
+    return vModes;
+}
+
+std::string SocketEventsModeToString(SocketEventsMode mode)
+{
+    switch (mode) {
+        case SOCKETEVENTS_SELECT: return "select";
+        case SOCKETEVENTS_POLL: return "poll";
+        case SOCKETEVENTS_EPOLL: return "epoll";
+    }
+    return "unknown";
+}
+
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& modeRet)
+{
+    for (SocketEventsMode mode : GetSupportedSocketEventsModes()) {
+        if (str == SocketEventsModeToString(mode)) {
+            modeRet = mode;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string GetSupportedSocketEventsModesString()
+{
+    std::string strModes;
+    for (SocketEventsMode mode : GetSupportedSocketEventsModes()) {
+        strModes += (strModes.empty() ? "" : ", ") + SocketEventsModeToString(mode);
+    }
+    return strModes;
+}
+
 // find 'best' local address for a particular peer
 bool GetLocal(CService& addr, const CNetAddr *paddrPeer)
 {
@@ -419,7 +475,7 @@ CNode* CConnman::ConnectNode(CAddress addrConnect, const char *pszDest, bool fCo
     if (pszDest ? ConnectSocketByName(addrConnect, hSocket, pszDest, Params().GetDefaultPort(), nConnectTimeout, &proxyConnectionFailed) :
                   ConnectSocket(addrConnect, hSocket, nConnectTimeout, &proxyConnectionFailed))
     {
-        if (!IsSelectableSocket(hSocket)) {
+        if (!IsSocketEventsCapable(hSocket)) {
             LogPrintf("Cannot create connection: non-selectable socket created (fd >= FD_SETSIZE ?)\n");
             CloseSocket(hSocket);
             return nullptr;
@@ -936,6 +992,9 @@ size_t CConnman::SocketSendData(CNode *pnode) const
         assert(pnode->nSendSize == 0);
     }
     pnode->vSendMsg.erase(pnode->vSendMsg.begin(), it);
+    if (pnode->vSendMsg.empty()) {
+        UpdateSocketEvents(pnode);
+    }
     return nSentSize;
 }
 
@@ -1154,7 +1213,7 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         return;
     }
 
-    if (!IsSelectableSocket(hSocket))
+    if (!IsSocketEventsCapable(hSocket))
     {
         LogPrintf("%s: non-selectable socket\n", strDropped);
         CloseSocket(hSocket);
@@ -1210,15 +1269,384 @@ void CConnman::AcceptConnection(const ListenSocket& hListenSocket) {
         LogPrint(BCLog::NET, "connection accepted\n");
     }
 
+    AddNode(pnode);
+}
+
+void CConnman::AddNode(CNode* pnode)
+{
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        LOCK(pnode->cs_vSend);
+        {
+            LOCK(pnode->cs_hSocket);
+            epoll_event event;
+            event.events = 0;
+            event.data.u64 = pnode->GetId();
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, pnode->hSocket, &event) == 0) {
+                pnode->nSocketEvents = 0;
+            } else {
+                LogPrintf("%s: epoll_ctl for peer=%d failed: %s\n", __func__, pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+                pnode->fDisconnect = true;
+            }
+        }
+        // messages might have been pushed already when initializing the node
+        UpdateSocketEvents(pnode);
+    }
+#endif
+
+    LOCK(cs_vNodes);
+    vNodes.push_back(pnode);
+    mapNodesById.emplace(pnode->GetId(), pnode);
+}
+
+bool CConnman::IsSocketEventsCapable(const SOCKET& hSocket) const
+{
+    return socketEventsMode != SOCKETEVENTS_SELECT || IsSelectableSocket(hSocket);
+}
+
+void CConnman::UpdateSocketEvents(CNode* pnode) const
+{
+    AssertLockHeld(pnode->cs_vSend);
+#ifdef USE_EPOLL
+    if (socketEventsMode != SOCKETEVENTS_EPOLL) {
+        return;
+    }
+    if (pnode->nSocketEvents == -1) {
+        return;
+    }
+
+    // Same as for select(), drain the send queue before receiving more
+    int nEvents = 0;
+    if (!pnode->vSendMsg.empty()) {
+        nEvents = EPOLLOUT;
+    } else if (!pnode->fPauseRecv) {
+        nEvents = EPOLLIN;
+    }
+    if (nEvents == pnode->nSocketEvents) {
+        return;
+    }
+
+    LOCK(pnode->cs_hSocket);
+    if (pnode->hSocket == INVALID_SOCKET) {
+        return;
+    }
+    epoll_event event;
+    event.events = nEvents;
+    event.data.u64 = pnode->GetId();
+    if (epoll_ctl(epollfd, EPOLL_CTL_MOD, pnode->hSocket, &event) != 0) {
+        LogPrintf("%s: epoll_ctl for peer=%d failed: %s\n", __func__, pnode->GetId(), NetworkErrorString(WSAGetLastError()));
+        return;
+    }
+    pnode->nSocketEvents = nEvents;
+#endif
+}
+
+void CConnman::GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+#ifndef WIN32
+    // We add the wakeup fd to the read set so that the select() call can be woken up from the outside
+    // This is done when data is available for sending and at the same time optimistic sending was disabled
+    // when pushing the data.
+    // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
+    // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
+    // run on Linux and friends.
+    if (wakeupFds[0] != -1) {
+        recv_set.insert(wakeupFds[0]);
+    }
+#endif
+
+    for (const ListenSocket& hListenSocket : vhListenSocket) {
+        recv_set.insert(hListenSocket.socket);
+    }
+
+    LOCK(cs_vNodes);
+    for (CNode* pnode : vNodes)
+    {
+        // Implement the following logic:
+        // * If there is data to send, select() for sending data. As this only
+        //   happens when optimistic write failed, we choose to first drain the
+        //   write buffer in this case before receiving more. This avoids
+        //   needlessly queueing received data, if the remote peer is not themselves
+        //   receiving data. This means properly utilizing TCP flow control signalling.
+        // * Otherwise, if there is space left in the receive buffer, select() for
+        //   receiving data.
+        // * Hand off all complete messages to the processor, to be handled without
+        //   blocking here.
+
+        bool select_recv = !pnode->fPauseRecv;
+        bool select_send;
+        {
+            LOCK(pnode->cs_vSend);
+            select_send = !pnode->vSendMsg.empty();
+        }
+
+        LOCK(pnode->cs_hSocket);
+        if (pnode->hSocket == INVALID_SOCKET)
+            continue;
+
+        error_set.insert(pnode->hSocket);
+        if (select_send) {
+            send_set.insert(pnode->hSocket);
+            continue;
+        }
+        if (select_recv) {
+            recv_set.insert(pnode->hSocket);
+        }
+    }
+}
+
+void CConnman::SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
+    GenerateSelectSet(recv_select_set, send_select_set, error_select_set);
+
+    struct timeval timeout;
+    timeout.tv_sec  = 0;
+    timeout.tv_usec = SELECT_TIMEOUT_MILLISECONDS * 1000; // frequency to poll pnode->vSend
+
+    fd_set fdsetRecv;
+    fd_set fdsetSend;
+    fd_set fdsetError;
+    FD_ZERO(&fdsetRecv);
+    FD_ZERO(&fdsetSend);
+    FD_ZERO(&fdsetError);
+    SOCKET hSocketMax = 0;
+    bool have_fds = false;
+
+    for (SOCKET hSocket : recv_select_set) {
+        FD_SET(hSocket, &fdsetRecv);
+        hSocketMax = std::max(hSocketMax, hSocket);
+        have_fds = true;
+    }
+    for (SOCKET hSocket : send_select_set) {
+        FD_SET(hSocket, &fdsetSend);
+        hSocketMax = std::max(hSocketMax, hSocket);
+        have_fds = true;
+    }
+    for (SOCKET hSocket : error_select_set) {
+        FD_SET(hSocket, &fdsetError);
+        hSocketMax = std::max(hSocketMax, hSocket);
+        have_fds = true;
+    }
+
+    wakeupSelectNeeded = true;
+    int nSelect = select(have_fds ? hSocketMax + 1 : 0,
+                         &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
+
+    if (nSelect == SOCKET_ERROR)
     {
+        if (have_fds)
+        {
+            int nErr = WSAGetLastError();
+            LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
+            for (unsigned int i = 0; i <= hSocketMax; i++)
+                FD_SET(i, &fdsetRecv);
+        }
+        FD_ZERO(&fdsetSend);
+        FD_ZERO(&fdsetError);
+        if (!interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS)))
+            return;
+    }
+
+    for (SOCKET hSocket : recv_select_set) {
+        if (FD_ISSET(hSocket, &fdsetRecv)) {
+            recv_set.insert(hSocket);
+        }
+    }
+    for (SOCKET hSocket : send_select_set) {
+        if (FD_ISSET(hSocket, &fdsetSend)) {
+            send_set.insert(hSocket);
+        }
+    }
+    for (SOCKET hSocket : error_select_set) {
+        if (FD_ISSET(hSocket, &fdsetError)) {
+            error_set.insert(hSocket);
+        }
+    }
+}
+
+#ifdef USE_POLL
+void CConnman::SocketEventsPoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set)
+{
+    std::set<SOCKET> recv_select_set, send_select_set, error_select_set;
+    GenerateSelectSet(recv_select_set, send_select_set, error_select_set);
+
+    std::unordered_map<SOCKET, struct pollfd> pollfds;
+    for (SOCKET hSocket : recv_select_set) {
+        pollfds[hSocket].fd = hSocket;
+        pollfds[hSocket].events |= POLLIN;
+    }
+    for (SOCKET hSocket : send_select_set) {
+        pollfds[hSocket].fd = hSocket;
+        pollfds[hSocket].events |= POLLOUT;
+    }
+    for (SOCKET hSocket : error_select_set) {
+        // errors are reported without asking for them
+        pollfds[hSocket].fd = hSocket;
+    }
+
+    std::vector<struct pollfd> vpollfds;
+    vpollfds.reserve(pollfds.size());
+    for (const auto& it : pollfds) {
+        vpollfds.push_back(it.second);
+    }
+
+    wakeupSelectNeeded = true;
+    int nPoll = poll(vpollfds.data(), vpollfds.size(), SELECT_TIMEOUT_MILLISECONDS);
+    wakeupSelectNeeded = false;
+    if (interruptNet)
+        return;
+
+    if (nPoll < 0) {
+        LogPrintf("socket poll error %s\n", NetworkErrorString(WSAGetLastError()));
+        interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        return;
+    }
+
+    for (const struct pollfd& pfd : vpollfds) {
+        if (pfd.revents & POLLIN) {
+            recv_set.insert(pfd.fd);
+        }
+        if (pfd.revents & POLLOUT) {
+            send_set.insert(pfd.fd);
+        }
+        if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) {
+            error_set.insert(pfd.fd);
+        }
+    }
+}
+#endif
+
+#ifdef USE_EPOLL
+void CConnman::SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, std::vector<CNode*>& vEventNodes)
+{
+    // Resume receiving from the nodes whose process queue was drained in the meantime
+    if (!vRecvPausedNodes.empty()) {
         LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
+        for (auto it = vRecvPausedNodes.begin(); it != vRecvPausedNodes.end(); ) {
+            auto itNode = mapNodesById.find(*it);
+            if (itNode != mapNodesById.end() && itNode->second->fPauseRecv) {
+                ++it;
+                continue;
+            }
+            if (itNode != mapNodesById.end()) {
+                LOCK(itNode->second->cs_vSend);
+                UpdateSocketEvents(itNode->second);
+            }
+            it = vRecvPausedNodes.erase(it);
+        }
+    }
+
+    epoll_event events[EPOLL_MAX_EVENTS];
+    int nEvents = epoll_wait(epollfd, events, EPOLL_MAX_EVENTS, SELECT_TIMEOUT_MILLISECONDS);
+    if (interruptNet)
+        return;
+
+    if (nEvents < 0) {
+        if (errno != EINTR) {
+            LogPrintf("socket epoll_wait error %s\n", NetworkErrorString(WSAGetLastError()));
+            interruptNet.sleep_for(std::chrono::milliseconds(SELECT_TIMEOUT_MILLISECONDS));
+        }
+        return;
+    }
+
+    LOCK(cs_vNodes);
+    for (int i = 0; i < nEvents; i++) {
+        const epoll_event& event = events[i];
+        SOCKET hSocket;
+        if (event.data.u64 & EPOLL_DATA_SOCKET) {
+            // the wakeup fd or a listening socket
+            hSocket = (SOCKET)(event.data.u64 & ~EPOLL_DATA_SOCKET);
+        } else {
+            auto it = mapNodesById.find((NodeId)event.data.u64);
+            if (it == mapNodesById.end()) {
+                continue;
+            }
+            CNode* pnode = it->second;
+            {
+                LOCK(pnode->cs_hSocket);
+                hSocket = pnode->hSocket;
+            }
+            if (hSocket == INVALID_SOCKET) {
+                continue;
+            }
+            pnode->AddRef();
+            vEventNodes.push_back(pnode);
+        }
+
+        if (event.events & EPOLLIN) {
+            recv_set.insert(hSocket);
+        }
+        if (event.events & EPOLLOUT) {
+            send_set.insert(hSocket);
+        }
+        if (event.events & (EPOLLERR | EPOLLHUP)) {
+            error_set.insert(hSocket);
+        }
+    }
+}
+#endif
+
+void CConnman::SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, std::vector<CNode*>& vEventNodes)
+{
+    switch (socketEventsMode) {
+#ifdef USE_EPOLL
+        case SOCKETEVENTS_EPOLL:
+            SocketEventsEpoll(recv_set, send_set, error_set, vEventNodes);
+            return;
+#endif
+#ifdef USE_POLL
+        case SOCKETEVENTS_POLL:
+            SocketEventsPoll(recv_set, send_set, error_set);
+            break;
+#endif
+        default:
+            SocketEventsSelect(recv_set, send_set, error_set);
+            break;
+    }
+    vEventNodes = CopyNodeVector();
+}
+
+void CConnman::InactivityCheck(CNode* pnode)
+{
+    int64_t nTime = GetSystemTimeInSeconds();
+    if (nTime - pnode->nTimeConnected > 60)
+    {
+        if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
+        {
+            LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->GetId());
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
+        {
+            LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
+            pnode->fDisconnect = true;
+        }
+        else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
+        {
+            LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
+            pnode->fDisconnect = true;
+        }
+        else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
+        {
+            LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
+            pnode->fDisconnect = true;
+        }
+        else if (!pnode->fSuccessfullyConnected)
+        {
+            LogPrintf("version handshake timeout from %d\n", pnode->GetId());
+            pnode->fDisconnect = true;
+        }
     }
 }
 
 void CConnman::ThreadSocketHandler()
 {
     unsigned int nPrevNodeCount = 0;
+    int64_t nLastInactivityCheck = 0;
     while (!interruptNet)
     {
         //
@@ -1242,6 +1670,7 @@ void CConnman::ThreadSocketHandler()
 
                     // remove from vNodes
                     vNodes.erase(remove(vNodes.begin(), vNodes.end(), pnode), vNodes.end());
+                    mapNodesById.erase(pnode->GetId());
 
                     // release outbound grant (if any)
                     pnode->grantOutbound.Release();
@@ -1291,109 +1720,21 @@ void CConnman::ThreadSocketHandler()
                 clientInterface->NotifyNumConnectionsChanged(nPrevNodeCount);
         }
 
-        //
-        // Find which sockets have data to receive
-        //
-        struct timeval timeout;
-        timeout.tv_sec  = 0;
-        timeout.tv_usec = 50000; // frequency to poll pnode->vSend
-
-        fd_set fdsetRecv;
-        fd_set fdsetSend;
-        fd_set fdsetError;
-        FD_ZERO(&fdsetRecv);
-        FD_ZERO(&fdsetSend);
-        FD_ZERO(&fdsetError);
-        SOCKET hSocketMax = 0;
-        bool have_fds = false;
-
-#ifndef WIN32
-        // We add a pipe to the read set so that the select() call can be woken up from the outside
-        // This is done when data is available for sending and at the same time optimistic sending was disabled
-        // when pushing the data.
-        // This is currently only implemented for POSIX compliant systems. This means that Windows will fall back to
-        // timing out after 50ms and then trying to send. This is ok as we assume that heavy-load daemons are usually
-        // run on Linux and friends.
-        FD_SET(wakeupPipe[0], &fdsetRecv);
-        hSocketMax = std::max(hSocketMax, (SOCKET)wakeupPipe[0]);
-        have_fds = true;
-#endif
-
-        for (const ListenSocket& hListenSocket : vhListenSocket) {
-            FD_SET(hListenSocket.socket, &fdsetRecv);
-            hSocketMax = std::max(hSocketMax, hListenSocket.socket);
-            have_fds = true;
-        }
-
-        {
-            LOCK(cs_vNodes);
-            for (CNode* pnode : vNodes)
-            {
-                // Implement the following logic:
-                // * If there is data to send, select() for sending data. As this only
-                //   happens when optimistic write failed, we choose to first drain the
-                //   write buffer in this case before receiving more. This avoids
-                //   needlessly queueing received data, if the remote peer is not themselves
-                //   receiving data. This means properly utilizing TCP flow control signalling.
-                // * Otherwise, if there is space left in the receive buffer, select() for
-                //   receiving data.
-                // * Hand off all complete messages to the processor, to be handled without
-                //   blocking here.
-
-                bool select_recv = !pnode->fPauseRecv;
-                bool select_send;
-                {
-                    LOCK(pnode->cs_vSend);
-                    select_send = !pnode->vSendMsg.empty();
-                }
-
-                LOCK(pnode->cs_hSocket);
-                if (pnode->hSocket == INVALID_SOCKET)
-                    continue;
-
-                FD_SET(pnode->hSocket, &fdsetError);
-                hSocketMax = std::max(hSocketMax, pnode->hSocket);
-                have_fds = true;
-
-                if (select_send) {
-                    FD_SET(pnode->hSocket, &fdsetSend);
-                    continue;
-                }
-                if (select_recv) {
-                    FD_SET(pnode->hSocket, &fdsetRecv);
-                }
-            }
-        }
-
-        wakeupSelectNeeded = true;
-        int nSelect = select(have_fds ? hSocketMax + 1 : 0,
-                             &fdsetRecv, &fdsetSend, &fdsetError, &timeout);
-        wakeupSelectNeeded = false;
-        if (interruptNet)
+        std::set<SOCKET> recv_set, send_set, error_set;
+        std::vector<CNode*> vEventNodes;
+        SocketEvents(recv_set, send_set, error_set, vEventNodes);
+        if (interruptNet) {
+            ReleaseNodeVector(vEventNodes);
             return;
-
-        if (nSelect == SOCKET_ERROR)
-        {
-            if (have_fds)
-            {
-                int nErr = WSAGetLastError();
-                LogPrintf("socket select error %s\n", NetworkErrorString(nErr));
-                for (unsigned int i = 0; i <= hSocketMax; i++)
-                    FD_SET(i, &fdsetRecv);
-            }
-            FD_ZERO(&fdsetSend);
-            FD_ZERO(&fdsetError);
-            if (!interruptNet.sleep_for(std::chrono::milliseconds(timeout.tv_usec/1000)))
-                return;
         }
 
 #ifndef WIN32
-        // drain the wakeup pipe
-        if (FD_ISSET(wakeupPipe[0], &fdsetRecv)) {
+        // drain the wakeup fd
+        if (wakeupFds[0] != -1 && recv_set.count(wakeupFds[0])) {
             LogPrint(BCLog::NET, "woke up select()\n");
             char buf[128];
             while (true) {
-                int r = read(wakeupPipe[0], buf, sizeof(buf));
+                int r = read(wakeupFds[0], buf, sizeof(buf));
                 if (r <= 0) {
                     break;
                 }
@@ -1406,17 +1747,16 @@ void CConnman::ThreadSocketHandler()
         //
         for (const ListenSocket& hListenSocket : vhListenSocket)
         {
-            if (hListenSocket.socket != INVALID_SOCKET && FD_ISSET(hListenSocket.socket, &fdsetRecv))
+            if (hListenSocket.socket != INVALID_SOCKET && recv_set.count(hListenSocket.socket))
             {
                 AcceptConnection(hListenSocket);
             }
         }
 
         //
-        // Service each socket
+        // Service each socket with events
         //
-        std::vector<CNode*> vNodesCopy = CopyNodeVector();
-        for (CNode* pnode : vNodesCopy)
+        for (CNode* pnode : vEventNodes)
         {
             if (interruptNet)
                 return;
@@ -1431,9 +1771,9 @@ void CConnman::ThreadSocketHandler()
                 LOCK(pnode->cs_hSocket);
                 if (pnode->hSocket == INVALID_SOCKET)
                     continue;
-                recvSet = FD_ISSET(pnode->hSocket, &fdsetRecv);
-                sendSet = FD_ISSET(pnode->hSocket, &fdsetSend);
-                errorSet = FD_ISSET(pnode->hSocket, &fdsetError);
+                recvSet = recv_set.count(pnode->hSocket) > 0;
+                sendSet = send_set.count(pnode->hSocket) > 0;
+                errorSet = error_set.count(pnode->hSocket) > 0;
             }
             if (recvSet || errorSet)
             {
@@ -1466,6 +1806,14 @@ void CConnman::ThreadSocketHandler()
                             pnode->nProcessQueueSize += nSizeAdded;
                             pnode->fPauseRecv = pnode->nProcessQueueSize > nReceiveFloodSize;
                         }
+#ifdef USE_EPOLL
+                        if (pnode->fPauseRecv && socketEventsMode == SOCKETEVENTS_EPOLL) {
+                            // stop receiving until the message handler caught up, SocketEventsEpoll resumes it
+                            LOCK(pnode->cs_vSend);
+                            UpdateSocketEvents(pnode);
+                            vRecvPausedNodes.push_back(pnode->GetId());
+                        }
+#endif
                         WakeMessageHandler();
                     }
                 }
@@ -1502,40 +1850,21 @@ void CConnman::ThreadSocketHandler()
                 }
             }
 
-            //
-            // Inactivity checking
-            //
-            int64_t nTime = GetSystemTimeInSeconds();
-            if (nTime - pnode->nTimeConnected > 60)
-            {
-                if (pnode->nLastRecv == 0 || pnode->nLastSend == 0)
-                {
-                    LogPrint(BCLog::NET, "socket no message in first 60 seconds, %d %d from %d\n", pnode->nLastRecv != 0, pnode->nLastSend != 0, pnode->GetId());
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastSend > TIMEOUT_INTERVAL)
-                {
-                    LogPrintf("socket sending timeout: %is\n", nTime - pnode->nLastSend);
-                    pnode->fDisconnect = true;
-                }
-                else if (nTime - pnode->nLastRecv > (pnode->nVersion > BIP0031_VERSION ? TIMEOUT_INTERVAL : 90*60))
-                {
-                    LogPrintf("socket receive timeout: %is\n", nTime - pnode->nLastRecv);
-                    pnode->fDisconnect = true;
-                }
-                else if (pnode->nPingNonceSent && pnode->nPingUsecStart + TIMEOUT_INTERVAL * 1000000 < GetTimeMicros())
-                {
-                    LogPrintf("ping timeout: %fs\n", 0.000001 * (GetTimeMicros() - pnode->nPingUsecStart));
-                    pnode->fDisconnect = true;
-                }
-                else if (!pnode->fSuccessfullyConnected)
-                {
-                    LogPrintf("version handshake timeout from %d\n", pnode->GetId());
-                    pnode->fDisconnect = true;
-                }
+        }
+        ReleaseNodeVector(vEventNodes);
+
+        //
+        // Inactivity checking, once per second is plenty for timeouts counted in seconds
+        //
+        int64_t nTime = GetSystemTimeInSeconds();
+        if (nTime != nLastInactivityCheck) {
+            nLastInactivityCheck = nTime;
+            std::vector<CNode*> vNodesCopy = CopyNodeVector();
+            for (CNode* pnode : vNodesCopy) {
+                InactivityCheck(pnode);
             }
+            ReleaseNodeVector(vNodesCopy);
         }
-        ReleaseNodeVector(vNodesCopy);
     }
 }
 
@@ -1551,15 +1880,20 @@ void CConnman::WakeMessageHandler()
 void CConnman::WakeSelect()
 {
 #ifndef WIN32
-    if (wakeupPipe[1] == -1) {
+    if (wakeupFds[1] == -1) {
         return;
     }
 
     LogPrint(BCLog::NET, "waking up select()\n");
 
-    char buf[1];
-    if (write(wakeupPipe[1], buf, 1) != 1) {
-        LogPrint(BCLog::NET, "write to wakeupPipe failed\n");
+#ifdef HAVE_EVENTFD
+    // an eventfd is written to in 8 byte counter increments
+    uint64_t buf = 1;
+#else
+    char buf = 0;
+#endif
+    if (write(wakeupFds[1], &buf, sizeof(buf)) != (ssize_t)sizeof(buf)) {
+        LogPrint(BCLog::NET, "write to wakeupFds failed\n");
     }
 #endif
 
@@ -2233,10 +2567,7 @@ bool CConnman::OpenNetworkConnection(const CAddress& addrConnect, bool fCountFai
         pnode->fSmartnode = true;
 
     m_msgproc->InitializeNode(pnode);
-    {
-        LOCK(cs_vNodes);
-        vNodes.push_back(pnode);
-    }
+    AddNode(pnode);
 
     return true;
 }
@@ -2603,17 +2934,56 @@ bool CConnman::Start(CScheduler& scheduler, const Options& connOptions)
     }
 
 #ifndef WIN32
-    if (pipe(wakeupPipe) != 0) {
-        wakeupPipe[0] = wakeupPipe[1] = -1;
-        LogPrint(BCLog::NET, "pipe() for wakeupPipe failed\n");
+#ifdef HAVE_EVENTFD
+    wakeupFds[0] = wakeupFds[1] = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeupFds[0] == -1) {
+        LogPrint(BCLog::NET, "eventfd() for wakeupFds failed\n");
+    }
+#else
+    if (pipe(wakeupFds) != 0) {
+        wakeupFds[0] = wakeupFds[1] = -1;
+        LogPrint(BCLog::NET, "pipe() for wakeupFds failed\n");
     } else {
-        int fFlags = fcntl(wakeupPipe[0], F_GETFL, 0);
-        if (fcntl(wakeupPipe[0], F_SETFL, fFlags | O_NONBLOCK) == -1) {
-            LogPrint(BCLog::NET, "fcntl for O_NONBLOCK on wakeupPipe failed\n");
+        int fFlags = fcntl(wakeupFds[0], F_GETFL, 0);
+        if (fcntl(wakeupFds[0], F_SETFL, fFlags | O_NONBLOCK) == -1) {
+            LogPrint(BCLog::NET, "fcntl for O_NONBLOCK on wakeupFds failed\n");
+        }
+        fFlags = fcntl(wakeupFds[1], F_GETFL, 0);
+        if (fcntl(wakeupFds[1], F_SETFL, fFlags | O_NONBLOCK) == -1) {
+            LogPrint(BCLog::NET, "fcntl for O_NONBLOCK on wakeupFds failed\n");
+        }
+    }
+#endif
+#endif
+
+#ifdef USE_EPOLL
+    if (socketEventsMode == SOCKETEVENTS_EPOLL) {
+        epollfd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollfd == -1) {
+            LogPrintf("epoll_create1 failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            if (clientInterface) {
+                clientInterface->ThreadSafeMessageBox(
+                    _("Failed to set up the epoll socket events mode. Use -socketevents=select if you want this."),
+                    "", CClientUIInterface::MSG_ERROR);
+            }
+            return false;
         }
-        fFlags = fcntl(wakeupPipe[1], F_GETFL, 0);
-        if (fcntl(wakeupPipe[1], F_SETFL, fFlags | O_NONBLOCK) == -1) {
-            LogPrint(BCLog::NET, "fcntl for O_NONBLOCK on wakeupPipe failed\n");
+
+        // Nodes are registered as they are added, the other sockets stay registered for receiving
+        std::vector<SOCKET> vSockets;
+        for (const ListenSocket& hListenSocket : vhListenSocket) {
+            vSockets.push_back(hListenSocket.socket);
+        }
+        if (wakeupFds[0] != -1) {
+            vSockets.push_back(wakeupFds[0]);
+        }
+        for (SOCKET hSocket : vSockets) {
+            epoll_event event;
+            event.events = EPOLLIN;
+            event.data.u64 = EPOLL_DATA_SOCKET | (uint64_t)hSocket;
+            if (epoll_ctl(epollfd, EPOLL_CTL_ADD, hSocket, &event) != 0) {
+                LogPrintf("epoll_ctl failed: %s\n", NetworkErrorString(WSAGetLastError()));
+            }
         }
     }
 #endif
@@ -2736,6 +3106,7 @@ void CConnman::Stop()
         DeleteNode(pnode);
     }
     vNodes.clear();
+    mapNodesById.clear();
     vNodesDisconnected.clear();
     vhListenSocket.clear();
     delete semOutbound;
@@ -2746,9 +3117,14 @@ void CConnman::Stop()
     semSmartnodeOutbound = nullptr;
 
 #ifndef WIN32
-    if (wakeupPipe[0] != -1) close(wakeupPipe[0]);
-    if (wakeupPipe[1] != -1) close(wakeupPipe[1]);
-    wakeupPipe[0] = wakeupPipe[1] = -1;
+    if (wakeupFds[0] != -1) close(wakeupFds[0]);
+    if (wakeupFds[1] != -1 && wakeupFds[1] != wakeupFds[0]) close(wakeupFds[1]);
+    wakeupFds[0] = wakeupFds[1] = -1;
+#endif
+#ifdef USE_EPOLL
+    if (epollfd != -1) close(epollfd);
+    epollfd = -1;
+    vRecvPausedNodes.clear();
 #endif
 }
 
@@ -3220,6 +3596,7 @@ CNode::CNode(NodeId idIn, ServiceFlags nLocalServicesIn, int nMyStartingHeightIn
     nMinPingUsecTime = std::numeric_limits<int64_t>::max();
     fPauseRecv = false;
     fPauseSend = false;
+    nSocketEvents = -1;
     nProcessQueueSize = 0;
 
     for (const std::string &msg : getAllNetMessageTypes())
@@ -3338,6 +3715,9 @@ void CConnman::PushMessage(CNode* pnode, CSerializedNetMsg&& msg, bool allowOpti
         // wake up select() call in case there was no pending data before (so it was not selecting this socket for sending)
         else if (!hasPendingData && wakeupSelectNeeded)
             WakeSelect();
+
+        // with epoll the socket is registered for sending instead, which takes effect right away
+        UpdateSocketEvents(pnode);
     }
     if (nBytesSent)
         RecordBytesSent(nBytesSent);
@@ -31,6 +31,8 @@
 #include <thread>
 #include <memory>
 #include <condition_variable>
+#include <set>
+#include <unordered_map>
 #include <unordered_set>
 #include <queue>
 
@@ -112,6 +114,21 @@ static const bool DEFAULT_FORCEDNSSEED = false;
 static const size_t DEFAULT_MAXRECEIVEBUFFER = 5 * 1000;
 static const size_t DEFAULT_MAXSENDBUFFER    = 1 * 1000;
 
+/** How the socket handler thread waits for network events */
+enum SocketEventsMode {
+    SOCKETEVENTS_SELECT = 0,
+    SOCKETEVENTS_POLL = 1,
+    SOCKETEVENTS_EPOLL = 2,
+};
+/** -socketevents default */
+#if defined(USE_EPOLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_EPOLL;
+#elif defined(USE_POLL)
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_POLL;
+#else
+static const SocketEventsMode DEFAULT_SOCKETEVENTS = SOCKETEVENTS_SELECT;
+#endif
+
 // NOTE: When adjusting this, update rpcnet:setban's help ("24h")
 static const unsigned int DEFAULT_MISBEHAVING_BANTIME = 60 * 60 * 24;  // Default 24-hour ban
 
@@ -170,6 +187,7 @@ public:
         std::vector<std::string> vSeedNodes;
         std::vector<CSubNet> vWhitelistedRange;
         std::vector<CService> vBinds, vWhiteBinds;
+        SocketEventsMode socketEventsMode = DEFAULT_SOCKETEVENTS;
     };
 
     void Init(const Options& connOptions) {
@@ -186,6 +204,7 @@ public:
         nMaxOutboundTimeframe = connOptions.nMaxOutboundTimeframe;
         nMaxOutboundLimit = connOptions.nMaxOutboundLimit;
         vWhitelistedRange = connOptions.vWhitelistedRange;
+        socketEventsMode = connOptions.socketEventsMode;
     }
 
     CConnman(uint64_t seed0, uint64_t seed1);
@@ -467,6 +486,27 @@ private:
     void ThreadOpenConnections();
     void ThreadMessageHandler();
     void AcceptConnection(const ListenSocket& hListenSocket);
+    /** Add a connected node to vNodes and register its socket for events */
+    void AddNode(CNode* pnode);
+    /** Whether the socket events mode can wait on hSocket, select() only handles sockets below FD_SETSIZE */
+    bool IsSocketEventsCapable(const SOCKET& hSocket) const;
+    void GenerateSelectSet(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+    void SocketEventsSelect(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#ifdef USE_POLL
+    void SocketEventsPoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set);
+#endif
+#ifdef USE_EPOLL
+    void SocketEventsEpoll(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, std::vector<CNode*>& vEventNodes);
+#endif
+    /**
+     * Wait for the sockets to become ready and fill vEventNodes with the
+     * nodes to service, referenced. With epoll these are just the nodes
+     * which had events, the other modes return all of them.
+     */
+    void SocketEvents(std::set<SOCKET>& recv_set, std::set<SOCKET>& send_set, std::set<SOCKET>& error_set, std::vector<CNode*>& vEventNodes);
+    /** Update the events a node's socket is registered for, needs cs_vSend */
+    void UpdateSocketEvents(CNode* pnode) const;
+    void InactivityCheck(CNode* pnode);
     void ThreadSocketHandler();
     void ThreadDNSAddressSeed();
     void ThreadOpenSmartnodeConnections();
@@ -538,6 +578,8 @@ private:
     std::map<std::pair<Consensus::LLMQType, uint256>, std::set<uint256>> smartnodeQuorumNodes; // protected by cs_vPendingSmartnodes
     mutable CCriticalSection cs_vPendingSmartnodes;
     std::vector<CNode*> vNodes;
+    /** The nodes in vNodes by id, to find the ones epoll reports events for */
+    std::unordered_map<NodeId, CNode*> mapNodesById;
     std::list<CNode*> vNodesDisconnected;
     mutable CCriticalSection cs_vNodes;
     std::atomic<NodeId> nLastNodeId;
@@ -568,9 +610,20 @@ private:
 
     CThreadInterrupt interruptNet;
 
+    SocketEventsMode socketEventsMode{SOCKETEVENTS_SELECT};
+#ifdef USE_EPOLL
+    int epollfd{-1};
+    /** Nodes whose socket is not registered for receiving while fPauseRecv is set, only used by the socket handler */
+    std::vector<NodeId> vRecvPausedNodes;
+#endif
+
 #ifndef WIN32
-    /** a pipe which is added to select() calls to wakeup before the timeout */
-    int wakeupPipe[2]{-1,-1};
+    /**
+     * an eventfd (or a pipe where eventfd is not available) which is waited
+     * on together with the sockets to wakeup before the timeout. Both ends are
+     * the same descriptor for an eventfd.
+     */
+    int wakeupFds[2]{-1,-1};
 #endif
     std::atomic<bool> wakeupSelectNeeded{false};
 
@@ -592,6 +645,10 @@ extern std::unique_ptr<CConnman> g_connman;
 void Discover(boost::thread_group& threadGroup);
 void MapPort(bool fUseUPnP);
 unsigned short GetListenPort();
+std::string SocketEventsModeToString(SocketEventsMode mode);
+/** Parse a -socketevents mode, fails for modes not available on this system */
+bool SocketEventsModeFromString(const std::string& str, SocketEventsMode& modeRet);
+std::string GetSupportedSocketEventsModesString();
 bool BindListenPort(const CService &bindAddr, std::string& strError, bool fWhitelisted = false);
 
 struct CombinerAll
@@ -820,6 +877,8 @@ public:
 
     std::atomic_bool fPauseRecv;
     std::atomic_bool fPauseSend;
+    // Events the socket is registered for with epoll, -1 while not registered (protected by cs_vSend)
+    int nSocketEvents;
 protected:
 
     mapMsgCmdSize mapSendBytesPerMsgCmd;
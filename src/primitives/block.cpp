@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include <crypto/common.h>
 #include <hash.h>
 #include <primitives/block.h>
 #include <primitives/powcache.h>
@@ -21,29 +22,49 @@ uint256 CBlockHeader::ComputeHash() const
     return HashGR(BEGIN(nVersion), END(nNonce), hashPrevBlock);
 }
 
+uint256 CBlockHeader::ComputeHash(const GRPlan& plan) const
+{
+    return HashGR(BEGIN(nVersion), END(nNonce), plan);
+}
+
+GRMidstate CBlockHeader::GetPOWMidstate(const GRPlan& plan) const
+{
+    return GRMidstate(plan, BEGIN(nVersion), BEGIN(nNonce) - BEGIN(nVersion));
+}
+
+uint256 CBlockHeader::ComputeHash(const GRMidstate& midstate) const
+{
+    return HashGR(midstate, BEGIN(nNonce), END(nNonce));
+}
+
+void CBlockHeader::ComputeHashes(const GRMidstate& midstate, uint256* hashes, int n) const
+{
+    unsigned char nonces[GRPlan::MAX_LANES][sizeof(nNonce)];
+    const unsigned char* tails[GRPlan::MAX_LANES];
+    for (int i = 0; i < n && i < GRPlan::MAX_LANES; i++) {
+        WriteLE32(nonces[i], nNonce + i);
+        tails[i] = nonces[i];
+    }
+    HashGRBatch(midstate, tails, sizeof(nNonce), hashes, n);
+}
+
 uint256 CBlockHeader::GetPOWHash(bool readCache) const
 {
-    LOCK(cs_pow);
     CPowCache& cache(CPowCache::Instance());
-
     uint256 headerHash = GetHash();
-    uint256 powHash;
-    bool found = false;
 
-    if (readCache) {
-        found = cache.get(headerHash, powHash);
+    if (readCache && !cache.IsValidate()) {
+        return cache.GetOrCompute(headerHash, [this] { return ComputeHash(); });
     }
 
-    if (!found || cache.IsValidate()) {
-        uint256 powHash2 = ComputeHash();
-        if (found && powHash2 != powHash) {
-           LogPrintf("PowCache failure: headerHash: %s, from cache: %s, computed: %s, correcting\n", headerHash.ToString(), powHash.ToString(), powHash2.ToString());
-        }
-        powHash = powHash2;
-        cache.erase(headerHash); // If it exists, replace it
-        cache.insert(headerHash, powHash2);
+    uint256 powHash;
+    bool found = readCache && cache.Get(headerHash, powHash);
+    uint256 powHash2 = ComputeHash();
+    if (found && powHash2 != powHash) {
+        LogPrintf("PowCache failure: headerHash: %s, from cache: %s, computed: %s, correcting\n", headerHash.ToString(), powHash.ToString(), powHash2.ToString());
     }
-    return powHash;
+    cache.Insert(headerHash, powHash2); // If it exists, replace it
+    return powHash2;
 }
 
 std::string CBlock::ToString() const
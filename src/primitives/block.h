@@ -6,6 +6,7 @@
 #ifndef BITCOIN_PRIMITIVES_BLOCK_H
 #define BITCOIN_PRIMITIVES_BLOCK_H
 
+#include <hash_selection.h>
 #include <primitives/transaction.h>
 #include <serialize.h>
 #include <uint256.h>
@@ -71,6 +72,18 @@ public:
     /// Compute the POW hash using GhostRider algorithm
     uint256 ComputeHash() const;
 
+    /// Compute the POW hash with a GhostRider plan already resolved for hashPrevBlock
+    uint256 ComputeHash(const GRPlan& plan) const;
+
+    /// GhostRider first round state over every header field but nNonce
+    GRMidstate GetPOWMidstate(const GRPlan& plan) const;
+
+    /// Compute the POW hash for the current nNonce from a midstate of this header
+    uint256 ComputeHash(const GRMidstate& midstate) const;
+
+    /// Compute the POW hashes of the n (at most GRPlan::MAX_LANES) nonces starting at nNonce
+    void ComputeHashes(const GRMidstate& midstate, uint256* hashes, int n) const;
+
     /// Caching lookup/computation of POW hash using GhostRider algorithm
     uint256 GetPOWHash(bool readCache = true) const;
 
@@ -4,44 +4,36 @@
 
 #include <primitives/powcache.h>
 #include <primitives/block.h>
-#include <flat-database.h>
 #include <hash.h>
 #include <sync.h>
 #include <util.h>
 
-CCriticalSection cs_pow;
-
-CPowCache* CPowCache::instance = nullptr;
+#include <algorithm>
 
 CPowCache& CPowCache::Instance()
 {
-    if (CPowCache::instance == nullptr)
-    {
+    // Function-local static, so concurrent first calls construct it only once
+    static CPowCache instance([] {
         int  powCacheSize     = gArgs.GetArg("-powcachesize", DEFAULT_POW_CACHE_SIZE);
-        bool powCacheValidate = gArgs.GetArg("-powcachevalidate", 0) > 0 ? true : false;
-        powCacheSize = powCacheSize == 0 ? DEFAULT_POW_CACHE_SIZE : powCacheSize;
-
-        CPowCache::instance = new CPowCache(powCacheSize, powCacheValidate);
-    }
-    return *instance;
+        return powCacheSize == 0 ? DEFAULT_POW_CACHE_SIZE : powCacheSize;
+    }(), gArgs.GetArg("-powcachevalidate", 0) > 0 ? true : false);
+    return instance;
 }
 
 void CPowCache::DoMaintenance()
 {
-    LOCK(cs_pow);
-    // If cache has grown enough, save it:
-    if (cacheMap.size() - nLoadedSize > 100)
-    {
-        CFlatDB<CPowCache> flatDb("powcache.dat", "powCache");
-        flatDb.Dump(*this);
-    }
+    Flush();
 }
 
-CPowCache::CPowCache(int maxSize, bool validate) : unordered_lru_cache<uint256, uint256, std::hash<uint256>>(maxSize),
+CPowCache::CPowCache(int maxSize, bool validate) :
     nVersion(CURRENT_VERSION),
-    nLoadedSize(0),
+    nMaxSize(maxSize),
     bValidate(validate)
 {
+    size_t nShardSize = std::max(1, maxSize / SHARDS);
+    for (int i = 0; i < SHARDS; i++) {
+        vShards.emplace_back(new Shard(nShardSize));
+    }
     if (bValidate) LogPrintf("PowCache: Validation and auto correction enabled\n");
 }
 
@@ -49,9 +41,151 @@ CPowCache::~CPowCache()
 {
 }
 
+bool CPowCache::LookupLog(Shard& shard, const uint256& headerHash, uint256& powHash)
+{
+    AssertLockHeld(shard.cs);
+    if (!log.Lookup(headerHash, powHash)) {
+        return false;
+    }
+    // Bring it back into memory, it is already on disk
+    shard.insert(headerHash, powHash);
+    return true;
+}
+
+void CPowCache::InsertNew(Shard& shard, const uint256& headerHash, const uint256& powHash)
+{
+    AssertLockHeld(shard.cs);
+    shard.insert(headerHash, powHash);
+    LOCK(cs_pending);
+    vPending.emplace_back(headerHash, powHash);
+}
+
+bool CPowCache::Get(const uint256& headerHash, uint256& powHash)
+{
+    Shard& shard = GetShard(headerHash);
+    LOCK(shard.cs);
+    return shard.get(headerHash, powHash) || LookupLog(shard, headerHash, powHash);
+}
+
+bool CPowCache::Exists(const uint256& headerHash)
+{
+    uint256 powHash;
+    return Get(headerHash, powHash);
+}
+
+void CPowCache::Insert(const uint256& headerHash, const uint256& powHash, bool fPersist)
+{
+    Shard& shard = GetShard(headerHash);
+    LOCK(shard.cs);
+    if (fPersist) {
+        InsertNew(shard, headerHash, powHash);
+    } else {
+        shard.insert(headerHash, powHash);
+    }
+}
+
+void CPowCache::Erase(const uint256& headerHash)
+{
+    Shard& shard = GetShard(headerHash);
+    LOCK(shard.cs);
+    shard.erase(headerHash);
+    LOCK(cs_pending);
+    vPending.erase(std::remove_if(vPending.begin(), vPending.end(),
+        [&headerHash](const std::pair<uint256, uint256>& entry) { return entry.first == headerHash; }), vPending.end());
+}
+
+uint256 CPowCache::GetOrCompute(const uint256& headerHash, const std::function<uint256()>& compute)
+{
+    Shard& shard = GetShard(headerHash);
+    std::promise<uint256> promise;
+    std::shared_future<uint256> inFlight;
+    {
+        LOCK(shard.cs);
+        uint256 powHash;
+        if (shard.get(headerHash, powHash) || LookupLog(shard, headerHash, powHash)) {
+            return powHash;
+        }
+        auto it = shard.mapInFlight.find(headerHash);
+        if (it != shard.mapInFlight.end()) {
+            inFlight = it->second;
+        } else {
+            shard.mapInFlight.emplace(headerHash, promise.get_future().share());
+        }
+    }
+    if (inFlight.valid()) {
+        // Another thread is hashing this header already
+        return inFlight.get();
+    }
+
+    uint256 powHash;
+    try {
+        powHash = compute();
+    } catch (...) {
+        {
+            LOCK(shard.cs);
+            shard.mapInFlight.erase(headerHash);
+        }
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    {
+        LOCK(shard.cs);
+        InsertNew(shard, headerHash, powHash);
+        shard.mapInFlight.erase(headerHash);
+    }
+    promise.set_value(powHash);
+    return powHash;
+}
+
+size_t CPowCache::Size() const
+{
+    size_t nSize = 0;
+    for (const auto& shard : vShards) {
+        LOCK(shard->cs);
+        nSize += shard->size();
+    }
+    return nSize;
+}
+
+bool CPowCache::OpenLog(const fs::path& path)
+{
+    LOCK(cs);
+    if (!log.Open(path)) {
+        return false;
+    }
+    LogPrintf("PowCache: %u entries in %s\n", log.KeyCount(), path.string());
+    return true;
+}
+
+void CPowCache::Flush()
+{
+    LOCK(cs);
+    std::vector<std::pair<uint256, uint256>> vFlush;
+    {
+        LOCK(cs_pending);
+        vFlush.swap(vPending);
+    }
+    if (vFlush.empty() || !log.IsOpen()) {
+        return;
+    }
+    if (!log.Append(vFlush)) {
+        // Try again next time
+        LOCK(cs_pending);
+        vPending.insert(vPending.begin(), vFlush.begin(), vFlush.end());
+        return;
+    }
+    // Superseded and long evicted records pile up, rewrite once the log is twice the cache size
+    if (log.RecordCount() > 2 * (size_t)nMaxSize) {
+        log.Compact(nMaxSize);
+    }
+}
+
 void CPowCache::Clear()
 {
-   cacheMap.clear();
+    for (const auto& shard : vShards) {
+        LOCK(shard->cs);
+        shard->clear();
+    }
 }
 
 void CPowCache::CheckAndRemove()
@@ -61,6 +195,6 @@ void CPowCache::CheckAndRemove()
 std::string CPowCache::ToString() const
 {
     std::ostringstream info;
-    info << "PowCache: elements: " << (int)cacheMap.size();
+    info << "PowCache: elements: " << (int)Size();
     return info.str();
 }
@@ -5,24 +5,71 @@
 #ifndef YERB_POWCACHE_H
 #define YERB_POWCACHE_H
 
+#include <primitives/powcachelog.h>
 #include <uint256.h>
 #include <sync.h>
 #include <serialize.h>
 #include <unordered_lru_cache.h>
 #include <util.h>
 
-extern CCriticalSection cs_pow;
+#include <functional>
+#include <future>
+#include <memory>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
-class CPowCache : public unordered_lru_cache<uint256, uint256, std::hash<uint256>>
+/**
+ * Cache of header hash -> GhostRider PoW hash.
+ *
+ * The entries are spread over SHARDS independently locked LRU caches, so
+ * lookups and inserts only hold one shard lock for a map operation and
+ * never while hashing. Threads missing on a header that is already being
+ * hashed by another thread wait for that result instead of hashing it again.
+ *
+ * Behind the in-memory shards sits an append-only CPowCacheLog: misses are
+ * looked up in it before hashing, and entries inserted since the last
+ * Flush() are appended to it by the periodic maintenance.
+ */
+class CPowCache
 {
     private:
-        static CPowCache* instance;
         static const int CURRENT_VERSION = 1;
+        static const int SHARDS = 16;
+
+        class Shard : public unordered_lru_cache<uint256, uint256, std::hash<uint256>>
+        {
+            public:
+                explicit Shard(size_t maxSize) : unordered_lru_cache<uint256, uint256, std::hash<uint256>>(maxSize) {}
+
+                template<typename Callable>
+                void ForEach(Callable&& func) const
+                {
+                    for (const auto& p : cacheMap) {
+                        func(p.first, p.second.first);
+                    }
+                }
+
+                CCriticalSection cs;
+                /** Headers currently being hashed, protected by cs */
+                std::unordered_map<uint256, std::shared_future<uint256>, std::hash<uint256>> mapInFlight;
+        };
 
         int  nVersion;
-        int  nLoadedSize;
+        int  nMaxSize;
         bool bValidate;
+        /** Serializes dumps, loads and flushes */
         CCriticalSection cs;
+        std::vector<std::unique_ptr<Shard>> vShards;
+        CPowCacheLog log;
+        CCriticalSection cs_pending;
+        /** Entries not yet appended to the log, protected by cs_pending */
+        std::vector<std::pair<uint256, uint256>> vPending;
+
+        bool LookupLog(Shard& shard, const uint256& headerHash, uint256& powHash);
+        void InsertNew(Shard& shard, const uint256& headerHash, const uint256& powHash);
+
+        Shard& GetShard(const uint256& headerHash) const { return *vShards[headerHash.GetUint64(3) % SHARDS]; }
 
     public:
         static CPowCache& Instance();
@@ -30,6 +77,24 @@ class CPowCache : public unordered_lru_cache<uint256, uint256, std::hash<uint256
         CPowCache(int maxSize = DEFAULT_POW_CACHE_SIZE, bool validate = false);
         virtual ~CPowCache();
 
+        bool Get(const uint256& headerHash, uint256& powHash);
+        bool Exists(const uint256& headerHash);
+        /** Insert or replace the PoW hash of headerHash, only in memory unless fPersist */
+        void Insert(const uint256& headerHash, const uint256& powHash, bool fPersist = true);
+        /** Forget the PoW hash of headerHash, unless it already was written to the log */
+        void Erase(const uint256& headerHash);
+        /**
+         * Return the cached PoW hash of headerHash, or compute and cache it.
+         * Concurrent misses on the same header run compute only once.
+         */
+        uint256 GetOrCompute(const uint256& headerHash, const std::function<uint256()>& compute);
+        size_t Size() const;
+
+        /** Open (or create) the on-disk log at path */
+        bool OpenLog(const fs::path& path);
+        /** Append the entries inserted since the last flush to the log, compacting it when needed */
+        void Flush();
+
         void Clear();
         void CheckAndRemove();
         bool IsValidate() const { return bValidate; }
@@ -45,32 +110,38 @@ class CPowCache : public unordered_lru_cache<uint256, uint256, std::hash<uint256
             LOCK(cs);
             READWRITE(nVersion);
 
-            uint64_t cacheSize = (uint64_t)cacheMap.size();
-            READWRITE(COMPACTSIZE(cacheSize));
-
             if (ser_action.ForRead())
             {
+                uint64_t cacheSize = 0;
+                READWRITE(COMPACTSIZE(cacheSize));
                 uint256 headerHash;
                 uint256 powHash;
-                for (int i = 0; i < cacheSize; ++i)
+                for (uint64_t i = 0; i < cacheSize; ++i)
                 {
                     READWRITE(headerHash);
                     READWRITE(powHash);
-                    insert(headerHash, powHash);
+                    Insert(headerHash, powHash);
                 }
                 nVersion = CURRENT_VERSION;
-                nLoadedSize = cacheMap.size();
             }
             else
             {
-                for (auto it = cacheMap.begin(); it != cacheMap.end(); ++it)
+                // Copy one shard at a time so lookups are only blocked for a map walk
+                std::vector<std::pair<uint256, uint256>> vEntries;
+                vEntries.reserve(Size());
+                for (const auto& shard : vShards) {
+                    LOCK(shard->cs);
+                    shard->ForEach([&vEntries](const uint256& headerHash, const uint256& powHash) {
+                        vEntries.emplace_back(headerHash, powHash);
+                    });
+                }
+                uint64_t cacheSize = vEntries.size();
+                READWRITE(COMPACTSIZE(cacheSize));
+                for (auto& entry : vEntries)
                 {
-                    uint256 headerHash = it->first;
-                    uint256 powHash    = it->second.first;
-                    READWRITE(headerHash);
-                    READWRITE(powHash);
-                };
-                nLoadedSize = cacheMap.size(); // The size on disk is current
+                    READWRITE(entry.first);
+                    READWRITE(entry.second);
+                }
             }
         }
 };
@@ -0,0 +1,307 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include <primitives/powcachelog.h>
+
+#include <crypto/common.h>
+#include <util.h>
+
+#include <errno.h>
+#include <string.h>
+
+#ifndef WIN32
+#include <sys/mman.h>
+#endif
+
+static const unsigned char POWCACHELOG_MAGIC[8] = {'y', 'e', 'r', 'b', 'p', 'o', 'w', 0};
+
+CPowCacheLog::CPowCacheLog() :
+    file(nullptr),
+    pMapped(nullptr),
+    nMappedSize(0),
+    nRecords(0),
+    nKeys(0)
+{
+}
+
+CPowCacheLog::~CPowCacheLog()
+{
+    Close();
+}
+
+static bool WriteHeader(FILE* file, uint32_t nVersion)
+{
+    unsigned char header[16] = {0};
+    memcpy(header, POWCACHELOG_MAGIC, sizeof(POWCACHELOG_MAGIC));
+    WriteLE32(header + 8, nVersion);
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header);
+}
+
+size_t CPowCacheLog::FindSlot(const unsigned char* headerHash) const
+{
+    // Header hashes are uniformly distributed, any 8 bytes make a good slot hash
+    const size_t nMask = vSlots.size() - 1;
+    for (size_t i = ReadLE64(headerHash) & nMask; ; i = (i + 1) & nMask) {
+        if (vSlots[i] == 0 || memcmp(RecordPtr(vSlots[i] - 1), headerHash, 32) == 0) {
+            return i;
+        }
+    }
+}
+
+void CPowCacheLog::IndexRecord(uint32_t nRecord)
+{
+    size_t i = FindSlot(RecordPtr(nRecord));
+    if (vSlots[i] == 0) {
+        nKeys++;
+    }
+    vSlots[i] = nRecord + 1;
+}
+
+void CPowCacheLog::BuildIndex()
+{
+    // Keep the load factor at or below 1/2
+    size_t nSlots = 1024;
+    while (nSlots < 2 * (size_t)nRecords) {
+        nSlots <<= 1;
+    }
+    vSlots.assign(nSlots, 0);
+    nKeys = 0;
+    for (uint32_t n = 0; n < nRecords; n++) {
+        IndexRecord(n);
+    }
+}
+
+bool CPowCacheLog::Map()
+{
+    size_t nSize = HEADER_SIZE + (size_t)nRecords * RECORD_SIZE;
+#ifdef WIN32
+    // Only read what was appended since the last call
+    size_t nOld = vBuffer.size();
+    vBuffer.resize(nSize);
+    if (fseek(file, nOld, SEEK_SET) != 0 || fread(vBuffer.data() + nOld, 1, nSize - nOld, file) != nSize - nOld) {
+        vBuffer.clear();
+        return error("%s: failed to read %s", __func__, path.string());
+    }
+    pMapped = vBuffer.data();
+#else
+    fflush(file);
+    void* p = mmap(nullptr, nSize, PROT_READ, MAP_SHARED, fileno(file), 0);
+    if (p == MAP_FAILED) {
+        return error("%s: failed to map %s: %s", __func__, path.string(), strerror(errno));
+    }
+    pMapped = static_cast<const unsigned char*>(p);
+#endif
+    nMappedSize = nSize;
+    return true;
+}
+
+void CPowCacheLog::Unmap()
+{
+#ifndef WIN32
+    if (pMapped) {
+        munmap(const_cast<unsigned char*>(pMapped), nMappedSize);
+    }
+#endif
+    pMapped = nullptr;
+    nMappedSize = 0;
+}
+
+bool CPowCacheLog::Create()
+{
+    file = fsbridge::fopen(path, "wb+");
+    if (!file) {
+        return error("%s: failed to create %s", __func__, path.string());
+    }
+    if (!WriteHeader(file, CURRENT_VERSION)) {
+        CloseInternal();
+        return error("%s: failed to write %s", __func__, path.string());
+    }
+    FileCommit(file);
+    nRecords = 0;
+    if (!Map()) {
+        CloseInternal();
+        return false;
+    }
+    BuildIndex();
+    return true;
+}
+
+void CPowCacheLog::CloseInternal()
+{
+    Unmap();
+#ifdef WIN32
+    vBuffer.clear();
+#endif
+    if (file) {
+        fclose(file);
+        file = nullptr;
+    }
+    nRecords = 0;
+    vSlots.clear();
+    nKeys = 0;
+}
+
+bool CPowCacheLog::Open(const fs::path& _path)
+{
+    LOCK(cs);
+    CloseInternal();
+    path = _path;
+
+    file = fsbridge::fopen(path, "rb+");
+    if (!file) {
+        return Create();
+    }
+
+    unsigned char header[HEADER_SIZE];
+    if (fread(header, 1, HEADER_SIZE, file) != HEADER_SIZE ||
+        memcmp(header, POWCACHELOG_MAGIC, sizeof(POWCACHELOG_MAGIC)) != 0 ||
+        ReadLE32(header + 8) != CURRENT_VERSION) {
+        // The cache can always be rebuilt, start over rather than fail
+        LogPrintf("%s: %s has an unknown format, starting a new one\n", __func__, path.string());
+        CloseInternal();
+        return Create();
+    }
+
+    if (fseek(file, 0, SEEK_END) != 0) {
+        CloseInternal();
+        return error("%s: failed to seek in %s", __func__, path.string());
+    }
+    size_t nBody = (size_t)ftell(file) - HEADER_SIZE;
+    if (nBody % RECORD_SIZE != 0) {
+        LogPrintf("%s: dropping a partial record at the end of %s\n", __func__, path.string());
+        if (!TruncateFile(file, HEADER_SIZE + nBody / RECORD_SIZE * RECORD_SIZE)) {
+            CloseInternal();
+            return error("%s: failed to truncate %s", __func__, path.string());
+        }
+    }
+    nRecords = nBody / RECORD_SIZE;
+
+    if (!Map()) {
+        CloseInternal();
+        return false;
+    }
+    BuildIndex();
+    return true;
+}
+
+void CPowCacheLog::Close()
+{
+    LOCK(cs);
+    CloseInternal();
+}
+
+bool CPowCacheLog::IsOpen() const
+{
+    LOCK(cs);
+    return file != nullptr;
+}
+
+bool CPowCacheLog::Lookup(const uint256& headerHash, uint256& powHash) const
+{
+    LOCK(cs);
+    if (!pMapped) {
+        return false;
+    }
+    uint32_t nSlot = vSlots[FindSlot(headerHash.begin())];
+    if (nSlot == 0) {
+        return false;
+    }
+    memcpy(powHash.begin(), RecordPtr(nSlot - 1) + 32, 32);
+    return true;
+}
+
+bool CPowCacheLog::Append(const std::vector<std::pair<uint256, uint256>>& entries)
+{
+    LOCK(cs);
+    if (!file) {
+        return false;
+    }
+    if (entries.empty()) {
+        return true;
+    }
+
+    std::vector<unsigned char> vData(entries.size() * RECORD_SIZE);
+    for (size_t i = 0; i < entries.size(); i++) {
+        memcpy(&vData[i * RECORD_SIZE], entries[i].first.begin(), 32);
+        memcpy(&vData[i * RECORD_SIZE + 32], entries[i].second.begin(), 32);
+    }
+    if (fseek(file, 0, SEEK_END) != 0 || fwrite(vData.data(), 1, vData.size(), file) != vData.size()) {
+        // Don't leave a partial batch behind for the next open to trip over
+        TruncateFile(file, HEADER_SIZE + (size_t)nRecords * RECORD_SIZE);
+        return error("%s: failed to append to %s", __func__, path.string());
+    }
+    FileCommit(file);
+
+    uint32_t nOldRecords = nRecords;
+    nRecords += entries.size();
+    Unmap();
+    if (!Map()) {
+        CloseInternal();
+        return false;
+    }
+    if (2 * (size_t)nRecords > vSlots.size()) {
+        BuildIndex();
+    } else {
+        for (uint32_t n = nOldRecords; n < nRecords; n++) {
+            IndexRecord(n);
+        }
+    }
+    return true;
+}
+
+bool CPowCacheLog::Compact(size_t nKeep)
+{
+    LOCK(cs);
+    if (!file) {
+        return false;
+    }
+
+    // Appends happen in insertion order, so the newest records approximate the most recently used
+    std::vector<uint32_t> vKeep;
+    for (uint32_t n = nRecords; n-- > 0 && vKeep.size() < nKeep; ) {
+        if (vSlots[FindSlot(RecordPtr(n))] == n + 1) {
+            vKeep.push_back(n);
+        }
+    }
+
+    fs::path pathNew = path;
+    pathNew += ".new";
+    FILE* fileNew = fsbridge::fopen(pathNew, "wb");
+    if (!fileNew) {
+        return error("%s: failed to create %s", __func__, pathNew.string());
+    }
+    bool fOk = WriteHeader(fileNew, CURRENT_VERSION);
+    for (auto it = vKeep.rbegin(); fOk && it != vKeep.rend(); ++it) {
+        fOk = fwrite(RecordPtr(*it), 1, RECORD_SIZE, fileNew) == RECORD_SIZE;
+    }
+    if (fOk) {
+        FileCommit(fileNew);
+    }
+    fclose(fileNew);
+    if (!fOk) {
+        fs::remove(pathNew);
+        return error("%s: failed to write %s", __func__, pathNew.string());
+    }
+
+    LogPrint(BCLog::BENCHMARK, "%s: %u records, %u kept\n", __func__, nRecords, vKeep.size());
+
+    fs::path pathLog = path;
+    CloseInternal();
+    if (!RenameOver(pathNew, pathLog)) {
+        error("%s: failed to replace %s", __func__, pathLog.string());
+    }
+    return Open(pathLog);
+}
+
+size_t CPowCacheLog::RecordCount() const
+{
+    LOCK(cs);
+    return nRecords;
+}
+
+size_t CPowCacheLog::KeyCount() const
+{
+    LOCK(cs);
+    return nKeys;
+}
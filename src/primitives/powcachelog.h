@@ -0,0 +1,80 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YERB_POWCACHELOG_H
+#define YERB_POWCACHELOG_H
+
+#include <fs.h>
+#include <sync.h>
+#include <uint256.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <utility>
+#include <vector>
+
+/**
+ * Append-only on-disk log of (header hash, PoW hash) records backing CPowCache.
+ *
+ * The file is a 16 byte header followed by fixed size 64 byte records. It is
+ * memory mapped and indexed by an open addressing table of record numbers,
+ * so opening it costs one pass over the mapping and lookups read straight
+ * from it. New entries are only ever appended; when a header hash shows up
+ * more than once the newest record wins. Compact() rewrites the file with
+ * the newest distinct records once it has grown too much.
+ *
+ * A torn record at the end (e.g. after a crash during Append) is cut off on
+ * open. On Windows the file is read into memory instead of being mapped.
+ */
+class CPowCacheLog
+{
+private:
+    static const uint32_t CURRENT_VERSION = 1;
+    static const size_t HEADER_SIZE = 16;
+    static const size_t RECORD_SIZE = 64;
+
+    mutable CCriticalSection cs;
+    fs::path path;
+    FILE* file;
+    const unsigned char* pMapped;
+    size_t nMappedSize;
+#ifdef WIN32
+    std::vector<unsigned char> vBuffer;
+#endif
+    uint32_t nRecords;
+    /** Open addressing index, 1 + record number of the newest record of a header hash or 0 */
+    std::vector<uint32_t> vSlots;
+    uint32_t nKeys;
+
+    const unsigned char* RecordPtr(uint32_t nRecord) const { return pMapped + HEADER_SIZE + (size_t)nRecord * RECORD_SIZE; }
+    size_t FindSlot(const unsigned char* headerHash) const;
+    void IndexRecord(uint32_t nRecord);
+    void BuildIndex();
+    bool Map();
+    void Unmap();
+    bool Create();
+    void CloseInternal();
+
+public:
+    CPowCacheLog();
+    ~CPowCacheLog();
+
+    /** Open (or create) the log at _path and index its records */
+    bool Open(const fs::path& _path);
+    void Close();
+    bool IsOpen() const;
+
+    bool Lookup(const uint256& headerHash, uint256& powHash) const;
+    /** Append entries and make them durable */
+    bool Append(const std::vector<std::pair<uint256, uint256>>& entries);
+    /** Rewrite the log keeping the newest nKeep distinct header hashes */
+    bool Compact(size_t nKeep);
+
+    /** Records in the file, including ones superseded by a newer record */
+    size_t RecordCount() const;
+    /** Distinct header hashes in the file */
+    size_t KeyCount() const;
+};
+
+#endif // YERB_POWCACHELOG_H
@@ -391,10 +391,10 @@ void SendAssetsEntry::onAssetSelected(int index)
     auto vec = mapAssets.at(name.toStdString());
 
     // Go through all of the mapAssets to get the total count of assets
-    for (auto txout : vec) {
-        CAssetOutputEntry data;
-        if (GetAssetData(txout.tx->tx->vout[txout.i].scriptPubKey, data))
-            amount += data.nAmount;
+    for (const auto& txout : vec) {
+        const CAssetOutputData* assetOutput = txout.tx->GetAssetOutput(txout.i);
+        if (assetOutput && assetOutput->fValid)
+            amount += assetOutput->nAmount;
     }
 
     int units = fIsOwnerAsset ? OWNER_UNITS : asset.units;
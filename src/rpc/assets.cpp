@@ -43,7 +43,7 @@ void CheckRestrictedAssetTransferInputs(const CWalletTx& transaction, const std:
 
                 if (coin.IsAsset()) {
                     CAssetOutputEntry data;
-                    if (!GetAssetData(coin.out.scriptPubKey, data))
+                    if (!GetAssetData(*coin.assetOutput, data))
                         throw JSONRPCError(RPC_DATABASE_ERROR, std::string(
                                 _("Unable to get coin to verify restricted asset transfer from address")));
 
@@ -1713,6 +1713,7 @@ UniValue listassets(const JSONRPCRequest& request)
         start = request.params[3].get_int();
     }
 
+    LOCK(cs_main);
     std::vector<CDatabasedAssetData> assets;
     if (!passetsdb->AssetDir(assets, filter, count, start))
         throw JSONRPCError(RPC_INTERNAL_ERROR, "couldn't retrieve asset directory.");
@@ -7,6 +7,7 @@
 
 #include "rpc/blockchain.h"
 
+#include "addressindexer.h"
 #include "amount.h"
 #include "chain.h"
 #include "chainparams.h"
@@ -1666,6 +1667,39 @@ UniValue getmempoolinfo(const JSONRPCRequest& request)
     return mempoolInfoToJSON();
 }
 
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getindexinfo\n"
+            "\nReturns the state of the address, spent and timestamp indexes, which are built in the background.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"addressindex\": true|false,    (boolean) Whether -addressindex is on\n"
+            "  \"spentindex\": true|false,      (boolean) Whether -spentindex is on\n"
+            "  \"timestampindex\": true|false,  (boolean) Whether -timestampindex is on\n"
+            "  \"synced\": true|false,          (boolean) Whether the indexes caught up with the chain and follow it\n"
+            "  \"best_block_height\": xxxxx,    (numeric) Height of the last block in the indexes, -1 if none\n"
+            "  \"best_block_hash\": \"hash\",    (string, optional) Hash of the last block in the indexes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+        );
+
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("addressindex", fAddressIndex));
+    obj.push_back(Pair("spentindex", fSpentIndex));
+    obj.push_back(Pair("timestampindex", fTimestampIndex));
+
+    const CBlockIndex* pindexBest = g_addressindexer ? g_addressindexer->GetBestBlock() : nullptr;
+    obj.push_back(Pair("synced", g_addressindexer ? g_addressindexer->IsSynced() : false));
+    obj.push_back(Pair("best_block_height", pindexBest ? pindexBest->nHeight : -1));
+    if (pindexBest)
+        obj.push_back(Pair("best_block_hash", pindexBest->GetBlockHash().GetHex()));
+    return obj;
+}
+
 UniValue preciousblock(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 1)
@@ -2215,6 +2249,7 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getmerkleblocks",        &getmerkleblocks,        true,  {"filter","blockhash","count"} },
     { "blockchain",         "getchaintips",           &getchaintips,           true,  {"count","branchlen"} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          true,  {} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           true,  {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    true,  {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  true,  {"txid","verbose"} },
     { "blockchain",         "getmempoolentry",        &getmempoolentry,        true,  {"txid"} },
@@ -270,6 +270,8 @@ UniValue prioritisetransaction(const JSONRPCRequest& request)
     CAmount nAmount = request.params[1].get_int64();
 
     mempool.PrioritiseTransaction(hash, nAmount);
+    // the fee delta can change which packages make it into the block
+    blockTemplateManager.Invalidate();
     return true;
 }
 
@@ -531,28 +533,42 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     }
 
     // Update block
+    // The candidate follows the mempool, so the template reflects everything up to now
     static CBlockIndex* pindexPrev;
-    static int64_t nStart;
+    static uint64_t nSequenceLast;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5))
+    nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+    // Taken before the copy, a candidate changing meanwhile only makes the next call copy it again
+    uint64_t nSequence = blockTemplateManager.GetSequence();
+    if (pindexPrev != chainActive.Tip() || nSequence != nSequenceLast)
     {
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = nullptr;
 
-        // Store the chainActive.Tip() used before CreateNewBlock, to avoid races
-        nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-        CBlockIndex* pindexPrevNew = chainActive.Tip();
-        nStart = GetTime();
-
-        // Create new block
+        // Release the main lock while copying, checking the appended transactions of the candidate takes it when needed
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptDummy);
-        if (!pblocktemplate)
+        std::unique_ptr<CBlockTemplate> pblocktemplateNew;
+        LEAVE_CRITICAL_SECTION(cs_main);
+        try {
+            pblocktemplateNew = blockTemplateManager.GetTemplate(scriptDummy);
+        } catch (...) {
+            ENTER_CRITICAL_SECTION(cs_main);
+            throw;
+        }
+        ENTER_CRITICAL_SECTION(cs_main);
+        if (!pblocktemplateNew)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
-        // Need to update only after we know CreateNewBlock succeeded
-        pindexPrev = pindexPrevNew;
+        // The tip may have moved meanwhile, the template is built on the block it names
+        // and the next call picks up the new tip
+        BlockMap::iterator mi = mapBlockIndex.find(pblocktemplateNew->block.hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_INTERNAL_ERROR, "Template built on an unknown block");
+
+        // Need to update only after we know GetTemplate succeeded
+        pblocktemplate = std::move(pblocktemplateNew);
+        pindexPrev = mi->second;
+        nSequenceLast = nSequence;
     }
     CBlock* pblock = &pblocktemplate->block; // pointer for convenience
     const Consensus::Params& consensusParams = Params().GetConsensus();
@@ -9,6 +9,7 @@
 #include "chain.h"
 #include "clientversion.h"
 #include "core_io.h"
+#include "dbwrapper.h"
 #include "init.h"
 #include "httpserver.h"
 #include "net.h"
@@ -1137,6 +1138,27 @@ static UniValue RPCLockedMemoryInfo()
     return obj;
 }
 
+static UniValue RPCLevelDBMemoryInfo()
+{
+    UniValue obj(UniValue::VOBJ);
+    obj.push_back(Pair("cache_capacity", uint64_t(dbMemoryBudget.GetCacheCapacity())));
+    obj.push_back(Pair("cache_usage", uint64_t(dbMemoryBudget.GetCacheUsage())));
+    UniValue dbs(UniValue::VOBJ);
+    for (const auto& info : dbMemoryBudget.GetInfo()) {
+        UniValue db(UniValue::VOBJ);
+        db.push_back(Pair("nominal", uint64_t(info.nNominalSize)));
+        db.push_back(Pair("write_buffer", uint64_t(info.nWriteBufferSize)));
+        db.push_back(Pair("cache_usage", uint64_t(info.nCacheUsage)));
+        db.push_back(Pair("cache_quota", uint64_t(info.nCacheQuota)));
+        db.push_back(Pair("weight", info.dWeight));
+        db.push_back(Pair("hits", info.nHits));
+        db.push_back(Pair("misses", info.nMisses));
+        dbs.push_back(Pair(info.strName, db));
+    }
+    obj.push_back(Pair("databases", dbs));
+    return obj;
+}
+
 #ifdef HAVE_MALLOC_INFO
 static std::string RPCMallocInfo()
 {
@@ -1178,6 +1200,21 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
             "    \"locked\": xxxxxx,       (numeric) Amount of bytes that succeeded locking. If this number is smaller than total, locking pages failed at some point and key data could be swapped to disk.\n"
             "    \"chunks_used\": xxxxx,   (numeric) Number allocated chunks\n"
             "    \"chunks_free\": xxxxx,   (numeric) Number unused chunks\n"
+            "  },\n"
+            "  \"leveldb\": {              (json object) Information about the memory shared by the databases\n"
+            "    \"cache_capacity\": xxxxx, (numeric) Size of the block cache shared by the databases in bytes\n"
+            "    \"cache_usage\": xxxxx,    (numeric) Bytes of the shared block cache in use\n"
+            "    \"databases\": {           (json object) The split of the memory, by database\n"
+            "      \"name\": {\n"
+            "        \"nominal\": xxxxx,      (numeric) Memory the database was opened with in bytes\n"
+            "        \"write_buffer\": xxxxx, (numeric) Size of its write buffer in bytes\n"
+            "        \"cache_usage\": xxxxx,  (numeric) Bytes of the shared block cache it uses\n"
+            "        \"cache_quota\": xxxxx,  (numeric) Bytes of the shared block cache it may keep once it is full\n"
+            "        \"weight\": x.xxx,       (numeric) Its current share of the block cache, following its share of the cache hits\n"
+            "        \"hits\": xxxxx,         (numeric) Number of block cache hits\n"
+            "        \"misses\": xxxxx,       (numeric) Number of block cache misses\n"
+            "      }, ...\n"
+            "    }\n"
             "  }\n"
             "}\n"
             "\nResult (mode \"mallocinfo\"):\n"
@@ -1191,6 +1228,7 @@ UniValue getmemoryinfo(const JSONRPCRequest& request)
     if (mode == "stats") {
         UniValue obj(UniValue::VOBJ);
         obj.push_back(Pair("locked", RPCLockedMemoryInfo()));
+        obj.push_back(Pair("leveldb", RPCLevelDBMemoryInfo()));
         return obj;
     } else if (mode == "mallocinfo") {
 #ifdef HAVE_MALLOC_INFO
@@ -52,13 +52,13 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
 
     uint256 txid = tx.GetHash();
 
-    // Add spent information if spentindex is enabled
+    // Add spent information if spentindex is enabled, without waiting for the indexer as cs_main is held
     CSpentIndexTxInfo txSpentInfo;
     for (const auto& txin : tx.vin) {
         if (!tx.IsCoinBase()) {
             CSpentIndexValue spentInfo;
             CSpentIndexKey spentKey(txin.prevout.hash, txin.prevout.n);
-            if (GetSpentIndex(spentKey, spentInfo)) {
+            if (GetSpentIndex(spentKey, spentInfo, false)) {
                 txSpentInfo.mSpentInfo.emplace(spentKey, spentInfo);
             }
         }
@@ -66,7 +66,7 @@ void TxToJSON(const CTransaction& tx, const uint256 hashBlock, UniValue& entry)
     for (unsigned int i = 0; i < tx.vout.size(); i++) {
         CSpentIndexValue spentInfo;
         CSpentIndexKey spentKey(txid, i);
-        if (GetSpentIndex(spentKey, spentInfo)) {
+        if (GetSpentIndex(spentKey, spentInfo, false)) {
             txSpentInfo.mSpentInfo.emplace(spentKey, spentInfo);
         }
     }
@@ -856,6 +856,7 @@ UniValue signrawtransaction(const JSONRPCRequest& request)
                     newcoin.out.nValue = AmountFromValue(find_value(prevOut, "amount"));
                 }
                 newcoin.nHeight = 1;
+                newcoin.UpdateAssetOutput();
                 view.AddCoin(out, std::move(newcoin), true);
             }
 
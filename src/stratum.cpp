@@ -0,0 +1,776 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "arith_uint256.h"
+#include "base58.h"
+#include "chainparams.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "hash_selection.h"
+#include "miner.h"
+#include "netbase.h"
+#include "primitives/powcache.h"
+#include "streams.h"
+#include "timedata.h"
+#include "txmempool.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+
+/** Bytes of the coinbase extra nonce chosen by the server, per connection */
+static const int STRATUM_EXTRANONCE1_SIZE = 4;
+/** Bytes of the coinbase extra nonce rolled by the miner */
+static const int STRATUM_EXTRANONCE2_SIZE = 4;
+/** Rebuild the job when the mempool changed, but not more often than this (seconds) */
+static const int64_t STRATUM_JOB_REFRESH_INTERVAL = 10;
+/** Jobs kept for late shares, all of them are dropped on a new tip */
+static const size_t MAX_STRATUM_JOBS = 8;
+static const size_t MAX_STRATUM_CLIENTS = 1000;
+/** Disconnect miners which didn't send anything for this long (seconds) */
+static const int STRATUM_IDLE_TIMEOUT = 15 * 60;
+static const size_t MAX_STRATUM_LINE_LENGTH = 16 * 1024;
+/** Disconnect miners which don't read what we send them */
+static const size_t MAX_STRATUM_SEND_BUFFER = 1024 * 1024;
+/** Rejected shares in a row after which a miner is disconnected, each one can cost a hash */
+static const unsigned int MAX_STRATUM_REJECTED_SHARES = 1000;
+/** Seconds a miner disconnected for its rejected shares can't reconnect */
+static const int64_t STRATUM_BAN_TIME = 10 * 60;
+
+/** Stratum error codes */
+enum StratumError {
+    STRATUM_OTHER_ERROR         = 20,
+    STRATUM_JOB_NOT_FOUND       = 21,
+    STRATUM_DUPLICATE_SHARE     = 22,
+    STRATUM_LOW_DIFFICULTY      = 23,
+    STRATUM_UNAUTHORIZED        = 24,
+    STRATUM_NOT_SUBSCRIBED      = 25,
+};
+
+/** A block template split up for the miners, shared by all connections */
+struct CStratumJob
+{
+    std::string strId;
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    int nHeight;
+    /** The coinbase transaction before and after the extra nonces */
+    std::vector<unsigned char> vchCoinbase1;
+    std::vector<unsigned char> vchCoinbase2;
+    /** Hashes to combine the coinbase txid with for the Merkle root */
+    std::vector<uint256> vMerkleBranch;
+    GRPlan grPlan;
+    arith_uint256 blockTarget;
+    uint32_t nMinTime;
+    /** Header hashes of the shares submitted for this job */
+    std::set<uint256> setShares;
+};
+
+class CStratumServer;
+
+struct CStratumClient
+{
+    CStratumServer* server;
+    struct bufferevent* bev;
+    CService addr;
+    std::vector<unsigned char> vchExtraNonce1;
+    bool fSubscribed{false};
+    bool fAuthorized{false};
+    std::string strWorker;
+    /** Shares rejected since the last accepted one */
+    unsigned int nRejectedShares{0};
+    /** Set when the send buffer overflowed, the client is dropped by evDisconnect */
+    bool fDisconnect{false};
+};
+
+/** Turn a difficulty in the units of GetDifficulty() into a target */
+static arith_uint256 GetStratumTarget(double dDifficulty)
+{
+    // the inverse of GetDifficulty(), which is 0xffff / mantissa * 256^(29 - exponent)
+    double dMantissa = 65535.0 / dDifficulty;
+    int nExponent = 29;
+    while (dMantissa > 0x7fffff) {
+        dMantissa /= 256.0;
+        nExponent++;
+    }
+    while (dMantissa < 0x8000 && nExponent > 3) {
+        dMantissa *= 256.0;
+        nExponent--;
+    }
+    if (nExponent > 32) {
+        return ~arith_uint256();
+    }
+    arith_uint256 target;
+    target.SetCompact(((uint32_t)nExponent << 24) | (uint32_t)dMantissa);
+    return target;
+}
+
+static bool ParseHexUInt32(const UniValue& value, uint32_t& nRet)
+{
+    if (!value.isStr() || value.get_str().size() != 8 || !IsHex(value.get_str())) {
+        return false;
+    }
+    std::vector<unsigned char> vch = ParseHex(value.get_str());
+    nRet = ReadBE32(vch.data());
+    return true;
+}
+
+class CStratumServer : public CValidationInterface
+{
+private:
+    struct event_base* base;
+    std::vector<struct evconnlistener*> vListeners;
+    /** Activated by the validation interface, and once per second */
+    struct event* evUpdate;
+    struct event* evTimer;
+    /** Frees the clients flagged fDisconnect, outside of the callbacks which might still use them */
+    struct event* evDisconnect;
+
+    CScript scriptPayout;
+    double dDifficulty;
+    arith_uint256 shareTarget;
+
+    // Everything below is only used from the event loop thread
+    std::map<struct bufferevent*, std::unique_ptr<CStratumClient>> mapClients;
+    uint32_t nNextExtraNonce1;
+    /** Addresses of the miners dropped for their rejected shares, until when */
+    std::map<CNetAddr, int64_t> mapBanned;
+
+    std::map<uint32_t, std::shared_ptr<CStratumJob>> mapJobs;
+    uint32_t nNextJobId;
+    const CBlockIndex* pindexJobPrev;
+    unsigned int nTransactionsUpdatedJob;
+    int64_t nJobTime;
+
+    static void AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx);
+    static void ReadCallback(struct bufferevent* bev, void* ctx);
+    static void EventCallback(struct bufferevent* bev, short what, void* ctx);
+    static void UpdateCallback(evutil_socket_t, short, void* ctx);
+    static void DisconnectCallback(evutil_socket_t, short, void* ctx);
+
+    void Disconnect(CStratumClient& client);
+    void Send(CStratumClient& client, const UniValue& msg);
+    void Reply(CStratumClient& client, const UniValue& id, const UniValue& result);
+    void ReplyError(CStratumClient& client, const UniValue& id, StratumError code, const std::string& strMessage);
+    void SendJob(CStratumClient& client, const CStratumJob& job, bool fClean);
+    /** Reply with an error to a share, and drop miners which keep sending bad ones */
+    void RejectShare(CStratumClient& client, const UniValue& id, StratumError code, const std::string& strMessage);
+
+    bool ProcessLine(CStratumClient& client, const std::string& strLine);
+    void ProcessSubscribe(CStratumClient& client, const UniValue& id);
+    void ProcessSubmit(CStratumClient& client, const UniValue& id, const UniValue& params);
+
+    /** Check whether the current job is outdated and build a new one */
+    void Update();
+    std::shared_ptr<CStratumJob> CreateJob();
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override;
+
+public:
+    CStratumServer(struct event_base* baseIn, const CScript& scriptPayoutIn, double dDifficultyIn);
+    ~CStratumServer();
+
+    bool Bind(const CService& addr);
+};
+
+CStratumServer::CStratumServer(struct event_base* baseIn, const CScript& scriptPayoutIn, double dDifficultyIn) :
+    base(baseIn),
+    scriptPayout(scriptPayoutIn),
+    dDifficulty(dDifficultyIn),
+    shareTarget(GetStratumTarget(dDifficultyIn)),
+    nNextExtraNonce1(GetRand(std::numeric_limits<uint32_t>::max())),
+    nNextJobId(0),
+    pindexJobPrev(nullptr),
+    nTransactionsUpdatedJob(0),
+    nJobTime(0)
+{
+    evUpdate = event_new(base, -1, 0, UpdateCallback, this);
+    evTimer = event_new(base, -1, EV_PERSIST, UpdateCallback, this);
+    evDisconnect = event_new(base, -1, 0, DisconnectCallback, this);
+    struct timeval tv = {1, 0};
+    event_add(evTimer, &tv);
+}
+
+CStratumServer::~CStratumServer()
+{
+    while (!mapClients.empty()) {
+        Disconnect(*mapClients.begin()->second);
+    }
+    for (auto listener : vListeners) {
+        evconnlistener_free(listener);
+    }
+    event_free(evDisconnect);
+    event_free(evTimer);
+    event_free(evUpdate);
+}
+
+bool CStratumServer::Bind(const CService& addr)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        return error("Stratum: Unable to bind to %s, unsupported address", addr.ToString());
+    }
+    struct evconnlistener* listener = evconnlistener_new_bind(base, AcceptCallback, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1, (struct sockaddr*)&sockaddr, len);
+    if (!listener) {
+        return error("Stratum: Unable to bind to %s", addr.ToString());
+    }
+    LogPrintf("Stratum: Listening on %s\n", addr.ToString());
+    vListeners.push_back(listener);
+    return true;
+}
+
+void CStratumServer::AcceptCallback(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx)
+{
+    CStratumServer* server = static_cast<CStratumServer*>(ctx);
+
+    CService service;
+    service.SetSockAddr(addr);
+    auto itBanned = server->mapBanned.find(service);
+    if (itBanned != server->mapBanned.end()) {
+        if (itBanned->second > GetTime()) {
+            LogPrint(BCLog::STRATUM, "Stratum: Dropping connection from banned miner %s\n", service.ToString());
+            evutil_closesocket(fd);
+            return;
+        }
+        server->mapBanned.erase(itBanned);
+    }
+    if (server->mapClients.size() >= MAX_STRATUM_CLIENTS) {
+        LogPrint(BCLog::STRATUM, "Stratum: Too many miners, dropping connection from %s\n", service.ToString());
+        evutil_closesocket(fd);
+        return;
+    }
+
+    struct bufferevent* bev = bufferevent_socket_new(server->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+    auto client = std::make_unique<CStratumClient>();
+    client->server = server;
+    client->bev = bev;
+    client->addr = service;
+    client->vchExtraNonce1.resize(STRATUM_EXTRANONCE1_SIZE);
+    WriteBE32(client->vchExtraNonce1.data(), server->nNextExtraNonce1++);
+
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, client.get());
+    struct timeval tv = {STRATUM_IDLE_TIMEOUT, 0};
+    bufferevent_set_timeouts(bev, &tv, nullptr);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+
+    LogPrint(BCLog::STRATUM, "Stratum: Miner connected from %s\n", service.ToString());
+    server->mapClients.emplace(bev, std::move(client));
+}
+
+void CStratumServer::ReadCallback(struct bufferevent* bev, void* ctx)
+{
+    CStratumClient& client = *static_cast<CStratumClient*>(ctx);
+    CStratumServer* server = client.server;
+
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t nLength;
+    char* line;
+    while ((line = evbuffer_readln(input, &nLength, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string strLine(line, nLength);
+        free(line);
+        if (!server->ProcessLine(client, strLine) || client.fDisconnect) {
+            server->Disconnect(client);
+            return;
+        }
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE_LENGTH) {
+        LogPrint(BCLog::STRATUM, "Stratum: Line too long from %s, disconnecting\n", client.addr.ToString());
+        server->Disconnect(client);
+    }
+}
+
+void CStratumServer::EventCallback(struct bufferevent* bev, short what, void* ctx)
+{
+    CStratumClient& client = *static_cast<CStratumClient*>(ctx);
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR | BEV_EVENT_TIMEOUT)) {
+        client.server->Disconnect(client);
+    }
+}
+
+void CStratumServer::UpdateCallback(evutil_socket_t, short, void* ctx)
+{
+    static_cast<CStratumServer*>(ctx)->Update();
+}
+
+void CStratumServer::DisconnectCallback(evutil_socket_t, short, void* ctx)
+{
+    CStratumServer* server = static_cast<CStratumServer*>(ctx);
+    for (auto it = server->mapClients.begin(); it != server->mapClients.end();) {
+        CStratumClient& client = *(it++)->second;
+        if (client.fDisconnect) {
+            server->Disconnect(client);
+        }
+    }
+}
+
+void CStratumServer::UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload)
+{
+    if (!fInitialDownload) {
+        // the job is rebuilt on the event loop thread
+        event_active(evUpdate, 0, 0);
+    }
+}
+
+void CStratumServer::Disconnect(CStratumClient& client)
+{
+    LogPrint(BCLog::STRATUM, "Stratum: Miner %s disconnected\n", client.addr.ToString());
+    struct bufferevent* bev = client.bev;
+    bufferevent_free(bev);
+    mapClients.erase(bev);
+}
+
+void CStratumServer::Send(CStratumClient& client, const UniValue& msg)
+{
+    if (client.fDisconnect) {
+        return;
+    }
+    std::string strMsg = msg.write() + "\n";
+    if (evbuffer_get_length(bufferevent_get_output(client.bev)) + strMsg.size() > MAX_STRATUM_SEND_BUFFER) {
+        LogPrint(BCLog::STRATUM, "Stratum: Send buffer full for %s, disconnecting\n", client.addr.ToString());
+        client.fDisconnect = true;
+        event_active(evDisconnect, 0, 0);
+        return;
+    }
+    bufferevent_write(client.bev, strMsg.data(), strMsg.size());
+}
+
+void CStratumServer::Reply(CStratumClient& client, const UniValue& id, const UniValue& result)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("result", result));
+    reply.push_back(Pair("error", NullUniValue));
+    Send(client, reply);
+}
+
+void CStratumServer::ReplyError(CStratumClient& client, const UniValue& id, StratumError code, const std::string& strMessage)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back((int)code);
+    error.push_back(strMessage);
+    error.push_back(NullUniValue);
+
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("result", NullUniValue));
+    reply.push_back(Pair("error", error));
+    Send(client, reply);
+}
+
+void CStratumServer::RejectShare(CStratumClient& client, const UniValue& id, StratumError code, const std::string& strMessage)
+{
+    ReplyError(client, id, code, strMessage);
+    if (++client.nRejectedShares < MAX_STRATUM_REJECTED_SHARES || client.fDisconnect) {
+        return;
+    }
+    LogPrint(BCLog::STRATUM, "Stratum: %u shares in a row rejected from %s, disconnecting\n", client.nRejectedShares, client.addr.ToString());
+    int64_t nNow = GetTime();
+    for (auto it = mapBanned.begin(); it != mapBanned.end();) {
+        if (it->second <= nNow) {
+            it = mapBanned.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    mapBanned[client.addr] = nNow + STRATUM_BAN_TIME;
+    client.fDisconnect = true;
+    event_active(evDisconnect, 0, 0);
+}
+
+void CStratumServer::SendJob(CStratumClient& client, const CStratumJob& job, bool fClean)
+{
+    const CBlock& block = job.pblocktemplate->block;
+
+    // the previous block hash goes out as 32 bit words with their bytes swapped
+    std::vector<unsigned char> vchPrevHash(block.hashPrevBlock.begin(), block.hashPrevBlock.end());
+    for (size_t i = 0; i < vchPrevHash.size(); i += 4) {
+        std::reverse(vchPrevHash.begin() + i, vchPrevHash.begin() + i + 4);
+    }
+
+    UniValue branch(UniValue::VARR);
+    for (const auto& hash : job.vMerkleBranch) {
+        branch.push_back(HexStr(hash.begin(), hash.end()));
+    }
+
+    UniValue params(UniValue::VARR);
+    params.push_back(job.strId);
+    params.push_back(HexStr(vchPrevHash));
+    params.push_back(HexStr(job.vchCoinbase1));
+    params.push_back(HexStr(job.vchCoinbase2));
+    params.push_back(branch);
+    params.push_back(strprintf("%08x", (uint32_t)block.nVersion));
+    params.push_back(strprintf("%08x", block.nBits));
+    params.push_back(strprintf("%08x", block.nTime));
+    params.push_back(fClean);
+
+    UniValue msg(UniValue::VOBJ);
+    msg.push_back(Pair("id", NullUniValue));
+    msg.push_back(Pair("method", "mining.notify"));
+    msg.push_back(Pair("params", params));
+    Send(client, msg);
+}
+
+bool CStratumServer::ProcessLine(CStratumClient& client, const std::string& strLine)
+{
+    if (strLine.empty()) {
+        return true;
+    }
+
+    UniValue request;
+    if (!request.read(strLine) || !request.isObject()) {
+        LogPrint(BCLog::STRATUM, "Stratum: Invalid request from %s, disconnecting\n", client.addr.ToString());
+        return false;
+    }
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr()) {
+        ReplyError(client, id, STRATUM_OTHER_ERROR, "Invalid request");
+        return true;
+    }
+
+    const std::string& strMethod = method.get_str();
+    if (strMethod == "mining.subscribe") {
+        ProcessSubscribe(client, id);
+    } else if (strMethod == "mining.authorize") {
+        // blocks pay to -stratumaddress, the worker name is only kept for the logs
+        if (params.isArray() && params.size() > 0 && params[0].isStr()) {
+            client.strWorker = params[0].get_str();
+        }
+        client.fAuthorized = true;
+        Reply(client, id, true);
+    } else if (strMethod == "mining.submit") {
+        ProcessSubmit(client, id, params);
+    } else if (strMethod == "mining.extranonce.subscribe") {
+        // the extra nonce of a connection never changes
+        Reply(client, id, true);
+    } else {
+        ReplyError(client, id, STRATUM_OTHER_ERROR, "Unsupported method");
+    }
+    return true;
+}
+
+void CStratumServer::ProcessSubscribe(CStratumClient& client, const UniValue& id)
+{
+    std::string strSubscriptionId = HexStr(client.vchExtraNonce1);
+
+    UniValue subscription(UniValue::VARR);
+    subscription.push_back("mining.notify");
+    subscription.push_back(strSubscriptionId);
+    UniValue subscriptions(UniValue::VARR);
+    subscriptions.push_back(subscription);
+
+    UniValue result(UniValue::VARR);
+    result.push_back(subscriptions);
+    result.push_back(HexStr(client.vchExtraNonce1));
+    result.push_back(STRATUM_EXTRANONCE2_SIZE);
+    Reply(client, id, result);
+    client.fSubscribed = true;
+
+    UniValue difficulty(UniValue::VARR);
+    difficulty.push_back(dDifficulty);
+    UniValue msg(UniValue::VOBJ);
+    msg.push_back(Pair("id", NullUniValue));
+    msg.push_back(Pair("method", "mining.set_difficulty"));
+    msg.push_back(Pair("params", difficulty));
+    Send(client, msg);
+
+    if (!mapJobs.empty()) {
+        SendJob(client, *mapJobs.rbegin()->second, true);
+    } else {
+        // no jobs are built while nobody is connected, the new one goes out to every subscribed miner
+        event_active(evUpdate, 0, 0);
+    }
+}
+
+void CStratumServer::ProcessSubmit(CStratumClient& client, const UniValue& id, const UniValue& params)
+{
+    if (!client.fSubscribed) {
+        RejectShare(client, id, STRATUM_NOT_SUBSCRIBED, "Not subscribed");
+        return;
+    }
+    if (!client.fAuthorized) {
+        RejectShare(client, id, STRATUM_UNAUTHORIZED, "Unauthorized worker");
+        return;
+    }
+    if (!params.isArray() || params.size() < 5 || !params[1].isStr() || !params[2].isStr()) {
+        RejectShare(client, id, STRATUM_OTHER_ERROR, "Invalid parameters");
+        return;
+    }
+
+    uint32_t nJobId;
+    if (!ParseHexUInt32(params[1], nJobId) || !mapJobs.count(nJobId)) {
+        RejectShare(client, id, STRATUM_JOB_NOT_FOUND, "Job not found");
+        return;
+    }
+    CStratumJob& job = *mapJobs[nJobId];
+
+    const std::string& strExtraNonce2 = params[2].get_str();
+    uint32_t nTime;
+    uint32_t nNonce;
+    if (strExtraNonce2.size() != STRATUM_EXTRANONCE2_SIZE * 2 || !IsHex(strExtraNonce2)) {
+        RejectShare(client, id, STRATUM_OTHER_ERROR, "Invalid extranonce2");
+        return;
+    }
+    if (!ParseHexUInt32(params[3], nTime) || nTime < job.nMinTime || nTime > GetAdjustedTime() + MAX_FUTURE_BLOCK_TIME) {
+        RejectShare(client, id, STRATUM_OTHER_ERROR, "Invalid ntime");
+        return;
+    }
+    if (!ParseHexUInt32(params[4], nNonce)) {
+        RejectShare(client, id, STRATUM_OTHER_ERROR, "Invalid nonce");
+        return;
+    }
+
+    std::vector<unsigned char> vchCoinbase(job.vchCoinbase1);
+    vchCoinbase.insert(vchCoinbase.end(), client.vchExtraNonce1.begin(), client.vchExtraNonce1.end());
+    std::vector<unsigned char> vchExtraNonce2 = ParseHex(strExtraNonce2);
+    vchCoinbase.insert(vchCoinbase.end(), vchExtraNonce2.begin(), vchExtraNonce2.end());
+    vchCoinbase.insert(vchCoinbase.end(), job.vchCoinbase2.begin(), job.vchCoinbase2.end());
+
+    CBlockHeader header = job.pblocktemplate->block.GetBlockHeader();
+    header.hashMerkleRoot = Hash(vchCoinbase.begin(), vchCoinbase.end());
+    for (const auto& hash : job.vMerkleBranch) {
+        header.hashMerkleRoot = Hash(header.hashMerkleRoot.begin(), header.hashMerkleRoot.end(), hash.begin(), hash.end());
+    }
+    header.nTime = nTime;
+    header.nNonce = nNonce;
+
+    uint256 hashBlock = header.GetHash();
+    if (!job.setShares.insert(hashBlock).second) {
+        RejectShare(client, id, STRATUM_DUPLICATE_SHARE, "Duplicate share");
+        return;
+    }
+
+    uint256 powHash = header.ComputeHash(job.grPlan);
+    arith_uint256 powTarget = UintToArith256(powHash);
+    if (powTarget > shareTarget && powTarget > job.blockTarget) {
+        RejectShare(client, id, STRATUM_LOW_DIFFICULTY, "Low difficulty share");
+        return;
+    }
+    client.nRejectedShares = 0;
+    Reply(client, id, true);
+
+    if (powTarget > job.blockTarget) {
+        return;
+    }
+
+    std::shared_ptr<CBlock> pblock = std::make_shared<CBlock>(job.pblocktemplate->block);
+    *static_cast<CBlockHeader*>(pblock.get()) = header;
+    try {
+        CMutableTransaction txCoinbase;
+        CDataStream ss(vchCoinbase, SER_NETWORK, PROTOCOL_VERSION);
+        ss >> txCoinbase;
+        pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+    } catch (const std::exception& e) {
+        error("Stratum: Failed to decode the coinbase of block %s - %s", hashBlock.ToString(), e.what());
+        return;
+    }
+
+    LogPrintf("Stratum: Block %s at height %d found by %s (%s)\n", hashBlock.ToString(), job.nHeight, client.strWorker, client.addr.ToString());
+    // validation would hash the header again
+    CPowCache::Instance().Insert(hashBlock, powHash);
+    if (!ProcessNewBlock(Params(), pblock, true, nullptr)) {
+        error("Stratum: Block %s not accepted", hashBlock.ToString());
+    }
+}
+
+std::shared_ptr<CStratumJob> CStratumServer::CreateJob()
+{
+    auto job = std::make_shared<CStratumJob>();
+    try {
+        job->pblocktemplate = blockTemplateManager.GetTemplate(scriptPayout);
+    } catch (const std::exception& e) {
+        error("Stratum: Failed to create a block template - %s", e.what());
+        return nullptr;
+    }
+    if (!job->pblocktemplate) {
+        return nullptr;
+    }
+    CBlock& block = job->pblocktemplate->block;
+
+    {
+        LOCK(cs_main);
+        auto mi = mapBlockIndex.find(block.hashPrevBlock);
+        if (mi == mapBlockIndex.end()) {
+            return nullptr;
+        }
+        pindexJobPrev = mi->second;
+        job->nHeight = pindexJobPrev->nHeight + 1;
+        job->nMinTime = pindexJobPrev->GetMedianTimePast() + 1;
+    }
+    job->strId = strprintf("%08x", nNextJobId++);
+    job->grPlan = MakeGRPlan(block.hashPrevBlock);
+    job->blockTarget.SetCompact(block.nBits);
+
+    // Split the coinbase around the extra nonces, which the miners put into its scriptSig
+    CMutableTransaction txCoinbase(*block.vtx[0]);
+    std::vector<unsigned char> vchPlaceholder(STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE, 0);
+    txCoinbase.vin[0].scriptSig = (CScript() << job->nHeight << vchPlaceholder) + COINBASE_FLAGS;
+    CDataStream ssCoinbase(SER_NETWORK, PROTOCOL_VERSION);
+    ssCoinbase << txCoinbase;
+    // find the placeholder by serializing it once more with different bytes
+    std::fill(vchPlaceholder.begin(), vchPlaceholder.end(), 0xff);
+    txCoinbase.vin[0].scriptSig = (CScript() << job->nHeight << vchPlaceholder) + COINBASE_FLAGS;
+    CDataStream ssCoinbase2(SER_NETWORK, PROTOCOL_VERSION);
+    ssCoinbase2 << txCoinbase;
+    size_t nOffset = std::mismatch(ssCoinbase.begin(), ssCoinbase.end(), ssCoinbase2.begin()).first - ssCoinbase.begin();
+    job->vchCoinbase1.assign(ssCoinbase.begin(), ssCoinbase.begin() + nOffset);
+    job->vchCoinbase2.assign(ssCoinbase.begin() + nOffset + vchPlaceholder.size(), ssCoinbase.end());
+
+    // The branch of the coinbase, which is the first leaf, up to the Merkle root
+    std::vector<uint256> vHashes(block.vtx.size());
+    for (size_t i = 1; i < block.vtx.size(); i++) {
+        vHashes[i] = block.vtx[i]->GetHash();
+    }
+    while (vHashes.size() > 1) {
+        job->vMerkleBranch.push_back(vHashes[1]);
+        if (vHashes.size() & 1) {
+            vHashes.push_back(vHashes.back());
+        }
+        std::vector<uint256> vParents(1);
+        for (size_t i = 2; i < vHashes.size(); i += 2) {
+            vParents.push_back(Hash(vHashes[i].begin(), vHashes[i].end(), vHashes[i + 1].begin(), vHashes[i + 1].end()));
+        }
+        vHashes = std::move(vParents);
+    }
+
+    return job;
+}
+
+void CStratumServer::Update()
+{
+    if (mapClients.empty() || IsInitialBlockDownload()) {
+        return;
+    }
+
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    bool fNewTip = pindexTip != pindexJobPrev;
+    if (!fNewTip && !mapJobs.empty() && (mempool.GetTransactionsUpdated() == nTransactionsUpdatedJob || GetTime() - nJobTime < STRATUM_JOB_REFRESH_INTERVAL)) {
+        return;
+    }
+
+    nTransactionsUpdatedJob = mempool.GetTransactionsUpdated();
+    nJobTime = GetTime();
+    int64_t nStart = GetTimeMillis();
+    auto job = CreateJob();
+    if (!job) {
+        return;
+    }
+    // the template might already build on a block which connected in the meantime
+    fNewTip = fNewTip || (!mapJobs.empty() && mapJobs.rbegin()->second->pblocktemplate->block.hashPrevBlock != job->pblocktemplate->block.hashPrevBlock);
+    if (fNewTip) {
+        mapJobs.clear();
+    }
+    while (mapJobs.size() >= MAX_STRATUM_JOBS) {
+        mapJobs.erase(mapJobs.begin());
+    }
+    mapJobs.emplace(nNextJobId - 1, job);
+
+    LogPrint(BCLog::STRATUM, "Stratum: New job %s at height %d with %d transactions  %dms\n", job->strId, job->nHeight, job->pblocktemplate->block.vtx.size(), GetTimeMillis() - nStart);
+    for (const auto& p : mapClients) {
+        if (p.second->fSubscribed) {
+            SendJob(*p.second, *job, fNewTip);
+        }
+    }
+}
+
+static struct event_base* stratumBase = nullptr;
+static std::unique_ptr<CStratumServer> stratumServer;
+static std::thread threadStratum;
+
+static void ThreadStratum()
+{
+    event_base_dispatch(stratumBase);
+}
+
+bool StartStratumServer()
+{
+    CBitcoinAddress address(gArgs.GetArg("-stratumaddress", ""));
+    if (!address.IsValid()) {
+        return InitError(_("-stratumbind requires a valid -stratumaddress to pay the mined blocks to"));
+    }
+    double dDifficulty = DEFAULT_STRATUM_DIFFICULTY;
+    if (gArgs.IsArgSet("-stratumdifficulty")) {
+        std::string strDifficulty = gArgs.GetArg("-stratumdifficulty", "");
+        if (!ParseDouble(strDifficulty, &dDifficulty) || dDifficulty <= 0) {
+            return InitError(strprintf(_("Invalid -stratumdifficulty '%s'"), strDifficulty));
+        }
+    }
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    stratumBase = event_base_new();
+    if (!stratumBase) {
+        return InitError(_("Unable to start Stratum server. See debug log for details."));
+    }
+    stratumServer.reset(new CStratumServer(stratumBase, GetScriptForDestination(address.Get()), dDifficulty));
+
+    for (const std::string& strBind : gArgs.GetArgs("-stratumbind")) {
+        CService addrBind;
+        if (!Lookup(strBind.c_str(), addrBind, DEFAULT_STRATUM_PORT, false)) {
+            StopStratumServer();
+            return InitError(strprintf(_("Cannot resolve -%s address: '%s'"), "stratumbind", strBind));
+        }
+        if (!stratumServer->Bind(addrBind)) {
+            StopStratumServer();
+            return InitError(strprintf(_("Unable to bind the Stratum server to %s"), addrBind.ToString()));
+        }
+    }
+
+    RegisterValidationInterface(stratumServer.get());
+    threadStratum = std::thread(&TraceThread<void (*)()>, "stratum", &ThreadStratum);
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (stratumBase) {
+        event_base_loopbreak(stratumBase);
+    }
+}
+
+void StopStratumServer()
+{
+    if (stratumServer) {
+        UnregisterValidationInterface(stratumServer.get());
+    }
+    if (threadStratum.joinable()) {
+        threadStratum.join();
+    }
+    stratumServer.reset();
+    if (stratumBase) {
+        event_base_free(stratumBase);
+        stratumBase = nullptr;
+    }
+}
@@ -0,0 +1,23 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YERB_STRATUM_H
+#define YERB_STRATUM_H
+
+static const unsigned short DEFAULT_STRATUM_PORT = 3333;
+/** Share difficulty, in the units of the difficulty reported by getmininginfo */
+static const double DEFAULT_STRATUM_DIFFICULTY = 0.001;
+
+/**
+ * Start the Stratum v1 server on the -stratumbind addresses. Miners get a new
+ * job as soon as the tip changes, and their shares are checked right in the
+ * server, which submits the ones meeting the block target.
+ */
+bool StartStratumServer();
+/** Interrupt the Stratum server thread */
+void InterruptStratumServer();
+/** Stop the Stratum server and disconnect all miners */
+void StopStratumServer();
+
+#endif // YERB_STRATUM_H
@@ -0,0 +1,83 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "assets/assets.h"
+#include "validation.h"
+
+#include "test/test_yerbas.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(assets_tests, BasicTestingSetup)
+
+static CAssetCacheNewAsset MakeCachedAsset(const std::string& strName, const CAmount nAmount, const int nHeight)
+{
+    return CAssetCacheNewAsset(CNewAsset(strName, nAmount), "", nHeight, uint256());
+}
+
+BOOST_AUTO_TEST_CASE(assets_cache_layers)
+{
+    CAssetsCache* passetsSaved = passets;
+    CAssetsCache global;
+    passets = &global;
+
+    global.setNewAssetsToAdd.insert(MakeCachedAsset("GLOBAL", 100 * COIN, 10));
+
+    // A cache over passets starts empty but sees its entries
+    CAssetsCache layer;
+    BOOST_CHECK(layer.GetBase() == passets);
+    BOOST_CHECK(layer.setNewAssetsToAdd.empty());
+    BOOST_CHECK(layer.CheckIfAssetExists("GLOBAL", true));
+
+    // A cache over another cache sees all layers below it
+    layer.setNewAssetsToAdd.insert(MakeCachedAsset("LAYER", 5 * COIN, 11));
+    CAssetsCache scratch(&layer);
+    BOOST_CHECK(scratch.GetBase() == &layer);
+    BOOST_CHECK(scratch.CheckIfAssetExists("GLOBAL", true));
+    BOOST_CHECK(scratch.CheckIfAssetExists("LAYER", true));
+
+    CNewAsset asset;
+    int nHeight;
+    uint256 blockHash;
+    BOOST_CHECK(scratch.GetAssetMetaDataIfExists("LAYER", asset, nHeight, blockHash));
+    BOOST_CHECK_EQUAL(asset.nAmount, 5 * COIN);
+    BOOST_CHECK_EQUAL(nHeight, 11);
+
+    // Reissued data of a lower layer is preferred over the original issuance
+    CNewAsset reissued(asset);
+    reissued.nAmount = 7 * COIN;
+    layer.mapReissuedAssetData["LAYER"] = reissued;
+    BOOST_CHECK(scratch.GetAssetMetaDataIfExists("LAYER", asset));
+    BOOST_CHECK_EQUAL(asset.nAmount, 7 * COIN);
+
+    // Removals in the top layer hide entries below it, without touching them
+    scratch.setNewAssetsToRemove.insert(MakeCachedAsset("GLOBAL", 100 * COIN, 10));
+    BOOST_CHECK(!scratch.CheckIfAssetExists("GLOBAL", true));
+    BOOST_CHECK(layer.CheckIfAssetExists("GLOBAL", true));
+    BOOST_CHECK(global.CheckIfAssetExists("GLOBAL", true));
+
+    // Dropping the scratch cache leaves the layers below as they were
+    {
+        CAssetsCache discarded(&layer);
+        discarded.setNewAssetsToAdd.insert(MakeCachedAsset("DISCARDED", COIN, 12));
+        BOOST_CHECK(discarded.CheckIfAssetExists("DISCARDED", true));
+    }
+    BOOST_CHECK(!layer.CheckIfAssetExists("DISCARDED", true));
+
+    // Flushing moves the changes one layer down only
+    BOOST_CHECK(scratch.Flush());
+    BOOST_CHECK(!layer.CheckIfAssetExists("GLOBAL", true));
+    BOOST_CHECK(global.CheckIfAssetExists("GLOBAL", true));
+    BOOST_CHECK(!global.CheckIfAssetExists("LAYER", true));
+
+    BOOST_CHECK(layer.Flush());
+    BOOST_CHECK(!global.CheckIfAssetExists("GLOBAL", true));
+    BOOST_CHECK(global.CheckIfAssetExists("LAYER", true));
+    BOOST_CHECK(global.GetAssetMetaDataIfExists("LAYER", asset));
+    BOOST_CHECK_EQUAL(asset.nAmount, 7 * COIN);
+
+    passets = passetsSaved;
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -5,6 +5,7 @@
 
 #include "bls/bls.h"
 #include "bls/bls_batchverifier.h"
+#include "bls/bls_worker.h"
 #include "test/test_yerbas.h"
 
 #include <boost/test/unit_test.hpp>
@@ -78,9 +79,9 @@ static void AddMessage(std::vector<Message>& vec, uint32_t sourceId, uint32_t ms
     vec.emplace_back(m);
 }
 
-static void Verify(std::vector<Message>& vec, bool secureVerification, bool perMessageFallback)
+static void Verify(std::vector<Message>& vec, bool secureVerification, bool perMessageFallback, CBLSWorker* worker = nullptr)
 {
-    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, perMessageFallback);
+    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(secureVerification, perMessageFallback, 0, worker);
 
     std::set<uint32_t> expectedBadMessages;
     std::set<uint32_t> expectedBadSources;
@@ -104,12 +105,12 @@ static void Verify(std::vector<Message>& vec, bool secureVerification, bool perM
     }
 }
 
-static void Verify(std::vector<Message>& vec)
+static void Verify(std::vector<Message>& vec, CBLSWorker* worker = nullptr)
 {
-    Verify(vec, false, false);
-    Verify(vec, true, false);
-    Verify(vec, false, true);
-    Verify(vec, true, true);
+    Verify(vec, false, false, worker);
+    Verify(vec, true, false, worker);
+    Verify(vec, false, true, worker);
+    Verify(vec, true, true, worker);
 }
 
 BOOST_AUTO_TEST_CASE(batch_verifier_tests)
@@ -155,4 +156,38 @@ BOOST_AUTO_TEST_CASE(batch_verifier_tests)
     Verify(msgs);
 }
 
+BOOST_AUTO_TEST_CASE(batch_verifier_parallel_tests)
+{
+    CBLSWorker worker;
+    worker.Start();
+
+    std::vector<Message> msgs;
+
+    // enough messages to be split into shards, with sources spanning multiple shards
+    for (uint32_t i = 0; i < 64; i++) {
+        AddMessage(msgs, i % 4, i, i, true);
+    }
+    Verify(msgs, &worker);
+
+    // invalid sigs from two sources
+    AddMessage(msgs, 1, 64, 64, false);
+    AddMessage(msgs, 3, 65, 65, false);
+    Verify(msgs, &worker);
+
+    // same message as an invalid one, but from another source and with valid sig
+    AddMessage(msgs, 2, 66, 65, true);
+    Verify(msgs, &worker);
+
+    // sub batches spread over the shards
+    CBLSBatchVerifier<uint32_t, uint32_t> batchVerifier(false, true, 8, &worker);
+    for (auto& m : msgs) {
+        batchVerifier.PushMessage(m.sourceId, m.msgId, m.msgHash, m.sig, m.pk);
+    }
+    batchVerifier.Verify();
+    BOOST_CHECK(batchVerifier.badSources == std::set<uint32_t>({1, 3}));
+    BOOST_CHECK(batchVerifier.badMessages == std::set<uint32_t>({64, 65}));
+
+    worker.Stop();
+}
+
 BOOST_AUTO_TEST_SUITE_END()
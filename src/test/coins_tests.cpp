@@ -2,6 +2,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "base58.h"
 #include "coins.h"
 #include "script/standard.h"
 #include "uint256.h"
@@ -855,4 +856,46 @@ BOOST_AUTO_TEST_CASE(ccoins_write)
                     CheckWriteCoins(parent_value, child_value, parent_value, parent_flags, child_flags, parent_flags);
 }
 
+BOOST_AUTO_TEST_CASE(coin_asset_output)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CScript script = GetScriptForDestination(key.GetPubKey().GetID());
+    CTxOut plain(COIN, script);
+    CAssetTransfer("YERBTEST", 5 * COIN, "", 0).ConstructTransaction(script);
+    CTxOut transfer(0, script);
+
+    BOOST_CHECK(!Coin(plain, 1, false).IsAsset());
+
+    // The asset fields are decoded when the coin is built, deserialized or read back from undo data
+    Coin coin(transfer, 1, false);
+    BOOST_CHECK(coin.IsAsset());
+    BOOST_CHECK(coin.assetOutput->fValid);
+    BOOST_CHECK_EQUAL(coin.assetOutput->type, TX_TRANSFER_ASSET);
+    BOOST_CHECK_EQUAL(coin.assetOutput->assetName, "YERBTEST");
+    BOOST_CHECK_EQUAL(coin.assetOutput->nAmount, 5 * COIN);
+    BOOST_CHECK_EQUAL(coin.assetOutput->strAddress, EncodeDestination(key.GetPubKey().GetID()));
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << coin;
+    Coin coinRead;
+    ss >> coinRead;
+    BOOST_CHECK(coinRead.IsAsset());
+    BOOST_CHECK_EQUAL(coinRead.assetOutput->assetName, "YERBTEST");
+
+    ss << TxInUndoSerializer(&coin);
+    Coin coinUndo;
+    TxInUndoDeserializer undo(&coinUndo);
+    ss >> undo;
+    BOOST_CHECK(coinUndo.IsAsset());
+    BOOST_CHECK_EQUAL(coinUndo.assetOutput->nAmount, 5 * COIN);
+
+    coinUndo.out = plain;
+    coinUndo.UpdateAssetOutput();
+    BOOST_CHECK(!coinUndo.IsAsset());
+
+    coin.Clear();
+    BOOST_CHECK(!coin.IsAsset());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -12,6 +12,7 @@
 #include "crypto/sha512.h"
 #include "crypto/hmac_sha256.h"
 #include "crypto/hmac_sha512.h"
+#include "cryptonote/slow-hash.h"
 #include "random.h"
 #include "utilstrencodings.h"
 #include "test/test_yerbas.h"
@@ -783,4 +784,49 @@ BOOST_AUTO_TEST_CASE(sha256d64)
     }
 }
 
+static void TestCryptonight(void (*hash)(const char*, char*, uint32_t, int), const std::string& hexin, const std::string& hexout)
+{
+    std::vector<unsigned char> in = ParseHex(hexin);
+    std::vector<unsigned char> out(32);
+    hash((const char*)in.data(), (char*)out.data(), in.size(), 1);
+    BOOST_CHECK_EQUAL(HexStr(out), hexout);
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_ghostrider_variants)
+{
+    BOOST_TEST_MESSAGE("Using the " << cn_slow_hash_autodetect() << " cryptonight implementation");
+
+    const std::string in = "01203f5e7d9cbbdaf91837567594b3d2f1102f4e6d8cabcae90827466584a3c2e1001f3e5d7c9bbad9f81736557493b2d1f00f2e4d6c8baac9e80726456483a2";
+    TestCryptonight(crypto::cryptonight_dark_hash, in, "c7ff825922e089a8785a182093a54b844e6fb71a3549fea8f43ed5c77d9fa86f");
+    TestCryptonight(crypto::cryptonight_darklite_hash, in, "241a8ca8e38ab9f0be3e4c46c1e79e8c768f4ecf0867edab11485024d0c19df0");
+    TestCryptonight(crypto::cryptonight_cnfast_hash, in, "664d326321e82af3d618bb5354fb4ada931797477397c6cfca7242a23d4166ff");
+    TestCryptonight(crypto::cryptonight_cnlite_hash, in, "fac645f2f90043e5106ab85867d1ae4a7cda55a33eab199d0ea98a568de227ed");
+    TestCryptonight(crypto::cryptonight_turtle_hash, in, "c4152765718f196d1c4028739641504a0c06af256756fe49827513aa7a6cef8b");
+    TestCryptonight(crypto::cryptonight_turtlelite_hash, in, "f10df5688bbd6646d099ccf73b7e9355975af3b893dcaced5e83514bfccbd252");
+}
+
+BOOST_AUTO_TEST_CASE(cryptonight_hw_matches_portable)
+{
+    static const uint32_t params[][3] = {
+        {CN_DARK_PAGE_SIZE, CN_DARK_ITERATIONS, CN_DARK_AES_ROUNDS},
+        {CN_DARK_PAGE_SIZE, CN_DARK_ITERATIONS, CN_DARK_LITE_AES_ROUNDS},
+        {CN_FAST_PAGE_SIZE, CN_FAST_ITERATIONS, CN_FAST_AES_ROUNDS},
+        {CN_LITE_PAGE_SIZE, CN_LITE_ITERATIONS, CN_LITE_AES_ROUNDS},
+        {CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_AES_ROUNDS},
+        {CN_TURTLE_PAGE_SIZE, CN_TURTLE_ITERATIONS, CN_TURTLE_LITE_AES_ROUNDS},
+    };
+    for (const auto& p : params) {
+        for (int i = 0; i < 4; i++) {
+            unsigned char in[64];
+            char out1[32], out2[32];
+            for (int j = 0; j < 64; j++) {
+                in[j] = InsecureRandBits(8);
+            }
+            crypto::cn_slow_hash((const char*)in, out1, sizeof(in), 1, p[0], p[1], p[2]);
+            crypto::cn_slow_hash_portable((const char*)in, out2, sizeof(in), 1, p[0], p[1], p[2]);
+            BOOST_CHECK(memcmp(out1, out2, sizeof(out1)) == 0);
+        }
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -77,6 +77,47 @@ BOOST_AUTO_TEST_CASE(dbwrapper_batch)
     }
 }
 
+class CBatchedDBWrapper : public CDBWrapper
+{
+public:
+    using CDBWrapper::CDBWrapper;
+    using CDBWrapper::BatchWrite;
+    using CDBWrapper::BatchErase;
+};
+
+BOOST_AUTO_TEST_CASE(dbwrapper_pending_batch)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CBatchedDBWrapper dbw(ph, (1 << 20), true, false, true);
+    uint256 res;
+
+    // Without a pending batch the writes go straight to the database
+    BOOST_CHECK(dbw.BatchWrite('a', InsecureRand256()));
+    BOOST_CHECK(dbw.Exists('a'));
+
+    dbw.BeginBatch(1 << 20);
+    BOOST_CHECK(dbw.IsBatching());
+    uint256 in = InsecureRand256();
+    BOOST_CHECK(dbw.BatchWrite('b', in));
+    BOOST_CHECK(dbw.BatchErase('a'));
+    BOOST_CHECK(!dbw.Exists('b'));
+    BOOST_CHECK(dbw.Exists('a'));
+    BOOST_CHECK(dbw.CommitBatch());
+    BOOST_CHECK(!dbw.IsBatching());
+    BOOST_CHECK(dbw.Read('b', res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    BOOST_CHECK(!dbw.Exists('a'));
+
+    // A batch past the size limit is written before the commit
+    dbw.BeginBatch(1);
+    BOOST_CHECK(dbw.BatchWrite('c', in));
+    BOOST_CHECK(dbw.Exists('c'));
+    BOOST_CHECK(dbw.BatchErase('b'));
+    BOOST_CHECK(!dbw.Exists('b'));
+    dbw.AbortBatch();
+    BOOST_CHECK(!dbw.IsBatching());
+}
+
 BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 {
     // Perform tests both obfuscated and non-obfuscated.
@@ -118,6 +159,34 @@ BOOST_AUTO_TEST_CASE(dbwrapper_iterator)
 }
 
 // Test that we do not obfuscation if there is existing data.
+BOOST_AUTO_TEST_CASE(dbwrapper_snapshot_iterator)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+
+    uint256 in = InsecureRand256();
+    BOOST_CHECK(dbw.Write('j', in));
+    std::unique_ptr<CDBSnapshot> snapshot = dbw.GetSnapshot();
+
+    // Changes made after the snapshot was taken don't show up in it
+    BOOST_CHECK(dbw.Write('j', InsecureRand256()));
+    BOOST_CHECK(dbw.Write('k', InsecureRand256()));
+
+    std::unique_ptr<CDBIterator> it(dbw.NewIterator(*snapshot));
+    it->Seek('j');
+    char key;
+    uint256 res;
+    BOOST_REQUIRE(it->Valid());
+    BOOST_CHECK(it->GetKey(key));
+    BOOST_CHECK_EQUAL(key, 'j');
+    BOOST_CHECK(it->GetValue(res));
+    BOOST_CHECK_EQUAL(res.ToString(), in.ToString());
+    it->Next();
+    BOOST_CHECK(!it->Valid());
+
+    BOOST_CHECK(dbw.Read('k', res));
+}
+
 BOOST_AUTO_TEST_CASE(existing_data_no_obfuscate)
 {
     // We're going to share this fs::path between two wrappers
@@ -317,6 +386,82 @@ BOOST_AUTO_TEST_CASE(iterator_string_ordering)
     }
 }
 
+BOOST_AUTO_TEST_CASE(iterator_key_prefix)
+{
+    fs::path ph = fs::temp_directory_path() / fs::unique_path();
+    CDBWrapper dbw(ph, (1 << 20), true, false, true);
+
+    // "AB" starts with the same name bytes as "A" but must not match its prefix
+    for (const std::string& name : {"A", "AB", "B"}) {
+        for (const std::string& address : {"x", "y"}) {
+            BOOST_CHECK(dbw.Write(std::make_pair('B', std::make_pair(name, address)), (int64_t)name.size()));
+        }
+    }
 
+    CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+    ssPrefix << std::make_pair('B', std::string("A"));
+
+    std::unique_ptr<CDBIterator> it(const_cast<CDBWrapper&>(dbw).NewIterator());
+    std::vector<std::string> addresses;
+    for (it->Seek(ssPrefix); it->Valid() && it->KeyHasPrefix(ssPrefix); it->Next()) {
+        std::string address;
+        int64_t value;
+        BOOST_CHECK(it->GetKeySuffix(ssPrefix.size(), address));
+        BOOST_CHECK(it->GetValue(value));
+        BOOST_CHECK_EQUAL(value, 1);
+        addresses.push_back(address);
+    }
+    BOOST_CHECK(addresses == std::vector<std::string>({"x", "y"}));
+
+    // Names are length prefixed, so the loop stopped on the first "B" key
+    BOOST_CHECK(it->Valid());
+    std::pair<char, std::pair<std::string, std::string>> key;
+    BOOST_CHECK(it->GetKey(key));
+    BOOST_CHECK_EQUAL(key.second.first, "B");
+}
+
+BOOST_AUTO_TEST_CASE(dbwrapper_memory_budget)
+{
+    dbMemoryBudget.Init(8 << 20);
+    {
+        CDBWrapper dbwHot(fs::temp_directory_path() / fs::unique_path(), (4 << 20), true);
+        CDBWrapper dbwCold(fs::temp_directory_path() / fs::unique_path(), (4 << 20), true);
+        for (int i = 0; i < 1000; i++) {
+            BOOST_CHECK(dbwHot.Write(i, InsecureRand256()));
+            BOOST_CHECK(dbwCold.Write(i, InsecureRand256()));
+        }
+        // Move the entries from the write buffers to tables, which are read through the block cache
+        dbwHot.CompactFull();
+        dbwCold.CompactFull();
+
+        std::vector<CDBMemoryBudget::DBInfo> vInfo = dbMemoryBudget.GetInfo();
+        BOOST_CHECK_EQUAL(vInfo.size(), 2U);
+        BOOST_CHECK_EQUAL(vInfo[0].nWriteBufferSize, (size_t)(1 << 20));
+        BOOST_CHECK_EQUAL(vInfo[0].nCacheQuota, vInfo[1].nCacheQuota);
+
+        uint256 res;
+        for (int n = 0; n < 10; n++) {
+            for (int i = 0; i < 1000; i++) {
+                BOOST_CHECK(dbwHot.Read(i, res));
+            }
+        }
+        BOOST_CHECK(dbwCold.Read(0, res));
+
+        vInfo = dbMemoryBudget.GetInfo();
+        BOOST_CHECK(vInfo[0].nHits > vInfo[1].nHits);
+        BOOST_CHECK(vInfo[0].nCacheUsage > 0);
+        BOOST_CHECK_EQUAL(dbMemoryBudget.GetCacheUsage(), vInfo[0].nCacheUsage + vInfo[1].nCacheUsage);
+
+        // The quotas follow the hits but keep within the capacity
+        dbMemoryBudget.Rebalance();
+        vInfo = dbMemoryBudget.GetInfo();
+        BOOST_CHECK(vInfo[0].dWeight > vInfo[1].dWeight);
+        BOOST_CHECK(vInfo[0].nCacheQuota > vInfo[1].nCacheQuota);
+        BOOST_CHECK(vInfo[1].nCacheQuota > 0);
+        BOOST_CHECK(vInfo[0].nCacheQuota + vInfo[1].nCacheQuota <= dbMemoryBudget.GetCacheCapacity());
+    }
+    BOOST_CHECK(dbMemoryBudget.GetInfo().empty());
+    dbMemoryBudget.Reset();
+}
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -6,6 +6,7 @@
 #include "test/test_yerbas.h"
 
 #include "bls/bls.h"
+#include "consensus/merkle.h"
 #include "evo/simplifiedmns.h"
 #include "netbase.h"
 
@@ -71,4 +72,57 @@ BOOST_AUTO_TEST_CASE(simplifiedmns_merkleroots)
 
     BOOST_CHECK(expectedMerkleRoot == calculatedMerkleRoot);
 }
+
+BOOST_AUTO_TEST_CASE(simplifiedmns_merkletree)
+{
+    std::map<uint256, uint256> mapLeaves;
+    CSimplifiedMNListMerkleTree tree;
+
+    for (int i = 0; i < 300; i++) {
+        CSimplifiedMNListMerkleTree::LeafChanges changes;
+        int nChanges = InsecureRandRange(i % 10 == 0 ? 40 : 4);
+        for (int j = 0; j < nChanges; j++) {
+            int nType = InsecureRandRange(mapLeaves.empty() ? 1 : 4);
+            if (nType == 0) {
+                changes[InsecureRand256()] = InsecureRand256();
+                continue;
+            }
+            auto it = std::next(mapLeaves.begin(), InsecureRandRange(mapLeaves.size()));
+            if (nType == 1) {
+                changes[it->first] = boost::none;
+            } else if (nType == 2) {
+                changes[it->first] = InsecureRand256();
+            } else {
+                // same hash as another leaf, which mutates the tree if they are siblings
+                changes[it->first] = std::next(mapLeaves.begin(), InsecureRandRange(mapLeaves.size()))->second;
+            }
+        }
+
+        std::map<uint256, uint256> mapNewLeaves = mapLeaves;
+        for (const auto& p : changes) {
+            if (p.second) {
+                mapNewLeaves[p.first] = *p.second;
+            } else {
+                mapNewLeaves.erase(p.first);
+            }
+        }
+        std::vector<uint256> vLeaves;
+        for (const auto& p : mapNewLeaves) {
+            vLeaves.emplace_back(p.second);
+        }
+        bool fMutatedExpected;
+        uint256 rootExpected = ComputeMerkleRoot(vLeaves, &fMutatedExpected);
+
+        bool fMutated;
+        BOOST_CHECK(tree.CalcMerkleRoot(changes, &fMutated) == rootExpected);
+        BOOST_CHECK_EQUAL(fMutated, fMutatedExpected);
+
+        tree.ApplyChanges(changes);
+        mapLeaves = std::move(mapNewLeaves);
+        BOOST_CHECK_EQUAL(tree.size(), mapLeaves.size());
+        BOOST_CHECK(tree.GetMerkleRoot(&fMutated) == rootExpected);
+        BOOST_CHECK_EQUAL(fMutated, fMutatedExpected);
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,141 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "flat-database.h"
+#include "test/test_yerbas.h"
+
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+struct CTestCache
+{
+    CCriticalSection cs;
+    std::map<int, int> mapValues;
+    CFlatDBJournal* journal{nullptr};
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action)
+    {
+        LOCK(cs);
+        READWRITE(mapValues);
+    }
+
+    void Set(int nKey, int nValue)
+    {
+        LOCK(cs);
+        mapValues[nKey] = nValue;
+        if (journal) {
+            journal->Append(nKey, nValue);
+        }
+    }
+
+    void Replay(CDataStream& s)
+    {
+        int nKey, nValue;
+        s >> nKey >> nValue;
+        LOCK(cs);
+        mapValues[nKey] = nValue;
+    }
+
+    void Clear() { mapValues.clear(); }
+    void CheckAndRemove() {}
+    std::string ToString() const { return strprintf("Values: %d", mapValues.size()); }
+};
+
+/** A cache with its journal, as set up on startup */
+struct CTestNode
+{
+    CTestCache cache;
+    CFlatDBJournal journal;
+    CFlatDB<CTestCache> flatdb;
+
+    CTestNode() :
+        journal("test.dat", "magicTestJournal", cache.cs, std::bind(&CTestCache::Replay, &cache, std::placeholders::_1)),
+        flatdb("test.dat", "magicTestCache", &journal)
+    {
+        BOOST_CHECK(flatdb.Load(cache));
+        cache.journal = &journal;
+    }
+};
+
+} // namespace
+
+BOOST_FIXTURE_TEST_SUITE(flatdb_tests, TestingSetup)
+
+BOOST_AUTO_TEST_CASE(journal_replay)
+{
+    {
+        CTestNode node;
+        node.cache.Set(1, 10);
+        BOOST_CHECK(node.flatdb.Checkpoint(node.cache));
+        node.cache.Set(2, 20);
+        node.cache.Set(1, 11);
+        // no checkpoint at the end, as if the node crashed
+    }
+    {
+        CTestNode node;
+        BOOST_CHECK(node.cache.mapValues == (std::map<int, int>{{1, 11}, {2, 20}}));
+        node.cache.Set(3, 30);
+    }
+    {
+        // the journal is appended to after a replay
+        CTestNode node;
+        BOOST_CHECK(node.cache.mapValues == (std::map<int, int>{{1, 11}, {2, 20}, {3, 30}}));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(journal_torn_record)
+{
+    {
+        CTestNode node;
+        node.cache.Set(1, 10);
+        node.cache.Set(2, 20);
+    }
+
+    // a record cut off in the middle of writing it
+    FILE* file = fsbridge::fopen(GetDataDir() / "test.dat.journal", "ab");
+    BOOST_CHECK(file);
+    unsigned char vchTorn[] = {0x08, 0x00, 0x00, 0x00, 0x03};
+    fwrite(vchTorn, 1, sizeof(vchTorn), file);
+    fclose(file);
+
+    {
+        CTestNode node;
+        BOOST_CHECK(node.cache.mapValues == (std::map<int, int>{{1, 10}, {2, 20}}));
+        node.cache.Set(3, 30);
+    }
+    {
+        CTestNode node;
+        BOOST_CHECK(node.cache.mapValues == (std::map<int, int>{{1, 10}, {2, 20}, {3, 30}}));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(journal_interrupted_checkpoint)
+{
+    {
+        CTestNode node;
+        node.cache.Set(1, 10);
+        {
+            // the journal was rotated, but the new checkpoint never made it to disk
+            LOCK(node.cache.cs);
+            node.journal.Rotate(GetRandHash());
+        }
+        node.cache.Set(2, 20);
+    }
+    {
+        CTestNode node;
+        BOOST_CHECK(node.cache.mapValues == (std::map<int, int>{{1, 10}, {2, 20}}));
+        BOOST_CHECK(!fs::exists(GetDataDir() / "test.dat.journal.old"));
+        node.cache.Set(3, 30);
+    }
+    {
+        CTestNode node;
+        BOOST_CHECK(node.cache.mapValues == (std::map<int, int>{{1, 10}, {2, 20}, {3, 30}}));
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
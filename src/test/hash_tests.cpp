@@ -149,4 +149,91 @@ BOOST_AUTO_TEST_CASE(siphash)
     BOOST_CHECK_EQUAL(SipHashUint256(1, 2, ss.GetHash()), 0x79751e980c2a0a35ULL);
 }
 
+BOOST_AUTO_TEST_CASE(ghostrider_plan)
+{
+    // The pre-computed plan must pick the same round order as HashSelection
+    for (int i = 0; i < 1000; i++) {
+        uint256 prevBlockHash = InsecureRand256();
+        HashSelection hashSelection(prevBlockHash, {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14}, {0, 1, 2, 3, 4, 5});
+        std::vector<int> algos = hashSelection.getAlgoIndexes();
+        std::vector<int> cns = hashSelection.getCnIndexes();
+        std::vector<int> expected;
+        for (int group = 0; group < 3; group++) {
+            expected.insert(expected.end(), algos.begin() + group * 5, algos.begin() + group * 5 + 5);
+            expected.push_back(GRPlan::CN_BASE + cns[group]);
+        }
+        GRPlan plan = MakeGRPlan(prevBlockHash);
+        BOOST_CHECK(std::equal(expected.begin(), expected.end(), plan.algos));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ghostrider_testvectors)
+{
+    std::vector<unsigned char> header = ParseHex("0714212e3b4855626f7c8996a3b0bdcad7e4f1fe0b1825323f4c596673808d9aa7b4c1cedbe8f5020f1c293643505d6a7784919eabb8c5d2dfecf90613202d3a4754616e7b8895a2afbcc9d6e3f0fd0a");
+    uint256 prevBlockHash(ParseHex("033c75aee7205992cb043d76afe8215a93cc053e77b0e9225b94cd063f78b1ea"));
+    BOOST_CHECK_EQUAL(HashGR(header.begin(), header.end(), prevBlockHash).GetHex(), "6162fd660501cf6fa32b20a65e4356b315b09c3ec1e13c785204ae5aa39c1c26");
+    GRPlan plan = MakeGRPlan(prevBlockHash);
+    BOOST_CHECK_EQUAL(HashGR(header.begin(), header.end(), plan).GetHex(), "6162fd660501cf6fa32b20a65e4356b315b09c3ec1e13c785204ae5aa39c1c26");
+
+    header = ParseHex("6c798693a0adbac7d4e1eefb0815222f3c495663707d8a97a4b1becbd8e5f2ff0c192633404d5a6774818e9ba8b5c2cfdce9f603101d2a3744515e6b7885929facb9c6d3e0edfa0714212e3b4855626f");
+    prevBlockHash = uint256(ParseHex("205992cb043d76afe8215a93cc053e77b0e9225b94cd063f78b1ea235c95ce07"));
+    BOOST_CHECK_EQUAL(HashGR(header.begin(), header.end(), prevBlockHash).GetHex(), "258f1820a9ff8376c63906395ae44de1ad030cf3d00dfd35b3aebe71cf118d66");
+    GRMidstate midstate(MakeGRPlan(prevBlockHash), header.data(), 76);
+    BOOST_CHECK_EQUAL(HashGR(midstate, header.begin() + 76, header.end()).GetHex(), "258f1820a9ff8376c63906395ae44de1ad030cf3d00dfd35b3aebe71cf118d66");
+}
+
+BOOST_AUTO_TEST_CASE(ghostrider_midstate)
+{
+    // Hashing the nonce tail on top of a midstate must match hashing the whole header
+    std::vector<unsigned char> header(80);
+    for (int i = 0; i < 20; i++) {
+        uint256 prevBlockHash = InsecureRand256();
+        GetRandBytes(header.data(), header.size());
+        GRMidstate midstate(MakeGRPlan(prevBlockHash), header.data(), 76);
+        for (uint32_t nonce = 0; nonce < 2; nonce++) {
+            WriteLE32(header.data() + 76, nonce);
+            BOOST_CHECK(HashGR(midstate, header.begin() + 76, header.end()) == HashGR(header.begin(), header.end(), prevBlockHash));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ghostrider_batch)
+{
+    // Every lane of a batch must hash exactly like the scalar code, whatever kernels got picked
+    uint512 in[GRPlan::MAX_LANES], out[GRPlan::MAX_LANES], expected;
+    const uint512* pin[GRPlan::MAX_LANES];
+    uint512* pout[GRPlan::MAX_LANES];
+    for (int i = 0; i < GRPlan::MAX_LANES; i++) {
+        GetRandBytes(in[i].begin(), 64);
+        pin[i] = &in[i];
+        pout[i] = &out[i];
+    }
+    for (int algo = 0; algo < 16; algo++) {
+        for (int n = 1; n <= GRPlan::MAX_LANES; n++) {
+            coreHashN(pin, pout, n, algo);
+            for (int i = 0; i < n; i++) {
+                coreHash(&in[i], &expected, 64, algo);
+                BOOST_CHECK(out[i] == expected);
+            }
+        }
+    }
+
+    std::vector<unsigned char> header(80);
+    GetRandBytes(header.data(), header.size());
+    uint256 prevBlockHash = InsecureRand256();
+    GRMidstate midstate(MakeGRPlan(prevBlockHash), header.data(), 76);
+    unsigned char nonces[GRPlan::MAX_LANES][4];
+    const unsigned char* tails[GRPlan::MAX_LANES];
+    uint256 hashes[GRPlan::MAX_LANES];
+    for (int i = 0; i < GRPlan::MAX_LANES; i++) {
+        WriteLE32(nonces[i], i);
+        tails[i] = nonces[i];
+    }
+    HashGRBatch(midstate, tails, 4, hashes, GRPlan::MAX_LANES);
+    for (int i = 0; i < GRPlan::MAX_LANES; i++) {
+        WriteLE32(header.data() + 76, i);
+        BOOST_CHECK(hashes[i] == HashGR(header.begin(), header.end(), prevBlockHash));
+    }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,72 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "LibBoolEE.h"
+
+#include "test/test_yerbas.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(libboolee_tests, BasicTestingSetup)
+
+// The compiled program must throw exactly when resolve does and agree with it otherwise
+static void CheckCompiledMatchesResolve(const std::string& formula, const std::vector<std::string>& variables)
+{
+    LibBoolEE::Program program;
+    bool fCompiled = true;
+    try {
+        LibBoolEE::compile(formula, variables, program);
+    } catch (const std::runtime_error&) {
+        fCompiled = false;
+    }
+
+    for (uint64_t valuation = 0; valuation < (uint64_t(1) << variables.size()); valuation++) {
+        LibBoolEE::Vals vals;
+        for (size_t i = 0; i < variables.size(); i++) {
+            vals.insert(std::make_pair(variables[i], ((valuation >> i) & 1) != 0));
+        }
+
+        bool fResolved = true;
+        bool fResult = false;
+        try {
+            fResult = LibBoolEE::resolve(formula, vals);
+        } catch (const std::runtime_error&) {
+            fResolved = false;
+        }
+
+        BOOST_CHECK_MESSAGE(fResolved == fCompiled, formula);
+        if (fResolved && fCompiled) {
+            BOOST_CHECK_MESSAGE(LibBoolEE::evaluate(program, valuation) == fResult, formula);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(libboolee_compile)
+{
+    const std::vector<std::string> variables = {"KYC", "ACC.1", "B_2"};
+    const std::vector<std::string> formulas = {
+        "KYC", "!KYC", "!!KYC", "KYC&ACC.1", "KYC|ACC.1", "KYC & !ACC.1 | B_2",
+        "(KYC|ACC.1)&B_2", "!(KYC&(ACC.1|!B_2))", "((KYC))", "1", "0", "KYC|0", "KYC&1",
+        "", "KYC&", "|KYC", "KYC||ACC.1", "(KYC", "KYC)", "(KYC)B_2", "KYC$ACC.1", "OTHER", "#KYC", "()",
+    };
+    for (const auto& formula : formulas) {
+        CheckCompiledMatchesResolve(formula, variables);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(libboolee_compile_random)
+{
+    const std::vector<std::string> variables = {"A", "B", "C"};
+    const std::string alphabet = "ABC01!&|() ";
+    for (int i = 0; i < 2000; i++) {
+        std::string formula;
+        int nLength = 1 + InsecureRandRange(12);
+        for (int j = 0; j < nLength; j++) {
+            formula += alphabet[InsecureRandRange(alphabet.size())];
+        }
+        CheckCompiledMatchesResolve(formula, variables);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -8,11 +8,13 @@
 #include "consensus/merkle.h"
 #include "consensus/tx_verify.h"
 #include "consensus/validation.h"
+#include "key.h"
 #include "validation.h"
 #include "smartnode/smartnode-payments.h"
 #include "miner.h"
 #include "policy/policy.h"
 #include "pubkey.h"
+#include "script/interpreter.h"
 #include "script/standard.h"
 #include "txmempool.h"
 #include "uint256.h"
@@ -531,4 +533,90 @@ BOOST_AUTO_TEST_CASE(CreateNewBlock_validity)
     fCheckpointsEnabled = true;
 }
 
+// Spend the first output of prevTx, paid to scriptPubKey, leaving nFee to the miner
+static CMutableTransaction CreateSignedSpend(const CTransaction& prevTx, const CScript& scriptPubKey, const CKey& key, CAmount nFee)
+{
+    CMutableTransaction tx;
+    tx.vin.resize(1);
+    tx.vin[0].prevout = COutPoint(prevTx.GetHash(), 0);
+    tx.vout.resize(1);
+    tx.vout[0].nValue = prevTx.vout[0].nValue - nFee;
+    tx.vout[0].scriptPubKey = scriptPubKey;
+
+    std::vector<unsigned char> vchSig;
+    uint256 hash = SignatureHash(scriptPubKey, tx, 0, SIGHASH_ALL, 0, SIGVERSION_BASE);
+    BOOST_CHECK(key.Sign(hash, vchSig));
+    vchSig.push_back((unsigned char)SIGHASH_ALL);
+    tx.vin[0].scriptSig << vchSig;
+    return tx;
+}
+
+// Test the candidate block kept by CBlockTemplateManager. The transactions
+// are signed, as candidates with appended transactions go through
+// TestBlockValidity before they are handed out.
+BOOST_FIXTURE_TEST_CASE(BlockTemplateManager_candidate, TestChain100Setup)
+{
+    CScript scriptPubKey = CScript() << ToByteVector(coinbaseKey.GetPubKey()) << OP_CHECKSIG;
+    // Mature the second coinbase as well
+    CreateAndProcessBlock({}, scriptPubKey);
+
+    TestMemPoolEntryHelper entry;
+    mempool.clear();
+    int64_t nTime = GetTime();
+    SetMockTime(nTime);
+    blockTemplateManager.Connect();
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate = blockTemplateManager.GetTemplate(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 1);
+    BOOST_CHECK(pblocktemplate->block.vtx[0]->vout[0].scriptPubKey == scriptPubKey);
+    CAmount nValueEmpty = pblocktemplate->block.vtx[0]->GetValueOut();
+
+    // Nothing changed, nothing to copy again
+    uint64_t nSequence = blockTemplateManager.GetSequence();
+    pblocktemplate = blockTemplateManager.GetTemplate(scriptPubKey);
+    BOOST_CHECK_EQUAL(blockTemplateManager.GetSequence(), nSequence);
+
+    // A new transaction is appended to the candidate, and its fee paid to the coinbase
+    CMutableTransaction tx = CreateSignedSpend(coinbaseTxns[0], scriptPubKey, coinbaseKey, 10000);
+    uint256 hashAppendedTx = tx.GetHash();
+    mempool.addUnchecked(hashAppendedTx, entry.Fee(10000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+
+    // Until the validation interval passed, the last checked copy is handed out
+    pblocktemplate = blockTemplateManager.GetTemplate(scriptPubKey);
+    BOOST_CHECK(blockTemplateManager.GetSequence() != nSequence);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 1);
+
+    SetMockTime(nTime + BLOCK_TEMPLATE_VALIDATION_INTERVAL);
+    pblocktemplate = blockTemplateManager.GetTemplate(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashAppendedTx);
+    BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[1], 10000);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx[0]->GetValueOut(), nValueEmpty + 10000);
+    BOOST_CHECK(pblocktemplate->block.hashMerkleRoot == BlockMerkleRoot(pblocktemplate->block));
+
+    // A child whose parent doesn't pay enough to be appended waits for the rebuild
+    CMutableTransaction txParent = CreateSignedSpend(coinbaseTxns[1], scriptPubKey, coinbaseKey, 0);
+    uint256 hashFreeParentTx = txParent.GetHash();
+    mempool.addUnchecked(hashFreeParentTx, entry.Fee(0).Time(GetTime()).SpendsCoinbase(true).FromTx(txParent));
+    tx = CreateSignedSpend(txParent, scriptPubKey, coinbaseKey, 50000);
+    uint256 hashChildTx = tx.GetHash();
+    mempool.addUnchecked(hashChildTx, entry.Fee(50000).Time(GetTime()).SpendsCoinbase(false).FromTx(tx));
+
+    SetMockTime(nTime + 2 * BLOCK_TEMPLATE_VALIDATION_INTERVAL);
+    pblocktemplate = blockTemplateManager.GetTemplate(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+
+    // Removing a transaction of the candidate rebuilds it, taking the package as a whole
+    mempool.removeRecursive(*pblocktemplate->block.vtx[1]);
+
+    pblocktemplate = blockTemplateManager.GetTemplate(scriptPubKey);
+    BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3);
+    BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashFreeParentTx);
+    BOOST_CHECK(pblocktemplate->block.vtx[2]->GetHash() == hashChildTx);
+
+    blockTemplateManager.Disconnect();
+    mempool.clear();
+    SetMockTime(0);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,171 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "primitives/powcache.h"
+#include "streams.h"
+#include "version.h"
+
+#include "test/test_yerbas.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(powcache_tests, BasicTestingSetup)
+
+BOOST_AUTO_TEST_CASE(powcache_insert_get)
+{
+    CPowCache cache(1000);
+    uint256 headerHash = InsecureRand256();
+    uint256 powHash = InsecureRand256();
+    uint256 result;
+
+    BOOST_CHECK(!cache.Get(headerHash, result));
+    cache.Insert(headerHash, powHash);
+    BOOST_CHECK(cache.Exists(headerHash));
+    BOOST_CHECK(cache.Get(headerHash, result) && result == powHash);
+
+    // Inserting again replaces the entry
+    uint256 powHash2 = InsecureRand256();
+    cache.Insert(headerHash, powHash2);
+    BOOST_CHECK(cache.Get(headerHash, result) && result == powHash2);
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+
+    cache.Clear();
+    BOOST_CHECK(!cache.Exists(headerHash));
+}
+
+BOOST_AUTO_TEST_CASE(powcache_serialize)
+{
+    CPowCache cache(1000);
+    std::vector<std::pair<uint256, uint256>> entries;
+    for (int i = 0; i < 100; i++) {
+        entries.emplace_back(InsecureRand256(), InsecureRand256());
+        cache.Insert(entries.back().first, entries.back().second);
+    }
+
+    CDataStream ss(SER_DISK, CLIENT_VERSION);
+    ss << cache;
+    CPowCache cache2(1000);
+    ss >> cache2;
+
+    BOOST_CHECK_EQUAL(cache2.Size(), entries.size());
+    for (const auto& entry : entries) {
+        uint256 result;
+        BOOST_CHECK(cache2.Get(entry.first, result) && result == entry.second);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(powcache_coalesce_misses)
+{
+    CPowCache cache(1000);
+    uint256 headerHash = InsecureRand256();
+    uint256 powHash = InsecureRand256();
+    std::atomic<int> nComputed{0};
+
+    std::vector<std::thread> threads;
+    std::vector<uint256> results(8);
+    for (size_t i = 0; i < results.size(); i++) {
+        threads.emplace_back([&, i] {
+            results[i] = cache.GetOrCompute(headerHash, [&] {
+                nComputed++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                return powHash;
+            });
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    BOOST_CHECK_EQUAL(nComputed, 1);
+    for (const uint256& result : results) {
+        BOOST_CHECK(result == powHash);
+    }
+
+    // A failed computation is not cached and does not block later lookups
+    uint256 headerHash2 = InsecureRand256();
+    BOOST_CHECK_THROW(cache.GetOrCompute(headerHash2, []() -> uint256 { throw std::runtime_error("failed"); }), std::runtime_error);
+    BOOST_CHECK(!cache.Exists(headerHash2));
+    BOOST_CHECK(cache.GetOrCompute(headerHash2, [&] { return powHash; }) == powHash);
+}
+
+BOOST_AUTO_TEST_CASE(powcache_log)
+{
+    fs::path pathDir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(pathDir);
+    fs::path pathLog = pathDir / "powcache.log";
+
+    std::vector<std::pair<uint256, uint256>> entries;
+    for (int i = 0; i < 3000; i++) {
+        entries.emplace_back(InsecureRand256(), InsecureRand256());
+    }
+
+    {
+        CPowCacheLog log;
+        BOOST_CHECK(log.Open(pathLog));
+        BOOST_CHECK(log.Append(std::vector<std::pair<uint256, uint256>>(entries.begin(), entries.begin() + 1000)));
+        BOOST_CHECK(log.Append(std::vector<std::pair<uint256, uint256>>(entries.begin() + 1000, entries.end())));
+        // A newer record for the same header replaces the old one
+        entries[0].second = InsecureRand256();
+        BOOST_CHECK(log.Append({entries[0]}));
+        BOOST_CHECK_EQUAL(log.RecordCount(), entries.size() + 1);
+        BOOST_CHECK_EQUAL(log.KeyCount(), entries.size());
+    }
+
+    // Simulate a torn append at the end of the file
+    {
+        FILE* file = fsbridge::fopen(pathLog, "ab");
+        fwrite("torn", 1, 4, file);
+        fclose(file);
+    }
+
+    CPowCacheLog log;
+    BOOST_CHECK(log.Open(pathLog));
+    BOOST_CHECK_EQUAL(log.KeyCount(), entries.size());
+    for (const auto& entry : entries) {
+        uint256 powHash;
+        BOOST_CHECK(log.Lookup(entry.first, powHash) && powHash == entry.second);
+    }
+    uint256 powHash;
+    BOOST_CHECK(!log.Lookup(InsecureRand256(), powHash));
+
+    // Compaction keeps the newest records only
+    BOOST_CHECK(log.Compact(1000));
+    BOOST_CHECK_EQUAL(log.RecordCount(), 1000U);
+    BOOST_CHECK(log.Lookup(entries[0].first, powHash) && powHash == entries[0].second);
+    BOOST_CHECK(log.Lookup(entries.back().first, powHash) && powHash == entries.back().second);
+    BOOST_CHECK(!log.Lookup(entries[1].first, powHash));
+
+    log.Close();
+    fs::remove_all(pathDir);
+}
+
+BOOST_AUTO_TEST_CASE(powcache_flush_to_log)
+{
+    fs::path pathDir = fs::temp_directory_path() / fs::unique_path();
+    fs::create_directories(pathDir);
+
+    uint256 headerHash = InsecureRand256();
+    uint256 powHash = InsecureRand256();
+    {
+        CPowCache cache(1000);
+        BOOST_CHECK(cache.OpenLog(pathDir / "powcache.log"));
+        cache.Insert(headerHash, powHash);
+        cache.Flush();
+    }
+
+    // A fresh cache serves the entry from the log without hashing
+    CPowCache cache(1000);
+    BOOST_CHECK(cache.OpenLog(pathDir / "powcache.log"));
+    BOOST_CHECK_EQUAL(cache.Size(), 0U);
+    BOOST_CHECK(cache.GetOrCompute(headerHash, []() -> uint256 { throw std::runtime_error("not cached"); }) == powHash);
+    BOOST_CHECK_EQUAL(cache.Size(), 1U);
+
+    fs::remove_all(pathDir);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -9,6 +9,7 @@
 #include "consensus/validation.h"
 #include "crypto/sha256.h"
 #include "fs.h"
+#include "hash_selection.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -33,12 +34,14 @@ void CConnmanTest::AddNode(CNode& node)
 {
     LOCK(g_connman->cs_vNodes);
     g_connman->vNodes.push_back(&node);
+    g_connman->mapNodesById.emplace(node.GetId(), &node);
 }
 
 void CConnmanTest::ClearNodes()
 {
     LOCK(g_connman->cs_vNodes);
     g_connman->vNodes.clear();
+    g_connman->mapNodesById.clear();
 }
 
 uint256 insecure_rand_seed = GetRandHash();
@@ -50,6 +53,7 @@ extern void noui_connect();
 BasicTestingSetup::BasicTestingSetup(const std::string& chainName)
 {
         SHA256AutoDetect();
+        GRBatchAutoDetect();
         RandomInit();
         ECC_Start();
         BLSInit();
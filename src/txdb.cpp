@@ -26,6 +26,7 @@ static const char DB_ADDRESSINDEX = 'a';
 static const char DB_ADDRESSUNSPENTINDEX = 'u';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_ADDRESSINDEXER_BEST_BLOCK = 'i';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -259,30 +260,6 @@ bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     return Read(std::make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_SPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_SPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
-        if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
-        } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
-        }
-    }
-    return WriteBatch(batch);
-}
-
 bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
@@ -309,20 +286,6 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
-    return WriteBatch(batch);
-}
-
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
-    CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
-    return WriteBatch(batch);
-}
-
 bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
@@ -357,12 +320,6 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
-    CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
-    return WriteBatch(batch);
-}
-
 bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &hashes) {
 
     std::unique_ptr<CDBIterator> pcursor(NewIterator());
@@ -383,6 +340,70 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
+bool CBlockTreeDB::WriteAddressIndexerUpdates(const std::vector<CAddressIndexerUpdate> &vUpdates, const CBlockLocator &locator) {
+    CDBBatch batch(*this);
+    for (const CAddressIndexerUpdate& update : vUpdates) {
+        for (const auto& entry : update.vAddressIndex) {
+            if (update.fEraseAddressIndex) {
+                batch.Erase(std::make_pair(DB_ADDRESSINDEX, entry.first));
+            } else {
+                batch.Write(std::make_pair(DB_ADDRESSINDEX, entry.first), entry.second);
+            }
+        }
+        for (const auto& entry : update.vAddressUnspentIndex) {
+            if (entry.second.IsNull()) {
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first));
+            } else {
+                batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, entry.first), entry.second);
+            }
+        }
+        for (const auto& entry : update.vSpentIndex) {
+            if (entry.second.IsNull()) {
+                batch.Erase(std::make_pair(DB_SPENTINDEX, entry.first));
+            } else {
+                batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+            }
+        }
+        for (const CTimestampIndexKey& key : update.vTimestampIndex) {
+            batch.Write(std::make_pair(DB_TIMESTAMPINDEX, key), 0);
+        }
+    }
+    batch.Write(DB_ADDRESSINDEXER_BEST_BLOCK, locator);
+    return WriteBatch(batch);
+}
+
+bool CBlockTreeDB::ReadAddressIndexerBestBlock(CBlockLocator &locator) {
+    return Read(DB_ADDRESSINDEXER_BEST_BLOCK, locator);
+}
+
+bool CBlockTreeDB::EraseAddressIndexes() {
+    size_t batch_size = (size_t)gArgs.GetArg("-dbbatchsize", nDefaultDbBatchSize);
+    CDBBatch batch(*this);
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    size_t count = 0;
+
+    for (char chIndex : {DB_ADDRESSINDEX, DB_ADDRESSUNSPENTINDEX, DB_SPENTINDEX, DB_TIMESTAMPINDEX}) {
+        CDataStream ssPrefix(SER_DISK, CLIENT_VERSION);
+        ssPrefix << chIndex;
+        for (pcursor->Seek(chIndex); pcursor->Valid() && pcursor->KeyHasPrefix(ssPrefix); pcursor->Next()) {
+            boost::this_thread::interruption_point();
+            batch.Erase(pcursor->GetKey());
+            count++;
+            if (batch.SizeEstimate() > batch_size) {
+                if (!WriteBatch(batch))
+                    return false;
+                batch.Clear();
+            }
+        }
+    }
+
+    // An empty locator makes the indexer start at the genesis block. It goes last, so
+    // an interrupted wipe leaves the old best block and gets wiped again on the next start.
+    batch.Write(DB_ADDRESSINDEXER_BEST_BLOCK, CBlockLocator());
+    LogPrintf("%s: erased %u address, spent and timestamp index entries\n", __func__, count);
+    return WriteBatch(batch, true);
+}
+
 bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
@@ -107,6 +107,26 @@ private:
     friend class CCoinsViewDB;
 };
 
+/** Changes to the address, spent and timestamp indexes from connecting or disconnecting one block */
+struct CAddressIndexerUpdate
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vAddressIndex;
+    //! Whether the vAddressIndex entries are erased instead of written
+    bool fEraseAddressIndex;
+    //! Null values are erased
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vAddressUnspentIndex;
+    //! Null values are erased
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpentIndex;
+    std::vector<CTimestampIndexKey> vTimestampIndex;
+
+    CAddressIndexerUpdate() : fEraseAddressIndex(false) {}
+
+    size_t Count() const
+    {
+        return vAddressIndex.size() + vAddressUnspentIndex.size() + vSpentIndex.size() + vTimestampIndex.size();
+    }
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -125,17 +145,17 @@ public:
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
-    bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
-    bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
-    bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
-    bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
-    bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
     bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, std::vector<uint256> &vect);
+    //! Apply vUpdates in order and move the address indexer to locator, atomically
+    bool WriteAddressIndexerUpdates(const std::vector<CAddressIndexerUpdate> &vUpdates, const CBlockLocator &locator);
+    bool ReadAddressIndexerBestBlock(CBlockLocator &locator);
+    //! Erase all address, spent and timestamp index entries and move the address indexer before the genesis block
+    bool EraseAddressIndexes();
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
     bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
@@ -55,6 +55,7 @@ public:
             ::Unserialize(s, VARINT(nVersionDummy));
         }
         ::Unserialize(s, REF(CTxOutCompressor(REF(txout->out))));
+        txout->UpdateAssetOutput();
     }
 
     TxInUndoDeserializer(Coin* coin) : txout(coin) {}
@@ -279,6 +279,7 @@ const CLogCategoryDesc LogCategories[] =
     {BCLog::MNSYNC, "mnsync"},
     {BCLog::PRIVATESEND, "privatesend"},
     {BCLog::SPORK, "spork"},
+    {BCLog::STRATUM, "stratum"},
     //End Yerbas
 
 };
@@ -301,7 +302,8 @@ bool GetLogCategory(uint64_t *f, const std::string *str)
                 | BCLog::MNPAYMENTS
                 | BCLog::MNSYNC
                 | BCLog::PRIVATESEND
-                | BCLog::SPORK;
+                | BCLog::SPORK
+                | BCLog::STRATUM;
             return true;
         }
         for (unsigned int i = 0; i < ARRAYLEN(LogCategories); i++) {
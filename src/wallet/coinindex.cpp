@@ -0,0 +1,123 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/coinindex.h"
+
+const std::string& CWalletCoinIndex::Coin::GetAssetName() const
+{
+    static const std::string strEmpty;
+    return assetOutput && assetOutput->fValid ? assetOutput->assetName : strEmpty;
+}
+
+CWalletCoinIndex::CWalletCoinIndex()
+{
+    Clear();
+    fDirty = true;
+}
+
+void CWalletCoinIndex::Clear()
+{
+    mapCoins.clear();
+    mapAssetCoins.clear();
+    mapTxs.clear();
+    setPendingTxs.clear();
+    nSettledBalance = 0;
+    nSettledWatchOnlyBalance = 0;
+    mapSettledAddressBalances.clear();
+    pindexSettled = nullptr;
+}
+
+void CWalletCoinIndex::AddToTotals(const Coin& coin, int nSign)
+{
+    if (coin.mine & ISMINE_SPENDABLE) {
+        nSettledBalance += nSign * coin.nValue;
+    }
+    if (coin.mine & ISMINE_WATCH_ONLY) {
+        nSettledWatchOnlyBalance += nSign * coin.nValue;
+    }
+    if (IsValidDestination(coin.dest)) {
+        mapSettledAddressBalances[coin.dest] += nSign * coin.nValue;
+    }
+}
+
+void CWalletCoinIndex::AddCoin(const COutPoint& outpoint, const Coin& coin)
+{
+    if (!mapCoins.emplace(outpoint, coin).second) {
+        return;
+    }
+    mapAssetCoins[coin.GetAssetName()].insert(outpoint);
+
+    auto it = mapTxs.emplace(outpoint.hash, false).first;
+    if (it->second) {
+        AddToTotals(coin, 1);
+    } else {
+        setPendingTxs.insert(outpoint.hash);
+    }
+}
+
+void CWalletCoinIndex::RemoveCoin(const COutPoint& outpoint)
+{
+    auto it = mapCoins.find(outpoint);
+    if (it == mapCoins.end()) {
+        return;
+    }
+
+    auto itAsset = mapAssetCoins.find(it->second.GetAssetName());
+    itAsset->second.erase(outpoint);
+    if (itAsset->second.empty()) {
+        mapAssetCoins.erase(itAsset);
+    }
+
+    auto itTx = mapTxs.find(outpoint.hash);
+    if (itTx->second) {
+        AddToTotals(it->second, -1);
+    }
+    mapCoins.erase(it);
+
+    // Coins are sorted by outpoint, so this tx has coins left if a neighbour has the same hash
+    auto itNext = mapCoins.lower_bound(COutPoint(outpoint.hash, 0));
+    if (itNext == mapCoins.end() || itNext->first.hash != outpoint.hash) {
+        mapTxs.erase(itTx);
+        setPendingTxs.erase(outpoint.hash);
+    }
+}
+
+void CWalletCoinIndex::SettleTx(const uint256& txid)
+{
+    auto itTx = mapTxs.find(txid);
+    if (itTx == mapTxs.end() || itTx->second) {
+        return;
+    }
+    itTx->second = true;
+    setPendingTxs.erase(txid);
+    for (auto it = mapCoins.lower_bound(COutPoint(txid, 0)); it != mapCoins.end() && it->first.hash == txid; ++it) {
+        AddToTotals(it->second, 1);
+    }
+}
+
+void CWalletCoinIndex::UnsettleAll()
+{
+    for (auto& pair : mapTxs) {
+        pair.second = false;
+        setPendingTxs.insert(pair.first);
+    }
+    nSettledBalance = 0;
+    nSettledWatchOnlyBalance = 0;
+    for (auto& pair : mapSettledAddressBalances) {
+        pair.second = 0;
+    }
+}
+
+void CWalletCoinIndex::AddSettledAddress(const CTxDestination& dest)
+{
+    if (IsValidDestination(dest)) {
+        mapSettledAddressBalances.emplace(dest, 0);
+    }
+}
+
+const CWalletCoinIndex::Coin* CWalletCoinIndex::GetCoin(const COutPoint& outpoint) const
+{
+    auto it = mapCoins.find(outpoint);
+    return it == mapCoins.end() ? nullptr : &it->second;
+}
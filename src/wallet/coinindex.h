@@ -0,0 +1,99 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YERB_WALLET_COININDEX_H
+#define YERB_WALLET_COININDEX_H
+
+#include "amount.h"
+#include "assets/assettypes.h"
+#include "primitives/transaction.h"
+#include "script/ismine.h"
+#include "script/standard.h"
+
+#include <map>
+#include <set>
+#include <string>
+
+class CBlockIndex;
+
+/**
+ * The wallet's unspent outputs (the ones in CWallet::setWalletUTXO) with
+ * everything the balance and coin selection queries need to know about
+ * them decoded once, split by asset name.
+ *
+ * Transactions are either settled, i.e. confirmed and mature, or pending.
+ * Settled transactions stay trusted and spendable until a reorg, so the
+ * index keeps running totals of their outputs, while queries only have to
+ * look at the pending transactions one by one.
+ */
+class CWalletCoinIndex
+{
+public:
+    /** An unspent output, its transaction is the one in mapWallet with the outpoint's hash */
+    struct Coin
+    {
+        isminetype mine;
+        CAmount nValue;
+        /** Decoded asset script, null for plain YERB outputs */
+        CAssetOutputDataRef assetOutput;
+        CTxDestination dest;
+
+        /** Asset name of valid asset outputs, empty for everything else */
+        const std::string& GetAssetName() const;
+    };
+
+    typedef std::map<COutPoint, Coin> CoinMap;
+
+private:
+    CoinMap mapCoins;
+    /** Outpoints by asset name, YERB outputs are under the empty name */
+    std::map<std::string, std::set<COutPoint>> mapAssetCoins;
+    /** Transactions with coins in the index, and whether they are settled */
+    std::map<uint256, bool> mapTxs;
+    std::set<uint256> setPendingTxs;
+
+    CAmount nSettledBalance;
+    CAmount nSettledWatchOnlyBalance;
+    /** Settled YERB per destination, kept at zero when all its coins got spent */
+    std::map<CTxDestination, CAmount> mapSettledAddressBalances;
+
+    /** Chain tip when the settled transactions were last checked */
+    const CBlockIndex* pindexSettled;
+    bool fDirty;
+
+    void AddToTotals(const Coin& coin, int nSign);
+
+public:
+    CWalletCoinIndex();
+
+    void Clear();
+    /** Have the wallet rebuild the index before its next use */
+    void SetDirty() { fDirty = true; }
+    bool IsDirty() const { return fDirty; }
+    void SetClean() { fDirty = false; }
+
+    /** Add an unspent output, it is pending until its transaction is settled */
+    void AddCoin(const COutPoint& outpoint, const Coin& coin);
+    void RemoveCoin(const COutPoint& outpoint);
+    /** Move a pending transaction and its coins to the settled totals */
+    void SettleTx(const uint256& txid);
+    /** Move all transactions back to pending, e.g. after a reorg */
+    void UnsettleAll();
+    /** List a destination in the address balances even if none of its coins are left */
+    void AddSettledAddress(const CTxDestination& dest);
+
+    const CBlockIndex* GetSettledTip() const { return pindexSettled; }
+    void SetSettledTip(const CBlockIndex* pindex) { pindexSettled = pindex; }
+
+    const CoinMap& GetCoins() const { return mapCoins; }
+    const Coin* GetCoin(const COutPoint& outpoint) const;
+    const std::map<std::string, std::set<COutPoint>>& GetAssetCoins() const { return mapAssetCoins; }
+    const std::set<uint256>& GetPendingTxs() const { return setPendingTxs; }
+
+    CAmount GetSettledBalance() const { return nSettledBalance; }
+    CAmount GetSettledWatchOnlyBalance() const { return nSettledWatchOnlyBalance; }
+    const std::map<CTxDestination, CAmount>& GetSettledAddressBalances() const { return mapSettledAddressBalances; }
+};
+
+#endif // YERB_WALLET_COININDEX_H
@@ -2621,6 +2621,13 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
             "      }\n"
             "      ,...\n"
             "    ]\n"
+            "  \"scanning\":                  (json object) current rescan details, or false if the wallet is not rescanning\n"
+            "    {\n"
+            "      \"duration\": xxxx,          (numeric) elapsed seconds since the rescan started\n"
+            "      \"progress\": x.xxxx,        (numeric) rescan progress between 0 and 1\n"
+            "      \"blocks\": xxxx,            (numeric) number of blocks scanned so far\n"
+            "      \"blocks_per_second\": xxx,  (numeric) average number of blocks scanned per second\n"
+            "    }\n"
             "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getwalletinfo", "")
@@ -2668,6 +2675,18 @@ UniValue getwalletinfo(const JSONRPCRequest& request)
         }
         obj.push_back(Pair("hdaccounts", accounts));
     }
+    if (pwallet->IsScanning()) {
+        UniValue scanning(UniValue::VOBJ);
+        int64_t nDuration = pwallet->ScanningDuration();
+        int nBlocks = pwallet->ScanningBlocks();
+        scanning.push_back(Pair("duration", nDuration / 1000));
+        scanning.push_back(Pair("progress", pwallet->ScanningProgress()));
+        scanning.push_back(Pair("blocks", nBlocks));
+        scanning.push_back(Pair("blocks_per_second", nDuration > 0 ? nBlocks * 1000.0 / nDuration : 0.0));
+        obj.push_back(Pair("scanning", scanning));
+    } else {
+        obj.push_back(Pair("scanning", false));
+    }
     return obj;
 }
 
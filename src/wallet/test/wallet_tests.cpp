@@ -14,6 +14,7 @@
 #include "test/test_yerbas.h"
 #include "validation.h"
 #include "wallet/coincontrol.h"
+#include "wallet/walletscan.h"
 #include "wallet/test/wallet_test_fixture.h"
 
 #include <boost/test/unit_test.hpp>
@@ -593,6 +594,119 @@ BOOST_AUTO_TEST_CASE(LoadReceiveRequests)
     BOOST_CHECK_EQUAL(values[1], "val_rr1");
 }
 
+BOOST_AUTO_TEST_CASE(scan_filter)
+{
+    CKey key, otherKey;
+    key.MakeNewKey(true);
+    otherKey.MakeNewKey(true);
+    CScript redeemScript = GetScriptForMultisig(1, {key.GetPubKey()});
+    CScript watchScript = CScript() << OP_RETURN << ToByteVector(otherKey.GetPubKey());
+
+    CWalletScanFilter filter;
+    BOOST_CHECK(filter.IsEmpty());
+    filter.AddKey(key.GetPubKey().GetID());
+    filter.AddScript(CScriptID(redeemScript));
+    filter.AddWatchOnly(watchScript);
+
+    BOOST_CHECK(filter.IsRelevant(GetScriptForDestination(key.GetPubKey().GetID())));
+    BOOST_CHECK(filter.IsRelevant(GetScriptForRawPubKey(key.GetPubKey())));
+    BOOST_CHECK(filter.IsRelevant(GetScriptForMultisig(1, {otherKey.GetPubKey(), key.GetPubKey()})));
+    BOOST_CHECK(filter.IsRelevant(GetScriptForDestination(CScriptID(redeemScript))));
+    BOOST_CHECK(filter.IsRelevant(watchScript));
+    BOOST_CHECK(!filter.IsRelevant(GetScriptForDestination(otherKey.GetPubKey().GetID())));
+    BOOST_CHECK(!filter.IsRelevant(GetScriptForMultisig(1, {otherKey.GetPubKey()})));
+
+    // Transactions paying to us, and anything spending them or their inputs
+    CMutableTransaction txFunding;
+    txFunding.vin.resize(1);
+    txFunding.vin[0].prevout = COutPoint(GetRandHash(), 0);
+    txFunding.vout.resize(1);
+    txFunding.vout[0].scriptPubKey = GetScriptForDestination(otherKey.GetPubKey().GetID());
+    BOOST_CHECK(!filter.IsRelevant(CTransaction(txFunding)));
+
+    CMutableTransaction txSpend;
+    txSpend.vin.resize(1);
+    txSpend.vin[0].prevout = COutPoint(txFunding.GetHash(), 0);
+    txSpend.vout.resize(1);
+    txSpend.vout[0].scriptPubKey = GetScriptForDestination(otherKey.GetPubKey().GetID());
+    CMutableTransaction txConflict;
+    txConflict.vin.resize(1);
+    txConflict.vin[0].prevout = txFunding.vin[0].prevout;
+
+    CWalletScanFilter filterTxs;
+    filterTxs.AddTx(CTransaction(txFunding));
+    BOOST_CHECK(!filterTxs.IsEmpty());
+    BOOST_CHECK(filterTxs.IsRelevant(CTransaction(txFunding)));
+    BOOST_CHECK(filterTxs.IsRelevant(CTransaction(txSpend)));
+    BOOST_CHECK(filterTxs.IsRelevant(CTransaction(txConflict)));
+    BOOST_CHECK(!filter.IsRelevant(CTransaction(txSpend)));
+
+    txSpend.vout.push_back(CTxOut(1, GetScriptForRawPubKey(key.GetPubKey())));
+    BOOST_CHECK(filter.IsRelevant(CTransaction(txSpend)));
+
+    filterTxs.Clear();
+    BOOST_CHECK(filterTxs.IsEmpty());
+    BOOST_CHECK(!filterTxs.IsRelevant(CTransaction(txSpend)));
+}
+
+BOOST_AUTO_TEST_CASE(coin_index)
+{
+    CKey key;
+    key.MakeNewKey(true);
+    CTxDestination dest = key.GetPubKey().GetID();
+
+    auto makeCoin = [&dest](isminetype mine, CAmount nValue) {
+        CWalletCoinIndex::Coin coin;
+        coin.mine = mine;
+        coin.nValue = nValue;
+        coin.dest = dest;
+        return coin;
+    };
+
+    uint256 txid1 = GetRandHash();
+    uint256 txid2 = GetRandHash();
+    CWalletCoinIndex index;
+    index.AddCoin(COutPoint(txid1, 0), makeCoin(ISMINE_SPENDABLE, 10));
+    index.AddCoin(COutPoint(txid1, 1), makeCoin(ISMINE_WATCH_SOLVABLE, 20));
+    index.AddCoin(COutPoint(txid2, 0), makeCoin(ISMINE_SPENDABLE, 40));
+    BOOST_CHECK_EQUAL(index.GetCoins().size(), 3U);
+    BOOST_CHECK_EQUAL(index.GetAssetCoins().size(), 1U);
+    BOOST_CHECK_EQUAL(index.GetAssetCoins().at("").size(), 3U);
+    BOOST_CHECK_EQUAL(index.GetPendingTxs().size(), 2U);
+    BOOST_CHECK_EQUAL(index.GetSettledBalance(), 0);
+
+    // Settled coins go into the totals, and come out of them when spent
+    index.SettleTx(txid1);
+    BOOST_CHECK_EQUAL(index.GetPendingTxs().size(), 1U);
+    BOOST_CHECK_EQUAL(index.GetSettledBalance(), 10);
+    BOOST_CHECK_EQUAL(index.GetSettledWatchOnlyBalance(), 20);
+    BOOST_CHECK_EQUAL(index.GetSettledAddressBalances().at(dest), 30);
+
+    index.AddCoin(COutPoint(txid1, 2), makeCoin(ISMINE_SPENDABLE, 5));
+    BOOST_CHECK_EQUAL(index.GetSettledBalance(), 15);
+    index.RemoveCoin(COutPoint(txid1, 0));
+    index.RemoveCoin(COutPoint(txid1, 2));
+    BOOST_CHECK_EQUAL(index.GetSettledBalance(), 0);
+    BOOST_CHECK_EQUAL(index.GetSettledAddressBalances().at(dest), 20);
+    index.RemoveCoin(COutPoint(txid1, 1));
+    BOOST_CHECK_EQUAL(index.GetSettledWatchOnlyBalance(), 0);
+    BOOST_CHECK(index.GetCoin(COutPoint(txid1, 1)) == nullptr);
+
+    // The address of spent coins stays listed
+    BOOST_CHECK_EQUAL(index.GetSettledAddressBalances().at(dest), 0);
+
+    index.SettleTx(txid2);
+    BOOST_CHECK_EQUAL(index.GetSettledBalance(), 40);
+    index.UnsettleAll();
+    BOOST_CHECK_EQUAL(index.GetSettledBalance(), 0);
+    BOOST_CHECK_EQUAL(index.GetPendingTxs().size(), 1U);
+    BOOST_CHECK_EQUAL(index.GetSettledAddressBalances().at(dest), 0);
+
+    index.Clear();
+    BOOST_CHECK(index.GetCoins().empty());
+    BOOST_CHECK(index.GetAssetCoins().empty());
+}
+
 class ListCoinsTestingSetup : public TestChain100Setup
 {
 public:
@@ -680,4 +794,36 @@ BOOST_FIXTURE_TEST_CASE(ListCoins, ListCoinsTestingSetup)
     BOOST_CHECK_EQUAL(list.begin()->second.size(), 2);
 }
 
+// Outputs whose only spender gets abandoned have to come back into the coin
+// index, and with them into the balance and the available coins.
+BOOST_FIXTURE_TEST_CASE(coin_index_abandon, ListCoinsTestingSetup)
+{
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), 500 * COIN);
+
+    // Spend the mature coinbase without broadcasting, so the spend can be abandoned
+    CWalletTx wtx;
+    CReserveKey reservekey(wallet.get());
+    CAmount fee;
+    int changePos = -1;
+    std::string error;
+    CCoinControl dummy;
+    BOOST_CHECK(wallet->CreateTransaction({CRecipient{GetScriptForRawPubKey({}), 1 * COIN, false}}, wtx, reservekey, fee, changePos, error, dummy));
+    {
+        LOCK2(cs_main, wallet->cs_wallet);
+        BOOST_CHECK(wallet->AddToWallet(wtx));
+    }
+
+    // The change isn't in the mempool, so it isn't trusted either
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), 0);
+    std::vector<COutput> available;
+    wallet->AvailableCoins(available);
+    BOOST_CHECK(available.empty());
+
+    BOOST_CHECK(wallet->AbandonTransaction(wtx.GetHash()));
+    BOOST_CHECK_EQUAL(wallet->GetBalance(), 500 * COIN);
+    wallet->AvailableCoins(available);
+    BOOST_CHECK_EQUAL(available.size(), 1U);
+    BOOST_CHECK(available[0].tx->GetHash() != wtx.GetHash());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
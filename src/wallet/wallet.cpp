@@ -18,6 +18,7 @@
 #include "key.h"
 #include "keystore.h"
 #include "validation.h"
+#include "wallet/walletscan.h"
 #include "net.h"
 #include "policy/fees.h"
 #include "policy/policy.h"
@@ -475,6 +476,7 @@ bool CWallet::RemoveWatchOnly(const CScript &dest)
     AssertLockHeld(cs_wallet);
     if (!CCryptoKeyStore::RemoveWatchOnly(dest))
         return false;
+    coinIndex.SetDirty();
     if (!HaveWatchOnly())
         NotifyWatchonlyChanged(false);
     if (!CWalletDB(*dbw).EraseWatchOnly(dest))
@@ -804,6 +806,7 @@ void CWallet::AddToSpends(const COutPoint& outpoint, const uint256& wtxid)
 {
     mapTxSpends.insert(std::make_pair(outpoint, wtxid));
     setWalletUTXO.erase(outpoint);
+    coinIndex.RemoveCoin(outpoint);
 
     std::pair<TxSpends::iterator, TxSpends::iterator> range;
     range = mapTxSpends.equal_range(outpoint);
@@ -822,6 +825,34 @@ void CWallet::AddToSpends(const uint256& wtxid)
         AddToSpends(txin.prevout, wtxid);
 }
 
+void CWallet::UpdateSpentCoins(const CWalletTx& wtx)
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+    if (wtx.IsCoinBase())
+        return;
+
+    // The outputs wtx spends are unspent again when all their spenders got abandoned or
+    // conflicted, and spent again when one of them becomes active
+    for (const CTxIn& txin : wtx.tx->vin) {
+        const COutPoint& prevout = txin.prevout;
+        auto it = mapWallet.find(prevout.hash);
+        if (it == mapWallet.end() || prevout.n >= it->second.tx->vout.size())
+            continue;
+        if (IsSpent(prevout.hash, prevout.n)) {
+            setWalletUTXO.erase(prevout);
+            coinIndex.RemoveCoin(prevout);
+            continue;
+        }
+        isminetype mine = IsMine(it->second.tx->vout[prevout.n]);
+        if (mine == ISMINE_NO)
+            continue;
+        setWalletUTXO.insert(prevout);
+        if (!coinIndex.IsDirty())
+            coinIndex.AddCoin(prevout, MakeCoinIndexEntry(it->second, prevout.n, mine));
+    }
+}
+
 bool CWallet::EncryptWallet(const SecureString& strWalletPassphrase)
 {
     if (IsCrypted())
@@ -1112,6 +1143,8 @@ void CWallet::MarkDirty()
         LOCK(cs_wallet);
         for (std::pair<const uint256, CWalletTx>& item : mapWallet)
             item.second.MarkDirty();
+        // Keys may have been added, so outputs may now be ours
+        coinIndex.SetDirty();
     }
 
     fAnonymizableTallyCached = false;
@@ -1141,8 +1174,12 @@ bool CWallet::AddToWallet(const CWalletTx& wtxIn, bool fFlushOnClose)
 
         auto mnList = deterministicMNManager->GetListAtChainTip();
         for(unsigned int i = 0; i < wtx.tx->vout.size(); ++i) {
-            if (IsMine(wtx.tx->vout[i]) && !IsSpent(hash, i)) {
+            isminetype mine = IsMine(wtx.tx->vout[i]);
+            if (mine != ISMINE_NO && !IsSpent(hash, i)) {
                 setWalletUTXO.insert(COutPoint(hash, i));
+                if (!coinIndex.IsDirty()) {
+                    coinIndex.AddCoin(COutPoint(hash, i), MakeCoinIndexEntry(wtx, i, mine));
+                }
                 if (deterministicMNManager->IsProTxWithCollateral(wtx.tx, i) || mnList.HasMNByCollateral(COutPoint(hash, i))) {
                     LockCoin(COutPoint(hash, i));
                 }
@@ -1361,6 +1398,7 @@ bool CWallet::AbandonTransaction(const uint256& hashTx)
                 if (mapWallet.count(txin.prevout.hash))
                     mapWallet[txin.prevout.hash].MarkDirty();
             }
+            UpdateSpentCoins(wtx);
         }
     }
 
@@ -1425,6 +1463,7 @@ void CWallet::MarkConflicted(const uint256& hashBlock, const uint256& hashTx)
                 if (mapWallet.count(txin.prevout.hash))
                     mapWallet[txin.prevout.hash].MarkDirty();
             }
+            UpdateSpentCoins(wtx);
         }
     }
 
@@ -1446,6 +1485,7 @@ void CWallet::SyncTransaction(const CTransactionRef& ptx, const CBlockIndex *pin
         if (mapWallet.count(txin.prevout.hash))
             mapWallet[txin.prevout.hash].MarkDirty();
     }
+    UpdateSpentCoins(mapWallet.at(tx.GetHash()));
 
     fAnonymizableTallyCached = false;
     fAnonymizableTallyCachedNonDenom = false;
@@ -1552,9 +1592,10 @@ CAmount CWallet::GetDebit(const CTxIn &txin, const isminefilter& filter, CAssetO
             const CWalletTx& prev = (*mi).second;
             if (txin.prevout.n < prev.tx->vout.size())
                 if (IsMine(prev.tx->vout[txin.prevout.n]) & filter) {
-                    // if asset get that assets data from the scriptPubKey
-                    if (prev.tx->vout[txin.prevout.n].scriptPubKey.IsAssetScript())
-                        if (GetAssetData(prev.tx->vout[txin.prevout.n].scriptPubKey, assetData))
+                    // if asset get that assets data from the decoded scriptPubKey
+                    const CAssetOutputData* assetOutput = prev.GetAssetOutput(txin.prevout.n);
+                    if (assetOutput)
+                        if (GetAssetData(*assetOutput, assetData))
                             return prev.tx->vout[txin.prevout.n].nValue;
                 }
         }
@@ -2011,10 +2052,11 @@ void CWalletTx::GetAmounts(std::list<COutputEntry>& listReceived,
 
         /** YERB START */
         if (AreAssetsDeployed()) {
-            if (txout.scriptPubKey.IsAssetScript()) {
+            const CAssetOutputData* assetOutput = GetAssetOutput(i);
+            if (assetOutput) {
                 CAssetOutputEntry assetoutput;
                 assetoutput.vout = i;
-                GetAssetData(txout.scriptPubKey, assetoutput);
+                GetAssetData(*assetOutput, assetoutput);
 
                 // The only asset type we send is transfer_asset. We need to skip all other types for the sent category
                 if (nDebit > 0 && assetoutput.type == TX_TRANSFER_ASSET)
@@ -2057,11 +2099,53 @@ int64_t CWallet::RescanFromTime(int64_t startTime, bool update)
     return startTime;
 }
 
+size_t CWallet::GetScanKeyCount() const
+{
+    AssertLockHeld(cs_wallet);
+    LOCK(cs_KeyStore);
+    // Every key added by the keypool or an import gets metadata
+    return mapKeyMetadata.size() + mapHdPubKeys.size() + mapScripts.size() + setWatchOnly.size();
+}
+
+std::shared_ptr<const CWalletScanFilter> CWallet::BuildScanFilter() const
+{
+    AssertLockHeld(cs_wallet);
+    auto filter = std::make_shared<CWalletScanFilter>();
+
+    std::set<CKeyID> setKeyIds;
+    GetKeys(setKeyIds);
+    for (const CKeyID& keyid : setKeyIds) {
+        filter->AddKey(keyid);
+    }
+    for (const auto& pair : mapHdPubKeys) {
+        filter->AddKey(pair.first);
+    }
+    {
+        LOCK(cs_KeyStore);
+        for (const auto& pair : mapScripts) {
+            filter->AddScript(pair.first);
+        }
+        for (const CScript& script : setWatchOnly) {
+            filter->AddWatchOnly(script);
+        }
+    }
+    for (const auto& pair : mapWallet) {
+        filter->AddTx(*pair.second.tx);
+    }
+    return filter;
+}
+
 /**
  * Scan the block chain (starting in pindexStart) for transactions
  * from or to us. If fUpdate is true, found transactions that already
  * exist in the wallet will be updated.
  *
+ * Blocks are read and matched against a snapshot of the wallet's keys and
+ * transactions by a CWalletScanQueue, ahead of the loop below which only
+ * passes the matching transactions to AddToWalletIfInvolvingMe, in chain
+ * order. Transactions added since the snapshot are matched here, and the
+ * snapshot is rebuilt when the keys changed, e.g. by a keypool top up.
+ *
  * Returns null if scan was successful. Otherwise, if a complete rescan was not
  * possible (due to pruning or corruption), returns pointer to the most recent
  * block that could not be scanned.
@@ -2073,40 +2157,132 @@ CBlockIndex* CWallet::ScanForWalletTransactions(CBlockIndex* pindexStart, bool f
 
     CBlockIndex* pindex = pindexStart;
     CBlockIndex* ret = nullptr;
+
+    fAbortRescan = false;
+    fScanningWallet = true;
+    nScanningStartTime = GetTimeMillis();
+    dScanningProgress = 0;
+    nScanningBlocks = 0;
+
+    ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
+
+    std::shared_ptr<const CWalletScanFilter> filter;
+    // Transactions added by the scan which filter does not know about yet
+    CWalletScanFilter filterAdded;
+    size_t nScanKeys;
+    size_t nWalletTxs;
+    double dProgressStart;
+    double dProgressTip;
     {
         LOCK2(cs_main, cs_wallet);
-        fAbortRescan = false;
-        fScanningWallet = true;
+        filter = BuildScanFilter();
+        nScanKeys = GetScanKeyCount();
+        nWalletTxs = mapWallet.size();
+        dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
+        dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
+    }
 
-        ShowProgress(_("Rescanning..."), 0); // show rescan progress in GUI as dialog or on splashscreen, if -rescan on startup
-        double dProgressStart = GuessVerificationProgress(chainParams.TxData(), pindex);
-        double dProgressTip = GuessVerificationProgress(chainParams.TxData(), chainActive.Tip());
-        while (pindex && !fAbortRescan)
-        {
-            if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0)
-                ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)((GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart) * 100))));
-            if (GetTime() >= nNow + 60) {
-                nNow = GetTime();
-                LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+    int nThreads = std::max(1, std::min(GetNumCores(), MAX_RESCAN_THREADS));
+    CWalletScanQueue queue(chainParams.GetConsensus(), filter, nThreads);
+    // Last block handed to the queue
+    CBlockIndex* pindexPushed = nullptr;
+
+    while (pindex && !fAbortRescan)
+    {
+        if (queue.Size() < (size_t)RESCAN_READ_AHEAD / 2) {
+            LOCK2(cs_main, cs_wallet);
+            // Someone else added transactions, they might be spent by the blocks to come
+            if (mapWallet.size() != nWalletTxs) {
+                filter = BuildScanFilter();
+                filterAdded.Clear();
+                nScanKeys = GetScanKeyCount();
+                nWalletTxs = mapWallet.size();
+                queue.SetFilter(filter);
+            }
+            CBlockIndex* pindexNext = pindexPushed ? chainActive.Next(pindexPushed) : pindex;
+            if (pindexPushed && !chainActive.Contains(pindexPushed)) {
+                // Reorged, the blocks of the old branch are skipped when they come out of the queue
+                pindexNext = chainActive.Next(chainActive.FindFork(pindexPushed));
             }
+            for (; pindexNext && queue.Size() < (size_t)RESCAN_READ_AHEAD; pindexNext = chainActive.Next(pindexNext)) {
+                queue.Push(pindexNext);
+                pindexPushed = pindexNext;
+            }
+        }
+
+        CWalletScanQueue::Result result;
+        if (!queue.Pop(result)) {
+            pindex = nullptr;
+            break;
+        }
+        pindex = result.pindex;
+
+        if (pindex->nHeight % 100 == 0 && dProgressTip - dProgressStart > 0.0) {
+            dScanningProgress = (GuessVerificationProgress(chainParams.TxData(), pindex) - dProgressStart) / (dProgressTip - dProgressStart);
+            ShowProgress(_("Rescanning..."), std::max(1, std::min(99, (int)(dScanningProgress * 100))));
+        }
+        if (GetTime() >= nNow + 60) {
+            nNow = GetTime();
+            LogPrintf("Still rescanning. At block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+        }
+        nScanningBlocks++;
+
+        if (!result.fRead) {
+            ret = pindex;
+            continue;
+        }
 
-            CBlock block;
-            if (ReadBlockFromDisk(block, pindex, Params().GetConsensus())) {
-                for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
-                    AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate);
+        const CBlock& block = *result.pblock;
+        std::vector<uint32_t> vMatches;
+        if (result.filter != filter) {
+            // Read before the last rebuild of the filter, match it again
+            for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                if (filter->IsRelevant(*block.vtx[posInBlock])) {
+                    vMatches.push_back(posInBlock);
+                }
+            }
+        } else if (!filterAdded.IsEmpty()) {
+            // filterAdded only holds transactions, so this is just a few lookups per input
+            auto it = result.vMatches.begin();
+            for (size_t posInBlock = 0; posInBlock < block.vtx.size(); ++posInBlock) {
+                if (it != result.vMatches.end() && *it == posInBlock) {
+                    vMatches.push_back(posInBlock);
+                    ++it;
+                } else if (filterAdded.IsRelevant(*block.vtx[posInBlock])) {
+                    vMatches.push_back(posInBlock);
                 }
-            } else {
-                ret = pindex;
             }
-            pindex = chainActive.Next(pindex);
+        } else {
+            vMatches = std::move(result.vMatches);
         }
-        if (pindex && fAbortRescan) {
-            LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+        if (vMatches.empty()) {
+            continue;
         }
-        ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
 
-        fScanningWallet = false;
+        LOCK2(cs_main, cs_wallet);
+        if (!chainActive.Contains(pindex)) {
+            continue;
+        }
+        for (uint32_t posInBlock : vMatches) {
+            if (AddToWalletIfInvolvingMe(block.vtx[posInBlock], pindex, posInBlock, fUpdate)) {
+                filterAdded.AddTx(*block.vtx[posInBlock]);
+            }
+        }
+        if (GetScanKeyCount() != nScanKeys) {
+            // The keypool was topped up, the blocks already read have to be matched again
+            filter = BuildScanFilter();
+            filterAdded.Clear();
+            nScanKeys = GetScanKeyCount();
+            queue.SetFilter(filter);
+        }
+        nWalletTxs = mapWallet.size();
     }
+    if (pindex && fAbortRescan) {
+        LogPrintf("Rescan aborted at block %d. Progress=%f\n", pindex->nHeight, GuessVerificationProgress(chainParams.TxData(), pindex));
+    }
+    ShowProgress(_("Rescanning..."), 100); // hide progress dialog in GUI
+
+    fScanningWallet = false;
     return ret;
 }
 
@@ -2414,6 +2590,23 @@ CAmount CWalletTx::GetChange() const
     return nChangeCached;
 }
 
+const CAssetOutputData* CWalletTx::GetAssetOutput(unsigned int n) const
+{
+    return GetAssetOutputRef(n).get();
+}
+
+CAssetOutputDataRef CWalletTx::GetAssetOutputRef(unsigned int n) const
+{
+    if (!fAssetOutputsCached) {
+        vAssetOutputsCached.clear();
+        vAssetOutputsCached.reserve(tx->vout.size());
+        for (const CTxOut& txout : tx->vout)
+            vAssetOutputsCached.push_back(DecodeAssetOutput(txout.scriptPubKey));
+        fAssetOutputsCached = true;
+    }
+    return n < vAssetOutputsCached.size() ? vAssetOutputsCached[n] : nullptr;
+}
+
 bool CWalletTx::InMempool() const
 {
     LOCK(mempool.cs);
@@ -2542,15 +2735,103 @@ std::unordered_set<const CWalletTx*, WalletTxHasher> CWallet::GetSpendableTXs()
     return ret;
 }
 
+CWalletCoinIndex::Coin CWallet::MakeCoinIndexEntry(const CWalletTx& wtx, unsigned int n, isminetype mine) const
+{
+    CWalletCoinIndex::Coin coin;
+    coin.mine = mine;
+    coin.nValue = wtx.tx->vout[n].nValue;
+    coin.assetOutput = wtx.GetAssetOutputRef(n);
+    ExtractDestination(wtx.tx->vout[n].scriptPubKey, coin.dest);
+    return coin;
+}
+
+bool CWallet::IsCoinIndexSettled(const CWalletTx& wtx) const
+{
+    return wtx.GetDepthInMainChain() >= 1 && wtx.GetBlocksToMaturity() == 0;
+}
+
+void CWallet::UpdateCoinIndex() const
+{
+    AssertLockHeld(cs_main);
+    AssertLockHeld(cs_wallet);
+
+    if (coinIndex.IsDirty()) {
+        coinIndex.Clear();
+        for (const COutPoint& outpoint : setWalletUTXO) {
+            auto it = mapWallet.find(outpoint.hash);
+            if (it == mapWallet.end() || outpoint.n >= it->second.tx->vout.size() || IsSpent(outpoint.hash, outpoint.n))
+                continue;
+            isminetype mine = IsMine(it->second.tx->vout[outpoint.n]);
+            if (mine != ISMINE_NO) {
+                coinIndex.AddCoin(outpoint, MakeCoinIndexEntry(it->second, outpoint.n, mine));
+            }
+        }
+        // Addresses whose coins were all spent are still listed with a zero balance
+        for (const auto& pair : mapWallet) {
+            const CWalletTx& wtx = pair.second;
+            if (!IsCoinIndexSettled(wtx))
+                continue;
+            for (unsigned int i = 0; i < wtx.tx->vout.size(); i++) {
+                CTxDestination dest;
+                if (!coinIndex.GetCoin(COutPoint(pair.first, i)) && IsMine(wtx.tx->vout[i]) && ExtractDestination(wtx.tx->vout[i].scriptPubKey, dest)) {
+                    coinIndex.AddSettledAddress(dest);
+                }
+            }
+        }
+        coinIndex.SetClean();
+    } else if (coinIndex.GetSettledTip() && !chainActive.Contains(coinIndex.GetSettledTip())) {
+        // Reorged, confirmations and maturity may have gone back, and spenders
+        // conflicted by a block of the old branch count again
+        coinIndex.UnsettleAll();
+        std::vector<COutPoint> vSpent;
+        for (const auto& pair : coinIndex.GetCoins()) {
+            if (IsSpent(pair.first.hash, pair.first.n)) {
+                vSpent.push_back(pair.first);
+            }
+        }
+        for (const COutPoint& outpoint : vSpent) {
+            coinIndex.RemoveCoin(outpoint);
+        }
+    }
+
+    std::vector<uint256> vSettled;
+    for (const uint256& txid : coinIndex.GetPendingTxs()) {
+        auto it = mapWallet.find(txid);
+        if (it != mapWallet.end() && IsCoinIndexSettled(it->second)) {
+            vSettled.push_back(txid);
+        }
+    }
+    for (const uint256& txid : vSettled) {
+        coinIndex.SettleTx(txid);
+    }
+    coinIndex.SetSettledTip(chainActive.Tip());
+}
+
+std::vector<const CWalletTx*> CWallet::GetPendingCoinTXs() const
+{
+    UpdateCoinIndex();
+
+    std::vector<const CWalletTx*> ret;
+    ret.reserve(coinIndex.GetPendingTxs().size());
+    for (const uint256& txid : coinIndex.GetPendingTxs()) {
+        auto it = mapWallet.find(txid);
+        if (it != mapWallet.end()) {
+            ret.push_back(&it->second);
+        }
+    }
+    return ret;
+}
+
 CAmount CWallet::GetBalance() const
 {
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto pcoin : GetSpendableTXs()) {
+        for (auto pcoin : GetPendingCoinTXs()) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableCredit();
         }
+        nTotal += coinIndex.GetSettledBalance();
     }
 
     return nTotal;
@@ -2659,7 +2940,7 @@ CAmount CWallet::GetUnconfirmedBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto pcoin : GetSpendableTXs()) {
+        for (auto pcoin : GetPendingCoinTXs()) {
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableCredit();
         }
@@ -2672,7 +2953,7 @@ CAmount CWallet::GetImmatureBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto pcoin : GetSpendableTXs()) {
+        for (auto pcoin : GetPendingCoinTXs()) {
             nTotal += pcoin->GetImmatureCredit();
         }
     }
@@ -2684,10 +2965,11 @@ CAmount CWallet::GetWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto pcoin : GetSpendableTXs()) {
+        for (auto pcoin : GetPendingCoinTXs()) {
             if (pcoin->IsTrusted())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
+        nTotal += coinIndex.GetSettledWatchOnlyBalance();
     }
 
     return nTotal;
@@ -2698,7 +2980,7 @@ CAmount CWallet::GetUnconfirmedWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto pcoin : GetSpendableTXs()) {
+        for (auto pcoin : GetPendingCoinTXs()) {
             if (!pcoin->IsTrusted() && pcoin->GetDepthInMainChain() == 0 && !pcoin->IsLockedByInstantSend() && pcoin->InMempool())
                 nTotal += pcoin->GetAvailableWatchOnlyCredit();
         }
@@ -2711,7 +2993,7 @@ CAmount CWallet::GetImmatureWatchOnlyBalance() const
     CAmount nTotal = 0;
     {
         LOCK2(cs_main, cs_wallet);
-        for (auto pcoin : GetSpendableTXs()) {
+        for (auto pcoin : GetPendingCoinTXs()) {
             nTotal += pcoin->GetImmatureWatchOnlyCredit();
         }
     }
@@ -2810,65 +3092,92 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
     SmartnodeCollaterals collaterals = Params().GetConsensus().nCollaterals;
     {
         LOCK2(cs_main, cs_wallet);
+        UpdateCoinIndex();
 
         CAmount nTotal = 0;
         
         bool fYERBLimitHit = false;
-        // A set of the hashes that have already been used
-        std::set<uint256> usedMempoolHashes;
 
         std::map<std::string, CAmount> mapAssetTotals;
-        std::map<uint256, COutPoint> mapOutPoints;
         std::set<std::string> setAssetMaxFound;
 
-        for (auto pcoin : GetSpendableTXs()) {
-            const uint256& wtxid = pcoin->GetHash();
+        // The coins of a transaction are next to each other, so its checks only run once
+        const CWalletTx* pcoinLast = nullptr;
+        bool fTxUsable = false;
+        int nDepth = 0;
+        bool safeTx = false;
 
-            if (!CheckFinalTx(*pcoin))
+        // Plain YERB coins are indexed under the empty asset name
+        for (const auto& assetCoins : coinIndex.GetAssetCoins()) {
+            if (assetCoins.first.empty() ? !fGetYERB : !fGetAssets)
                 continue;
-
-            if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
+            if (!assetCoins.first.empty() && (!AreAssetsDeployed() || setAssetMaxFound.count(assetCoins.first)))
                 continue;
 
-            int nDepth = pcoin->GetDepthInMainChain();
+            for (const COutPoint& outpoint : assetCoins.second) {
+                const CWalletCoinIndex::Coin& coin = *coinIndex.GetCoin(outpoint);
+                const uint256& wtxid = outpoint.hash;
+                const CWalletTx* pcoin = pcoinLast;
+                if (!pcoin || pcoin->GetHash() != wtxid) {
+                    auto itWtx = mapWallet.find(wtxid);
+                    if (itWtx == mapWallet.end())
+                        continue;
+                    pcoin = &itWtx->second;
+                }
+                unsigned int i = outpoint.n;
 
-            // We should not consider coins which aren't at least in our mempool
-            // It's possible for these to be conflicted via ancestors which we may never be able to detect
-            if (nDepth == 0 && !pcoin->InMempool())
-                continue;
+                if (pcoin != pcoinLast) {
+                    pcoinLast = pcoin;
+                    fTxUsable = false;
 
-            bool safeTx = pcoin->IsTrusted();
+                    if (!CheckFinalTx(*pcoin))
+                        continue;
 
-            if (fOnlySafe && !safeTx) {
-                continue;
-            }
+                    if (pcoin->IsCoinBase() && pcoin->GetBlocksToMaturity() > 0)
+                        continue;
+
+                    nDepth = pcoin->GetDepthInMainChain();
+
+                    // We should not consider coins which aren't at least in our mempool
+                    // It's possible for these to be conflicted via ancestors which we may never be able to detect
+                    if (nDepth == 0 && !pcoin->InMempool())
+                        continue;
+
+                    safeTx = pcoin->IsTrusted();
+
+                    if (fOnlySafe && !safeTx) {
+                        continue;
+                    }
+
+                    if (nDepth < nMinDepth || nDepth > nMaxDepth)
+                        continue;
+
+                    fTxUsable = true;
+                }
+                if (!fTxUsable)
+                    continue;
 
-            if (nDepth < nMinDepth || nDepth > nMaxDepth)
-                continue;
-            for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++) {
                 bool found = false;
                 if(nCoinType == CoinType::ONLY_DENOMINATED) {
-                    found = CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
+                    found = CPrivateSend::IsDenominatedAmount(coin.nValue);
                 } else if(nCoinType == CoinType::ONLY_NONDENOMINATED) {
-                    if (CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue)) continue; // do not use collateral amounts
-                    found = !CPrivateSend::IsDenominatedAmount(pcoin->tx->vout[i].nValue);
+                    if (CPrivateSend::IsCollateralAmount(coin.nValue)) continue; // do not use collateral amounts
+                    found = !CPrivateSend::IsDenominatedAmount(coin.nValue);
                 } else if(nCoinType == CoinType::SMARTNODE_COLLATERAL) {
-                    found = collaterals.isValidCollateral(pcoin->tx->vout[i].nValue);
+                    found = collaterals.isValidCollateral(coin.nValue);
                 } else if(nCoinType == CoinType::ONLY_PRIVATESEND_COLLATERAL) {
-                    found = CPrivateSend::IsCollateralAmount(pcoin->tx->vout[i].nValue);
+                    found = CPrivateSend::IsCollateralAmount(coin.nValue);
                 } else {
                     found = true;
                 }
                 if(!found) continue;
 
-                int nType;
-                bool fIsOwner;
-                bool isAssetScript = pcoin->tx->vout[i].scriptPubKey.IsAssetScript(nType, fIsOwner);
+                bool isAssetScript = coin.assetOutput != nullptr;
                 
-                if (!isAssetScript && (pcoin->tx->vout[i].nValue < nMinimumAmount || pcoin->tx->vout[i].nValue > nMaximumAmount))
+                if (!isAssetScript && (coin.nValue < nMinimumAmount || coin.nValue > nMaximumAmount))
                     continue;
 
-                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(COutPoint(wtxid, i)))
+                if (coinControl && coinControl->HasSelected() && !coinControl->fAllowOtherInputs && !coinControl->IsSelected(outpoint))
                     continue;
 
                 if (IsLockedCoin(wtxid, i) && nCoinType != CoinType::SMARTNODE_COLLATERAL)
@@ -2877,11 +3186,7 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
                 if (IsSpent(wtxid, i))
                     continue;
 
-                isminetype mine = IsMine(pcoin->tx->vout[i]);
-
-                if (mine == ISMINE_NO) {
-                    continue;
-                }
+                isminetype mine = coin.mine;
 
                 bool fSpendableIn = ((mine & ISMINE_SPENDABLE) != ISMINE_NO) || (coinControl && coinControl->fAllowWatchOnly && (mine & ISMINE_WATCH_SOLVABLE) != ISMINE_NO);
                 bool fSolvableIn = (mine & (ISMINE_SPENDABLE | ISMINE_WATCH_SOLVABLE)) != ISMINE_NO;
@@ -2891,15 +3196,15 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
                 // Looking for Asset Tx OutPoints Only
                 if (fGetAssets && AreAssetsDeployed() && isAssetScript) {
                     
-                    CAssetOutputEntry output_data;
-                    if (!GetAssetData(pcoin->tx->vout[i].scriptPubKey, output_data))
+                    if (!coin.assetOutput->fValid)
                         continue;
 
-                    address = EncodeDestination(output_data.destination);
+                    const CAssetOutputData& output_data = *coin.assetOutput;
+                    address = output_data.strAddress;
 
                     // If we already have the maximum amount or size for this asset, skip it
                     if (setAssetMaxFound.count(output_data.assetName))
-                        continue;
+                        break;
 
                     if (IsAssetNameAnRestricted(output_data.assetName)) {
                         if (passets->CheckForAddressRestriction(output_data.assetName, address, true)) {
@@ -2907,19 +3212,9 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
                         }
                     }
 
-                    // Initialize the map vector is it doesn't exist yet
-                    if (!mapAssetCoins.count(output_data.assetName)) {
-                        std::vector<COutput> vOutput;
-                        mapAssetCoins.insert(std::make_pair(output_data.assetName, vOutput));
-                    }
-
                     // Add the COutput to the map of available Asset Coins
-                    mapAssetCoins.at(output_data.assetName).push_back(
-                            COutput(pcoin, i, nDepth, fSpendableIn, fSolvableIn, safeTx));
-
-                    // Initialize the map of current asset totals
-                    if (!mapAssetTotals.count(output_data.assetName))
-                        mapAssetTotals[output_data.assetName] = 0;
+                    std::vector<COutput>& vAssetCoins = mapAssetCoins[output_data.assetName];
+                    vAssetCoins.push_back(COutput(pcoin, i, nDepth, fSpendableIn, fSolvableIn, safeTx));
 
                     // Update the map of totals depending the which type of asset tx we are looking at
                     mapAssetTotals[output_data.assetName] += output_data.nAmount;
@@ -2931,7 +3226,7 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
                     }
 
                     // Checks the maximum number of UTXO's, and addes to set of of asset that we found the max for
-                    if (nMaximumCount > 0 && mapAssetCoins[output_data.assetName].size() >= nMaximumCount) {
+                    if (nMaximumCount > 0 && vAssetCoins.size() >= nMaximumCount) {
                         setAssetMaxFound.insert(output_data.assetName);
                     }
                 }
@@ -2947,7 +3242,7 @@ void CWallet::AvailableCoinsAll(std::vector<COutput>& vCoins, std::map<std::stri
 
                     // Checks the sum amount of all UTXO's.
                     if (nMinimumSumAmount != MAX_MONEY) {
-                        nTotal += pcoin->tx->vout[i].nValue;
+                        nTotal += coin.nValue;
 
                         if (nTotal >= nMinimumSumAmount) {
                             return;
@@ -5416,6 +5711,8 @@ DBErrors CWallet::ZapSelectTx(std::vector<uint256>& vHashIn, std::vector<uint256
     DBErrors nZapSelectTxRet = CWalletDB(*dbw,"cr+").ZapSelectTx(vHashIn, vHashOut);
     for (uint256 hash : vHashOut)
         mapWallet.erase(hash);
+    // the index still has the coins of the erased transactions
+    coinIndex.SetDirty();
 
     if (nZapSelectTxRet == DB_NEED_REWRITE)
     {
@@ -5775,11 +6072,12 @@ std::map<CTxDestination, CAmount> CWallet::GetAddressBalances()
     std::map<CTxDestination, CAmount> balances;
 
     {
-        LOCK(cs_wallet);
-        for (const auto& walletEntry : mapWallet)
-        {
-            const CWalletTx *pcoin = &walletEntry.second;
+        LOCK2(cs_main, cs_wallet);
+        std::vector<const CWalletTx*> vPending = GetPendingCoinTXs();
+        balances = coinIndex.GetSettledAddressBalances();
 
+        for (const CWalletTx* pcoin : vPending)
+        {
             if (!pcoin->IsTrusted())
                 continue;
 
@@ -5790,19 +6088,12 @@ std::map<CTxDestination, CAmount> CWallet::GetAddressBalances()
             if ((nDepth < (pcoin->IsFromMe(ISMINE_ALL) ? 0 : 1)) && !pcoin->IsLockedByInstantSend())
                 continue;
 
+            const uint256& hash = pcoin->GetHash();
             for (unsigned int i = 0; i < pcoin->tx->vout.size(); i++)
             {
-                CTxDestination addr;
-                if (!IsMine(pcoin->tx->vout[i]))
-                    continue;
-                if(!ExtractDestination(pcoin->tx->vout[i].scriptPubKey, addr))
-                    continue;
-
-                CAmount n = IsSpent(walletEntry.first, i) ? 0 : pcoin->tx->vout[i].nValue;
-
-                if (!balances.count(addr))
-                    balances[addr] = 0;
-                balances[addr] += n;
+                const CWalletCoinIndex::Coin* coin = coinIndex.GetCoin(COutPoint(hash, i));
+                if (coin && IsValidDestination(coin->dest))
+                    balances[coin->dest] += coin->nValue;
             }
         }
     }
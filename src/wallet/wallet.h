@@ -20,6 +20,7 @@
 #include "validationinterface.h"
 #include "script/ismine.h"
 #include "wallet/coincontrol.h"
+#include "wallet/coinindex.h"
 #include "wallet/crypter.h"
 #include "wallet/walletdb.h"
 #include "wallet/rpcwallet.h"
@@ -90,6 +91,7 @@ class CScheduler;
 class CTxMemPool;
 class CBlockPolicyEstimator;
 class CWalletTx;
+class CWalletScanFilter;
 struct FeeCalculation;
 enum class FeeEstimateMode;
 
@@ -377,6 +379,8 @@ public:
     mutable CAmount nImmatureWatchCreditCached;
     mutable CAmount nAvailableWatchCreditCached;
     mutable CAmount nChangeCached;
+    mutable bool fAssetOutputsCached;
+    mutable std::vector<CAssetOutputDataRef> vAssetOutputsCached;
 
     CWalletTx()
     {
@@ -422,9 +426,17 @@ public:
         nAvailableWatchCreditCached = 0;
         nImmatureWatchCreditCached = 0;
         nChangeCached = 0;
+        fAssetOutputsCached = false;
+        vAssetOutputsCached.clear();
         nOrderPos = -1;
     }
 
+    void SetTx(CTransactionRef arg)
+    {
+        CMerkleTx::SetTx(std::move(arg));
+        fAssetOutputsCached = false;
+    }
+
     ADD_SERIALIZE_METHODS;
 
     template <typename Stream, typename Operation>
@@ -505,6 +517,11 @@ public:
     CAmount GetAvailableWatchOnlyCredit(const bool& fUseCache=true) const;
     CAmount GetChange() const;
 
+    //! Decoded asset fields of output n, nullptr if it isn't an asset output
+    const CAssetOutputData* GetAssetOutput(unsigned int n) const;
+    //! Same as GetAssetOutput, sharing the cached entry
+    CAssetOutputDataRef GetAssetOutputRef(unsigned int n) const;
+
     CAmount GetAnonymizedCredit(bool fUseCache=true) const;
     CAmount GetDenominatedCredit(bool unconfirmed, bool fUseCache=true) const;
 
@@ -726,6 +743,9 @@ private:
     static std::atomic<bool> fFlushScheduled;
     std::atomic<bool> fAbortRescan;
     std::atomic<bool> fScanningWallet;
+    std::atomic<int64_t> nScanningStartTime;
+    std::atomic<double> dScanningProgress;
+    std::atomic<int> nScanningBlocks;
 
     /**
      * Select a set of coins such that nValueRet >= nTargetValue and at least
@@ -735,6 +755,11 @@ private:
     bool SelectCoins(const std::vector<COutput>& vAvailableCoins, const CAmount& nTargetValue, std::set<CInputCoin>& setCoinsRet, CAmount& nValueRet, const CCoinControl *coinControl = nullptr) const;
     bool SelectAssets(const std::map<std::string, std::vector<COutput> >& mapAvailableAssets, const std::map<std::string, CAmount>& mapAssetTargetValue, std::set<CInputCoin>& setCoinsRet, std::map<std::string, CAmount>& nValueRet) const;
 
+    /** Snapshot of the keys and transactions a rescan looks for */
+    std::shared_ptr<const CWalletScanFilter> BuildScanFilter() const;
+    /** Changes whenever keys, scripts or watch-only scripts are added */
+    size_t GetScanKeyCount() const;
+
     CWalletDB *pwalletdbEncryption;
 
     //! the current wallet version: clients below this version are not able to load the wallet
@@ -761,8 +786,19 @@ private:
     TxSpends mapTxSpends;
     void AddToSpends(const COutPoint& outpoint, const uint256& wtxid);
     void AddToSpends(const uint256& wtxid);
+    /** Bring the outputs spent by wtx back into setWalletUTXO and the coin index, or take them out, after its state changed */
+    void UpdateSpentCoins(const CWalletTx& wtx);
 
     std::set<COutPoint> setWalletUTXO;
+    /** setWalletUTXO decoded for the balance and coin queries, brought up to date by UpdateCoinIndex */
+    mutable CWalletCoinIndex coinIndex;
+
+    CWalletCoinIndex::Coin MakeCoinIndexEntry(const CWalletTx& wtx, unsigned int n, isminetype mine) const;
+    /** Confirmed and mature, so it stays trusted until a reorg */
+    bool IsCoinIndexSettled(const CWalletTx& wtx) const;
+    void UpdateCoinIndex() const;
+    /** Update the coin index and return the transactions with unspent outputs that are not settled */
+    std::vector<const CWalletTx*> GetPendingCoinTXs() const;
 
     /* Mark a transaction (and its in-wallet descendants) as conflicting with a particular block. */
     void MarkConflicted(const uint256& hashBlock, const uint256& hashTx);
@@ -873,6 +909,9 @@ public:
         nRelockTime = 0;
         fAbortRescan = false;
         fScanningWallet = false;
+        nScanningStartTime = 0;
+        dScanningProgress = 0;
+        nScanningBlocks = 0;
         fAnonymizableTallyCached = false;
         fAnonymizableTallyCachedNonDenom = false;
         vecAnonymizableTallyCached.clear();
@@ -997,6 +1036,9 @@ public:
     void AbortRescan() { fAbortRescan = true; }
     bool IsAbortingRescan() { return fAbortRescan; }
     bool IsScanning() { return fScanningWallet; }
+    int64_t ScanningDuration() const { return fScanningWallet ? GetTimeMillis() - nScanningStartTime : 0; }
+    double ScanningProgress() const { return fScanningWallet ? (double)dScanningProgress : 0; }
+    int ScanningBlocks() const { return fScanningWallet ? (int)nScanningBlocks : 0; }
 
     /**
      * keystore implementation
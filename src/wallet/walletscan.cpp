@@ -0,0 +1,205 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "wallet/walletscan.h"
+
+#include "chain.h"
+#include "pubkey.h"
+#include "util.h"
+#include "validation.h"
+
+void CWalletScanFilter::AddKey(const CKeyID& keyid)
+{
+    setKeys.insert(keyid);
+}
+
+void CWalletScanFilter::AddScript(const CScriptID& scriptid)
+{
+    setScripts.insert(scriptid);
+}
+
+void CWalletScanFilter::AddWatchOnly(const CScript& script)
+{
+    setWatchOnly.insert(script);
+}
+
+void CWalletScanFilter::AddTx(const CTransaction& tx)
+{
+    setTxids.insert(tx.GetHash());
+    for (const CTxIn& txin : tx.vin) {
+        setSpent.insert(txin.prevout);
+    }
+}
+
+bool CWalletScanFilter::IsRelevant(const CScript& scriptPubKey) const
+{
+    if (!setWatchOnly.empty() && setWatchOnly.count(scriptPubKey)) {
+        return true;
+    }
+
+    std::vector<std::vector<unsigned char>> vSolutions;
+    txnouttype whichType;
+    if (!Solver(scriptPubKey, whichType, vSolutions)) {
+        return false;
+    }
+
+    // Same cases as ::IsMine, but without looking into redeem scripts and
+    // counting partially owned multisig as a match
+    switch (whichType) {
+    case TX_PUBKEY:
+        return HaveKey(CPubKey(vSolutions[0]).GetID());
+    case TX_PUBKEYHASH:
+    case TX_NEW_ASSET:
+    case TX_TRANSFER_ASSET:
+    case TX_REISSUE_ASSET:
+        return HaveKey(uint160(vSolutions[0]));
+    case TX_SCRIPTHASH:
+        return setScripts.count(uint160(vSolutions[0])) != 0;
+    case TX_MULTISIG:
+        for (size_t i = 1; i + 1 < vSolutions.size(); i++) {
+            if (HaveKey(CPubKey(vSolutions[i]).GetID())) {
+                return true;
+            }
+        }
+        return false;
+    default:
+        return false;
+    }
+}
+
+bool CWalletScanFilter::IsRelevant(const CTransaction& tx) const
+{
+    if (setTxids.count(tx.GetHash())) {
+        return true;
+    }
+    for (const CTxIn& txin : tx.vin) {
+        if (setTxids.count(txin.prevout.hash) || setSpent.count(txin.prevout)) {
+            return true;
+        }
+    }
+    if (setKeys.empty() && setScripts.empty() && setWatchOnly.empty()) {
+        return false;
+    }
+    for (const CTxOut& txout : tx.vout) {
+        if (IsRelevant(txout.scriptPubKey)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CWalletScanFilter::IsEmpty() const
+{
+    return setKeys.empty() && setScripts.empty() && setWatchOnly.empty() && setTxids.empty() && setSpent.empty();
+}
+
+void CWalletScanFilter::Clear()
+{
+    setKeys.clear();
+    setScripts.clear();
+    setWatchOnly.clear();
+    setTxids.clear();
+    setSpent.clear();
+}
+
+CWalletScanQueue::CWalletScanQueue(const Consensus::Params& consensusParamsIn, std::shared_ptr<const CWalletScanFilter> filterIn, int nThreads) :
+    consensusParams(consensusParamsIn),
+    nNextWork(0),
+    filter(std::move(filterIn)),
+    fStopping(false)
+{
+    for (int i = 0; i < nThreads; i++) {
+        vThreads.emplace_back(&TraceThread<std::function<void()> >, "rescan", std::function<void()>(std::bind(&CWalletScanQueue::ThreadScan, this)));
+    }
+}
+
+CWalletScanQueue::~CWalletScanQueue()
+{
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        fStopping = true;
+    }
+    condWork.notify_all();
+    for (auto& thread : vThreads) {
+        thread.join();
+    }
+}
+
+void CWalletScanQueue::ThreadScan()
+{
+    while (true) {
+        std::shared_ptr<Slot> slot;
+        std::shared_ptr<const CWalletScanFilter> filterUsed;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condWork.wait(lock, [this] { return fStopping || nNextWork < queueSlots.size(); });
+            if (fStopping) {
+                return;
+            }
+            slot = queueSlots[nNextWork++];
+            filterUsed = filter;
+        }
+
+        Result& result = slot->result;
+        auto pblock = std::make_shared<CBlock>();
+        result.fRead = ReadBlockFromDisk(*pblock, slot->blockPos, result.pindex->GetBlockHash(), consensusParams);
+        if (result.fRead) {
+            for (size_t pos = 0; pos < pblock->vtx.size(); pos++) {
+                if (filterUsed->IsRelevant(*pblock->vtx[pos])) {
+                    result.vMatches.push_back(pos);
+                }
+            }
+            result.pblock = std::move(pblock);
+        }
+        result.filter = std::move(filterUsed);
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            slot->fDone = true;
+        }
+        condDone.notify_all();
+    }
+}
+
+void CWalletScanQueue::Push(CBlockIndex* pindex)
+{
+    AssertLockHeld(cs_main);
+
+    auto slot = std::make_shared<Slot>();
+    slot->result.pindex = pindex;
+    slot->blockPos = pindex->GetBlockPos();
+    slot->result.fRead = false;
+    slot->fDone = false;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        queueSlots.push_back(std::move(slot));
+    }
+    condWork.notify_one();
+}
+
+bool CWalletScanQueue::Pop(Result& result)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    if (queueSlots.empty()) {
+        return false;
+    }
+    std::shared_ptr<Slot> slot = queueSlots.front();
+    condDone.wait(lock, [&slot] { return slot->fDone; });
+    result = std::move(slot->result);
+    queueSlots.pop_front();
+    nNextWork--;
+    return true;
+}
+
+size_t CWalletScanQueue::Size()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    return queueSlots.size();
+}
+
+void CWalletScanQueue::SetFilter(std::shared_ptr<const CWalletScanFilter> filterIn)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    filter = std::move(filterIn);
+}
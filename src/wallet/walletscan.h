@@ -0,0 +1,128 @@
+// Copyright (c) 2022 The Yerbas developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef YERB_WALLET_WALLETSCAN_H
+#define YERB_WALLET_WALLETSCAN_H
+
+#include "chain.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "primitives/transaction.h"
+#include "saltedhasher.h"
+#include "script/standard.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+class CKeyID;
+
+namespace Consensus { struct Params; }
+
+/** Maximum number of threads reading and matching blocks during a rescan */
+static const int MAX_RESCAN_THREADS = 8;
+/** Blocks read ahead of the one being added to the wallet during a rescan */
+static const int RESCAN_READ_AHEAD = 64;
+
+/**
+ * Snapshot of what makes a transaction relevant to a wallet: its keys,
+ * redeem scripts, watch-only scripts, transactions and spent outpoints.
+ *
+ * IsRelevant() matches a superset of what CWallet::AddToWalletIfInvolvingMe
+ * picks up, without taking any wallet lock, so blocks can be matched against
+ * it in parallel and only the hits need the wallet.
+ */
+class CWalletScanFilter
+{
+private:
+    struct IdHasher
+    {
+        size_t operator()(const uint160& id) const { return id.GetUint64(0) ^ id.GetUint64(1); }
+    };
+
+    std::unordered_set<uint160, IdHasher> setKeys;
+    std::unordered_set<uint160, IdHasher> setScripts;
+    std::set<CScript> setWatchOnly;
+    std::unordered_set<uint256, StaticSaltedHasher> setTxids;
+    std::unordered_set<COutPoint, SaltedOutpointHasher> setSpent;
+
+    bool HaveKey(const uint160& keyid) const { return setKeys.count(keyid) != 0; }
+
+public:
+    void AddKey(const CKeyID& keyid);
+    void AddScript(const CScriptID& scriptid);
+    void AddWatchOnly(const CScript& script);
+    /** Add a wallet transaction, its outputs and the outpoints it spends */
+    void AddTx(const CTransaction& tx);
+
+    bool IsRelevant(const CScript& scriptPubKey) const;
+    bool IsRelevant(const CTransaction& tx) const;
+
+    bool IsEmpty() const;
+    void Clear();
+};
+
+/**
+ * Read-ahead stage of the wallet rescan.
+ *
+ * Worker threads read the pushed blocks from disk and match their
+ * transactions against the current filter, while the caller takes the
+ * results in the order the blocks were pushed.
+ */
+class CWalletScanQueue
+{
+public:
+    struct Result
+    {
+        CBlockIndex* pindex;
+        bool fRead;
+        std::shared_ptr<const CBlock> pblock;
+        /** Positions of the transactions matching filter */
+        std::vector<uint32_t> vMatches;
+        std::shared_ptr<const CWalletScanFilter> filter;
+    };
+
+private:
+    struct Slot
+    {
+        Result result;
+        /** Copied from result.pindex under cs_main, for the workers to read the block without it */
+        CDiskBlockPos blockPos;
+        bool fDone;
+    };
+
+    const Consensus::Params& consensusParams;
+
+    std::mutex mutex;
+    std::condition_variable condWork;
+    std::condition_variable condDone;
+    std::deque<std::shared_ptr<Slot>> queueSlots;
+    /** First slot no worker has picked up yet */
+    size_t nNextWork;
+    std::shared_ptr<const CWalletScanFilter> filter;
+    bool fStopping;
+    std::vector<std::thread> vThreads;
+
+    void ThreadScan();
+
+public:
+    CWalletScanQueue(const Consensus::Params& consensusParamsIn, std::shared_ptr<const CWalletScanFilter> filterIn, int nThreads);
+    ~CWalletScanQueue();
+
+    /** Queue a block of the active chain, requires cs_main */
+    void Push(CBlockIndex* pindex);
+    /** Wait for the oldest pushed block, returns false when there is none */
+    bool Pop(Result& result);
+    size_t Size();
+
+    /** Match the blocks picked up from now on against filterIn */
+    void SetFilter(std::shared_ptr<const CWalletScanFilter> filterIn);
+};
+
+#endif // YERB_WALLET_WALLETSCAN_H
@@ -35,15 +35,16 @@ class SpentIndexTest(BitcoinTestFramework):
         self.sync_all()
 
     def run_test(self):
-        self.log.info("Test that settings can't be changed without -reindex...")
+        self.log.info("Test that settings can be changed without -reindex...")
         self.stop_node(1)
-        self.nodes[1].assert_start_raises_init_error(["-spentindex=0"], "You need to rebuild the database using -reindex to change -spentindex", partial_match=True)
-        self.start_node(1, ["-spentindex=0", "-reindex"])
+        self.start_node(1, ["-spentindex=0"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
+        assert_equal(self.nodes[1].getindexinfo()["spentindex"], False)
         self.stop_node(1)
-        self.nodes[1].assert_start_raises_init_error(["-spentindex"], "You need to rebuild the database using -reindex to change -spentindex", partial_match=True)
-        self.start_node(1, ["-spentindex", "-reindex"])
+        self.start_node(1, ["-spentindex"])
+        wait_until(lambda: self.nodes[1].getindexinfo()["synced"])
+        assert_equal(self.nodes[1].getindexinfo()["best_block_height"], self.nodes[1].getblockcount())
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
 
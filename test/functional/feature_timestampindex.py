@@ -33,15 +33,16 @@ class TimestampIndexTest(BitcoinTestFramework):
         self.sync_all()
 
     def run_test(self):
-        self.log.info("Test that settings can't be changed without -reindex...")
+        self.log.info("Test that settings can be changed without -reindex...")
         self.stop_node(1)
-        self.nodes[1].assert_start_raises_init_error(["-timestampindex=0"], "You need to rebuild the database using -reindex to change -timestampindex", partial_match=True)
-        self.start_node(1, ["-timestampindex=0", "-reindex"])
+        self.start_node(1, ["-timestampindex=0"])
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
+        assert_equal(self.nodes[1].getindexinfo()["timestampindex"], False)
         self.stop_node(1)
-        self.nodes[1].assert_start_raises_init_error(["-timestampindex"], "You need to rebuild the database using -reindex to change -timestampindex", partial_match=True)
-        self.start_node(1, ["-timestampindex", "-reindex"])
+        self.start_node(1, ["-timestampindex"])
+        wait_until(lambda: self.nodes[1].getindexinfo()["synced"])
+        assert_equal(self.nodes[1].getindexinfo()["best_block_height"], self.nodes[1].getblockcount())
         connect_nodes(self.nodes[0], 1)
         self.sync_all()
 
@@ -0,0 +1,132 @@
+#!/usr/bin/env python3
+# Copyright (c) 2022 The Yerbas developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the Stratum v1 server
+
+- subscribe and authorize, receive the difficulty and a job
+- rejected, duplicate and invalid shares
+- a share meeting the block target is submitted as block
+- a new tip pushes a clean job and makes the old ones stale"""
+
+import json
+import socket
+
+from test_framework.test_framework import BitcoinTestFramework
+from test_framework.util import assert_equal, p2p_port, wait_until
+
+class StratumClient():
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=30)
+        self.file = self.sock.makefile("r")
+        self.next_id = 1
+        self.notifications = []
+
+    def close(self):
+        self.file.close()
+        self.sock.close()
+
+    def send(self, method, params):
+        msg_id = self.next_id
+        self.next_id += 1
+        self.sock.sendall((json.dumps({"id": msg_id, "method": method, "params": params}) + "\n").encode())
+        return msg_id
+
+    def read(self):
+        return json.loads(self.file.readline())
+
+    def call(self, method, params):
+        """Return the result and the error of a request, keeping the notifications received in between"""
+        msg_id = self.send(method, params)
+        while True:
+            msg = self.read()
+            if msg["id"] == msg_id:
+                return msg["result"], msg["error"]
+            self.notifications.append(msg)
+
+    def wait_notification(self, method):
+        while True:
+            msg = self.notifications.pop(0) if self.notifications else self.read()
+            if msg.get("method") == method:
+                return msg["params"]
+
+def prevhash_to_hex(prevhash):
+    """The previous block hash is sent as 32 bit words with their bytes swapped"""
+    data = bytes.fromhex(prevhash)
+    data = b"".join(data[i:i + 4][::-1] for i in range(0, len(data), 4))
+    return data[::-1].hex()
+
+class StratumTest(BitcoinTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        node.generate(1)
+        address = node.getnewaddress()
+        port = p2p_port(self.num_nodes)
+        # the share difficulty is about 20 times the regtest block difficulty, so every accepted share is a block
+        self.restart_node(0, ["-stratumbind=127.0.0.1:%d" % port, "-stratumaddress=%s" % address, "-stratumdifficulty=0.00000001"])
+
+        self.log.info("Subscribe and authorize")
+        client = StratumClient(port)
+        result, error = client.call("mining.subscribe", ["test/1.0"])
+        assert_equal(error, None)
+        assert_equal(len(result[1]), 8)
+        assert_equal(result[2], 4)
+        result, error = client.call("mining.authorize", ["worker", "x"])
+        assert_equal(result, True)
+        assert_equal(client.wait_notification("mining.set_difficulty"), [0.00000001])
+
+        job = client.wait_notification("mining.notify")
+        job_id, ntime = job[0], job[7]
+        assert_equal(prevhash_to_hex(job[1]), node.getbestblockhash())
+        assert_equal(job[6], node.getblocktemplate()["bits"])
+        assert_equal(job[8], True)
+
+        self.log.info("Invalid shares")
+        result, error = client.call("mining.submit", ["worker", "ffffffff", "00000000", ntime, "00000000"])
+        assert_equal(error[0], 21)
+        result, error = client.call("mining.submit", ["worker", job_id, "00", ntime, "00000000"])
+        assert_equal(error[0], 20)
+        result, error = client.call("mining.submit", ["worker", job_id, "00000000", "00000000", "00000000"])
+        assert_equal(error[0], 20)
+
+        self.log.info("Submit shares until one was rejected and one is a block")
+        low_nonce = None
+        for nonce in range(10000):
+            height = node.getblockcount()
+            result, error = client.call("mining.submit", ["worker", job_id, "00000000", ntime, "%08x" % nonce])
+            if result:
+                wait_until(lambda: node.getblockcount() == height + 1, timeout=10)
+                if low_nonce is not None:
+                    break
+                # a block before any rejected share, go on with the job on top of it
+                job = client.wait_notification("mining.notify")
+                job_id, ntime = job[0], job[7]
+                continue
+            assert_equal(error[0], 23)
+            if low_nonce is None:
+                low_nonce = nonce
+                result, error = client.call("mining.submit", ["worker", job_id, "00000000", ntime, "%08x" % nonce])
+                assert_equal(error[0], 22)
+        assert result
+        assert low_nonce is not None
+        block = node.getblock(node.getbestblockhash(), 2)
+        assert_equal(block["tx"][0]["vout"][0]["scriptPubKey"]["addresses"], [address])
+        assert_equal(block["time"], int(ntime, 16))
+
+        self.log.info("A new tip pushes a clean job")
+        job = client.wait_notification("mining.notify")
+        assert_equal(prevhash_to_hex(job[1]), node.getbestblockhash())
+        assert_equal(job[8], True)
+        result, error = client.call("mining.submit", ["worker", job_id, "00000000", ntime, "%08x" % nonce])
+        assert_equal(error[0], 21)
+
+        node.generate(1)
+        job = client.wait_notification("mining.notify")
+        assert_equal(prevhash_to_hex(job[1]), node.getbestblockhash())
+        client.close()
+
+if __name__ == '__main__':
+    StratumTest().main()
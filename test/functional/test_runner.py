@@ -111,6 +111,7 @@ BASE_SCRIPTS= [
     'mempool_persist.py',
     'wallet_multiwallet.py',
     'interface_http.py',
+    'interface_stratum.py',
     'rpc_users.py',
     'feature_proxy.py',
     'rpc_signrawtransaction.py',